@@ -0,0 +1,40 @@
+/*
+ * Copyright 2019 Saman Ashkiani
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "slab_hash/backend.h"
+
+/*
+ * Default hash function:
+ * It treat any kind of input as a concatenation of ints.
+ */
+template <typename Key>
+struct hash {
+    __device__ __host__ uint64_t operator()(const Key& key) const {
+        uint64_t hash = UINT64_C(14695981039346656037);
+
+        const int chunks = sizeof(Key) / sizeof(int);
+        for (size_t i = 0; i < chunks; ++i) {
+            hash ^= ((int32_t*)(&key))[i];
+            hash *= UINT64_C(1099511628211);
+        }
+        return hash;
+    }
+};
@@ -0,0 +1,407 @@
+/*
+ * Copyright 2019 Saman Ashkiani
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Compile-time backend selection.
+ * - default: CUDA, all the kernels run on the device;
+ * - SLABHASH_BACKEND_CPU: the same slab layout and allocators live in host
+ *   memory, and the batched operations run on host threads, one key per
+ *   thread at a time;
+ * - SLABHASH_BACKEND_SIMT: as SLABHASH_BACKEND_CPU, but the batched
+ *   operations run the CUDA kernels unmodified on emulated warps (simt.h).
+ *
+ * Everything that differs between the backends (memory management,
+ * atomics, timing, launching) is wrapped here, so that the data structures
+ * themselves are written once.
+ */
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(SLABHASH_BACKEND_SIMT) && !defined(SLABHASH_BACKEND_CPU)
+#define SLABHASH_BACKEND_CPU
+#endif
+
+#ifdef SLABHASH_BACKEND_CPU
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+
+#include "thread_pool.h"
+
+/* CUDA qualifiers are meaningless on host: every function is a host function */
+#define __host__
+#define __device__
+#define __global__
+#define __forceinline__ inline
+
+template <typename T1, typename T2>
+using pair_t = std::pair<T1, T2>;
+
+/* Optional per-thread CAS counters, used to profile contention (simt.h) */
+struct CASCounters {
+    uint64_t num_cas = 0;
+    uint64_t num_cas_failures = 0;
+};
+
+inline CASCounters*& ThreadCASCounters() {
+    static thread_local CASCounters* counters = nullptr;
+    return counters;
+}
+
+/**
+ * Host atomics.
+ * They share the names and semantics of the CUDA intrinsics, so that the
+ * allocators can be written once. Slabs and heaps are plain uint32_t/int
+ * arrays, so we view them as std::atomic in place.
+ */
+template <typename T>
+inline std::atomic<T>* as_atomic(T* address) {
+    static_assert(sizeof(std::atomic<T>) == sizeof(T),
+                  "std::atomic<T> must be layout compatible with T");
+    return reinterpret_cast<std::atomic<T>*>(address);
+}
+
+template <typename T>
+inline T AtomicCASImpl(T* address, T compare, T val) {
+    bool success = as_atomic(address)->compare_exchange_strong(compare, val);
+    if (CASCounters* counters = ThreadCASCounters()) {
+        counters->num_cas++;
+        counters->num_cas_failures += !success;
+    }
+    return compare;
+}
+
+inline unsigned int atomicCAS(unsigned int* address,
+                              unsigned int compare,
+                              unsigned int val) {
+    return AtomicCASImpl(address, compare, val);
+}
+
+inline int atomicCAS(int* address, int compare, int val) {
+    return AtomicCASImpl(address, compare, val);
+}
+
+inline unsigned long long atomicCAS(unsigned long long* address,
+                                    unsigned long long compare,
+                                    unsigned long long val) {
+    return AtomicCASImpl(address, compare, val);
+}
+
+inline int atomicAdd(int* address, int val) {
+    return as_atomic(address)->fetch_add(val);
+}
+
+inline unsigned int atomicAdd(unsigned int* address, unsigned int val) {
+    return as_atomic(address)->fetch_add(val);
+}
+
+/* Read-modify-write without a native std::atomic operation */
+template <typename T, typename Op>
+inline T AtomicUpdateImpl(T* address, Op op) {
+    std::atomic<T>* atomic = as_atomic(address);
+    T old = atomic->load(std::memory_order_relaxed);
+    while (!atomic->compare_exchange_weak(old, op(old))) {
+    }
+    return old;
+}
+
+inline unsigned long long atomicAdd(unsigned long long* address,
+                                    unsigned long long val) {
+    return as_atomic(address)->fetch_add(val);
+}
+
+inline float atomicAdd(float* address, float val) {
+    return AtomicUpdateImpl(address, [val](float old) { return old + val; });
+}
+
+inline double atomicAdd(double* address, double val) {
+    return AtomicUpdateImpl(address, [val](double old) { return old + val; });
+}
+
+template <typename T>
+inline T AtomicMinImpl(T* address, T val) {
+    return AtomicUpdateImpl(address,
+                            [val](T old) { return val < old ? val : old; });
+}
+
+template <typename T>
+inline T AtomicMaxImpl(T* address, T val) {
+    return AtomicUpdateImpl(address,
+                            [val](T old) { return val > old ? val : old; });
+}
+
+inline int atomicMin(int* address, int val) {
+    return AtomicMinImpl(address, val);
+}
+
+inline unsigned int atomicMin(unsigned int* address, unsigned int val) {
+    return AtomicMinImpl(address, val);
+}
+
+inline unsigned long long atomicMin(unsigned long long* address,
+                                    unsigned long long val) {
+    return AtomicMinImpl(address, val);
+}
+
+inline int atomicMax(int* address, int val) {
+    return AtomicMaxImpl(address, val);
+}
+
+inline unsigned int atomicMax(unsigned int* address, unsigned int val) {
+    return AtomicMaxImpl(address, val);
+}
+
+inline unsigned long long atomicMax(unsigned long long* address,
+                                    unsigned long long val) {
+    return AtomicMaxImpl(address, val);
+}
+
+inline int atomicSub(int* address, int val) {
+    return as_atomic(address)->fetch_sub(val);
+}
+
+inline unsigned int atomicSub(unsigned int* address, unsigned int val) {
+    return as_atomic(address)->fetch_sub(val);
+}
+
+inline unsigned int atomicAnd(unsigned int* address, unsigned int val) {
+    return as_atomic(address)->fetch_and(val);
+}
+
+inline unsigned int atomicExch(unsigned int* address, unsigned int val) {
+    return as_atomic(address)->exchange(val);
+}
+
+inline void __threadfence() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+/* Reads a slab word that other host threads may CAS concurrently */
+inline uint32_t AtomicLoad(const uint32_t* address) {
+    return as_atomic(const_cast<uint32_t*>(address))
+            ->load(std::memory_order_acquire);
+}
+
+/** Memory management **/
+template <typename T>
+inline void BackendMalloc(T** ptr, size_t bytes) {
+    *ptr = static_cast<T*>(std::malloc(bytes));
+    if (*ptr == nullptr && bytes > 0) {
+        printf("Host allocation of %zu bytes failed at %s %d\n", bytes,
+               __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+}
+
+inline void BackendFree(void* ptr) { std::free(ptr); }
+
+/* Host memory the backend copies from and to asynchronously */
+template <typename T>
+inline void BackendMallocHost(T** ptr, size_t bytes) {
+    BackendMalloc(ptr, bytes);
+}
+
+inline void BackendFreeHost(void* ptr) { std::free(ptr); }
+
+inline void BackendMemset(void* ptr, int value, size_t bytes) {
+    std::memset(ptr, value, bytes);
+}
+
+/* Direction agnostic: every buffer is host memory */
+inline void BackendMemcpy(void* dst, const void* src, size_t bytes) {
+    std::memcpy(dst, src, bytes);
+}
+
+inline void BackendSetDevice(uint32_t /*device_idx*/) {}
+
+inline void BackendSynchronize() {}
+
+/** Streamed copies: host-device copies that may overlap with the kernels of
+ * the default stream, ordered after the kernels an event marks. The host
+ * backend runs everything in program order, so these copy in place **/
+typedef int BackendStream;
+typedef int BackendEvent;
+
+inline void BackendStreamCreate(BackendStream* /*stream*/) {}
+inline void BackendStreamDestroy(BackendStream /*stream*/) {}
+inline void BackendStreamSynchronize(BackendStream /*stream*/) {}
+
+inline void BackendEventCreate(BackendEvent* /*event*/) {}
+inline void BackendEventDestroy(BackendEvent /*event*/) {}
+/* Marks the work issued so far on the default stream */
+inline void BackendEventRecord(BackendEvent /*event*/) {}
+/* The copies issued next on @stream wait for the work @event marks */
+inline void BackendStreamWaitEvent(BackendStream /*stream*/,
+                                   BackendEvent /*event*/) {}
+
+inline void BackendMemcpyAsync(void* dst,
+                               const void* src,
+                               size_t bytes,
+                               BackendStream /*stream*/) {
+    std::memcpy(dst, src, bytes);
+}
+
+/** Primitives **/
+/* In place exclusive prefix sum of @n counts */
+inline void BackendExclusiveScan(uint32_t* data, uint32_t n) {
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t count = data[i];
+        data[i] = sum;
+        sum += count;
+    }
+}
+
+/** Timing, in ms, to match cudaEventElapsedTime. Stop is Mark, which ends
+ * the interval without waiting for it, then Elapsed **/
+class BackendTimer {
+public:
+    void Start() { start_ = std::chrono::high_resolution_clock::now(); }
+    void Mark() { stop_ = std::chrono::high_resolution_clock::now(); }
+    float Elapsed() {
+        return std::chrono::duration<float, std::milli>(stop_ - start_)
+                .count();
+    }
+    float Stop() {
+        Mark();
+        return Elapsed();
+    }
+
+private:
+    std::chrono::high_resolution_clock::time_point start_;
+    std::chrono::high_resolution_clock::time_point stop_;
+};
+
+/** Launching: host kernels go through ParallelFor (thread_pool.h), CUDA
+ * kernels through SimtLaunch **/
+#include "simt.h"
+
+#else /* CUDA */
+#include <thrust/execution_policy.h>
+#include <thrust/pair.h>
+#include <thrust/scan.h>
+#include "../helper_cuda.h"
+
+template <typename T1, typename T2>
+using pair_t = thrust::pair<T1, T2>;
+
+/** Memory management **/
+template <typename T>
+inline void BackendMalloc(T** ptr, size_t bytes) {
+    CHECK_CUDA(cudaMalloc(ptr, bytes));
+}
+
+inline void BackendFree(void* ptr) { CHECK_CUDA(cudaFree(ptr)); }
+
+/* Pinned: copies from pageable memory do not overlap with kernels */
+template <typename T>
+inline void BackendMallocHost(T** ptr, size_t bytes) {
+    CHECK_CUDA(cudaMallocHost(ptr, bytes));
+}
+
+inline void BackendFreeHost(void* ptr) { CHECK_CUDA(cudaFreeHost(ptr)); }
+
+inline void BackendMemset(void* ptr, int value, size_t bytes) {
+    CHECK_CUDA(cudaMemset(ptr, value, bytes));
+}
+
+/* Direction is inferred from unified virtual addressing */
+inline void BackendMemcpy(void* dst, const void* src, size_t bytes) {
+    CHECK_CUDA(cudaMemcpy(dst, src, bytes, cudaMemcpyDefault));
+}
+
+inline void BackendSetDevice(uint32_t device_idx) {
+    CHECK_CUDA(cudaSetDevice(device_idx));
+}
+
+inline void BackendSynchronize() { CHECK_CUDA(cudaDeviceSynchronize()); }
+
+/** Streamed copies: a non-blocking stream, so that its copies overlap with
+ * the kernels of the (legacy) default stream, ordered through events **/
+typedef cudaStream_t BackendStream;
+typedef cudaEvent_t BackendEvent;
+
+inline void BackendStreamCreate(BackendStream* stream) {
+    CHECK_CUDA(cudaStreamCreateWithFlags(stream, cudaStreamNonBlocking));
+}
+inline void BackendStreamDestroy(BackendStream stream) {
+    CHECK_CUDA(cudaStreamDestroy(stream));
+}
+inline void BackendStreamSynchronize(BackendStream stream) {
+    CHECK_CUDA(cudaStreamSynchronize(stream));
+}
+
+inline void BackendEventCreate(BackendEvent* event) {
+    CHECK_CUDA(cudaEventCreateWithFlags(event, cudaEventDisableTiming));
+}
+inline void BackendEventDestroy(BackendEvent event) {
+    CHECK_CUDA(cudaEventDestroy(event));
+}
+inline void BackendEventRecord(BackendEvent event) {
+    CHECK_CUDA(cudaEventRecord(event, 0));
+}
+inline void BackendStreamWaitEvent(BackendStream stream, BackendEvent event) {
+    CHECK_CUDA(cudaStreamWaitEvent(stream, event, 0));
+}
+
+inline void BackendMemcpyAsync(void* dst,
+                               const void* src,
+                               size_t bytes,
+                               BackendStream stream) {
+    CHECK_CUDA(cudaMemcpyAsync(dst, src, bytes, cudaMemcpyDefault, stream));
+}
+
+/** Primitives **/
+inline void BackendExclusiveScan(uint32_t* data, uint32_t n) {
+    thrust::exclusive_scan(thrust::device, data, data + n, data);
+}
+
+/** Timing on the default stream **/
+class BackendTimer {
+public:
+    BackendTimer() {
+        CHECK_CUDA(cudaEventCreate(&start_));
+        CHECK_CUDA(cudaEventCreate(&stop_));
+    }
+    ~BackendTimer() {
+        CHECK_CUDA(cudaEventDestroy(start_));
+        CHECK_CUDA(cudaEventDestroy(stop_));
+    }
+
+    void Start() { CHECK_CUDA(cudaEventRecord(start_, 0)); }
+    void Mark() { CHECK_CUDA(cudaEventRecord(stop_, 0)); }
+    float Elapsed() {
+        float time;
+        CHECK_CUDA(cudaEventSynchronize(stop_));
+        CHECK_CUDA(cudaEventElapsedTime(&time, start_, stop_));
+        return time;
+    }
+    float Stop() {
+        Mark();
+        return Elapsed();
+    }
+
+private:
+    cudaEvent_t start_;
+    cudaEvent_t stop_;
+};
+#endif
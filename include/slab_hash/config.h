@@ -24,9 +24,28 @@ static constexpr uint32_t EMPTY_SLAB_PTR = 0xFFFFFFFF;
 static constexpr uint32_t EMPTY_PAIR_PTR = 0xFFFFFFFF;
 static constexpr uint32_t HEAD_SLAB_PTR = 0xFFFFFFFE;
 
+/** Fingerprints: optional hash bits in the high bits of the pair pointers **/
+static constexpr uint32_t MAX_FINGERPRINT_BITS = 8;
+
+/** Inline pairs: keys in the even lanes, values in the odd lanes **/
+static constexpr uint32_t EMPTY_KEY = 0xFFFFFFFF;
+static constexpr uint64_t EMPTY_PAIR_64 = 0xFFFFFFFFFFFFFFFF;
+static constexpr uint32_t INLINE_PAIRS_PER_SLAB = 15;
+/* lanes 0, 2, ..., 28 */
+static constexpr uint32_t INLINE_KEY_LANES_MASK = 0x15555555;
+
 /** Queries **/
 static constexpr uint32_t SEARCH_NOT_FOUND = 0xFFFFFFFF;
 
+/** Pair pool: values are stored in chunks of at least 2^10 **/
+static constexpr int MIN_LOG_CHUNK_SIZE = 10;
+
+/** Per key status of the inserting operations **/
+static constexpr uint8_t STATUS_SUCCESS = 0;
+static constexpr uint8_t STATUS_OUT_OF_CAPACITY = 1;
+/* inline layout: EMPTY_KEY marks the empty slots and cannot be stored */
+static constexpr uint8_t STATUS_RESERVED_KEY = 2;
+
 /** Warp operations **/
 static constexpr uint32_t WARP_WIDTH = 32;
 static constexpr uint32_t BLOCKSIZE_ = 128;
@@ -43,3 +62,5 @@ using addr_t = uint32_t;
 using ptr_t = uint32_t;
 using iterator_t = uint32_t;
 static constexpr uint32_t NULL_ITERATOR = 0xFFFFFFFF;
+/* Returned instead of an iterator when the pair pool is full */
+static constexpr uint32_t OUT_OF_CAPACITY_ITERATOR = 0xFFFFFFFE;
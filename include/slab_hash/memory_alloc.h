@@ -4,7 +4,9 @@
 
 #pragma once
 
+#include <algorithm>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 /**
@@ -15,23 +17,26 @@
  */
 
 #include <assert.h>
-#include "../helper_cuda.h"
+#include <new>
+#include "backend.h"
 #include "config.h"
 
-#define CUDA_DEBUG_ENABLE_ASSERTION_
+/* Define CUDA_DEBUG_ENABLE_ASSERTION to check the pointers */
 template <typename T>
 class MemoryAllocContext {
 public:
-    T *data_;           /* [N] */
+    T **chunks_;        /* [N / chunk size] */
     ptr_t *heap_;       /* [N] */
     int *heap_counter_; /* [1] */
 
 public:
     int max_capacity_;
+    /* The values are stored in chunks of 2^log_chunk_size_ */
+    int log_chunk_size_;
 
 public:
     /**
-     * The @value array's size is FIXED.
+     * The @value chunks never move: the pool grows by adding chunks.
      * The @heap array stores the addresses of the values.
      * Only the unallocated part is maintained.
      * (ONLY care about the heap above the heap counter. Below is meaningless.)
@@ -45,13 +50,22 @@ public:
      *  2                   2                    2 <-                 2    |
      *  1                   1 <-                 1                    0 <- |
      *  0 <- heap_counter   0                    0                    0
+     *
+     * Returns EMPTY_PAIR_PTR when the heap is exhausted. The counter is
+     * bumped with a CAS so that it never exceeds max_capacity_: an
+     * atomicAdd undone afterwards would let a concurrent Free write past
+     * the heap.
      */
     __device__ ptr_t Allocate() {
-        int index = atomicAdd(heap_counter_, 1);
-#ifdef CUDA_DEBUG_ENABLE_ASSERTION
-        assert(index < max_capacity_);
-#endif
-        return heap_[index];
+        int index = *((volatile int *)heap_counter_);
+        while (index < max_capacity_) {
+            int prev = atomicCAS(heap_counter_, index, index + 1);
+            if (prev == index) {
+                return heap_[index];
+            }
+            index = prev;
+        }
+        return EMPTY_PAIR_PTR;
     }
 
     __device__ void Free(ptr_t ptr) {
@@ -64,24 +78,29 @@ public:
 
     __device__ T &extract(ptr_t ptr) {
 #ifdef CUDA_DEBUG_ENABLE_ASSERTION
-        assert(addr < max_capacity_);
+        assert(ptr < ptr_t(max_capacity_));
 #endif
-        return data_[ptr];
+        return chunks_[ptr >> log_chunk_size_]
+                      [ptr & ((1u << log_chunk_size_) - 1)];
     }
 
     __device__ const T &extract(ptr_t ptr) const {
 #ifdef CUDA_DEBUG_ENABLE_ASSERTION
-        assert(addr < max_capacity_);
+        assert(ptr < ptr_t(max_capacity_));
 #endif
-        return data_[ptr];
+        return chunks_[ptr >> log_chunk_size_]
+                      [ptr & ((1u << log_chunk_size_) - 1)];
     }
 };
 
+/* Initialize the values and the heap entries in [begin, end) */
 template <typename T>
-__global__ void ResetMemoryAllocKernel(MemoryAllocContext<T> ctx) {
-    const int i = blockIdx.x * blockDim.x + threadIdx.x;
-    if (i < ctx.max_capacity_) {
-        ctx.data_[i] = T(); /* This is not required. */
+__global__ void ResetMemoryAllocKernel(MemoryAllocContext<T> ctx,
+                                       int begin,
+                                       int end) {
+    const int i = begin + blockIdx.x * blockDim.x + threadIdx.x;
+    if (i < end) {
+        ctx.extract(i) = T(); /* This is not required. */
         ctx.heap_[i] = i;
     }
 }
@@ -94,54 +113,140 @@ public:
 
 public:
     MemoryAlloc(int max_capacity) {
+        max_capacity_ = 0;
+        committed_ = 0;
+        in_flight_ = 0;
+        gpu_context_.max_capacity_ = 0;
+        gpu_context_.chunks_ = nullptr;
+        gpu_context_.heap_ = nullptr;
+
+        /* Chunks of 1/16 to 1/8 of the initial capacity: a pool grown by
+         * Reserve is at most a chunk larger than requested */
+        int log_chunk_size = MIN_LOG_CHUNK_SIZE;
+        while (log_chunk_size < 30 &&
+               (size_t(1) << (log_chunk_size + 4)) <= size_t(max_capacity)) {
+            ++log_chunk_size;
+        }
+        gpu_context_.log_chunk_size_ = log_chunk_size;
+
+        BackendMalloc(&(gpu_context_.heap_counter_), sizeof(int));
+        int heap_counter = 0;
+        BackendMemcpy(gpu_context_.heap_counter_, &heap_counter, sizeof(int));
+
+        Reserve(max_capacity);
+    }
+
+    ~MemoryAlloc() {
+        BackendFree(gpu_context_.heap_counter_);
+        BackendFree(gpu_context_.heap_);
+        BackendFree(gpu_context_.chunks_);
+        for (T *chunk : chunks_) {
+            BackendFree(chunk);
+        }
+    }
+
+    /* Grow the pool to @max_capacity values. Chunks are appended and the
+     * heap extended: the allocated values stay in place, so their pointers
+     * remain valid. The new entries are initialized by Commit. Must not
+     * overlap with a kernel using gpu_context_, which has to be copied
+     * again afterwards */
+    void Reserve(int max_capacity) {
+        if (max_capacity <= max_capacity_) return;
+
+        const size_t chunk_size = size_t(1) << gpu_context_.log_chunk_size_;
+        while (chunks_.size() * chunk_size < size_t(max_capacity)) {
+            T *chunk;
+            BackendMalloc(&chunk, sizeof(T) * chunk_size);
+            chunks_.push_back(chunk);
+        }
+        BackendFree(gpu_context_.chunks_);
+        BackendMalloc(&(gpu_context_.chunks_), sizeof(T *) * chunks_.size());
+        BackendMemcpy(gpu_context_.chunks_, chunks_.data(),
+                      sizeof(T *) * chunks_.size());
+
+        /* The free entries above the counter are kept, the new ones go on
+         * top of them */
+        ptr_t *heap;
+        BackendMalloc(&heap, sizeof(ptr_t) * max_capacity);
+        if (committed_ > 0) {
+            BackendMemcpy(heap, gpu_context_.heap_,
+                          sizeof(ptr_t) * committed_);
+        }
+        BackendFree(gpu_context_.heap_);
+        gpu_context_.heap_ = heap;
+
         max_capacity_ = max_capacity;
         gpu_context_.max_capacity_ = max_capacity;
-        CHECK_CUDA(cudaMalloc(&(gpu_context_.heap_counter_), sizeof(int)));
-        CHECK_CUDA(
-                cudaMalloc(&(gpu_context_.heap_), sizeof(int) * max_capacity_));
-        CHECK_CUDA(
-                cudaMalloc(&(gpu_context_.data_), sizeof(T) * max_capacity_));
+    }
 
-        const int blocks = (max_capacity_ + 128 - 1) / 128;
+    /* Initialize the heap entries (and values) for @num_values more
+     * allocations, before a kernel that allocates at most @num_values, and
+     * Release them once it is done. The heap counter cannot exceed its
+     * current value plus the allocations of the kernels in flight, so the
+     * entries above are never read: a new pool costs nothing until it is
+     * filled, and one whose pairs are freed again is not initialized any
+     * further. Serialized with the batches of concurrent sessions */
+    void Commit(int num_values) {
+        std::lock_guard<std::mutex> lock(commit_mutex_);
+        in_flight_ += num_values;
+        const int begin = committed_;
+        const int end = int(std::min<int64_t>(
+                int64_t(heap_counter()) + in_flight_, max_capacity_));
+        if (end <= begin) return;
+        committed_ = end;
+
+#ifdef SLABHASH_BACKEND_CPU
+        for (int i = begin; i < end; ++i) {
+            new (&gpu_context_.extract(i)) T();
+            gpu_context_.heap_[i] = i;
+        }
+#else
+        const int blocks = (end - begin + 128 - 1) / 128;
         const int threads = 128;
 
-        ResetMemoryAllocKernel<<<blocks, threads>>>(gpu_context_);
+        ResetMemoryAllocKernel<<<blocks, threads>>>(gpu_context_, begin, end);
         CHECK_CUDA(cudaDeviceSynchronize());
         CHECK_CUDA(cudaGetLastError());
-
-        int heap_counter = 0;
-        CHECK_CUDA(cudaMemcpy(gpu_context_.heap_counter_, &heap_counter,
-                              sizeof(int), cudaMemcpyHostToDevice));
+#endif
     }
 
-    ~MemoryAlloc() {
-        CHECK_CUDA(cudaFree(gpu_context_.heap_counter_));
-        CHECK_CUDA(cudaFree(gpu_context_.heap_));
-        CHECK_CUDA(cudaFree(gpu_context_.data_));
+    void Release(int num_values) {
+        std::lock_guard<std::mutex> lock(commit_mutex_);
+        in_flight_ -= num_values;
     }
 
     std::vector<int> DownloadHeap() {
         std::vector<int> ret;
         ret.resize(max_capacity_);
-        CHECK_CUDA(cudaMemcpy(ret.data(), gpu_context_.heap_,
-                              sizeof(int) * max_capacity_,
-                              cudaMemcpyDeviceToHost));
+        BackendMemcpy(ret.data(), gpu_context_.heap_,
+                      sizeof(int) * max_capacity_);
         return ret;
     }
 
     std::vector<T> DownloadValue() {
         std::vector<T> ret;
         ret.resize(max_capacity_);
-        CHECK_CUDA(cudaMemcpy(ret.data(), gpu_context_.data_,
-                              sizeof(T) * max_capacity_,
-                              cudaMemcpyDeviceToHost));
+        const int chunk_size = 1 << gpu_context_.log_chunk_size_;
+        for (int i = 0; i * chunk_size < max_capacity_; ++i) {
+            int count = std::min(chunk_size, max_capacity_ - i * chunk_size);
+            BackendMemcpy(ret.data() + i * chunk_size, chunks_[i],
+                          sizeof(T) * count);
+        }
         return ret;
     }
 
     int heap_counter() {
         int heap_counter;
-        CHECK_CUDA(cudaMemcpy(&heap_counter, gpu_context_.heap_counter_,
-                              sizeof(int), cudaMemcpyDeviceToHost));
+        BackendMemcpy(&heap_counter, gpu_context_.heap_counter_, sizeof(int));
         return heap_counter;
     }
+
+private:
+    /* Host copy of gpu_context_.chunks_ */
+    std::vector<T *> chunks_;
+    /* The heap entries below are initialized, see Commit */
+    int committed_;
+    /* Allocations of the committed kernels not yet released */
+    int64_t in_flight_;
+    std::mutex commit_mutex_;
 };
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2019 Saman Ashkiani
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Reduction functors for SlabHash::InsertOrReduce.
+ * A functor is called as reduce(&stored_value, value) when the key already
+ * exists, and must combine value into stored_value atomically: other lanes
+ * of the same batch may hold the same key. The new value is stored as is
+ * when the key is inserted.
+ *
+ * ReduceAdd/Min/Max map to the atomic intrinsics, and are available for the
+ * types these support (e.g. no atomicMin on float). ReduceCAS wraps any
+ * binary operator on a 32 or 64-bit value in a CAS loop.
+ */
+
+#include <cstring>
+#include <type_traits>
+
+#include "backend.h"
+
+/* Keeps the stored value: InsertOrReduce then behaves as an Insert that
+ * only allocates a pair when the key is new */
+template <typename _Value>
+struct ReduceKeep {
+    __device__ __host__ void operator()(_Value* /*stored*/,
+                                        const _Value& /*value*/) const {}
+};
+
+template <typename _Value>
+struct ReduceAdd {
+    __device__ __host__ void operator()(_Value* stored,
+                                        const _Value& value) const {
+        atomicAdd(stored, value);
+    }
+};
+
+template <typename _Value>
+struct ReduceMin {
+    __device__ __host__ void operator()(_Value* stored,
+                                        const _Value& value) const {
+        atomicMin(stored, value);
+    }
+};
+
+template <typename _Value>
+struct ReduceMax {
+    __device__ __host__ void operator()(_Value* stored,
+                                        const _Value& value) const {
+        atomicMax(stored, value);
+    }
+};
+
+/* _Op: _Value operator()(const _Value& stored, const _Value& value) */
+template <typename _Value, typename _Op>
+struct ReduceCAS {
+    static_assert(sizeof(_Value) == 4 || sizeof(_Value) == 8,
+                  "ReduceCAS only supports 32 and 64-bit values");
+    using word_t = typename std::conditional<sizeof(_Value) == 4,
+                                             unsigned int,
+                                             unsigned long long>::type;
+
+    _Op op;
+
+    ReduceCAS(const _Op& op = _Op()) : op(op) {}
+
+    __device__ __host__ void operator()(_Value* stored,
+                                        const _Value& value) const {
+        word_t* address = reinterpret_cast<word_t*>(stored);
+        word_t old_bits = *reinterpret_cast<volatile word_t*>(address);
+        word_t assumed_bits;
+        do {
+            assumed_bits = old_bits;
+            _Value old_value;
+            memcpy(&old_value, &assumed_bits, sizeof(_Value));
+            _Value new_value = op(old_value, value);
+            word_t new_bits;
+            memcpy(&new_bits, &new_value, sizeof(_Value));
+            old_bits = atomicCAS(address, assumed_bits, new_bits);
+        } while (old_bits != assumed_bits);
+    }
+};
@@ -0,0 +1,414 @@
+/*
+ * Copyright 2019 Saman Ashkiani
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Software SIMT executor for the host backend. Included from backend.h.
+ *
+ * It lets the warp-cooperative kernels compile and run unmodified on the CPU:
+ * - each lane of a warp is a fiber with its own stack;
+ * - a warp-wide intrinsic (__ballot_sync, __shfl_sync) parks the calling lane;
+ *   once every live lane of the warp is parked, the intrinsic is resolved for
+ *   all of them and they are resumed one after another;
+ * - warps are independent (the kernels do not use __syncthreads), so the warps
+ *   of a grid are distributed over the worker threads with ParallelFor.
+ *
+ * Only the x dimension of the grid and of the blocks is supported.
+ * The executor also counts the intrinsics and CASes issued by each warp, to
+ * profile the work queues of the kernels (see SimtStats).
+ */
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#if !defined(__x86_64__)
+#include <ucontext.h>
+#endif
+
+struct dim3 {
+    uint32_t x, y, z;
+    dim3(uint32_t x = 1, uint32_t y = 1, uint32_t z = 1) : x(x), y(y), z(z) {}
+};
+
+/**
+ * Fiber context switch.
+ * On x86-64 only the callee-saved registers are swapped (swapcontext also
+ * saves the signal mask, which costs a syscall per switch and is two orders
+ * of magnitude slower). Elsewhere we fall back to ucontext.
+ */
+#if defined(__x86_64__)
+extern "C" void simt_switch_context(void** from_sp, void* to_sp);
+asm(R"(
+    .text
+    .weak simt_switch_context
+    .type simt_switch_context, @function
+simt_switch_context:
+    pushq %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    movq %rsp, (%rdi)
+    movq %rsi, %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ret
+    .size simt_switch_context, .-simt_switch_context
+)");
+
+struct SimtContext {
+    void* sp;
+};
+
+/* @entry must never return */
+inline void SimtMakeContext(SimtContext* ctx,
+                            char* stack,
+                            size_t stack_size,
+                            void (*entry)()) {
+    uintptr_t top = reinterpret_cast<uintptr_t>(stack + stack_size) &
+                    ~uintptr_t(15);
+    void** sp = reinterpret_cast<void**>(top);
+    *--sp = nullptr;                          /* fake return address */
+    *--sp = reinterpret_cast<void*>(entry);   /* popped by ret */
+    for (int i = 0; i < 6; ++i) *--sp = nullptr; /* callee-saved registers */
+    ctx->sp = sp;
+}
+
+inline void SimtSwapContext(SimtContext* from, SimtContext* to) {
+    simt_switch_context(&from->sp, to->sp);
+}
+#else
+struct SimtContext {
+    ucontext_t uc;
+};
+
+inline void SimtMakeContext(SimtContext* ctx,
+                            char* stack,
+                            size_t stack_size,
+                            void (*entry)()) {
+    getcontext(&ctx->uc);
+    ctx->uc.uc_stack.ss_sp = stack;
+    ctx->uc.uc_stack.ss_size = stack_size;
+    ctx->uc.uc_link = nullptr;
+    makecontext(&ctx->uc, entry, 0);
+}
+
+inline void SimtSwapContext(SimtContext* from, SimtContext* to) {
+    swapcontext(&from->uc, &to->uc);
+}
+#endif
+
+/* Accumulated over all the warps launched since the last SimtResetStats() */
+struct SimtStats {
+    uint64_t num_warps = 0;
+    /* Warp-wide steps: every work-queue iteration issues at least one */
+    uint64_t num_ballots = 0;
+    uint64_t num_shuffles = 0;
+    uint64_t max_ballots_per_warp = 0;
+    /* From CASCounters: CAS attempts, and the ones that lost a race */
+    uint64_t num_cas = 0;
+    uint64_t num_cas_failures = 0;
+
+    void Accumulate(const SimtStats& rhs) {
+        num_warps += rhs.num_warps;
+        num_ballots += rhs.num_ballots;
+        num_shuffles += rhs.num_shuffles;
+        max_ballots_per_warp =
+                std::max(max_ballots_per_warp, rhs.max_ballots_per_warp);
+        num_cas += rhs.num_cas;
+        num_cas_failures += rhs.num_cas_failures;
+    }
+};
+
+class SimtWarp {
+public:
+    static constexpr uint32_t kWarpSize = 32;
+    static constexpr size_t kLaneStackSize = 64 * 1024;
+
+    enum class Op { NONE, BALLOT, SHUFFLE };
+
+    SimtWarp() : kernel_(nullptr), current_lane_id_(0) {
+        for (auto& lane : lanes_) {
+            lane.stack.reset(new char[kLaneStackSize]);
+        }
+    }
+
+    /* One warp object per worker thread, reused by all the launches */
+    static SimtWarp& ForThisThread() {
+        static thread_local std::unique_ptr<SimtWarp> warp(new SimtWarp());
+        return *warp;
+    }
+
+    /* The warp being executed on this thread, nullptr outside a launch */
+    static SimtWarp*& Current() {
+        static thread_local SimtWarp* current = nullptr;
+        return current;
+    }
+
+    const dim3& thread_idx() const { return lanes_[current_lane_id_].thread_idx; }
+    const dim3& block_idx() const { return block_idx_; }
+    const dim3& block_dim() const { return block_dim_; }
+    const dim3& grid_dim() const { return grid_dim_; }
+
+    /* Runs @kernel on the lanes [warp_in_block * 32, +32) of a block */
+    void Run(const std::function<void()>& kernel,
+             const dim3& block_idx,
+             const dim3& block_dim,
+             const dim3& grid_dim,
+             uint32_t warp_in_block,
+             SimtStats& stats) {
+        kernel_ = &kernel;
+        block_idx_ = block_idx;
+        block_dim_ = block_dim;
+        grid_dim_ = grid_dim;
+
+        for (uint32_t lane_id = 0; lane_id < kWarpSize; ++lane_id) {
+            Lane& lane = lanes_[lane_id];
+            uint32_t tid = warp_in_block * kWarpSize + lane_id;
+            lane.thread_idx = dim3(tid);
+            lane.finished = (tid >= block_dim.x);
+            lane.op = Op::NONE;
+            if (!lane.finished) {
+                SimtMakeContext(&lane.context, lane.stack.get(),
+                                kLaneStackSize, &SimtWarp::LaneEntry);
+            }
+        }
+
+        SimtWarp*& current = Current();
+        SimtWarp* prev = current;
+        current = this;
+
+        uint64_t num_ballots = 0;
+        while (true) {
+            /* Run every live lane up to its next intrinsic (or its end) */
+            for (uint32_t lane_id = 0; lane_id < kWarpSize; ++lane_id) {
+                if (lanes_[lane_id].finished) continue;
+                current_lane_id_ = lane_id;
+                SimtSwapContext(&scheduler_, &lanes_[lane_id].context);
+            }
+
+            uint32_t parked = 0;
+            for (uint32_t lane_id = 0; lane_id < kWarpSize; ++lane_id) {
+                if (!lanes_[lane_id].finished) parked |= (1u << lane_id);
+            }
+            if (parked == 0) break;
+
+            Op op = Resolve(parked);
+            if (op == Op::BALLOT) {
+                ++num_ballots;
+            } else {
+                ++stats.num_shuffles;
+            }
+        }
+
+        current = prev;
+
+        stats.num_warps++;
+        stats.num_ballots += num_ballots;
+        stats.max_ballots_per_warp =
+                std::max(stats.max_ballots_per_warp, num_ballots);
+    }
+
+    /* Called by a lane: parks it until the whole warp reaches the intrinsic */
+    uint64_t Exchange(Op op, uint32_t mask, uint64_t value, int src_lane,
+                      int width) {
+        Lane& lane = lanes_[current_lane_id_];
+        lane.op = op;
+        lane.mask = mask;
+        lane.value = value;
+        lane.src_lane = src_lane;
+        lane.width = width;
+        SimtSwapContext(&lane.context, &scheduler_);
+        return lane.result;
+    }
+
+private:
+    struct Lane {
+        SimtContext context;
+        std::unique_ptr<char[]> stack;
+        dim3 thread_idx;
+        bool finished;
+
+        /* Intrinsic the lane is parked at */
+        Op op;
+        uint32_t mask;
+        uint64_t value;
+        int src_lane;
+        int width;
+        uint64_t result;
+    };
+
+    static void LaneEntry() {
+        SimtWarp* warp = Current();
+        (*warp->kernel_)();
+
+        /* Kernel returned: never resumed again */
+        Lane& lane = warp->lanes_[warp->current_lane_id_];
+        lane.finished = true;
+        SimtSwapContext(&lane.context, &warp->scheduler_);
+    }
+
+    Op Resolve(uint32_t parked) {
+        Op op = lanes_[__builtin_ctz(parked)].op;
+        for (uint32_t lane_id = 0; lane_id < kWarpSize; ++lane_id) {
+            if (!(parked & (1u << lane_id))) continue;
+            if (lanes_[lane_id].op != op) {
+                fprintf(stderr,
+                        "SIMT executor: divergent warp-wide intrinsics are "
+                        "not supported\n");
+                abort();
+            }
+        }
+
+        if (op == Op::BALLOT) {
+            uint32_t ballot = 0;
+            for (uint32_t lane_id = 0; lane_id < kWarpSize; ++lane_id) {
+                if ((parked & (1u << lane_id)) && lanes_[lane_id].value) {
+                    ballot |= (1u << lane_id);
+                }
+            }
+            for (uint32_t lane_id = 0; lane_id < kWarpSize; ++lane_id) {
+                lanes_[lane_id].result = ballot & lanes_[lane_id].mask;
+            }
+        } else {
+            for (uint32_t lane_id = 0; lane_id < kWarpSize; ++lane_id) {
+                if (!(parked & (1u << lane_id))) continue;
+                Lane& lane = lanes_[lane_id];
+                uint32_t src_lane = (lane_id & ~(lane.width - 1)) +
+                                    (lane.src_lane & (lane.width - 1));
+                /* Reading from an inactive lane is undefined in CUDA */
+                lane.result = (parked & (1u << src_lane))
+                                      ? lanes_[src_lane].value
+                                      : lane.value;
+            }
+        }
+
+        for (auto& lane : lanes_) {
+            lane.op = Op::NONE;
+        }
+        return op;
+    }
+
+    Lane lanes_[kWarpSize];
+    SimtContext scheduler_;
+
+    const std::function<void()>* kernel_;
+    uint32_t current_lane_id_;
+
+    dim3 block_idx_;
+    dim3 block_dim_;
+    dim3 grid_dim_;
+};
+
+/** Builtin variables **/
+#define threadIdx (SimtWarp::Current()->thread_idx())
+#define blockIdx (SimtWarp::Current()->block_idx())
+#define blockDim (SimtWarp::Current()->block_dim())
+#define gridDim (SimtWarp::Current()->grid_dim())
+
+/** Warp intrinsics **/
+inline unsigned int __ballot_sync(unsigned int mask, int predicate) {
+    assert(SimtWarp::Current() && "__ballot_sync called outside a launch");
+    return SimtWarp::Current()->Exchange(SimtWarp::Op::BALLOT, mask,
+                                         predicate != 0, 0,
+                                         SimtWarp::kWarpSize);
+}
+
+template <typename T>
+inline T __shfl_sync(unsigned int mask,
+                     T var,
+                     int src_lane,
+                     int width = SimtWarp::kWarpSize) {
+    static_assert(sizeof(T) <= sizeof(uint64_t),
+                  "__shfl_sync supports up to 64-bit types");
+    assert(SimtWarp::Current() && "__shfl_sync called outside a launch");
+    uint64_t value = 0;
+    std::memcpy(&value, &var, sizeof(T));
+    value = SimtWarp::Current()->Exchange(SimtWarp::Op::SHUFFLE, mask, value,
+                                          src_lane, width);
+    std::memcpy(&var, &value, sizeof(T));
+    return var;
+}
+
+inline int __ffs(int x) { return __builtin_ffs(x); }
+inline int __popc(unsigned int x) { return __builtin_popcount(x); }
+inline int __clz(int x) { return x ? __builtin_clz(x) : 32; }
+
+/** Statistics **/
+inline SimtStats& SimtGlobalStats() {
+    static SimtStats stats;
+    return stats;
+}
+
+inline std::mutex& SimtGlobalStatsMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+inline void SimtResetStats() {
+    std::lock_guard<std::mutex> lock(SimtGlobalStatsMutex());
+    SimtGlobalStats() = SimtStats();
+}
+
+inline SimtStats SimtGetStats() {
+    std::lock_guard<std::mutex> lock(SimtGlobalStatsMutex());
+    return SimtGlobalStats();
+}
+
+/**
+ * Host counterpart of kernel<<<grid_dim, block_dim>>>(args...).
+ * Like a kernel launch, every lane receives its own copy of @args.
+ */
+template <typename Kernel, typename... Args>
+void SimtLaunch(dim3 grid_dim, dim3 block_dim, Kernel kernel, Args... args) {
+    const std::function<void()> bound = std::bind(kernel, args...);
+
+    const uint32_t warps_per_block =
+            (block_dim.x + SimtWarp::kWarpSize - 1) / SimtWarp::kWarpSize;
+    const uint32_t num_warps = grid_dim.x * warps_per_block;
+
+    ParallelFor(num_warps, [&](uint32_t /*chunk_id*/, uint32_t begin,
+                               uint32_t end) {
+        SimtWarp& warp = SimtWarp::ForThisThread();
+        SimtStats stats;
+
+        CASCounters cas_counters;
+        CASCounters*& thread_cas_counters = ThreadCASCounters();
+        thread_cas_counters = &cas_counters;
+
+        for (uint32_t w = begin; w < end; ++w) {
+            warp.Run(bound, dim3(w / warps_per_block), block_dim, grid_dim,
+                     w % warps_per_block, stats);
+        }
+
+        thread_cas_counters = nullptr;
+        stats.num_cas = cas_counters.num_cas;
+        stats.num_cas_failures = cas_counters.num_cas_failures;
+
+        std::lock_guard<std::mutex> lock(SimtGlobalStatsMutex());
+        SimtGlobalStats().Accumulate(stats);
+    });
+}
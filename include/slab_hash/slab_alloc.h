@@ -17,8 +17,13 @@
 #pragma once
 
 #include <stdint.h>
+#include <algorithm>
+#include <cstring>
+#include <ctime>
 #include <iostream>
-#include "../helper_cuda.h"
+#include <random>
+#include <vector>
+#include "backend.h"
 #include "config.h"
 
 /*
@@ -27,11 +32,16 @@
  */
 class SlabAllocContext {
 public:
-    static constexpr uint32_t LOG_NUM_MEM_BLOCKS_ = 8;
-    static constexpr uint32_t NUM_SUPER_BLOCKS_ALLOCATOR_ = 32;
+    /* Runtime geometry, see SlabAlloc: the packed addresses below leave 5
+     * bits to the super block, and the offsets within the allocator must fit
+     * in 32 bits, i.e. at most 32 x 2^11 memory blocks */
+    static constexpr uint32_t MAX_NUM_SUPER_BLOCKS_ = 32;
+    static constexpr uint32_t MIN_LOG_NUM_MEM_BLOCKS_ = 4;
+    static constexpr uint32_t MAX_LOG_NUM_MEM_BLOCKS_ = 11;
     static constexpr uint32_t MEM_UNIT_WARP_MULTIPLES_ = 1;
 
-    // fixed parameters for the SlabAlloc
+    // fixed parameters for the SlabAlloc: a memory block has a bitmap per
+    // lane of a warp, hence 32 x 32 memory units
     static constexpr uint32_t NUM_MEM_UNITS_PER_BLOCK_ = 1024;
     static constexpr uint32_t NUM_BITMAP_PER_MEM_BLOCK_ = 32;
     static constexpr uint32_t BITMAP_SIZE_ = 32;
@@ -41,19 +51,24 @@ public:
     static constexpr uint32_t SUPER_BLOCK_BIT_OFFSET_ALLOC_ = 27;
     static constexpr uint32_t MEM_BLOCK_BIT_OFFSET_ALLOC_ = 10;
     static constexpr uint32_t MEM_UNIT_BIT_OFFSET_ALLOC_ = 5;
-    static constexpr uint32_t NUM_MEM_BLOCKS_PER_SUPER_BLOCK_ =
-            (1 << LOG_NUM_MEM_BLOCKS_);
     static constexpr uint32_t MEM_BLOCK_SIZE_ =
             NUM_MEM_UNITS_PER_BLOCK_ * MEM_UNIT_SIZE_;
-    static constexpr uint32_t SUPER_BLOCK_SIZE_ =
-            ((BITMAP_SIZE_ + MEM_BLOCK_SIZE_) *
-             NUM_MEM_BLOCKS_PER_SUPER_BLOCK_);
-    static constexpr uint32_t MEM_BLOCK_OFFSET_ =
-            (BITMAP_SIZE_ * NUM_MEM_BLOCKS_PER_SUPER_BLOCK_);
-    static constexpr uint32_t num_super_blocks_ = NUM_SUPER_BLOCKS_ALLOCATOR_;
+
+    // runtime parameters, set by SlabAlloc
+    uint32_t num_super_blocks_;
+    uint32_t log_num_mem_blocks_;
+    uint32_t num_mem_blocks_per_super_block_;
+    uint32_t super_block_size_;
+    uint32_t mem_block_offset_;
 
     SlabAllocContext()
-        : super_blocks_(nullptr),
+        : num_super_blocks_(0),
+          log_num_mem_blocks_(0),
+          num_mem_blocks_per_super_block_(0),
+          super_block_size_(0),
+          mem_block_offset_(0),
+          super_blocks_(nullptr),
+          num_allocated_(nullptr),
           hash_coef_(0),
           num_attempts_(0),
           resident_index_(0),
@@ -61,7 +76,13 @@ public:
           allocated_index_(0) {}
 
     SlabAllocContext& operator=(const SlabAllocContext& rhs) {
+        num_super_blocks_ = rhs.num_super_blocks_;
+        log_num_mem_blocks_ = rhs.log_num_mem_blocks_;
+        num_mem_blocks_per_super_block_ = rhs.num_mem_blocks_per_super_block_;
+        super_block_size_ = rhs.super_block_size_;
+        mem_block_offset_ = rhs.mem_block_offset_;
         super_blocks_ = rhs.super_blocks_;
+        num_allocated_ = rhs.num_allocated_;
         hash_coef_ = rhs.hash_coef_;
         num_attempts_ = 0;
         resident_index_ = 0;
@@ -72,9 +93,23 @@ public:
 
     ~SlabAllocContext() {}
 
-    void Setup(uint32_t* super_blocks, uint32_t hash_coef) {
+    void Setup(uint32_t* super_blocks,
+               uint32_t* num_allocated,
+               uint32_t hash_coef,
+               uint32_t num_super_blocks,
+               uint32_t log_num_mem_blocks) {
+        assert(num_super_blocks <= MAX_NUM_SUPER_BLOCKS_);
+        assert(log_num_mem_blocks >= MIN_LOG_NUM_MEM_BLOCKS_ &&
+               log_num_mem_blocks <= MAX_LOG_NUM_MEM_BLOCKS_);
         super_blocks_ = super_blocks;
+        num_allocated_ = num_allocated;
         hash_coef_ = hash_coef;
+        num_super_blocks_ = num_super_blocks;
+        log_num_mem_blocks_ = log_num_mem_blocks;
+        num_mem_blocks_per_super_block_ = 1 << log_num_mem_blocks;
+        super_block_size_ = (BITMAP_SIZE_ + MEM_BLOCK_SIZE_) *
+                            num_mem_blocks_per_super_block_;
+        mem_block_offset_ = BITMAP_SIZE_ * num_mem_blocks_per_super_block_;
     }
 
     __device__ __forceinline__ uint32_t* get_unit_ptr_from_slab(
@@ -83,10 +118,21 @@ public:
     }
     __device__ __forceinline__ uint32_t* get_ptr_for_bitmap(
             const uint32_t super_block_index, const uint32_t bitmap_index) {
-        return super_blocks_ + super_block_index * SUPER_BLOCK_SIZE_ +
+        return super_blocks_ + super_block_index * super_block_size_ +
                bitmap_index;
     }
 
+    // the @index-th memory unit in memory order: the units of a block, then
+    // the blocks of a super block, are contiguous (see SlabAlloc::Relayout)
+    __device__ __host__ addr_t getSequentialAddress(uint32_t index) const {
+        const uint32_t mem_block_index = index / NUM_MEM_UNITS_PER_BLOCK_;
+        return ((mem_block_index >> log_num_mem_blocks_)
+                << SUPER_BLOCK_BIT_OFFSET_ALLOC_) |
+               ((mem_block_index & (num_mem_blocks_per_super_block_ - 1))
+                << MEM_BLOCK_BIT_OFFSET_ALLOC_) |
+               (index % NUM_MEM_UNITS_PER_BLOCK_);
+    }
+
     // Objective: each warp selects its own resident warp allocator:
     __device__ void Init(uint32_t& tid, uint32_t& lane_id) {
         // hashing the memory block to be used:
@@ -94,7 +140,7 @@ public:
 
         // loading the assigned memory block:
         resident_bitmap_ =
-                *(super_blocks_ + super_block_index_ * SUPER_BLOCK_SIZE_ +
+                *(super_blocks_ + super_block_index_ * super_block_size_ +
                   resident_index_ * BITMAP_SIZE_ + lane_id);
         allocated_index_ = 0xFFFFFFFF;
     }
@@ -128,12 +174,13 @@ public:
             uint32_t src_lane = __ffs(free_lane) - 1;
             if (src_lane == lane_id) {
                 read_bitmap = atomicCAS(
-                        super_blocks_ + super_block_index_ * SUPER_BLOCK_SIZE_ +
+                        super_blocks_ + super_block_index_ * super_block_size_ +
                                 resident_index_ * BITMAP_SIZE_ + lane_id,
                         resident_bitmap_, resident_bitmap_ | (1 << empty_lane));
                 if (read_bitmap == resident_bitmap_) {
                     // successful attempt:
                     resident_bitmap_ |= (1 << empty_lane);
+                    atomicAdd(num_allocated_, 1u);
                     allocated_result =
                             (super_block_index_
                              << SUPER_BLOCK_BIT_OFFSET_ALLOC_) |
@@ -149,17 +196,139 @@ public:
             allocated_result =
                     __shfl_sync(0xFFFFFFFF, allocated_result, src_lane);
         }
+        // the memory units are not initialized up front: clear the slab
+        // before it is linked and visible to other warps
+        *get_unit_ptr_from_slab(allocated_result, lane_id) = 0xFFFFFFFF;
+        __threadfence();
+        return allocated_result;
+    }
+
+    // Same as WarpAllocate, but first tries the memory block of @near (e.g.
+    // the tail slab of the chain being extended), so that a chain stays in
+    // a few memory blocks. Falls back to the resident block once it is full.
+    __device__ uint32_t WarpAllocateNear(const uint32_t& lane_id,
+                                         const addr_t near) {
+        uint32_t* bitmap_ptr = super_blocks_ +
+                               getSuperBlockIndex(near) * super_block_size_ +
+                               getMemBlockIndex(near) * BITMAP_SIZE_ + lane_id;
+        uint32_t read_bitmap = *bitmap_ptr;
+        uint32_t allocated_result = 0xFFFFFFFF;
+
+        while (allocated_result == 0xFFFFFFFF) {
+            int empty_lane = __ffs(~read_bitmap) - 1;
+            uint32_t free_lane = __ballot_sync(0xFFFFFFFF, empty_lane >= 0);
+            if (free_lane == 0) {
+                return WarpAllocate(lane_id);
+            }
+            uint32_t src_lane = __ffs(free_lane) - 1;
+            if (src_lane == lane_id) {
+                uint32_t old_bitmap = atomicCAS(
+                        bitmap_ptr, read_bitmap,
+                        read_bitmap | (1 << empty_lane));
+                if (old_bitmap == read_bitmap) {
+                    atomicAdd(num_allocated_, 1u);
+                    allocated_result =
+                            (near & ~((1 << MEM_BLOCK_BIT_OFFSET_ALLOC_) - 1)) |
+                            (lane_id << MEM_UNIT_BIT_OFFSET_ALLOC_) |
+                            empty_lane;
+                } else {
+                    read_bitmap = old_bitmap;
+                }
+            }
+            allocated_result =
+                    __shfl_sync(0xFFFFFFFF, allocated_result, src_lane);
+        }
+        *get_unit_ptr_from_slab(allocated_result, lane_id) = 0xFFFFFFFF;
+        __threadfence();
         return allocated_result;
     }
 
+#ifdef SLABHASH_BACKEND_CPU
+    // Host counterpart of Init: each worker thread selects its own resident
+    // memory block, as a warp does on the device.
+    void Init(uint32_t worker_id) {
+        worker_id_ = worker_id;
+        createMemBlockIndex(worker_id_);
+        allocated_index_ = 0xFFFFFFFF;
+    }
+
+    // Host counterpart of WarpAllocate: a single thread scans the 32 bitmaps
+    // of the resident memory block (one per lane on the device) and claims
+    // the first empty memory unit with a CAS, then clears it.
+    addr_t Allocate() {
+        while (true) {
+            for (uint32_t lane_id = 0; lane_id < WARP_SIZE; ++lane_id) {
+                uint32_t* bitmap_ptr =
+                        super_blocks_ + super_block_index_ * super_block_size_ +
+                        resident_index_ * BITMAP_SIZE_ + lane_id;
+                uint32_t read_bitmap = AtomicLoad(bitmap_ptr);
+                while (read_bitmap != 0xFFFFFFFF) {
+                    int empty_lane = __builtin_ctz(~read_bitmap);
+                    uint32_t old_bitmap =
+                            atomicCAS(bitmap_ptr, read_bitmap,
+                                      read_bitmap | (1u << empty_lane));
+                    if (old_bitmap == read_bitmap) {
+                        atomicAdd(num_allocated_, 1u);
+                        addr_t allocated_result =
+                                (super_block_index_
+                                 << SUPER_BLOCK_BIT_OFFSET_ALLOC_) |
+                                (resident_index_
+                                 << MEM_BLOCK_BIT_OFFSET_ALLOC_) |
+                                (lane_id << MEM_UNIT_BIT_OFFSET_ALLOC_) |
+                                empty_lane;
+                        std::memset(get_unit_ptr_from_slab(allocated_result,
+                                                           0),
+                                    0xFF, sizeof(uint32_t) * WARP_SIZE);
+                        return allocated_result;
+                    }
+                    read_bitmap = old_bitmap;
+                }
+            }
+            // all bitmaps are full: need to be rehashed again
+            advanceMemBlockIndex(worker_id_);
+        }
+    }
+
+    // Host counterpart of WarpAllocateNear
+    addr_t AllocateNear(const addr_t near) {
+        for (uint32_t lane_id = 0; lane_id < WARP_SIZE; ++lane_id) {
+            uint32_t* bitmap_ptr =
+                    super_blocks_ +
+                    getSuperBlockIndex(near) * super_block_size_ +
+                    getMemBlockIndex(near) * BITMAP_SIZE_ + lane_id;
+            uint32_t read_bitmap = AtomicLoad(bitmap_ptr);
+            while (read_bitmap != 0xFFFFFFFF) {
+                int empty_lane = __builtin_ctz(~read_bitmap);
+                uint32_t old_bitmap =
+                        atomicCAS(bitmap_ptr, read_bitmap,
+                                  read_bitmap | (1u << empty_lane));
+                if (old_bitmap == read_bitmap) {
+                    atomicAdd(num_allocated_, 1u);
+                    addr_t allocated_result =
+                            (near &
+                             ~((1u << MEM_BLOCK_BIT_OFFSET_ALLOC_) - 1)) |
+                            (lane_id << MEM_UNIT_BIT_OFFSET_ALLOC_) |
+                            empty_lane;
+                    std::memset(get_unit_ptr_from_slab(allocated_result, 0),
+                                0xFF, sizeof(uint32_t) * WARP_SIZE);
+                    return allocated_result;
+                }
+                read_bitmap = old_bitmap;
+            }
+        }
+        return Allocate();
+    }
+#endif
+
     // This function, frees a recently allocated memory unit by a single thread.
     // Since it is untouched, there shouldn't be any worries for the actual
     // memory contents to be reset again.
     __device__ void FreeUntouched(addr_t ptr) {
-        atomicAnd(super_blocks_ + getSuperBlockIndex(ptr) * SUPER_BLOCK_SIZE_ +
+        atomicAnd(super_blocks_ + getSuperBlockIndex(ptr) * super_block_size_ +
                           getMemBlockIndex(ptr) * BITMAP_SIZE_ +
                           (getMemUnitIndex(ptr) >> 5),
                   ~(1 << (getMemUnitIndex(ptr) & 0x1F)));
+        atomicSub(num_allocated_, 1u);
     }
 
 private:
@@ -176,7 +345,7 @@ private:
     }
     __device__ __host__ __forceinline__ addr_t
     getMemBlockAddress(addr_t address) const {
-        return (MEM_BLOCK_OFFSET_ +
+        return (mem_block_offset_ +
                 getMemBlockIndex(address) * MEM_BLOCK_SIZE_);
     }
     __device__ __host__ __forceinline__ uint32_t
@@ -192,26 +361,31 @@ private:
     __device__ void createMemBlockIndex(uint32_t global_warp_id) {
         super_block_index_ = global_warp_id % num_super_blocks_;
         resident_index_ =
-                (hash_coef_ * global_warp_id) >> (32 - LOG_NUM_MEM_BLOCKS_);
+                (hash_coef_ * global_warp_id) >> (32 - log_num_mem_blocks_);
     }
 
-    // called when the allocator fails to find an empty unit to allocate:
-    __device__ void updateMemBlockIndex(uint32_t global_warp_id) {
+    // moves to the next candidate memory block:
+    __device__ void advanceMemBlockIndex(uint32_t global_warp_id) {
         num_attempts_++;
         super_block_index_++;
         super_block_index_ = (super_block_index_ == num_super_blocks_)
                                      ? 0
                                      : super_block_index_;
         resident_index_ = (hash_coef_ * (global_warp_id + num_attempts_)) >>
-                          (32 - LOG_NUM_MEM_BLOCKS_);
+                          (32 - log_num_mem_blocks_);
+    }
+
+    // called when the allocator fails to find an empty unit to allocate:
+    __device__ void updateMemBlockIndex(uint32_t global_warp_id) {
+        advanceMemBlockIndex(global_warp_id);
         // loading the assigned memory block:
         resident_bitmap_ =
-                *((super_blocks_ + super_block_index_ * SUPER_BLOCK_SIZE_) +
+                *((super_blocks_ + super_block_index_ * super_block_size_) +
                   resident_index_ * BITMAP_SIZE_ + (threadIdx.x & 0x1f));
     }
 
     __host__ __device__ addr_t addressDecoder(addr_t address_ptr_index) {
-        return getSuperBlockIndex(address_ptr_index) * SUPER_BLOCK_SIZE_ +
+        return getSuperBlockIndex(address_ptr_index) * super_block_size_ +
                getMemBlockAddress(address_ptr_index) +
                getMemUnitIndex(address_ptr_index) * MEM_UNIT_WARP_MULTIPLES_ *
                        WARP_SIZE;
@@ -230,6 +404,9 @@ private:
     // a pointer to each super-block
     uint32_t* super_blocks_;
 
+    // running count of the allocated memory units, owned by SlabAlloc
+    uint32_t* num_allocated_;
+
     // hash_coef (register): used as (16 bits, 16 bits) for hashing
     uint32_t hash_coef_;  // a random 32-bit
 
@@ -242,60 +419,256 @@ private:
     uint32_t resident_bitmap_;
     uint32_t super_block_index_;
     uint32_t allocated_index_;  // to be asked via shuffle after
+
+#ifdef SLABHASH_BACKEND_CPU
+    // host worker owning this copy, in place of the global warp id
+    uint32_t worker_id_;
+#endif
 };
 
 /*
- * This class owns the memory for the allocator on the device
+ * This class owns the memory for the allocator on the device.
+ * The geometry is sized from the expected number of slabs: memory blocks of
+ * 1024 units (a bitmap per lane), 2^log_num_mem_blocks blocks per super
+ * block, and as many super blocks (at most 32) as needed to hold twice the
+ * expected slabs, since warps probe random blocks and slow down as the blocks
+ * fill up.
  */
 class SlabAlloc {
 private:
     // a pointer to each super-block
     uint32_t* super_blocks_;
 
+    // number of allocated memory units, kept by the contexts on allocation
+    // and free so that it can be read without scanning the bitmaps
+    uint32_t* num_allocated_;
+
     // hash_coef (register): used as (16 bits, 16 bits) for hashing
     uint32_t hash_coef_;  // a random 32-bit
 
+    uint32_t num_super_blocks_;
+    uint32_t log_num_mem_blocks_;
+
     // the context class is actually copied shallowly into GPU device
     SlabAllocContext slab_alloc_context_;
 
+    static uint32_t ComputeNumMemBlocks(uint32_t num_slabs) {
+        uint64_t num_units = 2 * uint64_t(num_slabs);
+        return uint32_t(std::max<uint64_t>(
+                (num_units + SlabAllocContext::NUM_MEM_UNITS_PER_BLOCK_ - 1) /
+                        SlabAllocContext::NUM_MEM_UNITS_PER_BLOCK_,
+                1));
+    }
+
+    // sets the bitmaps of the super blocks [begin, end) to zeros. The memory
+    // units are left untouched until allocated (and then cleared by the
+    // allocating warp), so that on the host their pages are only committed
+    // once an allocation is routed to them
+    void InitSuperBlocks(uint32_t begin, uint32_t end) {
+        const uint32_t num_blocks = 1u << log_num_mem_blocks_;
+        const size_t super_block_size =
+                size_t(SlabAllocContext::BITMAP_SIZE_ +
+                       SlabAllocContext::MEM_BLOCK_SIZE_) *
+                num_blocks;
+        for (uint32_t i = begin; i < end; i++) {
+            uint32_t* super_block = super_blocks_ + i * super_block_size;
+            BackendMemset(super_block, 0x00,
+                          num_blocks * SlabAllocContext::BITMAP_SIZE_ *
+                                  sizeof(uint32_t));
+        }
+    }
+
+    // copies the bitmaps and the allocated memory units of the super blocks
+    // to @super_blocks, which has the same geometry. On the host, the free
+    // units are skipped so that their pages stay uncommitted (see
+    // InitSuperBlocks); on the device the whole range is copied at once
+    void CopySuperBlocks(uint32_t* super_blocks) const {
+#ifdef SLABHASH_BACKEND_CPU
+        const uint32_t num_bitmaps =
+                (1u << log_num_mem_blocks_) * SlabAllocContext::BITMAP_SIZE_;
+        const uint32_t num_units = num_bitmaps * 32;
+        const size_t super_block_size =
+                size_t(SlabAllocContext::BITMAP_SIZE_ +
+                       SlabAllocContext::MEM_BLOCK_SIZE_) *
+                (1u << log_num_mem_blocks_);
+        for (uint32_t i = 0; i < num_super_blocks_; i++) {
+            const uint32_t* src = super_blocks_ + i * super_block_size;
+            uint32_t* dst = super_blocks + i * super_block_size;
+            BackendMemcpy(dst, src, num_bitmaps * sizeof(uint32_t));
+
+            // the unit of bit b in the bitmap w is the unit 32 * w + b; runs
+            // of allocated units are copied at once
+            auto is_allocated = [src](uint32_t unit) {
+                return (src[unit >> 5] >> (unit & 31)) & 1;
+            };
+            uint32_t unit = 0;
+            while (unit < num_units) {
+                if (!is_allocated(unit)) {
+                    unit++;
+                    continue;
+                }
+                const uint32_t begin = unit;
+                while (unit < num_units && is_allocated(unit)) {
+                    unit++;
+                }
+                const size_t offset =
+                        num_bitmaps +
+                        size_t(begin) * SlabAllocContext::MEM_UNIT_SIZE_;
+                BackendMemcpy(dst + offset, src + offset,
+                              size_t(unit - begin) *
+                                      SlabAllocContext::MEM_UNIT_SIZE_ *
+                                      sizeof(uint32_t));
+            }
+        }
+#else
+        BackendMemcpy(super_blocks, super_blocks_,
+                      SuperBlocksBytes(num_super_blocks_));
+#endif
+    }
+
+    size_t SuperBlocksBytes(uint32_t num_super_blocks) const {
+        return size_t(SlabAllocContext::BITMAP_SIZE_ +
+                      SlabAllocContext::MEM_BLOCK_SIZE_) *
+               (size_t(1) << log_num_mem_blocks_) * num_super_blocks *
+               sizeof(uint32_t);
+    }
+
 public:
-    SlabAlloc() : super_blocks_(nullptr), hash_coef_(0) {
+    /* @num_slabs: expected peak number of slabs. The blocks per super block
+     * are chosen so that at most 4 super blocks are used at first, leaving
+     * room for Reserve to grow by appending super blocks */
+    explicit SlabAlloc(uint32_t num_slabs)
+        : super_blocks_(nullptr),
+          num_allocated_(nullptr),
+          hash_coef_(0),
+          num_super_blocks_(0),
+          log_num_mem_blocks_(SlabAllocContext::MIN_LOG_NUM_MEM_BLOCKS_) {
         // random coefficients for allocator's hash function
         std::mt19937 rng(time(0));
         hash_coef_ = rng();
 
+        const uint32_t num_blocks = ComputeNumMemBlocks(num_slabs);
+        while (log_num_mem_blocks_ <
+                       SlabAllocContext::MAX_LOG_NUM_MEM_BLOCKS_ &&
+               (4u << log_num_mem_blocks_) < num_blocks) {
+            log_num_mem_blocks_++;
+        }
+        num_super_blocks_ = std::min(
+                (num_blocks + (1u << log_num_mem_blocks_) - 1) >>
+                        log_num_mem_blocks_,
+                uint32_t(SlabAllocContext::MAX_NUM_SUPER_BLOCKS_));
+
         // In the light version, we put num_super_blocks super blocks within a
         // single array
-        CHECK_CUDA(cudaMalloc(&super_blocks_,
-                              slab_alloc_context_.SUPER_BLOCK_SIZE_ *
-                                      slab_alloc_context_.num_super_blocks_ *
-                                      sizeof(uint32_t)));
-
-        for (int i = 0; i < slab_alloc_context_.num_super_blocks_; i++) {
-            // setting bitmaps into zeros:
-            CHECK_CUDA(cudaMemset(
-                    super_blocks_ + i * slab_alloc_context_.SUPER_BLOCK_SIZE_,
-                    0x00,
-                    slab_alloc_context_.NUM_MEM_BLOCKS_PER_SUPER_BLOCK_ *
-                            slab_alloc_context_.BITMAP_SIZE_ *
-                            sizeof(uint32_t)));
-            // setting empty memory units into ones:
-            CHECK_CUDA(cudaMemset(
-                    super_blocks_ + i * slab_alloc_context_.SUPER_BLOCK_SIZE_ +
-                            (slab_alloc_context_
-                                     .NUM_MEM_BLOCKS_PER_SUPER_BLOCK_ *
-                             slab_alloc_context_.BITMAP_SIZE_),
-                    0xFF,
-                    slab_alloc_context_.MEM_BLOCK_SIZE_ *
-                            slab_alloc_context_
-                                    .NUM_MEM_BLOCKS_PER_SUPER_BLOCK_ *
-                            sizeof(uint32_t)));
-        }
+        BackendMalloc(&super_blocks_, SuperBlocksBytes(num_super_blocks_));
+        InitSuperBlocks(0, num_super_blocks_);
+        BackendMalloc(&num_allocated_, sizeof(uint32_t));
+        BackendMemset(num_allocated_, 0, sizeof(uint32_t));
 
         // initializing the slab context:
-        slab_alloc_context_.Setup(super_blocks_, hash_coef_);
+        slab_alloc_context_.Setup(super_blocks_, num_allocated_, hash_coef_,
+                                  num_super_blocks_, log_num_mem_blocks_);
+    }
+    ~SlabAlloc() {
+        BackendFree(super_blocks_);
+        BackendFree(num_allocated_);
+    }
+
+    /* Grows to hold @num_slabs expected slabs by appending super blocks: the
+     * slab addresses are offsets, so they stay valid across the copy. Returns
+     * false if more than MAX_NUM_SUPER_BLOCKS_ would be needed. The contexts
+     * copied from getContext() must be refreshed afterwards */
+    bool Reserve(uint32_t num_slabs) {
+        const uint32_t num_blocks = ComputeNumMemBlocks(num_slabs);
+        const uint32_t num_super_blocks =
+                (num_blocks + (1u << log_num_mem_blocks_) - 1) >>
+                log_num_mem_blocks_;
+        if (num_super_blocks > SlabAllocContext::MAX_NUM_SUPER_BLOCKS_) {
+            return false;
+        }
+        if (num_super_blocks <= num_super_blocks_) {
+            return true;
+        }
+
+        uint32_t* super_blocks;
+        BackendMalloc(&super_blocks, SuperBlocksBytes(num_super_blocks));
+        CopySuperBlocks(super_blocks);
+        BackendFree(super_blocks_);
+        super_blocks_ = super_blocks;
+        InitSuperBlocks(num_super_blocks_, num_super_blocks);
+        num_super_blocks_ = num_super_blocks;
+
+        slab_alloc_context_.Setup(super_blocks_, num_allocated_, hash_coef_,
+                                  num_super_blocks_, log_num_mem_blocks_);
+        return true;
+    }
+
+    /* Replaces all the allocated slabs by @num_slabs slabs copied from
+     * @slabs (32 words each): the i-th one is placed at the sequential
+     * address i, so that consecutive slabs are contiguous in memory. Must not
+     * overlap with a kernel using the allocator */
+    void Relayout(const uint32_t* slabs, uint32_t num_slabs) {
+        const uint32_t num_blocks = 1u << log_num_mem_blocks_;
+        const uint32_t num_units_per_super_block =
+                num_blocks * SlabAllocContext::NUM_MEM_UNITS_PER_BLOCK_;
+        assert(num_slabs <= num_super_blocks_ * num_units_per_super_block);
+
+        const size_t super_block_size =
+                size_t(SlabAllocContext::BITMAP_SIZE_ +
+                       SlabAllocContext::MEM_BLOCK_SIZE_) *
+                num_blocks;
+        std::vector<uint32_t> bitmaps(num_blocks *
+                                      SlabAllocContext::BITMAP_SIZE_);
+        for (uint32_t i = 0; i < num_super_blocks_; i++) {
+            // the units [begin, end) of this super block are taken
+            const uint32_t begin = i * num_units_per_super_block;
+            const uint32_t end = std::max(
+                    begin, std::min(num_slabs,
+                                    begin + num_units_per_super_block));
+            std::fill(bitmaps.begin(), bitmaps.end(), 0);
+            for (uint32_t unit = 0; unit < end - begin; unit += 32) {
+                const uint32_t num_units = std::min(32u, end - begin - unit);
+                bitmaps[unit >> 5] = (num_units == 32)
+                                             ? 0xFFFFFFFF
+                                             : ((1u << num_units) - 1);
+            }
+
+            uint32_t* super_block = super_blocks_ + i * super_block_size;
+            BackendMemcpy(super_block, bitmaps.data(),
+                          bitmaps.size() * sizeof(uint32_t));
+            if (end > begin) {
+                BackendMemcpy(
+                        super_block + num_blocks *
+                                              SlabAllocContext::BITMAP_SIZE_,
+                        slabs + size_t(begin) *
+                                        SlabAllocContext::MEM_UNIT_SIZE_,
+                        size_t(end - begin) * SlabAllocContext::MEM_UNIT_SIZE_ *
+                                sizeof(uint32_t));
+            }
+        }
+        BackendMemcpy(num_allocated_, &num_slabs, sizeof(uint32_t));
+    }
+
+    /* Number of memory units, allocated or not */
+    uint32_t NumUnits() const {
+        return (num_super_blocks_ << log_num_mem_blocks_) *
+               SlabAllocContext::NUM_MEM_UNITS_PER_BLOCK_;
+    }
+
+    /* Largest @num_slabs Reserve accepts with the current geometry */
+    uint32_t MaxReserve() const {
+        return (SlabAllocContext::MAX_NUM_SUPER_BLOCKS_
+                << log_num_mem_blocks_) *
+               (SlabAllocContext::NUM_MEM_UNITS_PER_BLOCK_ / 2);
+    }
+
+    /* Number of allocated memory units. Must not overlap with a kernel using
+     * the allocator */
+    uint32_t NumAllocated() const {
+        uint32_t num_allocated;
+        BackendMemcpy(&num_allocated, num_allocated_, sizeof(uint32_t));
+        return num_allocated;
     }
-    ~SlabAlloc() { CHECK_CUDA(cudaFree(super_blocks_)); }
 
     const SlabAllocContext& getContext() const { return slab_alloc_context_; }
 };
@@ -16,11 +16,13 @@
 
 #pragma once
 
-#include <thrust/pair.h>
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <memory>
 
 #include "memory_alloc.h"
+#include "reduce.h"
 #include "slab_alloc.h"
 
 /**
@@ -32,74 +34,426 @@ public:
     ptr_t next_slab_ptr;
 };
 
-template <typename _Key, typename _Value, typename _Hash>
+/* Pairs small enough to be stored inline in the slabs: the specializations
+ * in slab_hash_inline.h are then selected, without a pair pool */
+template <typename _Key, typename _Value>
+struct IsInlinePair {
+    static constexpr bool value = sizeof(_Key) <= sizeof(uint32_t) &&
+                                  sizeof(_Value) <= sizeof(uint32_t);
+};
+
+/* Per key status of an inserting operation, from its returned iterator */
+__device__ __host__ __forceinline__ uint8_t InsertStatus(iterator_t iterator) {
+    return (iterator == OUT_OF_CAPACITY_ITERATOR) ? STATUS_OUT_OF_CAPACITY
+                                                  : STATUS_SUCCESS;
+}
+
+template <typename _Key,
+          typename _Value,
+          typename _Hash,
+          bool _Inline = IsInlinePair<_Key, _Value>::value>
 class SlabHashContext;
 
-template <typename _Key, typename _Value, typename _Hash>
+template <typename _Key,
+          typename _Value,
+          typename _Hash,
+          bool _Inline = IsInlinePair<_Key, _Value>::value>
 class SlabHash {
 public:
     SlabHash(const uint32_t max_bucket_count,
              const uint32_t max_keyvalue_count,
-             uint32_t device_idx);
+             uint32_t device_idx,
+             bool use_fingerprints = false);
 
     ~SlabHash();
 
-    double ComputeLoadFactor(int flag);
+    double ComputeLoadFactor(int flag = 0);
 
-    void Insert(_Key* keys, _Value* values, uint32_t num_keys);
+    /* The inserting operations write STATUS_OUT_OF_CAPACITY to @statuses
+     * (if not nullptr) for the keys dropped because the pair pool is full,
+     * STATUS_SUCCESS otherwise. Insert allocates before looking for the
+     * key, so a full pool also reports its existing keys */
+    void Insert(_Key* keys,
+                _Value* values,
+                uint32_t num_keys,
+                uint8_t* statuses = nullptr);
     void Search(_Key* keys, _Value* values, uint8_t* founds, uint32_t num_keys);
     void Remove(_Key* keys, uint32_t num_keys);
 
+    /* Bulk load: the keys are grouped by bucket (counted, prefix-summed and
+     * scattered), then a warp per bucket appends its keys to the chain with
+     * plain stores instead of a CAS per slot. As with Insert, the keys
+     * already stored are skipped, and so are the duplicates in the batch but
+     * one, and the keys that do not fit in the pair pool */
+    void BulkBuild(_Key* keys, _Value* values, uint32_t num_keys);
+
+    /* Overwrite the values of existing keys in place, instead of a Remove
+     * and an Insert; UpdateExisting never inserts */
+    void InsertOrAssign(_Key* keys,
+                        _Value* values,
+                        uint32_t num_keys,
+                        uint8_t* statuses = nullptr);
+    void UpdateExisting(_Key* keys, _Value* values, uint32_t num_keys);
+
+    /* Insert, or combine the value into the existing one with @reduce
+     * (reduce.h); duplicate keys within the batch are combined as well */
+    template <typename _Reduce>
+    void InsertOrReduce(_Key* keys,
+                        _Value* values,
+                        uint32_t num_keys,
+                        _Reduce reduce,
+                        uint8_t* statuses = nullptr);
+
+    /* Find or insert (with a default value) each key in one chain walk.
+     * Returns the pair pool index of its entry, a dense id in
+     * [0, max_keyvalue_count) stable until the key is removed, and whether
+     * the entry was created; OUT_OF_CAPACITY_ITERATOR if the pool is full */
+    void Activate(_Key* keys,
+                  iterator_t* iterators,
+                  uint8_t* is_new,
+                  uint32_t num_keys);
+
+    /* Multimap: duplicate keys are kept by InsertMulti. Query with Count,
+     * then with SearchAll given the exclusive prefix sum of the counts
+     * (num_keys + 1 offsets) */
+    void InsertMulti(_Key* keys,
+                     _Value* values,
+                     uint32_t num_keys,
+                     uint8_t* statuses = nullptr);
+    void Count(_Key* keys, uint32_t* counts, uint32_t num_keys);
+    void SearchAll(_Key* keys,
+                   uint32_t* offsets,
+                   _Value* values,
+                   uint32_t num_keys);
+
+    /* Parallel iteration over the stored pairs.
+     * Export writes them to @keys and @values (either can be nullptr), which
+     * must hold Size() entries, and returns their number: the pairs are
+     * counted per bucket, the counts prefix-summed, and each bucket then
+     * writes its chain to its own range. ForEach calls func(key, value) on
+     * every pair, the value being writable in place */
+    uint32_t Size();
+    uint32_t Export(_Key* keys, _Value* values);
+    template <typename _Func>
+    void ForEach(_Func func);
+
+    /* Redistribute the pairs over @new_bucket_count buckets, a warp per old
+     * bucket: the encoded pair pointers are moved, so the pairs and their
+     * pool indices stay where they are. The old chains are then
+     * reset and returned to the slab allocator.
+     * With SetMaxChainLength(l), l > 0, the inserting operations call Rehash
+     * once ComputeAverageChainLength (slabs per bucket) exceeds l */
+    void Rehash(uint32_t new_bucket_count);
+    void SetMaxChainLength(float max_chain_length);
+    double ComputeAverageChainLength();
+
+    /* Reclaim the slabs emptied by Remove: a warp per bucket packs the pair
+     * pointers toward the head slab, then unlinks and frees the slabs left
+     * empty, so that searches walk the live chain length again. Iterators
+     * are unchanged. Must not overlap with other operations */
+    void Compact();
+
+    /* Copy the slab chains into a fresh, contiguous layout: the chains are
+     * laid out bucket after bucket, each in chain order, so that walking a
+     * chain reads consecutive slabs. The heads and the pairs do not move.
+     * Run Compact first to also drop the emptied slabs. Must not overlap
+     * with other operations */
+    void Relayout();
+
+    /* Slab allocation policy: by default a warp allocates from the memory
+     * block hashed from its id; with @near_tail_allocation, the slab that
+     * extends a chain is taken from the block of its tail slab if that
+     * block has room, which keeps long chains within a few blocks */
+    void SetNearTailAllocation(bool near_tail_allocation);
+
+    /* Search in bucket order: the queries are grouped by bucket first (see
+     * BulkBuild), so that the lanes of a warp, or the queries of a worker,
+     * walk the same chains while they are cached. The results are written
+     * back to the positions of their queries */
+    void SetBucketOrderedSearch(bool bucket_ordered_search);
+
+    /* In-batch deduplication: Insert, InsertOrAssign and InsertOrReduce
+     * first group the batch by bucket (see BulkBuild) and reduce it to one
+     * pair per distinct key, so that a single lane per key walks the chain
+     * and allocates. The value kept is that of the first copy in batch
+     * order for Insert, of the last one for InsertOrAssign, and the
+     * reduction of the copies for InsertOrReduce. Not applied when
+     * @statuses are requested, since those are reported per input key */
+    void SetBatchDeduplication(bool batch_deduplication);
+
+    /* Linear hashing: instead of a global Rehash, the trigger above splits
+     * the @splits_per_batch buckets at the split pointer, so that the table
+     * grows a few buckets per batch. The head array is extended to
+     * @max_bucket_count buckets, and doubled (heads only) when full */
+    void EnableLinearHashing(uint32_t max_bucket_count,
+                             uint32_t splits_per_batch);
+
+    /* Grow the pair pool to @max_keyvalue_count pairs, by whole chunks,
+     * and the slab allocator to match: the stored pairs and their iterators
+     * are unchanged. Returns false, and leaves the table as is, beyond what
+     * a slab word can address next to the fingerprint bits, or beyond the
+     * super blocks of the slab allocator */
+    bool Reserve(uint32_t max_keyvalue_count);
+
+    /* See the inline layout: here the pair pool bounds the pairs, and thus
+     * the slabs, so the slab allocator never grows on its own */
+    bool MayGrowSlabs(uint32_t num_keys);
+
 private:
+    /* Group @keys by bucket: @d_offsets (num_buckets_ + 1 entries) gets the
+     * prefix sum of the bucket counts, and @d_order (@num_keys entries) the
+     * indices of the keys of each bucket, in the range of that bucket */
+    void PartitionByBucket(_Key* keys,
+                           uint32_t num_keys,
+                           uint32_t* d_offsets,
+                           uint32_t* d_order);
+    /* In-batch deduplication: allocates @unique_keys and @unique_values,
+     * writes to them one pair per distinct key of the batch, grouped by
+     * bucket, with the value @combine keeps, and returns their number */
+    template <typename _Combine>
+    uint32_t DeduplicateBatch(_Key* keys,
+                              _Value* values,
+                              uint32_t num_keys,
+                              _Key** unique_keys,
+                              _Value** unique_values,
+                              _Combine combine);
+    /* Number of pairs per bucket */
+    void CountBuckets(uint32_t* d_bucket_count);
+    /* Exclusive prefix sum of the bucket counts in @d_offsets
+     * (num_buckets_ + 1 entries), returns the total */
+    uint32_t ComputeBucketOffsets(uint32_t* d_offsets);
+    /* Slabs taken from the slab allocator, i.e. excluding the list heads,
+     * read from its running count */
+    uint32_t CountAllocatedSlabs();
+    void RehashIfNeeded();
+    /* Grow the head array to @bucket_capacity, without moving any pair */
+    void ReserveBuckets(uint32_t bucket_capacity);
+    void SplitBuckets(uint32_t num_splits);
+
     uint32_t num_buckets_;
 
     Slab* bucket_list_head_;
 
-    SlabHashContext<_Key, _Value, _Hash> gpu_context_;
+    SlabHashContext<_Key, _Value, _Hash, _Inline> gpu_context_;
 
-    std::shared_ptr<MemoryAlloc<thrust::pair<_Key, _Value>>> pair_allocator_;
+    std::shared_ptr<MemoryAlloc<pair_t<_Key, _Value>>> pair_allocator_;
     std::shared_ptr<SlabAlloc> slab_list_allocator_;
 
     uint32_t device_idx_;
+
+    float max_chain_length_;
+    bool bucket_ordered_search_;
+    bool batch_deduplication_;
+
+    /* Linear hashing: num_buckets_ - split_bucket_ buckets in the current
+     * level, the first split_bucket_ of which are split */
+    uint32_t bucket_capacity_;
+    uint32_t split_bucket_;
+    uint32_t splits_per_batch_;
+
+    /* Largest pool a slab word can address next to the fingerprint bits */
+    uint32_t max_pair_capacity_;
 };
 
 /**
  * Implementation
  **/
-template <typename _Key, typename _Value, typename _Hash>
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
 class SlabHashContext {
 public:
     SlabHashContext();
     __host__ void Setup(Slab* bucket_list_head,
                         const uint32_t num_buckets,
                         const SlabAllocContext& allocator_ctx,
-                        const MemoryAllocContext<thrust::pair<_Key, _Value>>&
-                                pair_allocator_ctx);
+                        const MemoryAllocContext<pair_t<_Key, _Value>>&
+                                pair_allocator_ctx,
+                        const uint32_t fingerprint_bits = 0);
 
     /* Core SIMT operations */
-    __device__ thrust::pair<iterator_t, bool> Insert(bool& lane_active,
-                                                     const uint32_t lane_id,
-                                                     const uint32_t bucket_id,
-                                                     const _Key& key,
-                                                     const _Value& value);
+    __device__ pair_t<iterator_t, bool> Insert(bool& lane_active,
+                                               const uint32_t lane_id,
+                                               const uint32_t bucket_id,
+                                               const _Key& key,
+                                               const _Value& value);
 
-    __device__ thrust::pair<iterator_t, bool> Search(bool& lane_active,
-                                                     const uint32_t lane_id,
-                                                     const uint32_t bucket_id,
-                                                     const _Key& key);
+    __device__ pair_t<iterator_t, bool> Search(bool& lane_active,
+                                               const uint32_t lane_id,
+                                               const uint32_t bucket_id,
+                                               const _Key& key);
 
     __device__ bool Remove(bool& lane_active,
                            const uint32_t lane_id,
                            const uint32_t bucket_id,
                            const _Key& key);
 
-    /* Hash function */
+    /* Insert, or overwrite the value in place if the key exists; the pair
+     * is only allocated when an empty slot is found. Returns the iterator
+     * of the pair, and whether it was inserted */
+    __device__ pair_t<iterator_t, bool> InsertOrAssign(bool& lane_active,
+                                                       const uint32_t lane_id,
+                                                       const uint32_t bucket_id,
+                                                       const _Key& key,
+                                                       const _Value& value);
+
+    /* Overwrite the value only if the key exists, never allocates */
+    __device__ bool UpdateExisting(bool& lane_active,
+                                   const uint32_t lane_id,
+                                   const uint32_t bucket_id,
+                                   const _Key& key,
+                                   const _Value& value);
+
+    /* Insert, or call reduce(&stored_value, value) if the key exists.
+     * Allocates lazily as InsertOrAssign */
+    template <typename _Reduce>
+    __device__ pair_t<iterator_t, bool> InsertOrReduce(bool& lane_active,
+                                                       const uint32_t lane_id,
+                                                       const uint32_t bucket_id,
+                                                       const _Key& key,
+                                                       const _Value& value,
+                                                       const _Reduce& reduce);
+
+    /* Multimap operations: InsertMulti never checks for an existing key;
+     * Count and SearchAll visit every pair matching the key. SearchAll
+     * writes at most @capacity values to @values, and returns the number
+     * of values written */
+    __device__ iterator_t InsertMulti(bool& lane_active,
+                                      const uint32_t lane_id,
+                                      const uint32_t bucket_id,
+                                      const _Key& key,
+                                      const _Value& value);
+
+    __device__ uint32_t Count(bool& lane_active,
+                              const uint32_t lane_id,
+                              const uint32_t bucket_id,
+                              const _Key& key);
+
+    __device__ uint32_t SearchAll(bool& lane_active,
+                                  const uint32_t lane_id,
+                                  const uint32_t bucket_id,
+                                  const _Key& key,
+                                  _Value* values,
+                                  const uint32_t capacity);
+
+    /* Rehash primitives: InsertPairPtr links an encoded slab word of
+     * another table (pair pointer and fingerprint) into the chain of
+     * @bucket_id, without looking for its key; FreeChain frees the slabs
+     * chained after the head of @bucket_id */
+    __device__ void InsertPairPtr(bool& lane_active,
+                                  const uint32_t lane_id,
+                                  const uint32_t bucket_id,
+                                  const ptr_t pair_ptr);
+
+    __device__ void FreeChain(const uint32_t lane_id, const uint32_t bucket_id);
+
+    /* Linear hashing: moves the pairs of @bucket_id that belong to
+     * bucket_id + num_buckets at the next level into that (empty) bucket */
+    __device__ void SplitBucket(const uint32_t lane_id,
+                                const uint32_t bucket_id);
+
+    /* Compaction: packs the pair pointers of @bucket_id toward its head
+     * slab, in chain order, then unlinks and frees the slabs left empty */
+    __device__ void CompactBucket(const uint32_t lane_id,
+                                  const uint32_t bucket_id);
+
+    /* Bulk build: appends the pairs (keys[order[i]], values[order[i]]),
+     * i < @num_keys, all of @bucket_id, after the last pair of its chain
+     * with plain stores, skipping the keys already in the chain. The
+     * caller owns the bucket, see BulkBuildKernel */
+    __device__ void BuildBucket(const uint32_t lane_id,
+                                const uint32_t bucket_id,
+                                const _Key* keys,
+                                const _Value* values,
+                                const uint32_t* order,
+                                const uint32_t num_keys);
+
+#ifdef SLABHASH_BACKEND_CPU
+    /* Core scalar operations, one key per host thread */
+    pair_t<iterator_t, bool> Insert(const uint32_t bucket_id,
+                                    const _Key& key,
+                                    const _Value& value);
+
+    pair_t<iterator_t, bool> Search(const uint32_t bucket_id, const _Key& key);
+
+    bool Remove(const uint32_t bucket_id, const _Key& key);
+
+    pair_t<iterator_t, bool> InsertOrAssign(const uint32_t bucket_id,
+                                            const _Key& key,
+                                            const _Value& value);
+
+    bool UpdateExisting(const uint32_t bucket_id,
+                        const _Key& key,
+                        const _Value& value);
+
+    template <typename _Reduce>
+    pair_t<iterator_t, bool> InsertOrReduce(const uint32_t bucket_id,
+                                            const _Key& key,
+                                            const _Value& value,
+                                            const _Reduce& reduce);
+
+    iterator_t InsertMulti(const uint32_t bucket_id,
+                           const _Key& key,
+                           const _Value& value);
+
+    uint32_t Count(const uint32_t bucket_id, const _Key& key);
+
+    uint32_t SearchAll(const uint32_t bucket_id,
+                       const _Key& key,
+                       _Value* values,
+                       const uint32_t capacity);
+
+    void InsertPairPtr(const uint32_t bucket_id, const ptr_t pair_ptr);
+
+    void FreeChain(const uint32_t bucket_id);
+
+    void SplitBucket(const uint32_t bucket_id);
+
+    void CompactBucket(const uint32_t bucket_id);
+
+    void BuildBucket(const uint32_t bucket_id,
+                     const _Key* keys,
+                     const _Value* values,
+                     const uint32_t* order,
+                     const uint32_t num_keys);
+#endif
+
+    /* Hash function. With linear hashing, @num_buckets is the bucket count
+     * of the current level, and the buckets below @split_bucket have
+     * already been split in two, see SplitBucket */
     __device__ __host__ uint32_t ComputeBucket(const _Key& key) const;
+    __device__ __host__ uint32_t ComputeSplitBucket(const _Key& key) const;
+
+    /* Point to another bucket array, e.g. to rehash into it */
+    __host__ void SetBuckets(Slab* bucket_list_head,
+                             const uint32_t num_buckets,
+                             const uint32_t split_bucket = 0);
+    /* Refresh the pool context after MemoryAlloc::Reserve */
+    __host__ void SetPairAllocator(
+            const MemoryAllocContext<pair_t<_Key, _Value>>& pair_allocator_ctx);
+    /* Refresh the allocator context after SlabAlloc::Reserve */
+    __host__ void SetSlabAllocator(const SlabAllocContext& slab_alloc_ctx);
+    /* Allocate the slabs extending a chain next to its tail slab when
+     * possible, see SlabAllocContext::WarpAllocateNear */
+    __host__ void SetNearTailAllocation(const bool near_tail_allocation);
+
+    /* Fingerprints:
+     * with fingerprint_bits_ > 0, a slab word is the pair pointer in the low
+     * bits, or'ed with a few hash bits of its key in the high bits, so that
+     * only the lanes with a matching fingerprint are dereferenced in the
+     * pair pool. Iterators are always plain pair pointers. */
+    __device__ __host__ uint32_t ComputeFingerprint(const _Key& key) const;
+    __device__ __host__ __forceinline__ ptr_t
+    EncodePairPtr(const ptr_t pair_ptr, const uint32_t fingerprint) const {
+        return pair_ptr | fingerprint;
+    }
+    __device__ __host__ __forceinline__ ptr_t
+    DecodePairPtr(const ptr_t unit_data) const {
+        return unit_data & ~fingerprint_mask_;
+    }
 
     __device__ __host__ SlabAllocContext& get_slab_alloc_ctx() {
         return slab_list_allocator_ctx_;
     }
-    __device__ __host__ MemoryAllocContext<thrust::pair<_Key, _Value>>
+    __device__ __host__ MemoryAllocContext<pair_t<_Key, _Value>>
     get_pair_alloc_ctx() {
         return pair_allocator_ctx_;
     }
@@ -120,56 +474,148 @@ private:
                                                 const uint32_t lane_id,
                                                 _Key& ret);
     __device__ __forceinline__ int32_t WarpFindKey(const _Key& src_key,
+                                                   const uint32_t fingerprint,
                                                    const uint32_t lane_id,
                                                    const uint32_t unit_data);
+    __device__ __forceinline__ uint32_t
+    WarpFindKeys(const _Key& src_key,
+                 const uint32_t fingerprint,
+                 const uint32_t lane_id,
+                 const uint32_t unit_data);
     __device__ __forceinline__ int32_t WarpFindEmpty(const uint32_t unit_data);
 
-    __device__ __forceinline__ ptr_t AllocateSlab(const uint32_t lane_id);
+    /* A new slab to link after @tail_slab_ptr (HEAD_SLAB_PTR for the
+     * bucket head) */
+    __device__ __forceinline__ ptr_t AllocateSlab(const uint32_t lane_id,
+                                                  const ptr_t tail_slab_ptr);
+    /* A pool entry holding (@key, @value), EMPTY_PAIR_PTR if the pool is
+     * full; per lane, shared by the warp and the scalar operations */
+    __device__ __forceinline__ ptr_t AllocatePair(const _Key& key,
+                                                  const _Value& value);
+
+#ifdef SLABHASH_BACKEND_CPU
+    /* Scalar counterparts of the warp primitives:
+     * @slab is a snapshot of the 32 words of a slab, @empty_lanes its
+     * ballot of empty pair lanes (SlabProbe) */
+    int32_t FindKey(const _Key& key,
+                    const uint32_t fingerprint,
+                    const ptr_t* slab,
+                    const uint32_t empty_lanes);
+    uint32_t FindKeys(const _Key& key,
+                      const uint32_t fingerprint,
+                      const ptr_t* slab,
+                      const uint32_t empty_lanes);
+    int32_t FindEmpty(const uint32_t empty_lanes);
+
+    ptr_t* get_slab_ptr(const uint32_t bucket_id, const ptr_t slab_ptr);
+    ptr_t AllocateSlab(const ptr_t tail_slab_ptr);
+#endif
     __device__ __forceinline__ void FreeSlab(const ptr_t slab_ptr);
 
 private:
     uint32_t num_buckets_;
+    uint32_t split_bucket_;
     _Hash hash_fn_;
 
+    /* High bits of a slab word holding a fingerprint, 0 if disabled */
+    uint32_t fingerprint_mask_;
+
+    bool near_tail_allocation_;
+
     Slab* bucket_list_head_;
     SlabAllocContext slab_list_allocator_ctx_;
-    MemoryAllocContext<thrust::pair<_Key, _Value>> pair_allocator_ctx_;
+    MemoryAllocContext<pair_t<_Key, _Value>> pair_allocator_ctx_;
 };
 
 /**
  * Definitions
  **/
-template <typename _Key, typename _Value, typename _Hash>
-SlabHashContext<_Key, _Value, _Hash>::SlabHashContext()
-    : num_buckets_(0), bucket_list_head_(nullptr) {
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+SlabHashContext<_Key, _Value, _Hash, _Inline>::SlabHashContext()
+    : num_buckets_(0),
+      split_bucket_(0),
+      fingerprint_mask_(0),
+      near_tail_allocation_(false),
+      bucket_list_head_(nullptr) {
     static_assert(sizeof(Slab) == (WARP_WIDTH * sizeof(ptr_t)));
 }
 
-template <typename _Key, typename _Value, typename _Hash>
-__host__ void SlabHashContext<_Key, _Value, _Hash>::Setup(
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__host__ void SlabHashContext<_Key, _Value, _Hash, _Inline>::Setup(
         Slab* bucket_list_head,
         const uint32_t num_buckets,
         const SlabAllocContext& allocator_ctx,
-        const MemoryAllocContext<thrust::pair<_Key, _Value>>&
-                pair_allocator_ctx) {
+        const MemoryAllocContext<pair_t<_Key, _Value>>& pair_allocator_ctx,
+        const uint32_t fingerprint_bits /* = 0 */) {
     bucket_list_head_ = bucket_list_head;
 
     num_buckets_ = num_buckets;
     slab_list_allocator_ctx_ = allocator_ctx;
     pair_allocator_ctx_ = pair_allocator_ctx;
+
+    assert(fingerprint_bits <= MAX_FINGERPRINT_BITS);
+    fingerprint_mask_ = ~(0xFFFFFFFF >> fingerprint_bits);
 }
 
-template <typename _Key, typename _Value, typename _Hash>
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__host__ void SlabHashContext<_Key, _Value, _Hash, _Inline>::SetBuckets(
+        Slab* bucket_list_head,
+        const uint32_t num_buckets,
+        const uint32_t split_bucket /* = 0 */) {
+    bucket_list_head_ = bucket_list_head;
+    num_buckets_ = num_buckets;
+    split_bucket_ = split_bucket;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__host__ void SlabHashContext<_Key, _Value, _Hash, _Inline>::SetPairAllocator(
+        const MemoryAllocContext<pair_t<_Key, _Value>>& pair_allocator_ctx) {
+    pair_allocator_ctx_ = pair_allocator_ctx;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__host__ void SlabHashContext<_Key, _Value, _Hash, _Inline>::SetSlabAllocator(
+        const SlabAllocContext& slab_alloc_ctx) {
+    slab_list_allocator_ctx_ = slab_alloc_ctx;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__host__ void
+SlabHashContext<_Key, _Value, _Hash, _Inline>::SetNearTailAllocation(
+        const bool near_tail_allocation) {
+    near_tail_allocation_ = near_tail_allocation;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
 __device__ __host__ __forceinline__ uint32_t
-SlabHashContext<_Key, _Value, _Hash>::ComputeBucket(const _Key& key) const {
-    return hash_fn_(key) % num_buckets_;
+SlabHashContext<_Key, _Value, _Hash, _Inline>::ComputeBucket(
+        const _Key& key) const {
+    uint64_t hash = hash_fn_(key);
+    uint32_t bucket_id = hash % num_buckets_;
+    return (bucket_id < split_bucket_) ? hash % (2 * num_buckets_) : bucket_id;
 }
 
-template <typename _Key, typename _Value, typename _Hash>
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__device__ __host__ __forceinline__ uint32_t
+SlabHashContext<_Key, _Value, _Hash, _Inline>::ComputeSplitBucket(
+        const _Key& key) const {
+    return hash_fn_(key) % (2 * num_buckets_);
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__device__ __host__ __forceinline__ uint32_t
+SlabHashContext<_Key, _Value, _Hash, _Inline>::ComputeFingerprint(
+        const _Key& key) const {
+    /* Multiplicative mixing: the high bits depend on all the hash bits, while
+     * the bucket mostly depends on the low ones */
+    uint64_t mixed = uint64_t(hash_fn_(key)) * UINT64_C(0x9E3779B97F4A7C15);
+    return uint32_t(mixed >> 32) & fingerprint_mask_;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
 __device__ __forceinline__ void
-SlabHashContext<_Key, _Value, _Hash>::WarpSyncKey(const _Key& key,
-                                                  const uint32_t lane_id,
-                                                  _Key& ret) {
+SlabHashContext<_Key, _Value, _Hash, _Inline>::WarpSyncKey(
+        const _Key& key, const uint32_t lane_id, _Key& ret) {
     const int chunks = sizeof(_Key) / sizeof(int);
 #pragma unroll 1
     for (size_t i = 0; i < chunks; ++i) {
@@ -178,46 +624,78 @@ SlabHashContext<_Key, _Value, _Hash>::WarpSyncKey(const _Key& key,
     }
 }
 
-template <typename _Key, typename _Value, typename _Hash>
-__device__ int32_t SlabHashContext<_Key, _Value, _Hash>::WarpFindKey(
-        const _Key& key, const uint32_t lane_id, const ptr_t ptr) {
+/* Ballot of all the lanes holding @key */
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__device__ uint32_t SlabHashContext<_Key, _Value, _Hash, _Inline>::WarpFindKeys(
+        const _Key& key,
+        const uint32_t fingerprint,
+        const uint32_t lane_id,
+        const ptr_t ptr) {
     bool is_lane_found =
             /* select key lanes */
             ((1 << lane_id) & PAIR_PTR_LANES_MASK)
             /* validate key addrs */
             && (ptr != EMPTY_PAIR_PTR)
+            /* filter by fingerprint */
+            && (ptr & fingerprint_mask_) == fingerprint
             /* find keys in memory heap */
-            && pair_allocator_ctx_.extract(ptr).first == key;
+            && pair_allocator_ctx_.extract(DecodePairPtr(ptr)).first == key;
 
-    return __ffs(__ballot_sync(PAIR_PTR_LANES_MASK, is_lane_found)) - 1;
+    return __ballot_sync(PAIR_PTR_LANES_MASK, is_lane_found);
 }
 
-template <typename _Key, typename _Value, typename _Hash>
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__device__ int32_t SlabHashContext<_Key, _Value, _Hash, _Inline>::WarpFindKey(
+        const _Key& key,
+        const uint32_t fingerprint,
+        const uint32_t lane_id,
+        const ptr_t ptr) {
+    return __ffs(WarpFindKeys(key, fingerprint, lane_id, ptr)) - 1;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
 __device__ __forceinline__ int32_t
-SlabHashContext<_Key, _Value, _Hash>::WarpFindEmpty(const ptr_t ptr) {
+SlabHashContext<_Key, _Value, _Hash, _Inline>::WarpFindEmpty(const ptr_t ptr) {
     bool is_lane_empty = (ptr == EMPTY_PAIR_PTR);
 
     return __ffs(__ballot_sync(PAIR_PTR_LANES_MASK, is_lane_empty)) - 1;
 }
 
-template <typename _Key, typename _Value, typename _Hash>
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
 __device__ __forceinline__ ptr_t
-SlabHashContext<_Key, _Value, _Hash>::AllocateSlab(const uint32_t lane_id) {
-    return slab_list_allocator_ctx_.WarpAllocate(lane_id);
+SlabHashContext<_Key, _Value, _Hash, _Inline>::AllocateSlab(
+        const uint32_t lane_id, const ptr_t tail_slab_ptr) {
+    return (near_tail_allocation_ && tail_slab_ptr != HEAD_SLAB_PTR)
+                   ? slab_list_allocator_ctx_.WarpAllocateNear(lane_id,
+                                                               tail_slab_ptr)
+                   : slab_list_allocator_ctx_.WarpAllocate(lane_id);
 }
 
-template <typename _Key, typename _Value, typename _Hash>
-__device__ __forceinline__ void SlabHashContext<_Key, _Value, _Hash>::FreeSlab(
-        const ptr_t slab_ptr) {
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__device__ __forceinline__ void
+SlabHashContext<_Key, _Value, _Hash, _Inline>::FreeSlab(const ptr_t slab_ptr) {
     slab_list_allocator_ctx_.FreeUntouched(slab_ptr);
 }
 
-template <typename _Key, typename _Value, typename _Hash>
-__device__ thrust::pair<iterator_t, bool>
-SlabHashContext<_Key, _Value, _Hash>::Search(bool& to_search,
-                                             const uint32_t lane_id,
-                                             const uint32_t bucket_id,
-                                             const _Key& query_key) {
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__device__ __forceinline__ ptr_t
+SlabHashContext<_Key, _Value, _Hash, _Inline>::AllocatePair(
+        const _Key& key, const _Value& value) {
+    ptr_t pair_ptr = pair_allocator_ctx_.Allocate();
+    if (pair_ptr != EMPTY_PAIR_PTR) {
+        pair_allocator_ctx_.extract(pair_ptr) =
+                pair_t<_Key, _Value>(key, value);
+    }
+    return pair_ptr;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__device__ pair_t<iterator_t, bool>
+SlabHashContext<_Key, _Value, _Hash, _Inline>::Search(
+        bool& to_search,
+        const uint32_t lane_id,
+        const uint32_t bucket_id,
+        const _Key& query_key) {
     uint32_t work_queue = 0;
     uint32_t prev_work_queue = work_queue;
     uint32_t curr_slab_ptr = HEAD_SLAB_PTR;
@@ -236,6 +714,7 @@ SlabHashContext<_Key, _Value, _Hash>::Search(bool& to_search,
 
         _Key src_key;
         WarpSyncKey(query_key, src_lane, src_key);
+        uint32_t src_fingerprint = ComputeFingerprint(src_key);
 
         /* Each lane in the warp reads a uint in the slab in parallel */
         const uint32_t unit_data =
@@ -244,7 +723,8 @@ SlabHashContext<_Key, _Value, _Hash>::Search(bool& to_search,
                         : *(get_unit_ptr_from_list_nodes(curr_slab_ptr,
                                                          lane_id));
 
-        int32_t lane_found = WarpFindKey(src_key, lane_id, unit_data);
+        int32_t lane_found = WarpFindKey(src_key, src_fingerprint, lane_id,
+                                         unit_data);
 
         /** 1. Found in this slab, SUCCEED **/
         if (lane_found >= 0) {
@@ -255,7 +735,7 @@ SlabHashContext<_Key, _Value, _Hash>::Search(bool& to_search,
             if (lane_id == src_lane) {
                 to_search = false;
 
-                iterator = found_pair_internal_ptr;
+                iterator = DecodePairPtr(found_pair_internal_ptr);
                 mask = true;
             }
         }
@@ -281,7 +761,7 @@ SlabHashContext<_Key, _Value, _Hash>::Search(bool& to_search,
         prev_work_queue = work_queue;
     }
 
-    return thrust::make_pair(iterator, mask);
+    return pair_t<iterator_t, bool>(iterator, mask);
 }
 
 /*
@@ -289,13 +769,14 @@ SlabHashContext<_Key, _Value, _Hash>::Search(bool& to_search,
  * replacePair: REPLACE if found
  * WE DO NOT ALLOW DUPLICATE KEYS
  */
-template <typename _Key, typename _Value, typename _Hash>
-__device__ thrust::pair<iterator_t, bool>
-SlabHashContext<_Key, _Value, _Hash>::Insert(bool& to_be_inserted,
-                                             const uint32_t lane_id,
-                                             const uint32_t bucket_id,
-                                             const _Key& key,
-                                             const _Value& value) {
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__device__ pair_t<iterator_t, bool>
+SlabHashContext<_Key, _Value, _Hash, _Inline>::Insert(
+        bool& to_be_inserted,
+        const uint32_t lane_id,
+        const uint32_t bucket_id,
+        const _Key& key,
+        const _Value& value) {
     uint32_t work_queue = 0;
     uint32_t prev_work_queue = 0;
     uint32_t curr_slab_ptr = HEAD_SLAB_PTR;
@@ -305,11 +786,15 @@ SlabHashContext<_Key, _Value, _Hash>::Insert(bool& to_be_inserted,
 
     /** WARNING: Allocation should be finished in warp,
      * results are unexpected otherwise **/
-    int prealloc_pair_internal_ptr = EMPTY_PAIR_PTR;
+    ptr_t prealloc_pair_internal_ptr = EMPTY_PAIR_PTR;
     if (to_be_inserted) {
-        prealloc_pair_internal_ptr = pair_allocator_ctx_.Allocate();
-        pair_allocator_ctx_.extract(prealloc_pair_internal_ptr) =
-                thrust::make_pair(key, value);
+        prealloc_pair_internal_ptr = AllocatePair(key, value);
+
+        /** Pair pool full: ABORT **/
+        if (prealloc_pair_internal_ptr == EMPTY_PAIR_PTR) {
+            to_be_inserted = false;
+            iterator = OUT_OF_CAPACITY_ITERATOR;
+        }
     }
 
     /** > Loop when we have active lanes **/
@@ -322,6 +807,7 @@ SlabHashContext<_Key, _Value, _Hash>::Insert(bool& to_be_inserted,
                 __shfl_sync(ACTIVE_LANES_MASK, bucket_id, src_lane, WARP_WIDTH);
         _Key src_key;
         WarpSyncKey(key, src_lane, src_key);
+        uint32_t src_fingerprint = ComputeFingerprint(src_key);
 
         /* Each lane in the warp reads a uint in the slab */
         uint32_t unit_data =
@@ -330,7 +816,8 @@ SlabHashContext<_Key, _Value, _Hash>::Insert(bool& to_be_inserted,
                         : *(get_unit_ptr_from_list_nodes(curr_slab_ptr,
                                                          lane_id));
 
-        int32_t lane_found = WarpFindKey(src_key, lane_id, unit_data);
+        int32_t lane_found = WarpFindKey(src_key, src_fingerprint, lane_id,
+                                         unit_data);
         int32_t lane_empty = WarpFindEmpty(unit_data);
 
         /** Branch 1: key already existing, ABORT **/
@@ -352,9 +839,10 @@ SlabHashContext<_Key, _Value, _Hash>::Insert(bool& to_be_inserted,
                                                               lane_empty)
                                 : get_unit_ptr_from_list_nodes(curr_slab_ptr,
                                                                lane_empty);
-                ptr_t old_pair_internal_ptr =
-                        atomicCAS((unsigned int*)unit_data_ptr, EMPTY_PAIR_PTR,
-                                  prealloc_pair_internal_ptr);
+                ptr_t old_pair_internal_ptr = atomicCAS(
+                        (unsigned int*)unit_data_ptr, EMPTY_PAIR_PTR,
+                        EncodePairPtr(prealloc_pair_internal_ptr,
+                                      src_fingerprint));
 
                 /** Branch 2.1: SUCCEED **/
                 if (old_pair_internal_ptr == EMPTY_PAIR_PTR) {
@@ -386,7 +874,8 @@ SlabHashContext<_Key, _Value, _Hash>::Insert(bool& to_be_inserted,
 
             /** Branch 3.2: next slab empty, try to allocate one **/
             else {
-                ptr_t new_next_slab_ptr = AllocateSlab(lane_id);
+                ptr_t new_next_slab_ptr =
+                        AllocateSlab(lane_id, curr_slab_ptr);
 
                 if (lane_id == NEXT_SLAB_PTR_LANE) {
                     const uint32_t* unit_data_ptr =
@@ -415,11 +904,11 @@ SlabHashContext<_Key, _Value, _Hash>::Insert(bool& to_be_inserted,
         prev_work_queue = work_queue;
     }
 
-    return thrust::make_pair(iterator, mask);
+    return pair_t<iterator_t, bool>(iterator, mask);
 }
 
-template <typename _Key, typename _Value, typename _Hash>
-__device__ bool SlabHashContext<_Key, _Value, _Hash>::Remove(
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__device__ bool SlabHashContext<_Key, _Value, _Hash, _Inline>::Remove(
         bool& to_be_deleted,
         const uint32_t lane_id,
         const uint32_t bucket_id,
@@ -442,6 +931,7 @@ __device__ bool SlabHashContext<_Key, _Value, _Hash>::Remove(
 
         _Key src_key;
         WarpSyncKey(key, src_lane, src_key);
+        uint32_t src_fingerprint = ComputeFingerprint(src_key);
 
         const uint32_t unit_data =
                 (curr_slab_ptr == HEAD_SLAB_PTR)
@@ -449,7 +939,8 @@ __device__ bool SlabHashContext<_Key, _Value, _Hash>::Remove(
                         : *(get_unit_ptr_from_list_nodes(curr_slab_ptr,
                                                          lane_id));
 
-        int32_t lane_found = WarpFindKey(src_key, lane_id, unit_data);
+        int32_t lane_found = WarpFindKey(src_key, src_fingerprint, lane_id,
+                                         unit_data);
 
         /** Branch 1: key found **/
         if (lane_found >= 0) {
@@ -463,20 +954,19 @@ __device__ bool SlabHashContext<_Key, _Value, _Hash>::Remove(
                                                               lane_found)
                                 : get_unit_ptr_from_list_nodes(curr_slab_ptr,
                                                                lane_found);
-                ptr_t pair_to_delete = *unit_data_ptr;
-
-                // TODO: keep in mind the potential double free problem
                 ptr_t old_key_value_pair =
                         atomicCAS((unsigned int*)(unit_data_ptr),
-                                  pair_to_delete, EMPTY_PAIR_PTR);
+                                  src_pair_internal_ptr, EMPTY_PAIR_PTR);
                 /** Branch 1.1: this thread reset, free src_addr **/
-                if (old_key_value_pair == pair_to_delete) {
-                    pair_allocator_ctx_.Free(src_pair_internal_ptr);
+                if (old_key_value_pair == src_pair_internal_ptr) {
+                    pair_allocator_ctx_.Free(
+                            DecodePairPtr(src_pair_internal_ptr));
                     mask = true;
+                    to_be_deleted = false;
                 }
-                /** Branch 1.2: other thread did the job, avoid double free
-                 * **/
-                to_be_deleted = false;
+                /** Branch 1.2: other thread removed this pair, avoid double
+                 * free and RESTART lane: with duplicate keys, another copy
+                 * may still be stored further down the list **/
             }
         } else {  // no matching slot found:
             ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
@@ -494,144 +984,1551 @@ __device__ bool SlabHashContext<_Key, _Value, _Hash>::Remove(
     return mask;
 }
 
-//=== Individual search kernel:
-template <typename _Key, typename _Value, typename _Hash>
-__global__ void SearchKernel(SlabHashContext<_Key, _Value, _Hash> slab_hash_ctx,
-                             _Key* keys,
-                             _Value* values,
-                             uint8_t* founds,
-                             uint32_t num_queries) {
-    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
-    uint32_t lane_id = threadIdx.x & 0x1F;
+/*
+ * InsertOrAssign: REPLACE the value if found
+ */
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__device__ pair_t<iterator_t, bool>
+SlabHashContext<_Key, _Value, _Hash, _Inline>::InsertOrAssign(
+        bool& to_be_inserted,
+        const uint32_t lane_id,
+        const uint32_t bucket_id,
+        const _Key& key,
+        const _Value& value) {
+    uint32_t work_queue = 0;
+    uint32_t prev_work_queue = 0;
+    uint32_t curr_slab_ptr = HEAD_SLAB_PTR;
 
-    /* This warp is idle */
-    if ((tid - lane_id) >= num_queries) {
-        return;
-    }
+    iterator_t iterator = NULL_ITERATOR;
+    bool mask = false;
 
-    /* Initialize the memory allocator on each warp */
-    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+    /* Allocated by the source lane on its first attempt in Branch 2, and
+     * kept for the following attempts */
+    ptr_t prealloc_pair_internal_ptr = EMPTY_PAIR_PTR;
 
-    bool lane_active = false;
-    uint32_t bucket_id = 0;
-    _Key key;
+    /** > Loop when we have active lanes **/
+    while ((work_queue = __ballot_sync(ACTIVE_LANES_MASK, to_be_inserted))) {
+        /** 0. Restart from linked list head if last insertion is finished **/
+        curr_slab_ptr =
+                (prev_work_queue != work_queue) ? HEAD_SLAB_PTR : curr_slab_ptr;
+        uint32_t src_lane = __ffs(work_queue) - 1;
+        uint32_t src_bucket =
+                __shfl_sync(ACTIVE_LANES_MASK, bucket_id, src_lane, WARP_WIDTH);
+        _Key src_key;
+        WarpSyncKey(key, src_lane, src_key);
+        uint32_t src_fingerprint = ComputeFingerprint(src_key);
 
-    if (tid < num_queries) {
-        lane_active = true;
-        key = keys[tid];
-        bucket_id = slab_hash_ctx.ComputeBucket(key);
-    }
+        uint32_t unit_data =
+                (curr_slab_ptr == HEAD_SLAB_PTR)
+                        ? *(get_unit_ptr_from_list_head(src_bucket, lane_id))
+                        : *(get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                         lane_id));
 
-    thrust::pair<iterator_t, bool> result =
-            slab_hash_ctx.Search(lane_active, lane_id, bucket_id, key);
+        int32_t lane_found = WarpFindKey(src_key, src_fingerprint, lane_id,
+                                         unit_data);
+        int32_t lane_empty = WarpFindEmpty(unit_data);
 
-    if (tid < num_queries) {
-        bool found = result.second;
-        founds[tid] = found;
-        values[tid] = found ? slab_hash_ctx.get_pair_alloc_ctx()
-                                      .extract(result.first)
-                                      .second
-                            : _Value(0);
-    }
-}
+        /** Branch 1: key already existing, REPLACE the value **/
+        if (lane_found >= 0) {
+            ptr_t found_pair_internal_ptr = __shfl_sync(
+                    ACTIVE_LANES_MASK, unit_data, lane_found, WARP_WIDTH);
 
-template <typename _Key, typename _Value, typename _Hash>
-__global__ void InsertKernel(SlabHashContext<_Key, _Value, _Hash> slab_hash_ctx,
-                             _Key* keys,
-                             _Value* values,
-                             uint32_t num_keys) {
-    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
-    uint32_t lane_id = threadIdx.x & 0x1F;
+            if (lane_id == src_lane) {
+                to_be_inserted = false;
 
-    if ((tid - lane_id) >= num_keys) {
-        return;
-    }
+                iterator = DecodePairPtr(found_pair_internal_ptr);
+                pair_allocator_ctx_.extract(iterator).second = value;
+                if (prealloc_pair_internal_ptr != EMPTY_PAIR_PTR) {
+                    pair_allocator_ctx_.Free(prealloc_pair_internal_ptr);
+                }
+            }
+        }
 
-    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+        /** Branch 2: empty slot available, try to insert **/
+        else if (lane_empty >= 0) {
+            if (lane_id == src_lane &&
+                prealloc_pair_internal_ptr == EMPTY_PAIR_PTR) {
+                prealloc_pair_internal_ptr = AllocatePair(key, value);
 
-    bool lane_active = false;
-    uint32_t bucket_id = 0;
-    _Key key;
-    _Value value;
+                /** Branch 2.0: pair pool full, ABORT **/
+                if (prealloc_pair_internal_ptr == EMPTY_PAIR_PTR) {
+                    to_be_inserted = false;
+                    iterator = OUT_OF_CAPACITY_ITERATOR;
+                }
+            }
 
-    if (tid < num_keys) {
-        lane_active = true;
-        key = keys[tid];
-        value = values[tid];
-        bucket_id = slab_hash_ctx.ComputeBucket(key);
-    }
+            if (lane_id == src_lane && to_be_inserted) {
+                const uint32_t* unit_data_ptr =
+                        (curr_slab_ptr == HEAD_SLAB_PTR)
+                                ? get_unit_ptr_from_list_head(src_bucket,
+                                                              lane_empty)
+                                : get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                               lane_empty);
+                ptr_t old_pair_internal_ptr = atomicCAS(
+                        (unsigned int*)unit_data_ptr, EMPTY_PAIR_PTR,
+                        EncodePairPtr(prealloc_pair_internal_ptr,
+                                      src_fingerprint));
 
-    slab_hash_ctx.Insert(lane_active, lane_id, bucket_id, key, value);
-}
+                /** Branch 2.1: SUCCEED **/
+                if (old_pair_internal_ptr == EMPTY_PAIR_PTR) {
+                    to_be_inserted = false;
 
-template <typename _Key, typename _Value, typename _Hash>
-__global__ void RemoveKernel(SlabHashContext<_Key, _Value, _Hash> slab_hash_ctx,
-                             _Key* keys,
-                             uint32_t num_keys) {
-    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
-    uint32_t lane_id = threadIdx.x & 0x1F;
+                    iterator = prealloc_pair_internal_ptr;
+                    mask = true;
+                }
+                /** Branch 2.2: failed: RESTART **/
+            }
+        }
 
-    if ((tid - lane_id) >= num_keys) {
-        return;
-    }
+        /** Branch 3: nothing found in this slab, goto next slab **/
+        else {
+            ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                              NEXT_SLAB_PTR_LANE, WARP_WIDTH);
 
-    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+            /** Branch 3.1: next slab existing, RESTART this lane **/
+            if (next_slab_ptr != EMPTY_SLAB_PTR) {
+                curr_slab_ptr = next_slab_ptr;
+            }
 
-    bool lane_active = false;
-    uint32_t bucket_id = 0;
-    _Key key;
+            /** Branch 3.2: next slab empty, try to allocate one **/
+            else {
+                ptr_t new_next_slab_ptr =
+                        AllocateSlab(lane_id, curr_slab_ptr);
 
-    if (tid < num_keys) {
-        lane_active = true;
-        key = keys[tid];
-        bucket_id = slab_hash_ctx.ComputeBucket(key);
+                if (lane_id == NEXT_SLAB_PTR_LANE) {
+                    const uint32_t* unit_data_ptr =
+                            (curr_slab_ptr == HEAD_SLAB_PTR)
+                                    ? get_unit_ptr_from_list_head(
+                                              src_bucket, NEXT_SLAB_PTR_LANE)
+                                    : get_unit_ptr_from_list_nodes(
+                                              curr_slab_ptr,
+                                              NEXT_SLAB_PTR_LANE);
+
+                    ptr_t old_next_slab_ptr =
+                            atomicCAS((unsigned int*)unit_data_ptr,
+                                      EMPTY_SLAB_PTR, new_next_slab_ptr);
+
+                    /** Branch 3.2.1: other thread allocated, RESTART lane **/
+                    if (old_next_slab_ptr != EMPTY_SLAB_PTR) {
+                        FreeSlab(new_next_slab_ptr);
+                    }
+                    /** Branch 3.2.2: this thread allocated, RESTART lane **/
+                }
+            }
+        }
+
+        prev_work_queue = work_queue;
     }
 
-    slab_hash_ctx.Remove(lane_active, lane_id, bucket_id, key);
+    return pair_t<iterator_t, bool>(iterator, mask);
 }
 
 /*
- * This kernel can be used to compute total number of elements within each
- * bucket. The final results per bucket is stored in d_count_result array
+ * InsertOrReduce: COMBINE the values with @reduce if found
  */
-template <typename _Key, typename _Value, typename _Hash>
-__global__ void bucket_count_kernel(
-        SlabHashContext<_Key, _Value, _Hash> slab_hash_ctx,
-        uint32_t* d_count_result,
-        uint32_t num_buckets) {
-    // global warp ID
-    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
-    uint32_t wid = tid >> 5;
-    // assigning a warp per bucket
-    if (wid >= num_buckets) {
-        return;
-    }
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+template <typename _Reduce>
+__device__ pair_t<iterator_t, bool>
+SlabHashContext<_Key, _Value, _Hash, _Inline>::InsertOrReduce(
+        bool& to_be_inserted,
+        const uint32_t lane_id,
+        const uint32_t bucket_id,
+        const _Key& key,
+        const _Value& value,
+        const _Reduce& reduce) {
+    uint32_t work_queue = 0;
+    uint32_t prev_work_queue = 0;
+    uint32_t curr_slab_ptr = HEAD_SLAB_PTR;
 
-    uint32_t lane_id = threadIdx.x & 0x1F;
+    iterator_t iterator = NULL_ITERATOR;
+    bool mask = false;
 
-    // initializing the memory allocator on each warp:
-    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+    /* Allocated by the source lane on its first attempt in Branch 2, and
+     * kept for the following attempts */
+    ptr_t prealloc_pair_internal_ptr = EMPTY_PAIR_PTR;
 
-    uint32_t count = 0;
+    /** > Loop when we have active lanes **/
+    while ((work_queue = __ballot_sync(ACTIVE_LANES_MASK, to_be_inserted))) {
+        /** 0. Restart from linked list head if last insertion is finished **/
+        curr_slab_ptr =
+                (prev_work_queue != work_queue) ? HEAD_SLAB_PTR : curr_slab_ptr;
+        uint32_t src_lane = __ffs(work_queue) - 1;
+        uint32_t src_bucket =
+                __shfl_sync(ACTIVE_LANES_MASK, bucket_id, src_lane, WARP_WIDTH);
+        _Key src_key;
+        WarpSyncKey(key, src_lane, src_key);
+        uint32_t src_fingerprint = ComputeFingerprint(src_key);
 
-    uint32_t src_unit_data =
-            *slab_hash_ctx.get_unit_ptr_from_list_head(wid, lane_id);
+        uint32_t unit_data =
+                (curr_slab_ptr == HEAD_SLAB_PTR)
+                        ? *(get_unit_ptr_from_list_head(src_bucket, lane_id))
+                        : *(get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                         lane_id));
 
-    count += __popc(__ballot_sync(PAIR_PTR_LANES_MASK,
-                                  src_unit_data != EMPTY_PAIR_PTR));
-    uint32_t next = __shfl_sync(0xFFFFFFFF, src_unit_data, 31, 32);
+        int32_t lane_found = WarpFindKey(src_key, src_fingerprint, lane_id,
+                                         unit_data);
+        int32_t lane_empty = WarpFindEmpty(unit_data);
 
-    while (next != EMPTY_SLAB_PTR) {
-        src_unit_data =
-                *slab_hash_ctx.get_unit_ptr_from_list_nodes(next, lane_id);
-        count += __popc(__ballot_sync(PAIR_PTR_LANES_MASK,
+        /** Branch 1: key already existing, COMBINE the values **/
+        if (lane_found >= 0) {
+            ptr_t found_pair_internal_ptr = __shfl_sync(
+                    ACTIVE_LANES_MASK, unit_data, lane_found, WARP_WIDTH);
+
+            if (lane_id == src_lane) {
+                to_be_inserted = false;
+
+                iterator = DecodePairPtr(found_pair_internal_ptr);
+                reduce(&pair_allocator_ctx_.extract(iterator).second, value);
+                if (prealloc_pair_internal_ptr != EMPTY_PAIR_PTR) {
+                    pair_allocator_ctx_.Free(prealloc_pair_internal_ptr);
+                }
+            }
+        }
+
+        /** Branch 2: empty slot available, try to insert **/
+        else if (lane_empty >= 0) {
+            if (lane_id == src_lane &&
+                prealloc_pair_internal_ptr == EMPTY_PAIR_PTR) {
+                prealloc_pair_internal_ptr = AllocatePair(key, value);
+
+                /** Branch 2.0: pair pool full, ABORT **/
+                if (prealloc_pair_internal_ptr == EMPTY_PAIR_PTR) {
+                    to_be_inserted = false;
+                    iterator = OUT_OF_CAPACITY_ITERATOR;
+                }
+            }
+
+            if (lane_id == src_lane && to_be_inserted) {
+                const uint32_t* unit_data_ptr =
+                        (curr_slab_ptr == HEAD_SLAB_PTR)
+                                ? get_unit_ptr_from_list_head(src_bucket,
+                                                              lane_empty)
+                                : get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                               lane_empty);
+                ptr_t old_pair_internal_ptr = atomicCAS(
+                        (unsigned int*)unit_data_ptr, EMPTY_PAIR_PTR,
+                        EncodePairPtr(prealloc_pair_internal_ptr,
+                                      src_fingerprint));
+
+                /** Branch 2.1: SUCCEED **/
+                if (old_pair_internal_ptr == EMPTY_PAIR_PTR) {
+                    to_be_inserted = false;
+
+                    iterator = prealloc_pair_internal_ptr;
+                    mask = true;
+                }
+                /** Branch 2.2: failed: RESTART **/
+            }
+        }
+
+        /** Branch 3: nothing found in this slab, goto next slab **/
+        else {
+            ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                              NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+
+            /** Branch 3.1: next slab existing, RESTART this lane **/
+            if (next_slab_ptr != EMPTY_SLAB_PTR) {
+                curr_slab_ptr = next_slab_ptr;
+            }
+
+            /** Branch 3.2: next slab empty, try to allocate one **/
+            else {
+                ptr_t new_next_slab_ptr =
+                        AllocateSlab(lane_id, curr_slab_ptr);
+
+                if (lane_id == NEXT_SLAB_PTR_LANE) {
+                    const uint32_t* unit_data_ptr =
+                            (curr_slab_ptr == HEAD_SLAB_PTR)
+                                    ? get_unit_ptr_from_list_head(
+                                              src_bucket, NEXT_SLAB_PTR_LANE)
+                                    : get_unit_ptr_from_list_nodes(
+                                              curr_slab_ptr,
+                                              NEXT_SLAB_PTR_LANE);
+
+                    ptr_t old_next_slab_ptr =
+                            atomicCAS((unsigned int*)unit_data_ptr,
+                                      EMPTY_SLAB_PTR, new_next_slab_ptr);
+
+                    /** Branch 3.2.1: other thread allocated, RESTART lane **/
+                    if (old_next_slab_ptr != EMPTY_SLAB_PTR) {
+                        FreeSlab(new_next_slab_ptr);
+                    }
+                    /** Branch 3.2.2: this thread allocated, RESTART lane **/
+                }
+            }
+        }
+
+        prev_work_queue = work_queue;
+    }
+
+    return pair_t<iterator_t, bool>(iterator, mask);
+}
+
+/*
+ * UpdateExisting: Search, and REPLACE the value if found
+ */
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__device__ bool SlabHashContext<_Key, _Value, _Hash, _Inline>::UpdateExisting(
+        bool& to_update,
+        const uint32_t lane_id,
+        const uint32_t bucket_id,
+        const _Key& key,
+        const _Value& value) {
+    uint32_t work_queue = 0;
+    uint32_t prev_work_queue = work_queue;
+    uint32_t curr_slab_ptr = HEAD_SLAB_PTR;
+
+    bool mask = false;
+
+    /** > Loop when we have active lanes **/
+    while ((work_queue = __ballot_sync(ACTIVE_LANES_MASK, to_update))) {
+        /** 0. Restart from linked list head if the last query is finished **/
+        curr_slab_ptr =
+                (prev_work_queue != work_queue) ? HEAD_SLAB_PTR : curr_slab_ptr;
+        uint32_t src_lane = __ffs(work_queue) - 1;
+        uint32_t src_bucket =
+                __shfl_sync(ACTIVE_LANES_MASK, bucket_id, src_lane, WARP_WIDTH);
+
+        _Key src_key;
+        WarpSyncKey(key, src_lane, src_key);
+        uint32_t src_fingerprint = ComputeFingerprint(src_key);
+
+        const uint32_t unit_data =
+                (curr_slab_ptr == HEAD_SLAB_PTR)
+                        ? *(get_unit_ptr_from_list_head(src_bucket, lane_id))
+                        : *(get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                         lane_id));
+
+        int32_t lane_found = WarpFindKey(src_key, src_fingerprint, lane_id,
+                                         unit_data);
+
+        /** 1. Found in this slab, REPLACE the value **/
+        if (lane_found >= 0) {
+            ptr_t found_pair_internal_ptr = __shfl_sync(
+                    ACTIVE_LANES_MASK, unit_data, lane_found, WARP_WIDTH);
+
+            if (lane_id == src_lane) {
+                to_update = false;
+
+                pair_allocator_ctx_
+                        .extract(DecodePairPtr(found_pair_internal_ptr))
+                        .second = value;
+                mask = true;
+            }
+        }
+
+        /** 2. Not found in this slab **/
+        else {
+            ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                              NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+
+            /** 2.1. Next slab is empty, ABORT **/
+            if (next_slab_ptr == EMPTY_SLAB_PTR) {
+                if (lane_id == src_lane) {
+                    to_update = false;
+                }
+            }
+            /** 2.2. Next slab exists, RESTART **/
+            else {
+                curr_slab_ptr = next_slab_ptr;
+            }
+        }
+
+        prev_work_queue = work_queue;
+    }
+
+    return mask;
+}
+
+/*
+ * InsertMulti: Insert without Branch 1, duplicate keys are kept
+ */
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__device__ iterator_t
+SlabHashContext<_Key, _Value, _Hash, _Inline>::InsertMulti(
+        bool& to_be_inserted,
+        const uint32_t lane_id,
+        const uint32_t bucket_id,
+        const _Key& key,
+        const _Value& value) {
+    uint32_t work_queue = 0;
+    uint32_t prev_work_queue = 0;
+    uint32_t curr_slab_ptr = HEAD_SLAB_PTR;
+
+    iterator_t iterator = NULL_ITERATOR;
+
+    ptr_t prealloc_pair_internal_ptr = EMPTY_PAIR_PTR;
+    if (to_be_inserted) {
+        prealloc_pair_internal_ptr = AllocatePair(key, value);
+
+        /** Pair pool full: ABORT **/
+        if (prealloc_pair_internal_ptr == EMPTY_PAIR_PTR) {
+            to_be_inserted = false;
+            iterator = OUT_OF_CAPACITY_ITERATOR;
+        }
+    }
+
+    /** > Loop when we have active lanes **/
+    while ((work_queue = __ballot_sync(ACTIVE_LANES_MASK, to_be_inserted))) {
+        /** 0. Restart from linked list head if last insertion is finished **/
+        curr_slab_ptr =
+                (prev_work_queue != work_queue) ? HEAD_SLAB_PTR : curr_slab_ptr;
+        uint32_t src_lane = __ffs(work_queue) - 1;
+        uint32_t src_bucket =
+                __shfl_sync(ACTIVE_LANES_MASK, bucket_id, src_lane, WARP_WIDTH);
+        _Key src_key;
+        WarpSyncKey(key, src_lane, src_key);
+        uint32_t src_fingerprint = ComputeFingerprint(src_key);
+
+        uint32_t unit_data =
+                (curr_slab_ptr == HEAD_SLAB_PTR)
+                        ? *(get_unit_ptr_from_list_head(src_bucket, lane_id))
+                        : *(get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                         lane_id));
+
+        int32_t lane_empty = WarpFindEmpty(unit_data);
+
+        /** Branch 2: empty slot available, try to insert **/
+        if (lane_empty >= 0) {
+            if (lane_id == src_lane) {
+                const uint32_t* unit_data_ptr =
+                        (curr_slab_ptr == HEAD_SLAB_PTR)
+                                ? get_unit_ptr_from_list_head(src_bucket,
+                                                              lane_empty)
+                                : get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                               lane_empty);
+                ptr_t old_pair_internal_ptr = atomicCAS(
+                        (unsigned int*)unit_data_ptr, EMPTY_PAIR_PTR,
+                        EncodePairPtr(prealloc_pair_internal_ptr,
+                                      src_fingerprint));
+
+                /** Branch 2.1: SUCCEED **/
+                if (old_pair_internal_ptr == EMPTY_PAIR_PTR) {
+                    to_be_inserted = false;
+                    iterator = prealloc_pair_internal_ptr;
+                }
+                /** Branch 2.2: failed: RESTART **/
+            }
+        }
+
+        /** Branch 3: no empty slot in this slab, goto next slab **/
+        else {
+            ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                              NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+
+            /** Branch 3.1: next slab existing, RESTART this lane **/
+            if (next_slab_ptr != EMPTY_SLAB_PTR) {
+                curr_slab_ptr = next_slab_ptr;
+            }
+
+            /** Branch 3.2: next slab empty, try to allocate one **/
+            else {
+                ptr_t new_next_slab_ptr =
+                        AllocateSlab(lane_id, curr_slab_ptr);
+
+                if (lane_id == NEXT_SLAB_PTR_LANE) {
+                    const uint32_t* unit_data_ptr =
+                            (curr_slab_ptr == HEAD_SLAB_PTR)
+                                    ? get_unit_ptr_from_list_head(
+                                              src_bucket, NEXT_SLAB_PTR_LANE)
+                                    : get_unit_ptr_from_list_nodes(
+                                              curr_slab_ptr,
+                                              NEXT_SLAB_PTR_LANE);
+
+                    ptr_t old_next_slab_ptr =
+                            atomicCAS((unsigned int*)unit_data_ptr,
+                                      EMPTY_SLAB_PTR, new_next_slab_ptr);
+
+                    /** Branch 3.2.1: other thread allocated, RESTART lane **/
+                    if (old_next_slab_ptr != EMPTY_SLAB_PTR) {
+                        FreeSlab(new_next_slab_ptr);
+                    }
+                    /** Branch 3.2.2: this thread allocated, RESTART lane **/
+                }
+            }
+        }
+
+        prev_work_queue = work_queue;
+    }
+
+    return iterator;
+}
+
+/*
+ * Count: walk the whole chain, summing the ballots of matching lanes
+ */
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__device__ uint32_t SlabHashContext<_Key, _Value, _Hash, _Inline>::Count(
+        bool& to_count,
+        const uint32_t lane_id,
+        const uint32_t bucket_id,
+        const _Key& query_key) {
+    uint32_t work_queue = 0;
+    uint32_t prev_work_queue = work_queue;
+    uint32_t curr_slab_ptr = HEAD_SLAB_PTR;
+
+    uint32_t count = 0;
+
+    /** > Loop when we have active lanes **/
+    while ((work_queue = __ballot_sync(ACTIVE_LANES_MASK, to_count))) {
+        /** 0. Restart from linked list head if the last query is finished **/
+        curr_slab_ptr =
+                (prev_work_queue != work_queue) ? HEAD_SLAB_PTR : curr_slab_ptr;
+        uint32_t src_lane = __ffs(work_queue) - 1;
+        uint32_t src_bucket =
+                __shfl_sync(ACTIVE_LANES_MASK, bucket_id, src_lane, WARP_WIDTH);
+
+        _Key src_key;
+        WarpSyncKey(query_key, src_lane, src_key);
+        uint32_t src_fingerprint = ComputeFingerprint(src_key);
+
+        const uint32_t unit_data =
+                (curr_slab_ptr == HEAD_SLAB_PTR)
+                        ? *(get_unit_ptr_from_list_head(src_bucket, lane_id))
+                        : *(get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                         lane_id));
+
+        uint32_t found_lanes =
+                WarpFindKeys(src_key, src_fingerprint, lane_id, unit_data);
+        if (lane_id == src_lane) {
+            count += __popc(found_lanes);
+        }
+
+        ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                          NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+
+        /** 1. End of the chain, SUCCEED **/
+        if (next_slab_ptr == EMPTY_SLAB_PTR) {
+            if (lane_id == src_lane) {
+                to_count = false;
+            }
+        }
+        /** 2. Next slab exists, CONTINUE **/
+        else {
+            curr_slab_ptr = next_slab_ptr;
+        }
+
+        prev_work_queue = work_queue;
+    }
+
+    return count;
+}
+
+/*
+ * SearchAll: as Count, the matching lanes write their values in parallel
+ */
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__device__ uint32_t SlabHashContext<_Key, _Value, _Hash, _Inline>::SearchAll(
+        bool& to_search,
+        const uint32_t lane_id,
+        const uint32_t bucket_id,
+        const _Key& query_key,
+        _Value* values,
+        const uint32_t capacity) {
+    uint32_t work_queue = 0;
+    uint32_t prev_work_queue = work_queue;
+    uint32_t curr_slab_ptr = HEAD_SLAB_PTR;
+
+    /* Values written so far for the current query, uniform in the warp */
+    uint32_t src_written = 0;
+    uint32_t written = 0;
+
+    /** > Loop when we have active lanes **/
+    while ((work_queue = __ballot_sync(ACTIVE_LANES_MASK, to_search))) {
+        /** 0. Restart from linked list head if the last query is finished **/
+        if (prev_work_queue != work_queue) {
+            curr_slab_ptr = HEAD_SLAB_PTR;
+            src_written = 0;
+        }
+        uint32_t src_lane = __ffs(work_queue) - 1;
+        uint32_t src_bucket =
+                __shfl_sync(ACTIVE_LANES_MASK, bucket_id, src_lane, WARP_WIDTH);
+        _Value* src_values = reinterpret_cast<_Value*>(__shfl_sync(
+                ACTIVE_LANES_MASK, reinterpret_cast<uintptr_t>(values),
+                src_lane, WARP_WIDTH));
+        uint32_t src_capacity =
+                __shfl_sync(ACTIVE_LANES_MASK, capacity, src_lane, WARP_WIDTH);
+
+        _Key src_key;
+        WarpSyncKey(query_key, src_lane, src_key);
+        uint32_t src_fingerprint = ComputeFingerprint(src_key);
+
+        const uint32_t unit_data =
+                (curr_slab_ptr == HEAD_SLAB_PTR)
+                        ? *(get_unit_ptr_from_list_head(src_bucket, lane_id))
+                        : *(get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                         lane_id));
+
+        uint32_t found_lanes =
+                WarpFindKeys(src_key, src_fingerprint, lane_id, unit_data);
+
+        /* Each matching lane writes its value after the lower matching
+         * lanes */
+        if ((found_lanes >> lane_id) & 1) {
+            uint32_t rank =
+                    src_written + __popc(found_lanes & ((1u << lane_id) - 1));
+            if (rank < src_capacity) {
+                src_values[rank] = pair_allocator_ctx_
+                                           .extract(DecodePairPtr(unit_data))
+                                           .second;
+            }
+        }
+        src_written += __popc(found_lanes);
+        src_written = (src_written < src_capacity) ? src_written : src_capacity;
+
+        ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                          NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+
+        /** 1. End of the chain, SUCCEED **/
+        if (next_slab_ptr == EMPTY_SLAB_PTR) {
+            if (lane_id == src_lane) {
+                to_search = false;
+                written = src_written;
+            }
+        }
+        /** 2. Next slab exists, CONTINUE **/
+        else {
+            curr_slab_ptr = next_slab_ptr;
+        }
+
+        prev_work_queue = work_queue;
+    }
+
+    return written;
+}
+
+/*
+ * InsertPairPtr: InsertMulti of an already allocated pair, see Rehash
+ */
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__device__ void SlabHashContext<_Key, _Value, _Hash, _Inline>::InsertPairPtr(
+        bool& to_be_inserted,
+        const uint32_t lane_id,
+        const uint32_t bucket_id,
+        const ptr_t pair_ptr) {
+    uint32_t work_queue = 0;
+    uint32_t prev_work_queue = 0;
+    uint32_t curr_slab_ptr = HEAD_SLAB_PTR;
+
+    /** > Loop when we have active lanes **/
+    while ((work_queue = __ballot_sync(ACTIVE_LANES_MASK, to_be_inserted))) {
+        /** 0. Restart from linked list head if last insertion is finished **/
+        curr_slab_ptr =
+                (prev_work_queue != work_queue) ? HEAD_SLAB_PTR : curr_slab_ptr;
+        uint32_t src_lane = __ffs(work_queue) - 1;
+        uint32_t src_bucket =
+                __shfl_sync(ACTIVE_LANES_MASK, bucket_id, src_lane, WARP_WIDTH);
+
+        uint32_t unit_data =
+                (curr_slab_ptr == HEAD_SLAB_PTR)
+                        ? *(get_unit_ptr_from_list_head(src_bucket, lane_id))
+                        : *(get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                         lane_id));
+
+        int32_t lane_empty = WarpFindEmpty(unit_data);
+
+        /** Branch 2: empty slot available, try to insert **/
+        if (lane_empty >= 0) {
+            if (lane_id == src_lane) {
+                const uint32_t* unit_data_ptr =
+                        (curr_slab_ptr == HEAD_SLAB_PTR)
+                                ? get_unit_ptr_from_list_head(src_bucket,
+                                                              lane_empty)
+                                : get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                               lane_empty);
+                ptr_t old_pair_internal_ptr =
+                        atomicCAS((unsigned int*)unit_data_ptr, EMPTY_PAIR_PTR,
+                                  pair_ptr);
+
+                /** Branch 2.1: SUCCEED **/
+                if (old_pair_internal_ptr == EMPTY_PAIR_PTR) {
+                    to_be_inserted = false;
+                }
+                /** Branch 2.2: failed: RESTART **/
+            }
+        }
+
+        /** Branch 3: no empty slot in this slab, goto next slab **/
+        else {
+            ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                              NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+
+            /** Branch 3.1: next slab existing, RESTART this lane **/
+            if (next_slab_ptr != EMPTY_SLAB_PTR) {
+                curr_slab_ptr = next_slab_ptr;
+            }
+
+            /** Branch 3.2: next slab empty, try to allocate one **/
+            else {
+                ptr_t new_next_slab_ptr =
+                        AllocateSlab(lane_id, curr_slab_ptr);
+
+                if (lane_id == NEXT_SLAB_PTR_LANE) {
+                    const uint32_t* unit_data_ptr =
+                            (curr_slab_ptr == HEAD_SLAB_PTR)
+                                    ? get_unit_ptr_from_list_head(
+                                              src_bucket, NEXT_SLAB_PTR_LANE)
+                                    : get_unit_ptr_from_list_nodes(
+                                              curr_slab_ptr,
+                                              NEXT_SLAB_PTR_LANE);
+
+                    ptr_t old_next_slab_ptr =
+                            atomicCAS((unsigned int*)unit_data_ptr,
+                                      EMPTY_SLAB_PTR, new_next_slab_ptr);
+
+                    /** Branch 3.2.1: other thread allocated, RESTART lane **/
+                    if (old_next_slab_ptr != EMPTY_SLAB_PTR) {
+                        FreeSlab(new_next_slab_ptr);
+                    }
+                    /** Branch 3.2.2: this thread allocated, RESTART lane **/
+                }
+            }
+        }
+
+        prev_work_queue = work_queue;
+    }
+}
+
+/*
+ * FreeChain: the slab allocator clears a slab when it hands it out, so the
+ * slabs are released as they are
+ */
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__device__ void SlabHashContext<_Key, _Value, _Hash, _Inline>::FreeChain(
+        const uint32_t lane_id, const uint32_t bucket_id) {
+    uint32_t unit_data = *get_unit_ptr_from_list_head(bucket_id, lane_id);
+    ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                      NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+
+    while (next_slab_ptr != EMPTY_SLAB_PTR) {
+        ptr_t curr_slab_ptr = next_slab_ptr;
+        ptr_t* unit_data_ptr =
+                get_unit_ptr_from_list_nodes(curr_slab_ptr, lane_id);
+        unit_data = *unit_data_ptr;
+        next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                    NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+
+        if (lane_id == 0) {
+            FreeSlab(curr_slab_ptr);
+        }
+    }
+}
+
+/*
+ * SplitBucket: no other operation runs on either bucket meanwhile, so the
+ * moved lanes are simply overwritten
+ */
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__device__ void SlabHashContext<_Key, _Value, _Hash, _Inline>::SplitBucket(
+        const uint32_t lane_id, const uint32_t bucket_id) {
+    const uint32_t split_bucket_id = bucket_id + num_buckets_;
+    uint32_t curr_slab_ptr = HEAD_SLAB_PTR;
+
+    while (true) {
+        ptr_t* unit_data_ptr =
+                (curr_slab_ptr == HEAD_SLAB_PTR)
+                        ? get_unit_ptr_from_list_head(bucket_id, lane_id)
+                        : get_unit_ptr_from_list_nodes(curr_slab_ptr, lane_id);
+        uint32_t unit_data = *unit_data_ptr;
+
+        bool to_be_moved = false;
+        if (lane_id < NEXT_SLAB_PTR_LANE && unit_data != EMPTY_PAIR_PTR) {
+            const _Key& key =
+                    pair_allocator_ctx_.extract(DecodePairPtr(unit_data)).first;
+            to_be_moved = ComputeSplitBucket(key) == split_bucket_id;
+        }
+        if (to_be_moved) {
+            *unit_data_ptr = EMPTY_PAIR_PTR;
+        }
+        InsertPairPtr(to_be_moved, lane_id, split_bucket_id, unit_data);
+
+        ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                          NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+        if (next_slab_ptr == EMPTY_SLAB_PTR) break;
+        curr_slab_ptr = next_slab_ptr;
+    }
+}
+
+/*
+ * CompactBucket: the i-th live word of the chain goes to lane i % 31 of its
+ * i / 31-th slab. That is never past its own position, so the destination
+ * (dst) slab trails the source slab, and a slab is read whole by the warp
+ * before any lane writes over it. No other operation runs on the bucket
+ * meanwhile.
+ */
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__device__ void SlabHashContext<_Key, _Value, _Hash, _Inline>::CompactBucket(
+        const uint32_t lane_id, const uint32_t bucket_id) {
+    ptr_t src_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t dst_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t prev_dst_slab_ptr = EMPTY_SLAB_PTR;
+    uint32_t dst_count = 0;
+
+    while (src_slab_ptr != EMPTY_SLAB_PTR) {
+        uint32_t unit_data =
+                (src_slab_ptr == HEAD_SLAB_PTR)
+                        ? *get_unit_ptr_from_list_head(bucket_id, lane_id)
+                        : *get_unit_ptr_from_list_nodes(src_slab_ptr, lane_id);
+        uint32_t dst_unit_data =
+                (dst_slab_ptr == HEAD_SLAB_PTR)
+                        ? *get_unit_ptr_from_list_head(bucket_id, lane_id)
+                        : *get_unit_ptr_from_list_nodes(dst_slab_ptr, lane_id);
+        ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                          NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+        ptr_t next_dst_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, dst_unit_data,
+                                              NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+
+        bool is_live =
+                lane_id < NEXT_SLAB_PTR_LANE && unit_data != EMPTY_PAIR_PTR;
+        uint32_t live_lanes = __ballot_sync(ACTIVE_LANES_MASK, is_live);
+
+        /** Branch 1: pack the live words, overflowing into the next slab **/
+        if (is_live) {
+            uint32_t position =
+                    dst_count + __popc(live_lanes & ((1u << lane_id) - 1));
+            ptr_t slab_ptr = dst_slab_ptr;
+            if (position >= NEXT_SLAB_PTR_LANE) {
+                slab_ptr = next_dst_slab_ptr;
+                position -= NEXT_SLAB_PTR_LANE;
+            }
+            *((slab_ptr == HEAD_SLAB_PTR)
+                      ? get_unit_ptr_from_list_head(bucket_id, position)
+                      : get_unit_ptr_from_list_nodes(slab_ptr, position)) =
+                    unit_data;
+        }
+        dst_count += __popc(live_lanes);
+        if (dst_count >= NEXT_SLAB_PTR_LANE) {
+            prev_dst_slab_ptr = dst_slab_ptr;
+            dst_slab_ptr = next_dst_slab_ptr;
+            dst_count -= NEXT_SLAB_PTR_LANE;
+        }
+        src_slab_ptr = next_slab_ptr;
+    }
+
+    /** Branch 2: the last dst slab is empty, cut the chain before it **/
+    ptr_t last_slab_ptr = dst_slab_ptr;
+    if (dst_count == 0 && dst_slab_ptr != HEAD_SLAB_PTR) {
+        last_slab_ptr = prev_dst_slab_ptr;
+    }
+    ptr_t* unit_data_ptr =
+            (last_slab_ptr == HEAD_SLAB_PTR)
+                    ? get_unit_ptr_from_list_head(bucket_id, lane_id)
+                    : get_unit_ptr_from_list_nodes(last_slab_ptr, lane_id);
+    ptr_t free_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, *unit_data_ptr,
+                                      NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+    if (lane_id == NEXT_SLAB_PTR_LANE) {
+        *unit_data_ptr = EMPTY_SLAB_PTR;
+    } else if (last_slab_ptr == dst_slab_ptr && lane_id >= dst_count) {
+        *unit_data_ptr = EMPTY_PAIR_PTR;
+    }
+
+    /** Branch 3: free the unlinked slabs **/
+    while (free_slab_ptr != EMPTY_SLAB_PTR) {
+        ptr_t next_slab_ptr = __shfl_sync(
+                ACTIVE_LANES_MASK,
+                *get_unit_ptr_from_list_nodes(free_slab_ptr, lane_id),
+                NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+        if (lane_id == 0) {
+            FreeSlab(free_slab_ptr);
+        }
+        free_slab_ptr = next_slab_ptr;
+    }
+}
+
+/*
+ * BuildBucket: the warp takes the keys 32 at a time, a key per lane, and
+ * drops those already in the chain or held by a lower lane. The others
+ * are written after the tail lane in lane order, new slabs being linked
+ * as the tail fills up: no other warp writes to the bucket, so neither
+ * the slots nor the links need a CAS.
+ */
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+__device__ void SlabHashContext<_Key, _Value, _Hash, _Inline>::BuildBucket(
+        const uint32_t lane_id,
+        const uint32_t bucket_id,
+        const _Key* keys,
+        const _Value* values,
+        const uint32_t* order,
+        const uint32_t num_keys) {
+    /** Branch 1: find the tail slab and the lane after its last pair **/
+    ptr_t tail_slab_ptr = HEAD_SLAB_PTR;
+    uint32_t unit_data = *get_unit_ptr_from_list_head(bucket_id, lane_id);
+    ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                      NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+    while (next_slab_ptr != EMPTY_SLAB_PTR) {
+        tail_slab_ptr = next_slab_ptr;
+        unit_data = *get_unit_ptr_from_list_nodes(tail_slab_ptr, lane_id);
+        next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                    NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+    }
+    uint32_t tail_lane =
+            32 - __clz(__ballot_sync(ACTIVE_LANES_MASK,
+                                     unit_data != EMPTY_PAIR_PTR) &
+                       PAIR_PTR_LANES_MASK);
+
+    for (uint32_t first = 0; first < num_keys; first += WARP_WIDTH) {
+        bool lane_active = (first + lane_id < num_keys);
+        _Key key;
+        _Value value;
+        if (lane_active) {
+            key = keys[order[first + lane_id]];
+            value = values[order[first + lane_id]];
+        }
+
+        /** Branch 2: drop the keys in the chain, then the duplicates **/
+        bool to_search = lane_active;
+        bool is_found = Search(to_search, lane_id, bucket_id, key).second;
+        bool is_new = lane_active && !is_found;
+        uint32_t active_lanes = __ballot_sync(ACTIVE_LANES_MASK, lane_active);
+        while (active_lanes) {
+            uint32_t src_lane = __ffs(active_lanes) - 1;
+            _Key src_key;
+            WarpSyncKey(key, src_lane, src_key);
+            if (src_lane < lane_id && is_new && src_key == key) {
+                is_new = false;
+            }
+            active_lanes &= active_lanes - 1;
+        }
+
+        ptr_t pair_ptr = is_new ? AllocatePair(key, value) : EMPTY_PAIR_PTR;
+        uint32_t new_lanes =
+                __ballot_sync(ACTIVE_LANES_MASK, pair_ptr != EMPTY_PAIR_PTR);
+        uint32_t rank = __popc(new_lanes & ((1u << lane_id) - 1));
+        uint32_t num_new = __popc(new_lanes);
+
+        /** Branch 3: append them, linking a new slab to a full tail **/
+        while (num_new > 0) {
+            if (tail_lane == NEXT_SLAB_PTR_LANE) {
+                ptr_t new_slab_ptr = AllocateSlab(lane_id, tail_slab_ptr);
+                if (lane_id == NEXT_SLAB_PTR_LANE) {
+                    *((tail_slab_ptr == HEAD_SLAB_PTR)
+                              ? get_unit_ptr_from_list_head(bucket_id,
+                                                            lane_id)
+                              : get_unit_ptr_from_list_nodes(tail_slab_ptr,
+                                                             lane_id)) =
+                            new_slab_ptr;
+                }
+                tail_slab_ptr = new_slab_ptr;
+                tail_lane = 0;
+            }
+
+            uint32_t num_written =
+                    (num_new < NEXT_SLAB_PTR_LANE - tail_lane)
+                            ? num_new
+                            : NEXT_SLAB_PTR_LANE - tail_lane;
+            if (pair_ptr != EMPTY_PAIR_PTR && rank < num_written) {
+                uint32_t dst_lane = tail_lane + rank;
+                *((tail_slab_ptr == HEAD_SLAB_PTR)
+                          ? get_unit_ptr_from_list_head(bucket_id, dst_lane)
+                          : get_unit_ptr_from_list_nodes(tail_slab_ptr,
+                                                         dst_lane)) =
+                        EncodePairPtr(pair_ptr, ComputeFingerprint(key));
+                pair_ptr = EMPTY_PAIR_PTR;
+            } else if (pair_ptr != EMPTY_PAIR_PTR) {
+                rank -= num_written;
+            }
+            tail_lane += num_written;
+            num_new -= num_written;
+        }
+        __threadfence();
+    }
+}
+
+//=== Individual search kernel:
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void SearchKernel(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        _Key* keys,
+        const uint32_t* order,
+        _Value* values,
+        uint8_t* founds,
+        uint32_t num_queries) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    /* This warp is idle */
+    if ((tid - lane_id) >= num_queries) {
+        return;
+    }
+
+    /* Initialize the memory allocator on each warp */
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    /* With an @order, the query of this lane and its results' position */
+    uint32_t query_id = tid;
+    bool lane_active = false;
+    uint32_t bucket_id = 0;
+    _Key key;
+
+    if (tid < num_queries) {
+        query_id = order ? order[tid] : tid;
+        lane_active = true;
+        key = keys[query_id];
+        bucket_id = slab_hash_ctx.ComputeBucket(key);
+    }
+
+    pair_t<iterator_t, bool> result =
+            slab_hash_ctx.Search(lane_active, lane_id, bucket_id, key);
+
+    if (tid < num_queries) {
+        bool found = result.second;
+        founds[query_id] = found;
+        values[query_id] = found ? slab_hash_ctx.get_pair_alloc_ctx()
+                                           .extract(result.first)
+                                           .second
+                                 : _Value(0);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void InsertKernel(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        _Key* keys,
+        _Value* values,
+        uint8_t* statuses,
+        uint32_t num_keys) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    if ((tid - lane_id) >= num_keys) {
+        return;
+    }
+
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    bool lane_active = false;
+    uint32_t bucket_id = 0;
+    _Key key;
+    _Value value;
+
+    if (tid < num_keys) {
+        lane_active = true;
+        key = keys[tid];
+        value = values[tid];
+        bucket_id = slab_hash_ctx.ComputeBucket(key);
+    }
+
+    pair_t<iterator_t, bool> result =
+            slab_hash_ctx.Insert(lane_active, lane_id, bucket_id, key, value);
+
+    if (statuses && tid < num_keys) {
+        statuses[tid] = InsertStatus(result.first);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void RemoveKernel(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        _Key* keys,
+        uint32_t num_keys) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    if ((tid - lane_id) >= num_keys) {
+        return;
+    }
+
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    bool lane_active = false;
+    uint32_t bucket_id = 0;
+    _Key key;
+
+    if (tid < num_keys) {
+        lane_active = true;
+        key = keys[tid];
+        bucket_id = slab_hash_ctx.ComputeBucket(key);
+    }
+
+    slab_hash_ctx.Remove(lane_active, lane_id, bucket_id, key);
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void InsertOrAssignKernel(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        _Key* keys,
+        _Value* values,
+        uint8_t* statuses,
+        uint32_t num_keys) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    if ((tid - lane_id) >= num_keys) {
+        return;
+    }
+
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    bool lane_active = false;
+    uint32_t bucket_id = 0;
+    _Key key;
+    _Value value;
+
+    if (tid < num_keys) {
+        lane_active = true;
+        key = keys[tid];
+        value = values[tid];
+        bucket_id = slab_hash_ctx.ComputeBucket(key);
+    }
+
+    pair_t<iterator_t, bool> result = slab_hash_ctx.InsertOrAssign(
+            lane_active, lane_id, bucket_id, key, value);
+
+    if (statuses && tid < num_keys) {
+        statuses[tid] = InsertStatus(result.first);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash, typename _Reduce>
+__global__ void InsertOrReduceKernel(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        _Key* keys,
+        _Value* values,
+        uint8_t* statuses,
+        uint32_t num_keys,
+        _Reduce reduce) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    if ((tid - lane_id) >= num_keys) {
+        return;
+    }
+
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    bool lane_active = false;
+    uint32_t bucket_id = 0;
+    _Key key;
+    _Value value;
+
+    if (tid < num_keys) {
+        lane_active = true;
+        key = keys[tid];
+        value = values[tid];
+        bucket_id = slab_hash_ctx.ComputeBucket(key);
+    }
+
+    pair_t<iterator_t, bool> result = slab_hash_ctx.InsertOrReduce(
+            lane_active, lane_id, bucket_id, key, value, reduce);
+
+    if (statuses && tid < num_keys) {
+        statuses[tid] = InsertStatus(result.first);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void ActivateKernel(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        _Key* keys,
+        iterator_t* iterators,
+        uint8_t* is_new,
+        uint32_t num_keys) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    if ((tid - lane_id) >= num_keys) {
+        return;
+    }
+
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    bool lane_active = false;
+    uint32_t bucket_id = 0;
+    _Key key;
+
+    if (tid < num_keys) {
+        lane_active = true;
+        key = keys[tid];
+        bucket_id = slab_hash_ctx.ComputeBucket(key);
+    }
+
+    pair_t<iterator_t, bool> result =
+            slab_hash_ctx.InsertOrReduce(lane_active, lane_id, bucket_id, key,
+                                         _Value(), ReduceKeep<_Value>());
+
+    if (tid < num_keys) {
+        iterators[tid] = result.first;
+        is_new[tid] = result.second;
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void UpdateExistingKernel(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        _Key* keys,
+        _Value* values,
+        uint32_t num_keys) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    if ((tid - lane_id) >= num_keys) {
+        return;
+    }
+
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    bool lane_active = false;
+    uint32_t bucket_id = 0;
+    _Key key;
+    _Value value;
+
+    if (tid < num_keys) {
+        lane_active = true;
+        key = keys[tid];
+        value = values[tid];
+        bucket_id = slab_hash_ctx.ComputeBucket(key);
+    }
+
+    slab_hash_ctx.UpdateExisting(lane_active, lane_id, bucket_id, key, value);
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void InsertMultiKernel(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        _Key* keys,
+        _Value* values,
+        uint8_t* statuses,
+        uint32_t num_keys) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    if ((tid - lane_id) >= num_keys) {
+        return;
+    }
+
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    bool lane_active = false;
+    uint32_t bucket_id = 0;
+    _Key key;
+    _Value value;
+
+    if (tid < num_keys) {
+        lane_active = true;
+        key = keys[tid];
+        value = values[tid];
+        bucket_id = slab_hash_ctx.ComputeBucket(key);
+    }
+
+    iterator_t iterator = slab_hash_ctx.InsertMulti(lane_active, lane_id,
+                                                    bucket_id, key, value);
+
+    if (statuses && tid < num_keys) {
+        statuses[tid] = InsertStatus(iterator);
+    }
+}
+
+/* First pass of a multimap query: number of values per key */
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void CountKernel(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        _Key* keys,
+        uint32_t* counts,
+        uint32_t num_queries) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    if ((tid - lane_id) >= num_queries) {
+        return;
+    }
+
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    bool lane_active = false;
+    uint32_t bucket_id = 0;
+    _Key key;
+
+    if (tid < num_queries) {
+        lane_active = true;
+        key = keys[tid];
+        bucket_id = slab_hash_ctx.ComputeBucket(key);
+    }
+
+    uint32_t count = slab_hash_ctx.Count(lane_active, lane_id, bucket_id, key);
+
+    if (tid < num_queries) {
+        counts[tid] = count;
+    }
+}
+
+/* Second pass: the values of keys[i] go to values[offsets[i]:offsets[i+1]],
+ * with @offsets the exclusive prefix sum of the counts (CSR layout) */
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void SearchAllKernel(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        _Key* keys,
+        uint32_t* offsets,
+        _Value* values,
+        uint32_t num_queries) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    if ((tid - lane_id) >= num_queries) {
+        return;
+    }
+
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    bool lane_active = false;
+    uint32_t bucket_id = 0;
+    _Key key;
+    _Value* key_values = values;
+    uint32_t capacity = 0;
+
+    if (tid < num_queries) {
+        lane_active = true;
+        key = keys[tid];
+        bucket_id = slab_hash_ctx.ComputeBucket(key);
+        key_values = values + offsets[tid];
+        capacity = offsets[tid + 1] - offsets[tid];
+    }
+
+    slab_hash_ctx.SearchAll(lane_active, lane_id, bucket_id, key, key_values,
+                            capacity);
+}
+
+/*
+ * This kernel can be used to compute total number of elements within each
+ * bucket. The final results per bucket is stored in d_count_result array
+ */
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void bucket_count_kernel(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        uint32_t* d_count_result,
+        uint32_t num_buckets) {
+    // global warp ID
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t wid = tid >> 5;
+    // assigning a warp per bucket
+    if (wid >= num_buckets) {
+        return;
+    }
+
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    // initializing the memory allocator on each warp:
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    uint32_t count = 0;
+
+    uint32_t src_unit_data =
+            *slab_hash_ctx.get_unit_ptr_from_list_head(wid, lane_id);
+
+    count += __popc(__ballot_sync(PAIR_PTR_LANES_MASK,
+                                  src_unit_data != EMPTY_PAIR_PTR));
+    uint32_t next = __shfl_sync(0xFFFFFFFF, src_unit_data, 31, 32);
+
+    while (next != EMPTY_SLAB_PTR) {
+        src_unit_data =
+                *slab_hash_ctx.get_unit_ptr_from_list_nodes(next, lane_id);
+        count += __popc(__ballot_sync(PAIR_PTR_LANES_MASK,
                                       src_unit_data != EMPTY_PAIR_PTR));
         next = __shfl_sync(0xFFFFFFFF, src_unit_data, 31, 32);
     }
-    // writing back the results:
-    if (lane_id == 0) {
-        d_count_result[wid] = count;
+    // writing back the results:
+    if (lane_id == 0) {
+        d_count_result[wid] = count;
+    }
+}
+
+/*
+ * Export: a warp per bucket writes the pairs of its chain, in slab and lane
+ * order, from the exclusive prefix sum of the bucket counts d_offsets[wid]
+ */
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void ExportKernel(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        const uint32_t* d_offsets,
+        _Key* keys,
+        _Value* values,
+        uint32_t num_buckets) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t wid = tid >> 5;
+    if (wid >= num_buckets) {
+        return;
+    }
+
+    uint32_t lane_id = threadIdx.x & 0x1F;
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+    MemoryAllocContext<pair_t<_Key, _Value>> pair_allocator_ctx =
+            slab_hash_ctx.get_pair_alloc_ctx();
+
+    uint32_t offset = d_offsets[wid];
+    uint32_t src_unit_data =
+            *slab_hash_ctx.get_unit_ptr_from_list_head(wid, lane_id);
+
+    while (true) {
+        bool lane_valid = lane_id < NEXT_SLAB_PTR_LANE &&
+                          src_unit_data != EMPTY_PAIR_PTR;
+        uint32_t valid_lanes = __ballot_sync(ACTIVE_LANES_MASK, lane_valid);
+
+        if (lane_valid) {
+            uint32_t index =
+                    offset + __popc(valid_lanes & ((1u << lane_id) - 1));
+            const pair_t<_Key, _Value>& pair = pair_allocator_ctx.extract(
+                    slab_hash_ctx.DecodePairPtr(src_unit_data));
+            if (keys) keys[index] = pair.first;
+            if (values) values[index] = pair.second;
+        }
+        offset += __popc(valid_lanes);
+
+        uint32_t next = __shfl_sync(ACTIVE_LANES_MASK, src_unit_data,
+                                    NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+        if (next == EMPTY_SLAB_PTR) break;
+        src_unit_data =
+                *slab_hash_ctx.get_unit_ptr_from_list_nodes(next, lane_id);
+    }
+}
+
+/*
+ * ForEach: a warp per bucket, each lane visits the pair it holds
+ */
+template <typename _Key, typename _Value, typename _Hash, typename _Func>
+__global__ void ForEachKernel(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        _Func func,
+        uint32_t num_buckets) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t wid = tid >> 5;
+    if (wid >= num_buckets) {
+        return;
+    }
+
+    uint32_t lane_id = threadIdx.x & 0x1F;
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+    MemoryAllocContext<pair_t<_Key, _Value>> pair_allocator_ctx =
+            slab_hash_ctx.get_pair_alloc_ctx();
+
+    uint32_t src_unit_data =
+            *slab_hash_ctx.get_unit_ptr_from_list_head(wid, lane_id);
+
+    while (true) {
+        if (lane_id < NEXT_SLAB_PTR_LANE && src_unit_data != EMPTY_PAIR_PTR) {
+            pair_t<_Key, _Value>& pair = pair_allocator_ctx.extract(
+                    slab_hash_ctx.DecodePairPtr(src_unit_data));
+            func(pair.first, pair.second);
+        }
+
+        uint32_t next = __shfl_sync(ACTIVE_LANES_MASK, src_unit_data,
+                                    NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+        if (next == EMPTY_SLAB_PTR) break;
+        src_unit_data =
+                *slab_hash_ctx.get_unit_ptr_from_list_nodes(next, lane_id);
+    }
+}
+
+/*
+ * Rehash: a warp per bucket of the old table links the encoded words of its
+ * chain into the chains of @new_ctx; the pairs themselves stay in the pool
+ */
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void RehashKernel(
+        SlabHashContext<_Key, _Value, _Hash, false> old_ctx,
+        SlabHashContext<_Key, _Value, _Hash, false> new_ctx,
+        uint32_t num_buckets) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t wid = tid >> 5;
+    if (wid >= num_buckets) {
+        return;
+    }
+
+    uint32_t lane_id = threadIdx.x & 0x1F;
+    new_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+    MemoryAllocContext<pair_t<_Key, _Value>> pair_allocator_ctx =
+            old_ctx.get_pair_alloc_ctx();
+
+    uint32_t src_unit_data = *old_ctx.get_unit_ptr_from_list_head(wid, lane_id);
+
+    while (true) {
+        bool lane_active = lane_id < NEXT_SLAB_PTR_LANE &&
+                           src_unit_data != EMPTY_PAIR_PTR;
+        uint32_t new_bucket = 0;
+        if (lane_active) {
+            new_bucket = new_ctx.ComputeBucket(
+                    pair_allocator_ctx
+                            .extract(old_ctx.DecodePairPtr(src_unit_data))
+                            .first);
+        }
+        new_ctx.InsertPairPtr(lane_active, lane_id, new_bucket, src_unit_data);
+
+        uint32_t next = __shfl_sync(ACTIVE_LANES_MASK, src_unit_data,
+                                    NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+        if (next == EMPTY_SLAB_PTR) break;
+        src_unit_data = *old_ctx.get_unit_ptr_from_list_nodes(next, lane_id);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void FreeChainsKernel(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        uint32_t num_buckets) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t wid = tid >> 5;
+    if (wid >= num_buckets) {
+        return;
+    }
+
+    uint32_t lane_id = threadIdx.x & 0x1F;
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+    slab_hash_ctx.FreeChain(lane_id, wid);
+}
+
+/*
+ * Linear hashing: a warp per bucket in [first_bucket, first_bucket +
+ * num_splits) splits it, see SplitBucket
+ */
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void SplitKernel(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        uint32_t first_bucket,
+        uint32_t num_splits) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t wid = tid >> 5;
+    if (wid >= num_splits) {
+        return;
+    }
+
+    uint32_t lane_id = threadIdx.x & 0x1F;
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+    slab_hash_ctx.SplitBucket(lane_id, first_bucket + wid);
+}
+
+/* A warp per bucket compacts its chain, see CompactBucket */
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void CompactKernel(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        uint32_t num_buckets) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t wid = tid >> 5;
+    if (wid >= num_buckets) {
+        return;
+    }
+
+    uint32_t lane_id = threadIdx.x & 0x1F;
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+    slab_hash_ctx.CompactBucket(lane_id, wid);
+}
+
+/* A warp per bucket appends its range of the partitioned keys, see
+ * BuildBucket */
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void BulkBuildKernel(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        const _Key* keys,
+        const _Value* values,
+        const uint32_t* offsets,
+        const uint32_t* order,
+        uint32_t num_buckets) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t wid = tid >> 5;
+    if (wid >= num_buckets) {
+        return;
     }
+
+    uint32_t lane_id = threadIdx.x & 0x1F;
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+    slab_hash_ctx.BuildBucket(lane_id, wid, keys, values, order + offsets[wid],
+                              offsets[wid + 1] - offsets[wid]);
 }
 
 /*
@@ -639,118 +2536,1128 @@ __global__ void bucket_count_kernel(
  * allocator and store number of allocated slabs.
  * TODO: this should be moved into allocator's codebase (violation of layers)
  */
-template <typename _Key, typename _Value, typename _Hash>
-__global__ void compute_stats_allocators(
-        uint32_t* d_count_super_block,
-        SlabHashContext<_Key, _Value, _Hash> slab_hash_ctx) {
+template <typename _Context>
+__global__ void compute_stats_allocators(uint32_t* d_count_super_block,
+                                         _Context slab_hash_ctx) {
     uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
 
-    int num_bitmaps =
-            slab_hash_ctx.get_slab_alloc_ctx().NUM_MEM_BLOCKS_PER_SUPER_BLOCK_ *
+    uint32_t num_bitmaps =
+            slab_hash_ctx.get_slab_alloc_ctx().num_mem_blocks_per_super_block_ *
             32;
     if (tid >= num_bitmaps) {
         return;
     }
 
-    for (int i = 0; i < slab_hash_ctx.get_slab_alloc_ctx().num_super_blocks_;
-         i++) {
+    for (uint32_t i = 0;
+         i < slab_hash_ctx.get_slab_alloc_ctx().num_super_blocks_; i++) {
         uint32_t read_bitmap = *(
                 slab_hash_ctx.get_slab_alloc_ctx().get_ptr_for_bitmap(i, tid));
         atomicAdd(&d_count_super_block[i], __popc(read_bitmap));
     }
 }
 
-template <typename _Key, typename _Value, typename _Hash>
-SlabHash<_Key, _Value, _Hash>::SlabHash(const uint32_t max_bucket_count,
-                                        const uint32_t max_keyvalue_count,
-                                        uint32_t device_idx)
+/*
+ * Relayout, for both layouts: a thread per bucket counts its chained slabs,
+ * then a warp per bucket copies them to @slabs from @offsets[bucket] on,
+ * with the next pointers rewritten to the sequential addresses that
+ * SlabAlloc::Relayout gives them
+ */
+template <typename _Context>
+__global__ void CountChainSlabsKernel(_Context slab_hash_ctx,
+                                      uint32_t* counts,
+                                      uint32_t num_buckets) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    if (tid >= num_buckets) {
+        return;
+    }
+
+    uint32_t count = 0;
+    ptr_t slab_ptr =
+            *slab_hash_ctx.get_unit_ptr_from_list_head(tid, NEXT_SLAB_PTR_LANE);
+    while (slab_ptr != EMPTY_SLAB_PTR) {
+        ++count;
+        slab_ptr = *slab_hash_ctx.get_unit_ptr_from_list_nodes(
+                slab_ptr, NEXT_SLAB_PTR_LANE);
+    }
+    counts[tid] = count;
+}
+
+template <typename _Context>
+__global__ void GatherChainsKernel(_Context slab_hash_ctx,
+                                   const uint32_t* offsets,
+                                   uint32_t* slabs,
+                                   uint32_t num_buckets) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t wid = tid >> 5;
+    if (wid >= num_buckets) {
+        return;
+    }
+
+    uint32_t lane_id = threadIdx.x & 0x1F;
+    const SlabAllocContext& alloc_ctx = slab_hash_ctx.get_slab_alloc_ctx();
+    uint32_t index = offsets[wid];
+    ptr_t* head_ptr = slab_hash_ctx.get_unit_ptr_from_list_head(wid, lane_id);
+    ptr_t slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, *head_ptr,
+                                 NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+    if (slab_ptr != EMPTY_SLAB_PTR && lane_id == NEXT_SLAB_PTR_LANE) {
+        *head_ptr = alloc_ctx.getSequentialAddress(index);
+    }
+
+    while (slab_ptr != EMPTY_SLAB_PTR) {
+        uint32_t unit_data =
+                *slab_hash_ctx.get_unit_ptr_from_list_nodes(slab_ptr, lane_id);
+        slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                               NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+        if (slab_ptr != EMPTY_SLAB_PTR && lane_id == NEXT_SLAB_PTR_LANE) {
+            unit_data = alloc_ctx.getSequentialAddress(index + 1);
+        }
+        slabs[size_t(index) * WARP_WIDTH + lane_id] = unit_data;
+        ++index;
+    }
+}
+
+/*
+ * BulkBuild, for both layouts: a thread per key counts the keys of each
+ * bucket, then, with the counts prefix-summed into @cursors, writes its
+ * index to the range of its bucket in @order
+ */
+template <typename _Context, typename _Key>
+__global__ void CountBucketKeysKernel(_Context slab_hash_ctx,
+                                      const _Key* keys,
+                                      uint32_t* counts,
+                                      uint32_t num_keys) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    if (tid >= num_keys) {
+        return;
+    }
+
+    atomicAdd(&counts[slab_hash_ctx.ComputeBucket(keys[tid])], 1);
+}
+
+template <typename _Context, typename _Key>
+__global__ void PartitionKeysKernel(_Context slab_hash_ctx,
+                                    const _Key* keys,
+                                    uint32_t* cursors,
+                                    uint32_t* order,
+                                    uint32_t num_keys) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    if (tid >= num_keys) {
+        return;
+    }
+
+    order[atomicAdd(&cursors[slab_hash_ctx.ComputeBucket(keys[tid])], 1)] =
+            tid;
+}
+
+/*
+ * In-batch deduplication, for both layouts: with the keys grouped by bucket
+ * as above, a thread per bucket moves the first copy of each distinct key
+ * to the front of the range of its bucket in @order, and combines the
+ * values of the copies into @merged at the same position. The number of
+ * distinct keys goes to @counts, the prefix sum of which then gives each
+ * bucket its range of @unique_keys and @unique_values
+ */
+
+/* Combine functors, called as combine(&kept_index, &kept_value, index,
+ * value) for each copy after the first: Insert keeps the value of the
+ * first copy in batch order, InsertOrAssign that of the last one */
+template <typename _Value>
+struct DedupKeepFirst {
+    __device__ __host__ void operator()(uint32_t* kept_index,
+                                        _Value* kept_value,
+                                        uint32_t index,
+                                        const _Value& value) const {
+        if (index < *kept_index) {
+            *kept_index = index;
+            *kept_value = value;
+        }
+    }
+};
+
+template <typename _Value>
+struct DedupKeepLast {
+    __device__ __host__ void operator()(uint32_t* kept_index,
+                                        _Value* kept_value,
+                                        uint32_t index,
+                                        const _Value& value) const {
+        if (index > *kept_index) {
+            *kept_index = index;
+            *kept_value = value;
+        }
+    }
+};
+
+/* InsertOrReduce combines the copies with its reduce functor */
+template <typename _Value, typename _Reduce>
+struct DedupReduce {
+    _Reduce reduce;
+
+    DedupReduce(const _Reduce& reduce) : reduce(reduce) {}
+
+    __device__ __host__ void operator()(uint32_t* /*kept_index*/,
+                                        _Value* kept_value,
+                                        uint32_t /*index*/,
+                                        const _Value& value) const {
+        reduce(kept_value, value);
+    }
+};
+
+template <typename _Key, typename _Value, typename _Combine>
+__global__ void DedupBucketKeysKernel(const _Key* keys,
+                                      const _Value* values,
+                                      const uint32_t* offsets,
+                                      uint32_t* order,
+                                      _Value* merged,
+                                      uint32_t* counts,
+                                      uint32_t num_buckets,
+                                      _Combine combine) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    if (tid >= num_buckets) {
+        return;
+    }
+
+    uint32_t begin = offsets[tid];
+    uint32_t end = offsets[tid + 1];
+    uint32_t unique_end = begin;
+    for (uint32_t i = begin; i < end; ++i) {
+        uint32_t index = order[i];
+        uint32_t j = begin;
+        while (j < unique_end && !(keys[order[j]] == keys[index])) {
+            ++j;
+        }
+        if (j < unique_end) {
+            combine(&order[j], &merged[j], index, values[index]);
+        } else {
+            order[unique_end] = index;
+            merged[unique_end] = values[index];
+            ++unique_end;
+        }
+    }
+    counts[tid] = unique_end - begin;
+}
+
+template <typename _Key, typename _Value>
+__global__ void CompactBucketKeysKernel(const _Key* keys,
+                                        const uint32_t* offsets,
+                                        const uint32_t* order,
+                                        const _Value* merged,
+                                        const uint32_t* unique_offsets,
+                                        _Key* unique_keys,
+                                        _Value* unique_values,
+                                        uint32_t num_buckets) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    if (tid >= num_buckets) {
+        return;
+    }
+
+    uint32_t begin = offsets[tid];
+    uint32_t unique_begin = unique_offsets[tid];
+    uint32_t num_unique = unique_offsets[tid + 1] - unique_begin;
+    for (uint32_t i = 0; i < num_unique; ++i) {
+        unique_keys[unique_begin + i] = keys[order[begin + i]];
+        unique_values[unique_begin + i] = merged[begin + i];
+    }
+}
+
+#ifdef SLABHASH_BACKEND_CPU
+#include "slab_hash_host.h"
+#endif
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+SlabHash<_Key, _Value, _Hash, _Inline>::SlabHash(
+        const uint32_t max_bucket_count,
+        const uint32_t max_keyvalue_count,
+        uint32_t device_idx,
+        bool use_fingerprints /* = false */)
     : num_buckets_(max_bucket_count),
+      bucket_list_head_(nullptr),
       device_idx_(device_idx),
-      bucket_list_head_(nullptr) {
+      max_chain_length_(0),
+      bucket_ordered_search_(false),
+      batch_deduplication_(false),
+      bucket_capacity_(max_bucket_count),
+      split_bucket_(0),
+      splits_per_batch_(0) {
     // allocate an initialize the allocator:
-    pair_allocator_ = std::make_shared<MemoryAlloc<thrust::pair<_Key, _Value>>>(
+    pair_allocator_ = std::make_shared<MemoryAlloc<pair_t<_Key, _Value>>>(
             max_keyvalue_count);
-    slab_list_allocator_ = std::make_shared<SlabAlloc>();
+    slab_list_allocator_ = std::make_shared<SlabAlloc>(
+            max_keyvalue_count / NEXT_SLAB_PTR_LANE + 1);
 
+#ifndef SLABHASH_BACKEND_CPU
     int32_t device_count = 0;
     CHECK_CUDA(cudaGetDeviceCount(&device_count));
     assert(device_idx_ < device_count);
-    CHECK_CUDA(cudaSetDevice(device_idx_));
+#endif
+    BackendSetDevice(device_idx_);
 
     // allocating initial buckets:
-    CHECK_CUDA(cudaMalloc(&bucket_list_head_, sizeof(Slab) * num_buckets_));
-    CHECK_CUDA(
-            cudaMemset(bucket_list_head_, 0xFF, sizeof(Slab) * num_buckets_));
+    BackendMalloc(&bucket_list_head_, sizeof(Slab) * num_buckets_);
+    BackendMemset(bucket_list_head_, 0xFF, sizeof(Slab) * num_buckets_);
+
+    /* Pair pointers are < max_keyvalue_count: the remaining high bits are
+     * free for fingerprints, as long as an encoded word can never be
+     * EMPTY_PAIR_PTR, i.e. max_keyvalue_count <= 2^(32 - bits) - 1 */
+    uint32_t fingerprint_bits = 0;
+    if (use_fingerprints && max_keyvalue_count > 0) {
+        uint32_t pair_ptr_bits = 32 - __builtin_clz(max_keyvalue_count);
+        fingerprint_bits = std::min(MAX_FINGERPRINT_BITS, 32 - pair_ptr_bits);
+    }
+    max_pair_capacity_ =
+            std::min(0xFFFFFFFF >> fingerprint_bits, uint32_t(INT32_MAX));
 
     gpu_context_.Setup(bucket_list_head_, num_buckets_,
                        slab_list_allocator_->getContext(),
-                       pair_allocator_->gpu_context_);
+                       pair_allocator_->gpu_context_, fingerprint_bits);
 }
 
-template <typename _Key, typename _Value, typename _Hash>
-SlabHash<_Key, _Value, _Hash>::~SlabHash() {
-    CHECK_CUDA(cudaSetDevice(device_idx_));
-    CHECK_CUDA(cudaFree(bucket_list_head_));
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+SlabHash<_Key, _Value, _Hash, _Inline>::~SlabHash() {
+    BackendSetDevice(device_idx_);
+    BackendFree(bucket_list_head_);
 }
 
-template <typename _Key, typename _Value, typename _Hash>
-void SlabHash<_Key, _Value, _Hash>::Insert(_Key* keys,
-                                           _Value* values,
-                                           uint32_t num_keys) {
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::Insert(
+        _Key* keys,
+        _Value* values,
+        uint32_t num_keys,
+        uint8_t* statuses /* = nullptr */) {
+    BackendSetDevice(device_idx_);
+    _Key* unique_keys = nullptr;
+    _Value* unique_values = nullptr;
+    if (batch_deduplication_ && statuses == nullptr) {
+        num_keys = DeduplicateBatch(keys, values, num_keys, &unique_keys,
+                                    &unique_values, DedupKeepFirst<_Value>());
+        keys = unique_keys;
+        values = unique_values;
+    }
+
+    pair_allocator_->Commit(num_keys);
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_, InsertKernel<_Key, _Value, _Hash>,
+               gpu_context_, keys, values, statuses, num_keys);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_keys, [&](uint32_t worker_id, uint32_t begin,
+                              uint32_t end) {
+        InsertKernelHost(gpu_context_, keys, values, statuses, begin, end,
+                         worker_id);
+    });
+#else
     const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
     // calling the kernel for bulk build:
-    CHECK_CUDA(cudaSetDevice(device_idx_));
-    InsertKernel<_Key, _Value, _Hash>
-            <<<num_blocks, BLOCKSIZE_>>>(gpu_context_, keys, values, num_keys);
+    InsertKernel<_Key, _Value, _Hash><<<num_blocks, BLOCKSIZE_>>>(
+            gpu_context_, keys, values, statuses, num_keys);
+#endif
+    pair_allocator_->Release(num_keys);
+
+    if (unique_keys) {
+        BackendFree(unique_keys);
+        BackendFree(unique_values);
+    }
+
+    RehashIfNeeded();
 }
 
-template <typename _Key, typename _Value, typename _Hash>
-void SlabHash<_Key, _Value, _Hash>::Search(_Key* keys,
-                                           _Value* values,
-                                           uint8_t* founds,
-                                           uint32_t num_queries) {
-    CHECK_CUDA(cudaSetDevice(device_idx_));
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::BulkBuild(_Key* keys,
+                                                       _Value* values,
+                                                       uint32_t num_keys) {
+    BackendSetDevice(device_idx_);
+    pair_allocator_->Commit(num_keys);
+    uint32_t* d_offsets;
+    uint32_t* d_order;
+    BackendMalloc(&d_offsets, sizeof(uint32_t) * (num_buckets_ + 1));
+    BackendMalloc(&d_order, sizeof(uint32_t) * num_keys);
+
+    PartitionByBucket(keys, num_keys, d_offsets, d_order);
+
+    /* A warp per bucket appends its keys */
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    SimtLaunch(num_blocks, blocksize, BulkBuildKernel<_Key, _Value, _Hash>,
+               gpu_context_, keys, values, d_offsets, d_order, num_buckets_);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_buckets_, [&](uint32_t worker_id, uint32_t begin,
+                                  uint32_t end) {
+        BulkBuildKernelHost(gpu_context_, keys, values, d_offsets, d_order,
+                            begin, end, worker_id);
+    });
+#else
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    BulkBuildKernel<_Key, _Value, _Hash><<<num_blocks, blocksize>>>(
+            gpu_context_, keys, values, d_offsets, d_order, num_buckets_);
+#endif
+    pair_allocator_->Release(num_keys);
+
+    BackendFree(d_offsets);
+    BackendFree(d_order);
+
+    RehashIfNeeded();
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::PartitionByBucket(
+        _Key* keys,
+        uint32_t num_keys,
+        uint32_t* d_offsets,
+        uint32_t* d_order) {
+    uint32_t* d_cursors;
+    BackendMalloc(&d_cursors, sizeof(uint32_t) * (num_buckets_ + 1));
+    BackendMemset(d_offsets, 0, sizeof(uint32_t) * (num_buckets_ + 1));
+
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_,
+               CountBucketKeysKernel<
+                       SlabHashContext<_Key, _Value, _Hash, _Inline>, _Key>,
+               gpu_context_, keys, d_offsets, num_keys);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_keys, [&](uint32_t /*worker_id*/, uint32_t begin,
+                              uint32_t end) {
+        CountBucketKeysKernelHost(gpu_context_, keys, d_offsets, begin, end);
+    });
+#else
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    CountBucketKeysKernel<<<num_blocks, BLOCKSIZE_>>>(gpu_context_, keys,
+                                                      d_offsets, num_keys);
+#endif
+    BackendExclusiveScan(d_offsets, num_buckets_ + 1);
+
+    BackendMemcpy(d_cursors, d_offsets, sizeof(uint32_t) * (num_buckets_ + 1));
+#if defined(SLABHASH_BACKEND_SIMT)
+    SimtLaunch(num_blocks, BLOCKSIZE_,
+               PartitionKeysKernel<
+                       SlabHashContext<_Key, _Value, _Hash, _Inline>, _Key>,
+               gpu_context_, keys, d_cursors, d_order, num_keys);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_keys, [&](uint32_t /*worker_id*/, uint32_t begin,
+                              uint32_t end) {
+        PartitionKeysKernelHost(gpu_context_, keys, d_cursors, d_order, begin,
+                                end);
+    });
+#else
+    PartitionKeysKernel<<<num_blocks, BLOCKSIZE_>>>(gpu_context_, keys,
+                                                    d_cursors, d_order,
+                                                    num_keys);
+#endif
+
+    BackendFree(d_cursors);
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+template <typename _Combine>
+uint32_t SlabHash<_Key, _Value, _Hash, _Inline>::DeduplicateBatch(
+        _Key* keys,
+        _Value* values,
+        uint32_t num_keys,
+        _Key** unique_keys,
+        _Value** unique_values,
+        _Combine combine) {
+    uint32_t* d_offsets;
+    uint32_t* d_order;
+    uint32_t* d_unique_offsets;
+    _Value* d_merged;
+    BackendMalloc(&d_offsets, sizeof(uint32_t) * (num_buckets_ + 1));
+    BackendMalloc(&d_order, sizeof(uint32_t) * num_keys);
+    BackendMalloc(&d_unique_offsets, sizeof(uint32_t) * (num_buckets_ + 1));
+    BackendMalloc(&d_merged, sizeof(_Value) * num_keys);
+
+    PartitionByBucket(keys, num_keys, d_offsets, d_order);
+
+    /* A thread per bucket */
+    BackendMemset(d_unique_offsets, 0, sizeof(uint32_t) * (num_buckets_ + 1));
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_buckets_ + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_,
+               DedupBucketKeysKernel<_Key, _Value, _Combine>, keys, values,
+               d_offsets, d_order, d_merged, d_unique_offsets, num_buckets_,
+               combine);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_buckets_, [&](uint32_t /*worker_id*/, uint32_t begin,
+                                  uint32_t end) {
+        DedupBucketKeysKernelHost(keys, values, d_offsets, d_order, d_merged,
+                                  d_unique_offsets, begin, end, combine);
+    });
+#else
+    const uint32_t num_blocks = (num_buckets_ + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    DedupBucketKeysKernel<_Key, _Value, _Combine><<<num_blocks, BLOCKSIZE_>>>(
+            keys, values, d_offsets, d_order, d_merged, d_unique_offsets,
+            num_buckets_, combine);
+#endif
+
+    BackendExclusiveScan(d_unique_offsets, num_buckets_ + 1);
+    uint32_t num_unique;
+    BackendMemcpy(&num_unique, d_unique_offsets + num_buckets_,
+                  sizeof(uint32_t));
+
+    BackendMalloc(unique_keys, sizeof(_Key) * num_unique);
+    BackendMalloc(unique_values, sizeof(_Value) * num_unique);
+#if defined(SLABHASH_BACKEND_SIMT)
+    SimtLaunch(num_blocks, BLOCKSIZE_, CompactBucketKeysKernel<_Key, _Value>,
+               keys, d_offsets, d_order, d_merged, d_unique_offsets,
+               *unique_keys, *unique_values, num_buckets_);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_buckets_, [&](uint32_t /*worker_id*/, uint32_t begin,
+                                  uint32_t end) {
+        CompactBucketKeysKernelHost(keys, d_offsets, d_order, d_merged,
+                                    d_unique_offsets, *unique_keys,
+                                    *unique_values, begin, end);
+    });
+#else
+    CompactBucketKeysKernel<_Key, _Value><<<num_blocks, BLOCKSIZE_>>>(
+            keys, d_offsets, d_order, d_merged, d_unique_offsets, *unique_keys,
+            *unique_values, num_buckets_);
+#endif
+
+    BackendFree(d_offsets);
+    BackendFree(d_order);
+    BackendFree(d_unique_offsets);
+    BackendFree(d_merged);
+    return num_unique;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::Search(_Key* keys,
+                                                    _Value* values,
+                                                    uint8_t* founds,
+                                                    uint32_t num_queries) {
+    BackendSetDevice(device_idx_);
+    uint32_t* d_order = nullptr;
+    if (bucket_ordered_search_) {
+        uint32_t* d_offsets;
+        BackendMalloc(&d_offsets, sizeof(uint32_t) * (num_buckets_ + 1));
+        BackendMalloc(&d_order, sizeof(uint32_t) * num_queries);
+        PartitionByBucket(keys, num_queries, d_offsets, d_order);
+        BackendFree(d_offsets);
+    }
+
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_queries + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_, SearchKernel<_Key, _Value, _Hash>,
+               gpu_context_, keys, d_order, values, founds, num_queries);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_queries, [&](uint32_t worker_id, uint32_t begin,
+                                 uint32_t end) {
+        SearchKernelHost(gpu_context_, keys, d_order, values, founds, begin,
+                         end, worker_id);
+    });
+#else
     const uint32_t num_blocks = (num_queries + BLOCKSIZE_ - 1) / BLOCKSIZE_;
     SearchKernel<_Key, _Value, _Hash><<<num_blocks, BLOCKSIZE_>>>(
-            gpu_context_, keys, values, founds, num_queries);
+            gpu_context_, keys, d_order, values, founds, num_queries);
+#endif
+
+    if (d_order) BackendFree(d_order);
 }
 
-template <typename _Key, typename _Value, typename _Hash>
-void SlabHash<_Key, _Value, _Hash>::Remove(_Key* keys, uint32_t num_keys) {
-    CHECK_CUDA(cudaSetDevice(device_idx_));
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::Remove(_Key* keys,
+                                                    uint32_t num_keys) {
+    BackendSetDevice(device_idx_);
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_, RemoveKernel<_Key, _Value, _Hash>,
+               gpu_context_, keys, num_keys);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_keys, [&](uint32_t worker_id, uint32_t begin,
+                              uint32_t end) {
+        RemoveKernelHost(gpu_context_, keys, begin, end, worker_id);
+    });
+#else
     const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
     RemoveKernel<_Key, _Value, _Hash>
             <<<num_blocks, BLOCKSIZE_>>>(gpu_context_, keys, num_keys);
+#endif
 }
 
-template <typename _Key, typename _Value, typename _Hash>
-double SlabHash<_Key, _Value, _Hash>::ComputeLoadFactor(int flag = 0) {
-    uint32_t* h_bucket_count = new uint32_t[num_buckets_];
-    uint32_t* d_bucket_count;
-    CHECK_CUDA(cudaMalloc((void**)&d_bucket_count,
-                          sizeof(uint32_t) * num_buckets_));
-    CHECK_CUDA(cudaMemset(d_bucket_count, 0, sizeof(uint32_t) * num_buckets_));
-
-    const auto& dynamic_alloc = gpu_context_.get_slab_alloc_ctx();
-    const uint32_t num_super_blocks = dynamic_alloc.num_super_blocks_;
-    uint32_t* h_count_super_blocks = new uint32_t[num_super_blocks];
-    uint32_t* d_count_super_blocks;
-    CHECK_CUDA(cudaMalloc((void**)&d_count_super_blocks,
-                          sizeof(uint32_t) * num_super_blocks));
-    CHECK_CUDA(cudaMemset(d_count_super_blocks, 0,
-                          sizeof(uint32_t) * num_super_blocks));
-    //---------------------------------
-    // counting the number of inserted elements:
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::InsertOrAssign(
+        _Key* keys,
+        _Value* values,
+        uint32_t num_keys,
+        uint8_t* statuses /* = nullptr */) {
+    BackendSetDevice(device_idx_);
+    _Key* unique_keys = nullptr;
+    _Value* unique_values = nullptr;
+    if (batch_deduplication_ && statuses == nullptr) {
+        num_keys = DeduplicateBatch(keys, values, num_keys, &unique_keys,
+                                    &unique_values, DedupKeepLast<_Value>());
+        keys = unique_keys;
+        values = unique_values;
+    }
+
+    pair_allocator_->Commit(num_keys);
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_,
+               InsertOrAssignKernel<_Key, _Value, _Hash>, gpu_context_, keys,
+               values, statuses, num_keys);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_keys, [&](uint32_t worker_id, uint32_t begin,
+                              uint32_t end) {
+        InsertOrAssignKernelHost(gpu_context_, keys, values, statuses, begin,
+                                 end, worker_id);
+    });
+#else
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    InsertOrAssignKernel<_Key, _Value, _Hash><<<num_blocks, BLOCKSIZE_>>>(
+            gpu_context_, keys, values, statuses, num_keys);
+#endif
+    pair_allocator_->Release(num_keys);
+
+    if (unique_keys) {
+        BackendFree(unique_keys);
+        BackendFree(unique_values);
+    }
+
+    RehashIfNeeded();
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+template <typename _Reduce>
+void SlabHash<_Key, _Value, _Hash, _Inline>::InsertOrReduce(
+        _Key* keys,
+        _Value* values,
+        uint32_t num_keys,
+        _Reduce reduce,
+        uint8_t* statuses /* = nullptr */) {
+    BackendSetDevice(device_idx_);
+    _Key* unique_keys = nullptr;
+    _Value* unique_values = nullptr;
+    if (batch_deduplication_ && statuses == nullptr) {
+        num_keys = DeduplicateBatch(keys, values, num_keys, &unique_keys,
+                                    &unique_values,
+                                    DedupReduce<_Value, _Reduce>(reduce));
+        keys = unique_keys;
+        values = unique_values;
+    }
+
+    pair_allocator_->Commit(num_keys);
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_,
+               InsertOrReduceKernel<_Key, _Value, _Hash, _Reduce>, gpu_context_,
+               keys, values, statuses, num_keys, reduce);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_keys, [&](uint32_t worker_id, uint32_t begin,
+                              uint32_t end) {
+        InsertOrReduceKernelHost(gpu_context_, keys, values, statuses, begin,
+                                 end, worker_id, reduce);
+    });
+#else
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    InsertOrReduceKernel<_Key, _Value, _Hash, _Reduce>
+            <<<num_blocks, BLOCKSIZE_>>>(gpu_context_, keys, values, statuses,
+                                         num_keys, reduce);
+#endif
+    pair_allocator_->Release(num_keys);
+
+    if (unique_keys) {
+        BackendFree(unique_keys);
+        BackendFree(unique_values);
+    }
+
+    RehashIfNeeded();
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::Activate(_Key* keys,
+                                                      iterator_t* iterators,
+                                                      uint8_t* is_new,
+                                                      uint32_t num_keys) {
+    BackendSetDevice(device_idx_);
+    pair_allocator_->Commit(num_keys);
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_, ActivateKernel<_Key, _Value, _Hash>,
+               gpu_context_, keys, iterators, is_new, num_keys);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_keys, [&](uint32_t worker_id, uint32_t begin,
+                              uint32_t end) {
+        ActivateKernelHost(gpu_context_, keys, iterators, is_new, begin, end,
+                           worker_id);
+    });
+#else
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    ActivateKernel<_Key, _Value, _Hash><<<num_blocks, BLOCKSIZE_>>>(
+            gpu_context_, keys, iterators, is_new, num_keys);
+#endif
+    pair_allocator_->Release(num_keys);
+
+    RehashIfNeeded();
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::UpdateExisting(_Key* keys,
+                                                            _Value* values,
+                                                            uint32_t num_keys) {
+    BackendSetDevice(device_idx_);
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_,
+               UpdateExistingKernel<_Key, _Value, _Hash>, gpu_context_, keys,
+               values, num_keys);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_keys, [&](uint32_t worker_id, uint32_t begin,
+                              uint32_t end) {
+        UpdateExistingKernelHost(gpu_context_, keys, values, begin, end,
+                                 worker_id);
+    });
+#else
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    UpdateExistingKernel<_Key, _Value, _Hash>
+            <<<num_blocks, BLOCKSIZE_>>>(gpu_context_, keys, values, num_keys);
+#endif
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::InsertMulti(
+        _Key* keys,
+        _Value* values,
+        uint32_t num_keys,
+        uint8_t* statuses /* = nullptr */) {
+    BackendSetDevice(device_idx_);
+    pair_allocator_->Commit(num_keys);
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_, InsertMultiKernel<_Key, _Value, _Hash>,
+               gpu_context_, keys, values, statuses, num_keys);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_keys, [&](uint32_t worker_id, uint32_t begin,
+                              uint32_t end) {
+        InsertMultiKernelHost(gpu_context_, keys, values, statuses, begin, end,
+                              worker_id);
+    });
+#else
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    InsertMultiKernel<_Key, _Value, _Hash><<<num_blocks, BLOCKSIZE_>>>(
+            gpu_context_, keys, values, statuses, num_keys);
+#endif
+    pair_allocator_->Release(num_keys);
+
+    RehashIfNeeded();
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::Count(_Key* keys,
+                                                   uint32_t* counts,
+                                                   uint32_t num_queries) {
+    BackendSetDevice(device_idx_);
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_queries + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_, CountKernel<_Key, _Value, _Hash>,
+               gpu_context_, keys, counts, num_queries);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_queries, [&](uint32_t worker_id, uint32_t begin,
+                                 uint32_t end) {
+        CountKernelHost(gpu_context_, keys, counts, begin, end, worker_id);
+    });
+#else
+    const uint32_t num_blocks = (num_queries + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    CountKernel<_Key, _Value, _Hash><<<num_blocks, BLOCKSIZE_>>>(
+            gpu_context_, keys, counts, num_queries);
+#endif
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::SearchAll(_Key* keys,
+                                                       uint32_t* offsets,
+                                                       _Value* values,
+                                                       uint32_t num_queries) {
+    BackendSetDevice(device_idx_);
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_queries + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_, SearchAllKernel<_Key, _Value, _Hash>,
+               gpu_context_, keys, offsets, values, num_queries);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_queries, [&](uint32_t worker_id, uint32_t begin,
+                                 uint32_t end) {
+        SearchAllKernelHost(gpu_context_, keys, offsets, values, begin, end,
+                            worker_id);
+    });
+#else
+    const uint32_t num_blocks = (num_queries + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SearchAllKernel<_Key, _Value, _Hash><<<num_blocks, BLOCKSIZE_>>>(
+            gpu_context_, keys, offsets, values, num_queries);
+#endif
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::CountBuckets(
+        uint32_t* d_bucket_count) {
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    SimtLaunch(num_blocks, blocksize, bucket_count_kernel<_Key, _Value, _Hash>,
+               gpu_context_, d_bucket_count, num_buckets_);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_buckets_, [&](uint32_t /*worker_id*/, uint32_t begin,
+                                  uint32_t end) {
+        BucketCountKernelHost(gpu_context_, d_bucket_count, begin, end);
+    });
+#else
     const uint32_t blocksize = 128;
     const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
     bucket_count_kernel<_Key, _Value, _Hash><<<num_blocks, blocksize>>>(
             gpu_context_, d_bucket_count, num_buckets_);
-    CHECK_CUDA(cudaMemcpy(h_bucket_count, d_bucket_count,
-                          sizeof(uint32_t) * num_buckets_,
-                          cudaMemcpyDeviceToHost));
+#endif
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+uint32_t SlabHash<_Key, _Value, _Hash, _Inline>::ComputeBucketOffsets(
+        uint32_t* d_offsets) {
+    BackendMemset(d_offsets, 0, sizeof(uint32_t) * (num_buckets_ + 1));
+    CountBuckets(d_offsets);
+    BackendExclusiveScan(d_offsets, num_buckets_ + 1);
+
+    uint32_t num_pairs;
+    BackendMemcpy(&num_pairs, d_offsets + num_buckets_, sizeof(uint32_t));
+    return num_pairs;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+uint32_t SlabHash<_Key, _Value, _Hash, _Inline>::Size() {
+    BackendSetDevice(device_idx_);
+    uint32_t* d_offsets;
+    BackendMalloc(&d_offsets, sizeof(uint32_t) * (num_buckets_ + 1));
+    uint32_t num_pairs = ComputeBucketOffsets(d_offsets);
+    BackendFree(d_offsets);
+    return num_pairs;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+uint32_t SlabHash<_Key, _Value, _Hash, _Inline>::Export(_Key* keys,
+                                                        _Value* values) {
+    BackendSetDevice(device_idx_);
+    uint32_t* d_offsets;
+    BackendMalloc(&d_offsets, sizeof(uint32_t) * (num_buckets_ + 1));
+    uint32_t num_pairs = ComputeBucketOffsets(d_offsets);
+
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    SimtLaunch(num_blocks, blocksize, ExportKernel<_Key, _Value, _Hash>,
+               gpu_context_, d_offsets, keys, values, num_buckets_);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_buckets_, [&](uint32_t /*worker_id*/, uint32_t begin,
+                                  uint32_t end) {
+        ExportKernelHost(gpu_context_, d_offsets, keys, values, begin, end);
+    });
+#else
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    ExportKernel<_Key, _Value, _Hash><<<num_blocks, blocksize>>>(
+            gpu_context_, d_offsets, keys, values, num_buckets_);
+#endif
+
+    BackendFree(d_offsets);
+    return num_pairs;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+template <typename _Func>
+void SlabHash<_Key, _Value, _Hash, _Inline>::ForEach(_Func func) {
+    BackendSetDevice(device_idx_);
+    const uint32_t blocksize = 128;
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    SimtLaunch(num_blocks, blocksize,
+               ForEachKernel<_Key, _Value, _Hash, _Func>, gpu_context_, func,
+               num_buckets_);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_buckets_, [&](uint32_t worker_id, uint32_t begin,
+                                  uint32_t end) {
+        ForEachKernelHost(gpu_context_, func, begin, end);
+    });
+#else
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    ForEachKernel<_Key, _Value, _Hash, _Func>
+            <<<num_blocks, blocksize>>>(gpu_context_, func, num_buckets_);
+#endif
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::Rehash(uint32_t new_bucket_count) {
+    assert(new_bucket_count > 0);
+    BackendSetDevice(device_idx_);
+    const uint32_t bucket_capacity =
+            std::max(new_bucket_count, bucket_capacity_);
+    Slab* new_bucket_list_head;
+    BackendMalloc(&new_bucket_list_head, sizeof(Slab) * bucket_capacity);
+    BackendMemset(new_bucket_list_head, 0xFF, sizeof(Slab) * bucket_capacity);
+
+    SlabHashContext<_Key, _Value, _Hash, _Inline> new_context = gpu_context_;
+    new_context.SetBuckets(new_bucket_list_head, new_bucket_count);
+
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    SimtLaunch(num_blocks, blocksize, RehashKernel<_Key, _Value, _Hash>,
+               gpu_context_, new_context, num_buckets_);
+    SimtLaunch(num_blocks, blocksize,
+               FreeChainsKernel<_Key, _Value, _Hash>, gpu_context_,
+               num_buckets_);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_buckets_, [&](uint32_t worker_id, uint32_t begin,
+                                  uint32_t end) {
+        RehashKernelHost(gpu_context_, new_context, begin, end,
+                         worker_id);
+    });
+    ParallelFor(num_buckets_, [&](uint32_t /*worker_id*/, uint32_t begin,
+                                  uint32_t end) {
+        FreeChainsKernelHost(gpu_context_, begin, end);
+    });
+#else
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    RehashKernel<_Key, _Value, _Hash><<<num_blocks, blocksize>>>(
+            gpu_context_, new_context, num_buckets_);
+    FreeChainsKernel<_Key, _Value, _Hash>
+            <<<num_blocks, blocksize>>>(gpu_context_, num_buckets_);
+#endif
+
+    BackendFree(bucket_list_head_);
+    bucket_list_head_ = new_bucket_list_head;
+    num_buckets_ = new_bucket_count;
+    bucket_capacity_ = bucket_capacity;
+    split_bucket_ = 0;
+    gpu_context_.SetBuckets(bucket_list_head_, num_buckets_);
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::Compact() {
+    BackendSetDevice(device_idx_);
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    SimtLaunch(num_blocks, blocksize, CompactKernel<_Key, _Value, _Hash>,
+               gpu_context_, num_buckets_);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_buckets_, [&](uint32_t worker_id, uint32_t begin,
+                                  uint32_t end) {
+        CompactKernelHost(gpu_context_, begin, end, worker_id);
+    });
+#else
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    CompactKernel<_Key, _Value, _Hash>
+            <<<num_blocks, blocksize>>>(gpu_context_, num_buckets_);
+#endif
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::Relayout() {
+    BackendSetDevice(device_idx_);
+    uint32_t* d_offsets;
+    BackendMalloc(&d_offsets, sizeof(uint32_t) * (num_buckets_ + 1));
+    BackendMemset(d_offsets, 0, sizeof(uint32_t) * (num_buckets_ + 1));
+
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ + blocksize - 1) / blocksize;
+    SimtLaunch(num_blocks, blocksize, CountChainSlabsKernel<
+                       SlabHashContext<_Key, _Value, _Hash, _Inline>>,
+               gpu_context_, d_offsets, num_buckets_);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_buckets_, [&](uint32_t /*worker_id*/, uint32_t begin,
+                                  uint32_t end) {
+        CountChainSlabsKernelHost(gpu_context_, d_offsets, begin, end);
+    });
+#else
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ + blocksize - 1) / blocksize;
+    CountChainSlabsKernel<<<num_blocks, blocksize>>>(gpu_context_, d_offsets,
+                                                     num_buckets_);
+#endif
+    BackendExclusiveScan(d_offsets, num_buckets_ + 1);
+
+    uint32_t num_slabs;
+    BackendMemcpy(&num_slabs, d_offsets + num_buckets_, sizeof(uint32_t));
+    if (num_slabs > 0) {
+        uint32_t* d_slabs;
+        BackendMalloc(&d_slabs, sizeof(Slab) * num_slabs);
+#if defined(SLABHASH_BACKEND_SIMT)
+        const uint32_t num_blocks =
+                (num_buckets_ * 32 + blocksize - 1) / blocksize;
+        SimtLaunch(num_blocks, blocksize, GatherChainsKernel<
+                           SlabHashContext<_Key, _Value, _Hash, _Inline>>,
+                   gpu_context_, d_offsets, d_slabs, num_buckets_);
+#elif defined(SLABHASH_BACKEND_CPU)
+        ParallelFor(num_buckets_, [&](uint32_t /*worker_id*/, uint32_t begin,
+                                      uint32_t end) {
+            GatherChainsKernelHost(gpu_context_, d_offsets, d_slabs, begin,
+                                   end);
+        });
+#else
+        const uint32_t num_blocks =
+                (num_buckets_ * 32 + blocksize - 1) / blocksize;
+        GatherChainsKernel<<<num_blocks, blocksize>>>(gpu_context_, d_offsets,
+                                                      d_slabs, num_buckets_);
+#endif
+        slab_list_allocator_->Relayout(d_slabs, num_slabs);
+        BackendFree(d_slabs);
+    }
+    BackendFree(d_offsets);
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::SetMaxChainLength(
+        float max_chain_length) {
+    max_chain_length_ = max_chain_length;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::SetNearTailAllocation(
+        bool near_tail_allocation) {
+    gpu_context_.SetNearTailAllocation(near_tail_allocation);
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::SetBucketOrderedSearch(
+        bool bucket_ordered_search) {
+    bucket_ordered_search_ = bucket_ordered_search;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::SetBatchDeduplication(
+        bool batch_deduplication) {
+    batch_deduplication_ = batch_deduplication;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+double SlabHash<_Key, _Value, _Hash, _Inline>::ComputeAverageChainLength() {
+    BackendSetDevice(device_idx_);
+    return double(num_buckets_ + CountAllocatedSlabs()) / double(num_buckets_);
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::RehashIfNeeded() {
+    if (max_chain_length_ <= 0) return;
+
+    double average_chain_length = ComputeAverageChainLength();
+    if (average_chain_length > max_chain_length_ && splits_per_batch_ > 0) {
+        SplitBuckets(splits_per_batch_);
+    } else if (average_chain_length > max_chain_length_) {
+        /* Enough buckets for the current slabs to become list heads */
+        uint32_t new_bucket_count = std::max(
+                2 * num_buckets_,
+                uint32_t(std::ceil(num_buckets_ * average_chain_length)));
+        Rehash(new_bucket_count);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::EnableLinearHashing(
+        uint32_t max_bucket_count, uint32_t splits_per_batch) {
+    ReserveBuckets(max_bucket_count);
+    splits_per_batch_ = splits_per_batch;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+bool SlabHash<_Key, _Value, _Hash, _Inline>::Reserve(
+        uint32_t max_keyvalue_count) {
+    if (max_keyvalue_count > max_pair_capacity_) {
+        return false;
+    }
+
+    BackendSetDevice(device_idx_);
+    if (!slab_list_allocator_->Reserve(max_keyvalue_count / NEXT_SLAB_PTR_LANE +
+                                       1)) {
+        return false;
+    }
+    gpu_context_.SetSlabAllocator(slab_list_allocator_->getContext());
+    pair_allocator_->Reserve(max_keyvalue_count);
+    gpu_context_.SetPairAllocator(pair_allocator_->gpu_context_);
+    return true;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+bool SlabHash<_Key, _Value, _Hash, _Inline>::MayGrowSlabs(
+        uint32_t /*num_keys*/) {
+    return false;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::ReserveBuckets(
+        uint32_t bucket_capacity) {
+    if (bucket_capacity <= bucket_capacity_) return;
+
+    BackendSetDevice(device_idx_);
+    Slab* new_bucket_list_head;
+    BackendMalloc(&new_bucket_list_head, sizeof(Slab) * bucket_capacity);
+    BackendMemcpy(new_bucket_list_head, bucket_list_head_,
+                  sizeof(Slab) * num_buckets_);
+    BackendMemset(new_bucket_list_head + num_buckets_, 0xFF,
+                  sizeof(Slab) * (bucket_capacity - num_buckets_));
+
+    BackendFree(bucket_list_head_);
+    bucket_list_head_ = new_bucket_list_head;
+    bucket_capacity_ = bucket_capacity;
+    gpu_context_.SetBuckets(bucket_list_head_, num_buckets_ - split_bucket_,
+                            split_bucket_);
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHash<_Key, _Value, _Hash, _Inline>::SplitBuckets(uint32_t num_splits) {
+    const uint32_t level_buckets = num_buckets_ - split_bucket_;
+    num_splits = std::min(num_splits, level_buckets - split_bucket_);
+    if (num_buckets_ + num_splits > bucket_capacity_) {
+        ReserveBuckets(
+                std::max(2 * bucket_capacity_, num_buckets_ + num_splits));
+    }
+
+    BackendSetDevice(device_idx_);
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_splits * 32 + blocksize - 1) / blocksize;
+    SimtLaunch(num_blocks, blocksize, SplitKernel<_Key, _Value, _Hash>,
+               gpu_context_, split_bucket_, num_splits);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_splits, [&](uint32_t worker_id, uint32_t begin,
+                                uint32_t end) {
+        SplitKernelHost(gpu_context_, split_bucket_, begin, end,
+                        worker_id);
+    });
+#else
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_splits * 32 + blocksize - 1) / blocksize;
+    SplitKernel<_Key, _Value, _Hash><<<num_blocks, blocksize>>>(
+            gpu_context_, split_bucket_, num_splits);
+#endif
+
+    /* A level is complete once all its buckets are split */
+    num_buckets_ += num_splits;
+    split_bucket_ += num_splits;
+    if (split_bucket_ == level_buckets) split_bucket_ = 0;
+    gpu_context_.SetBuckets(bucket_list_head_, num_buckets_ - split_bucket_,
+                            split_bucket_);
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+uint32_t SlabHash<_Key, _Value, _Hash, _Inline>::CountAllocatedSlabs() {
+    return slab_list_allocator_->NumAllocated();
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+double SlabHash<_Key, _Value, _Hash, _Inline>::ComputeLoadFactor(
+        int flag /* = 0 */) {
+    uint32_t* h_bucket_count = new uint32_t[num_buckets_];
+    uint32_t* d_bucket_count;
+    BackendMalloc(&d_bucket_count, sizeof(uint32_t) * num_buckets_);
+    BackendMemset(d_bucket_count, 0, sizeof(uint32_t) * num_buckets_);
+
+    //---------------------------------
+    // counting the number of inserted elements:
+    CountBuckets(d_bucket_count);
+    BackendMemcpy(h_bucket_count, d_bucket_count,
+                  sizeof(uint32_t) * num_buckets_);
 
     int total_elements_stored = 0;
-    for (int i = 0; i < num_buckets_; i++) {
+    for (uint32_t i = 0; i < num_buckets_; i++) {
         total_elements_stored += h_bucket_count[i];
     }
 
@@ -760,29 +3667,17 @@ double SlabHash<_Key, _Value, _Hash>::ComputeLoadFactor(int flag = 0) {
                total_elements_stored * (sizeof(_Key) + sizeof(_Value)));
     }
 
-    // counting total number of allocated memory units:
-    int num_mem_units = dynamic_alloc.NUM_MEM_BLOCKS_PER_SUPER_BLOCK_ * 32;
-    int num_cuda_blocks = (num_mem_units + blocksize - 1) / blocksize;
-    compute_stats_allocators<<<num_cuda_blocks, blocksize>>>(
-            d_count_super_blocks, gpu_context_);
-
-    CHECK_CUDA(cudaMemcpy(h_count_super_blocks, d_count_super_blocks,
-                          sizeof(uint32_t) * num_super_blocks,
-                          cudaMemcpyDeviceToHost));
-
     // computing load factor
-    int total_mem_units = num_buckets_;
-    for (int i = 0; i < num_super_blocks; i++)
-        total_mem_units += h_count_super_blocks[i];
+    int total_mem_units = num_buckets_ + CountAllocatedSlabs();
 
     double load_factor =
             double(total_elements_stored * (sizeof(_Key) + sizeof(_Value))) /
             double(total_mem_units * WARP_WIDTH * sizeof(uint32_t));
 
-    if (d_count_super_blocks) CHECK_CUDA(cudaFree(d_count_super_blocks));
-    if (d_bucket_count) CHECK_CUDA(cudaFree(d_bucket_count));
+    if (d_bucket_count) BackendFree(d_bucket_count);
     delete[] h_bucket_count;
-    delete[] h_count_super_blocks;
 
     return load_factor;
 }
+
+#include "slab_hash_inline.h"
@@ -0,0 +1,1201 @@
+/*
+ * Copyright 2019 Saman Ashkiani
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Host backend (SLABHASH_BACKEND_CPU) of SlabHashContext.
+ * Included from slab_hash.h.
+ *
+ * The slab layout and the allocators are the same as on the device. Instead
+ * of a warp cooperatively processing one key at a time, each host thread
+ * processes its own key and scans the 32 words of a slab by itself. The
+ * branches below mirror the ones in the SIMT implementation; the ballots
+ * over a slab are vectorized by SlabProbe.
+ */
+
+#include "slab_probe.h"
+
+/* Ballot of the empty pair lanes of a slab snapshot */
+inline uint32_t FindEmptyLanes(const ptr_t* slab) {
+    return SlabProbe(slab, EMPTY_PAIR_PTR) & PAIR_PTR_LANES_MASK;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+ptr_t* SlabHashContext<_Key, _Value, _Hash, _Inline>::get_slab_ptr(
+        const uint32_t bucket_id, const ptr_t slab_ptr) {
+    return (slab_ptr == HEAD_SLAB_PTR)
+                   ? get_unit_ptr_from_list_head(bucket_id, 0)
+                   : get_unit_ptr_from_list_nodes(slab_ptr, 0);
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+int32_t SlabHashContext<_Key, _Value, _Hash, _Inline>::FindKey(
+        const _Key& key,
+        const uint32_t fingerprint,
+        const ptr_t* slab,
+        const uint32_t empty_lanes) {
+    /* Only the occupied lanes, with a matching fingerprint if enabled, need
+     * to be dereferenced */
+    uint32_t candidate_lanes = ~empty_lanes & PAIR_PTR_LANES_MASK;
+    if (fingerprint_mask_) {
+        candidate_lanes &= SlabProbe(slab, fingerprint, fingerprint_mask_);
+    }
+    while (candidate_lanes) {
+        int32_t lane_id = __builtin_ctz(candidate_lanes);
+        if (pair_allocator_ctx_.extract(DecodePairPtr(slab[lane_id])).first ==
+            key) {
+            return lane_id;
+        }
+        candidate_lanes &= candidate_lanes - 1;
+    }
+    return -1;
+}
+
+/* All the lanes holding @key, without early exit */
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+uint32_t SlabHashContext<_Key, _Value, _Hash, _Inline>::FindKeys(
+        const _Key& key,
+        const uint32_t fingerprint,
+        const ptr_t* slab,
+        const uint32_t empty_lanes) {
+    uint32_t candidate_lanes = ~empty_lanes & PAIR_PTR_LANES_MASK;
+    if (fingerprint_mask_) {
+        candidate_lanes &= SlabProbe(slab, fingerprint, fingerprint_mask_);
+    }
+    uint32_t found_lanes = 0;
+    while (candidate_lanes) {
+        int32_t lane_id = __builtin_ctz(candidate_lanes);
+        if (pair_allocator_ctx_.extract(DecodePairPtr(slab[lane_id])).first ==
+            key) {
+            found_lanes |= 1u << lane_id;
+        }
+        candidate_lanes &= candidate_lanes - 1;
+    }
+    return found_lanes;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+int32_t SlabHashContext<_Key, _Value, _Hash, _Inline>::FindEmpty(
+        const uint32_t empty_lanes) {
+    return empty_lanes ? __builtin_ctz(empty_lanes) : -1;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+ptr_t SlabHashContext<_Key, _Value, _Hash, _Inline>::AllocateSlab(
+        const ptr_t tail_slab_ptr) {
+    return (near_tail_allocation_ && tail_slab_ptr != HEAD_SLAB_PTR)
+                   ? slab_list_allocator_ctx_.AllocateNear(tail_slab_ptr)
+                   : slab_list_allocator_ctx_.Allocate();
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+pair_t<iterator_t, bool> SlabHashContext<_Key, _Value, _Hash, _Inline>::Search(
+        const uint32_t bucket_id, const _Key& query_key) {
+    ptr_t curr_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t unit_data[WARP_WIDTH];
+    const uint32_t fingerprint = ComputeFingerprint(query_key);
+
+    while (true) {
+        const ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        for (uint32_t lane_id = 0; lane_id < WARP_WIDTH; ++lane_id) {
+            unit_data[lane_id] = AtomicLoad(slab + lane_id);
+        }
+
+        uint32_t empty_lanes = FindEmptyLanes(unit_data);
+        int32_t lane_found = FindKey(query_key, fingerprint, unit_data,
+                                     empty_lanes);
+
+        /** 1. Found in this slab, SUCCEED **/
+        if (lane_found >= 0) {
+            return pair_t<iterator_t, bool>(
+                    DecodePairPtr(unit_data[lane_found]), true);
+        }
+
+        /** 2. Not found in this slab **/
+        ptr_t next_slab_ptr = unit_data[NEXT_SLAB_PTR_LANE];
+
+        /** 2.1. Next slab is empty, ABORT **/
+        if (next_slab_ptr == EMPTY_SLAB_PTR) {
+            return pair_t<iterator_t, bool>(NULL_ITERATOR, false);
+        }
+        /** 2.2. Next slab exists, RESTART **/
+        curr_slab_ptr = next_slab_ptr;
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+pair_t<iterator_t, bool> SlabHashContext<_Key, _Value, _Hash, _Inline>::Insert(
+        const uint32_t bucket_id, const _Key& key, const _Value& value) {
+    ptr_t curr_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t unit_data[WARP_WIDTH];
+    const uint32_t fingerprint = ComputeFingerprint(key);
+
+    ptr_t prealloc_pair_internal_ptr = AllocatePair(key, value);
+
+    /** Pair pool full: ABORT **/
+    if (prealloc_pair_internal_ptr == EMPTY_PAIR_PTR) {
+        return pair_t<iterator_t, bool>(OUT_OF_CAPACITY_ITERATOR, false);
+    }
+
+    while (true) {
+        ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        for (uint32_t lane_id = 0; lane_id < WARP_WIDTH; ++lane_id) {
+            unit_data[lane_id] = AtomicLoad(slab + lane_id);
+        }
+
+        uint32_t empty_lanes = FindEmptyLanes(unit_data);
+        int32_t lane_found =
+                FindKey(key, fingerprint, unit_data, empty_lanes);
+
+        /** Branch 1: key already existing, ABORT **/
+        if (lane_found >= 0) {
+            pair_allocator_ctx_.Free(prealloc_pair_internal_ptr);
+            return pair_t<iterator_t, bool>(NULL_ITERATOR, false);
+        }
+
+        /** Branch 2: empty slot available, try to insert **/
+        int32_t lane_empty = FindEmpty(empty_lanes);
+        if (lane_empty >= 0) {
+            ptr_t old_pair_internal_ptr = atomicCAS(
+                    slab + lane_empty, EMPTY_PAIR_PTR,
+                    EncodePairPtr(prealloc_pair_internal_ptr, fingerprint));
+
+            /** Branch 2.1: SUCCEED **/
+            if (old_pair_internal_ptr == EMPTY_PAIR_PTR) {
+                return pair_t<iterator_t, bool>(prealloc_pair_internal_ptr,
+                                                true);
+            }
+            /** Branch 2.2: failed: RESTART on the same slab **/
+            continue;
+        }
+
+        /** Branch 3: nothing found in this slab, goto next slab **/
+        ptr_t next_slab_ptr = unit_data[NEXT_SLAB_PTR_LANE];
+
+        /** Branch 3.1: next slab existing, RESTART this lane **/
+        if (next_slab_ptr != EMPTY_SLAB_PTR) {
+            curr_slab_ptr = next_slab_ptr;
+            continue;
+        }
+
+        /** Branch 3.2: next slab empty, try to allocate one **/
+        ptr_t new_next_slab_ptr = AllocateSlab(curr_slab_ptr);
+        ptr_t old_next_slab_ptr = atomicCAS(slab + NEXT_SLAB_PTR_LANE,
+                                            EMPTY_SLAB_PTR, new_next_slab_ptr);
+
+        /** Branch 3.2.1: other thread allocated, RESTART lane **/
+        if (old_next_slab_ptr != EMPTY_SLAB_PTR) {
+            FreeSlab(new_next_slab_ptr);
+        }
+        /** Branch 3.2.2: this thread allocated, RESTART lane **/
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+bool SlabHashContext<_Key, _Value, _Hash, _Inline>::Remove(
+        const uint32_t bucket_id, const _Key& key) {
+    ptr_t curr_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t unit_data[WARP_WIDTH];
+    const uint32_t fingerprint = ComputeFingerprint(key);
+
+    while (true) {
+        ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        for (uint32_t lane_id = 0; lane_id < WARP_WIDTH; ++lane_id) {
+            unit_data[lane_id] = AtomicLoad(slab + lane_id);
+        }
+
+        uint32_t empty_lanes = FindEmptyLanes(unit_data);
+        int32_t lane_found =
+                FindKey(key, fingerprint, unit_data, empty_lanes);
+
+        /** Branch 1: key found **/
+        if (lane_found >= 0) {
+            ptr_t pair_to_delete = unit_data[lane_found];
+            ptr_t old_key_value_pair = atomicCAS(
+                    slab + lane_found, pair_to_delete, EMPTY_PAIR_PTR);
+
+            /** Branch 1.1: this thread reset, free src_addr **/
+            if (old_key_value_pair == pair_to_delete) {
+                pair_allocator_ctx_.Free(DecodePairPtr(pair_to_delete));
+                return true;
+            }
+            /** Branch 1.2: other thread removed this pair, avoid double free
+             * and RESTART lane: with duplicate keys, another copy may still
+             * be stored further down the list **/
+            continue;
+        }
+
+        ptr_t next_slab_ptr = unit_data[NEXT_SLAB_PTR_LANE];
+        if (next_slab_ptr == EMPTY_SLAB_PTR) {
+            return false;
+        }
+        curr_slab_ptr = next_slab_ptr;
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+pair_t<iterator_t, bool>
+SlabHashContext<_Key, _Value, _Hash, _Inline>::InsertOrAssign(
+        const uint32_t bucket_id, const _Key& key, const _Value& value) {
+    ptr_t curr_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t unit_data[WARP_WIDTH];
+    const uint32_t fingerprint = ComputeFingerprint(key);
+
+    /* Allocated on the first attempt in Branch 2 */
+    ptr_t prealloc_pair_internal_ptr = EMPTY_PAIR_PTR;
+
+    while (true) {
+        ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        for (uint32_t lane_id = 0; lane_id < WARP_WIDTH; ++lane_id) {
+            unit_data[lane_id] = AtomicLoad(slab + lane_id);
+        }
+
+        uint32_t empty_lanes = FindEmptyLanes(unit_data);
+        int32_t lane_found =
+                FindKey(key, fingerprint, unit_data, empty_lanes);
+
+        /** Branch 1: key already existing, REPLACE the value **/
+        if (lane_found >= 0) {
+            iterator_t iterator = DecodePairPtr(unit_data[lane_found]);
+            pair_allocator_ctx_.extract(iterator).second = value;
+            if (prealloc_pair_internal_ptr != EMPTY_PAIR_PTR) {
+                pair_allocator_ctx_.Free(prealloc_pair_internal_ptr);
+            }
+            return pair_t<iterator_t, bool>(iterator, false);
+        }
+
+        /** Branch 2: empty slot available, try to insert **/
+        int32_t lane_empty = FindEmpty(empty_lanes);
+        if (lane_empty >= 0) {
+            if (prealloc_pair_internal_ptr == EMPTY_PAIR_PTR) {
+                prealloc_pair_internal_ptr = AllocatePair(key, value);
+
+                /** Branch 2.0: pair pool full, ABORT **/
+                if (prealloc_pair_internal_ptr == EMPTY_PAIR_PTR) {
+                    return pair_t<iterator_t, bool>(OUT_OF_CAPACITY_ITERATOR,
+                                                    false);
+                }
+            }
+
+            ptr_t old_pair_internal_ptr = atomicCAS(
+                    slab + lane_empty, EMPTY_PAIR_PTR,
+                    EncodePairPtr(prealloc_pair_internal_ptr, fingerprint));
+
+            /** Branch 2.1: SUCCEED **/
+            if (old_pair_internal_ptr == EMPTY_PAIR_PTR) {
+                return pair_t<iterator_t, bool>(prealloc_pair_internal_ptr,
+                                                true);
+            }
+            /** Branch 2.2: failed: RESTART on the same slab **/
+            continue;
+        }
+
+        /** Branch 3: nothing found in this slab, goto next slab **/
+        ptr_t next_slab_ptr = unit_data[NEXT_SLAB_PTR_LANE];
+
+        /** Branch 3.1: next slab existing, RESTART this lane **/
+        if (next_slab_ptr != EMPTY_SLAB_PTR) {
+            curr_slab_ptr = next_slab_ptr;
+            continue;
+        }
+
+        /** Branch 3.2: next slab empty, try to allocate one **/
+        ptr_t new_next_slab_ptr = AllocateSlab(curr_slab_ptr);
+        ptr_t old_next_slab_ptr = atomicCAS(slab + NEXT_SLAB_PTR_LANE,
+                                            EMPTY_SLAB_PTR, new_next_slab_ptr);
+
+        /** Branch 3.2.1: other thread allocated, RESTART lane **/
+        if (old_next_slab_ptr != EMPTY_SLAB_PTR) {
+            FreeSlab(new_next_slab_ptr);
+        }
+        /** Branch 3.2.2: this thread allocated, RESTART lane **/
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+template <typename _Reduce>
+pair_t<iterator_t, bool>
+SlabHashContext<_Key, _Value, _Hash, _Inline>::InsertOrReduce(
+        const uint32_t bucket_id,
+        const _Key& key,
+        const _Value& value,
+        const _Reduce& reduce) {
+    ptr_t curr_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t unit_data[WARP_WIDTH];
+    const uint32_t fingerprint = ComputeFingerprint(key);
+
+    /* Allocated on the first attempt in Branch 2 */
+    ptr_t prealloc_pair_internal_ptr = EMPTY_PAIR_PTR;
+
+    while (true) {
+        ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        for (uint32_t lane_id = 0; lane_id < WARP_WIDTH; ++lane_id) {
+            unit_data[lane_id] = AtomicLoad(slab + lane_id);
+        }
+
+        uint32_t empty_lanes = FindEmptyLanes(unit_data);
+        int32_t lane_found =
+                FindKey(key, fingerprint, unit_data, empty_lanes);
+
+        /** Branch 1: key already existing, COMBINE the values **/
+        if (lane_found >= 0) {
+            iterator_t iterator = DecodePairPtr(unit_data[lane_found]);
+            reduce(&pair_allocator_ctx_.extract(iterator).second, value);
+            if (prealloc_pair_internal_ptr != EMPTY_PAIR_PTR) {
+                pair_allocator_ctx_.Free(prealloc_pair_internal_ptr);
+            }
+            return pair_t<iterator_t, bool>(iterator, false);
+        }
+
+        /** Branch 2: empty slot available, try to insert **/
+        int32_t lane_empty = FindEmpty(empty_lanes);
+        if (lane_empty >= 0) {
+            if (prealloc_pair_internal_ptr == EMPTY_PAIR_PTR) {
+                prealloc_pair_internal_ptr = AllocatePair(key, value);
+
+                /** Branch 2.0: pair pool full, ABORT **/
+                if (prealloc_pair_internal_ptr == EMPTY_PAIR_PTR) {
+                    return pair_t<iterator_t, bool>(OUT_OF_CAPACITY_ITERATOR,
+                                                    false);
+                }
+            }
+
+            ptr_t old_pair_internal_ptr = atomicCAS(
+                    slab + lane_empty, EMPTY_PAIR_PTR,
+                    EncodePairPtr(prealloc_pair_internal_ptr, fingerprint));
+
+            /** Branch 2.1: SUCCEED **/
+            if (old_pair_internal_ptr == EMPTY_PAIR_PTR) {
+                return pair_t<iterator_t, bool>(prealloc_pair_internal_ptr,
+                                                true);
+            }
+            /** Branch 2.2: failed: RESTART on the same slab **/
+            continue;
+        }
+
+        /** Branch 3: nothing found in this slab, goto next slab **/
+        ptr_t next_slab_ptr = unit_data[NEXT_SLAB_PTR_LANE];
+
+        /** Branch 3.1: next slab existing, RESTART this lane **/
+        if (next_slab_ptr != EMPTY_SLAB_PTR) {
+            curr_slab_ptr = next_slab_ptr;
+            continue;
+        }
+
+        /** Branch 3.2: next slab empty, try to allocate one **/
+        ptr_t new_next_slab_ptr = AllocateSlab(curr_slab_ptr);
+        ptr_t old_next_slab_ptr = atomicCAS(slab + NEXT_SLAB_PTR_LANE,
+                                            EMPTY_SLAB_PTR, new_next_slab_ptr);
+
+        /** Branch 3.2.1: other thread allocated, RESTART lane **/
+        if (old_next_slab_ptr != EMPTY_SLAB_PTR) {
+            FreeSlab(new_next_slab_ptr);
+        }
+        /** Branch 3.2.2: this thread allocated, RESTART lane **/
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+bool SlabHashContext<_Key, _Value, _Hash, _Inline>::UpdateExisting(
+        const uint32_t bucket_id, const _Key& key, const _Value& value) {
+    pair_t<iterator_t, bool> result = Search(bucket_id, key);
+
+    /** 1. Found, REPLACE the value **/
+    if (result.second) {
+        pair_allocator_ctx_.extract(result.first).second = value;
+    }
+    return result.second;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+iterator_t SlabHashContext<_Key, _Value, _Hash, _Inline>::InsertMulti(
+        const uint32_t bucket_id, const _Key& key, const _Value& value) {
+    ptr_t curr_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t unit_data[WARP_WIDTH];
+    const uint32_t fingerprint = ComputeFingerprint(key);
+
+    ptr_t prealloc_pair_internal_ptr = AllocatePair(key, value);
+
+    /** Pair pool full: ABORT **/
+    if (prealloc_pair_internal_ptr == EMPTY_PAIR_PTR) {
+        return OUT_OF_CAPACITY_ITERATOR;
+    }
+
+    while (true) {
+        ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        for (uint32_t lane_id = 0; lane_id < WARP_WIDTH; ++lane_id) {
+            unit_data[lane_id] = AtomicLoad(slab + lane_id);
+        }
+
+        /** Branch 2: empty slot available, try to insert **/
+        int32_t lane_empty = FindEmpty(FindEmptyLanes(unit_data));
+        if (lane_empty >= 0) {
+            ptr_t old_pair_internal_ptr = atomicCAS(
+                    slab + lane_empty, EMPTY_PAIR_PTR,
+                    EncodePairPtr(prealloc_pair_internal_ptr, fingerprint));
+
+            /** Branch 2.1: SUCCEED **/
+            if (old_pair_internal_ptr == EMPTY_PAIR_PTR) {
+                return prealloc_pair_internal_ptr;
+            }
+            /** Branch 2.2: failed: RESTART on the same slab **/
+            continue;
+        }
+
+        /** Branch 3: no empty slot in this slab, goto next slab **/
+        ptr_t next_slab_ptr = unit_data[NEXT_SLAB_PTR_LANE];
+
+        /** Branch 3.1: next slab existing, RESTART this lane **/
+        if (next_slab_ptr != EMPTY_SLAB_PTR) {
+            curr_slab_ptr = next_slab_ptr;
+            continue;
+        }
+
+        /** Branch 3.2: next slab empty, try to allocate one **/
+        ptr_t new_next_slab_ptr = AllocateSlab(curr_slab_ptr);
+        ptr_t old_next_slab_ptr = atomicCAS(slab + NEXT_SLAB_PTR_LANE,
+                                            EMPTY_SLAB_PTR, new_next_slab_ptr);
+
+        /** Branch 3.2.1: other thread allocated, RESTART lane **/
+        if (old_next_slab_ptr != EMPTY_SLAB_PTR) {
+            FreeSlab(new_next_slab_ptr);
+        }
+        /** Branch 3.2.2: this thread allocated, RESTART lane **/
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+uint32_t SlabHashContext<_Key, _Value, _Hash, _Inline>::Count(
+        const uint32_t bucket_id, const _Key& query_key) {
+    ptr_t curr_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t unit_data[WARP_WIDTH];
+    const uint32_t fingerprint = ComputeFingerprint(query_key);
+
+    uint32_t count = 0;
+    while (curr_slab_ptr != EMPTY_SLAB_PTR) {
+        const ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        for (uint32_t lane_id = 0; lane_id < WARP_WIDTH; ++lane_id) {
+            unit_data[lane_id] = AtomicLoad(slab + lane_id);
+        }
+
+        count += __builtin_popcount(FindKeys(query_key, fingerprint, unit_data,
+                                             FindEmptyLanes(unit_data)));
+        curr_slab_ptr = unit_data[NEXT_SLAB_PTR_LANE];
+    }
+    return count;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+uint32_t SlabHashContext<_Key, _Value, _Hash, _Inline>::SearchAll(
+        const uint32_t bucket_id,
+        const _Key& query_key,
+        _Value* values,
+        const uint32_t capacity) {
+    ptr_t curr_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t unit_data[WARP_WIDTH];
+    const uint32_t fingerprint = ComputeFingerprint(query_key);
+
+    uint32_t written = 0;
+    while (curr_slab_ptr != EMPTY_SLAB_PTR && written < capacity) {
+        const ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        for (uint32_t lane_id = 0; lane_id < WARP_WIDTH; ++lane_id) {
+            unit_data[lane_id] = AtomicLoad(slab + lane_id);
+        }
+
+        uint32_t found_lanes = FindKeys(query_key, fingerprint, unit_data,
+                                        FindEmptyLanes(unit_data));
+        while (found_lanes && written < capacity) {
+            int32_t lane_id = __builtin_ctz(found_lanes);
+            values[written++] =
+                    pair_allocator_ctx_
+                            .extract(DecodePairPtr(unit_data[lane_id]))
+                            .second;
+            found_lanes &= found_lanes - 1;
+        }
+        curr_slab_ptr = unit_data[NEXT_SLAB_PTR_LANE];
+    }
+    return written;
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHashContext<_Key, _Value, _Hash, _Inline>::InsertPairPtr(
+        const uint32_t bucket_id, const ptr_t pair_ptr) {
+    ptr_t curr_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t unit_data[WARP_WIDTH];
+
+    while (true) {
+        ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        for (uint32_t lane_id = 0; lane_id < WARP_WIDTH; ++lane_id) {
+            unit_data[lane_id] = AtomicLoad(slab + lane_id);
+        }
+
+        /** Branch 2: empty slot available, try to insert **/
+        int32_t lane_empty = FindEmpty(FindEmptyLanes(unit_data));
+        if (lane_empty >= 0) {
+            ptr_t old_pair_internal_ptr =
+                    atomicCAS(slab + lane_empty, EMPTY_PAIR_PTR, pair_ptr);
+
+            /** Branch 2.1: SUCCEED **/
+            if (old_pair_internal_ptr == EMPTY_PAIR_PTR) {
+                return;
+            }
+            /** Branch 2.2: failed: RESTART on the same slab **/
+            continue;
+        }
+
+        /** Branch 3: no empty slot in this slab, goto next slab **/
+        ptr_t next_slab_ptr = unit_data[NEXT_SLAB_PTR_LANE];
+
+        /** Branch 3.1: next slab existing, RESTART this lane **/
+        if (next_slab_ptr != EMPTY_SLAB_PTR) {
+            curr_slab_ptr = next_slab_ptr;
+            continue;
+        }
+
+        /** Branch 3.2: next slab empty, try to allocate one **/
+        ptr_t new_next_slab_ptr = AllocateSlab(curr_slab_ptr);
+        ptr_t old_next_slab_ptr = atomicCAS(slab + NEXT_SLAB_PTR_LANE,
+                                            EMPTY_SLAB_PTR, new_next_slab_ptr);
+
+        /** Branch 3.2.1: other thread allocated, RESTART lane **/
+        if (old_next_slab_ptr != EMPTY_SLAB_PTR) {
+            FreeSlab(new_next_slab_ptr);
+        }
+        /** Branch 3.2.2: this thread allocated, RESTART lane **/
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHashContext<_Key, _Value, _Hash, _Inline>::FreeChain(
+        const uint32_t bucket_id) {
+    ptr_t next_slab_ptr =
+            *get_unit_ptr_from_list_head(bucket_id, NEXT_SLAB_PTR_LANE);
+    while (next_slab_ptr != EMPTY_SLAB_PTR) {
+        ptr_t curr_slab_ptr = next_slab_ptr;
+        ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        next_slab_ptr = slab[NEXT_SLAB_PTR_LANE];
+        FreeSlab(curr_slab_ptr);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHashContext<_Key, _Value, _Hash, _Inline>::SplitBucket(
+        const uint32_t bucket_id) {
+    const uint32_t split_bucket_id = bucket_id + num_buckets_;
+    ptr_t curr_slab_ptr = HEAD_SLAB_PTR;
+
+    while (curr_slab_ptr != EMPTY_SLAB_PTR) {
+        ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        uint32_t pair_lanes = ~FindEmptyLanes(slab) & PAIR_PTR_LANES_MASK;
+        while (pair_lanes) {
+            int32_t lane_id = __builtin_ctz(pair_lanes);
+            const _Key& key =
+                    pair_allocator_ctx_.extract(DecodePairPtr(slab[lane_id]))
+                            .first;
+            if (ComputeSplitBucket(key) == split_bucket_id) {
+                InsertPairPtr(split_bucket_id, slab[lane_id]);
+                slab[lane_id] = EMPTY_PAIR_PTR;
+            }
+            pair_lanes &= pair_lanes - 1;
+        }
+        curr_slab_ptr = slab[NEXT_SLAB_PTR_LANE];
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHashContext<_Key, _Value, _Hash, _Inline>::CompactBucket(
+        const uint32_t bucket_id) {
+    ptr_t src_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t dst_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t prev_dst_slab_ptr = EMPTY_SLAB_PTR;
+    uint32_t dst_count = 0;
+
+    while (src_slab_ptr != EMPTY_SLAB_PTR) {
+        ptr_t* slab = get_slab_ptr(bucket_id, src_slab_ptr);
+        for (uint32_t lane_id = 0; lane_id < NEXT_SLAB_PTR_LANE; ++lane_id) {
+            if (slab[lane_id] == EMPTY_PAIR_PTR) continue;
+
+            /* Never past the source lane, which was just read */
+            ptr_t* dst_slab = get_slab_ptr(bucket_id, dst_slab_ptr);
+            dst_slab[dst_count] = slab[lane_id];
+            if (++dst_count == NEXT_SLAB_PTR_LANE) {
+                prev_dst_slab_ptr = dst_slab_ptr;
+                dst_slab_ptr = dst_slab[NEXT_SLAB_PTR_LANE];
+                dst_count = 0;
+            }
+        }
+        src_slab_ptr = slab[NEXT_SLAB_PTR_LANE];
+    }
+
+    /* Cut the chain after the last non-empty slab, and free the rest */
+    ptr_t* last_slab;
+    if (dst_count == 0 && dst_slab_ptr != HEAD_SLAB_PTR) {
+        last_slab = get_slab_ptr(bucket_id, prev_dst_slab_ptr);
+    } else {
+        last_slab = get_slab_ptr(bucket_id, dst_slab_ptr);
+        std::fill(last_slab + dst_count, last_slab + NEXT_SLAB_PTR_LANE,
+                  EMPTY_PAIR_PTR);
+    }
+    ptr_t free_slab_ptr = last_slab[NEXT_SLAB_PTR_LANE];
+    last_slab[NEXT_SLAB_PTR_LANE] = EMPTY_SLAB_PTR;
+    while (free_slab_ptr != EMPTY_SLAB_PTR) {
+        ptr_t next_slab_ptr =
+                get_slab_ptr(bucket_id, free_slab_ptr)[NEXT_SLAB_PTR_LANE];
+        FreeSlab(free_slab_ptr);
+        free_slab_ptr = next_slab_ptr;
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash, bool _Inline>
+void SlabHashContext<_Key, _Value, _Hash, _Inline>::BuildBucket(
+        const uint32_t bucket_id,
+        const _Key* keys,
+        const _Value* values,
+        const uint32_t* order,
+        const uint32_t num_keys) {
+    /** Branch 1: find the tail slab and the lane after its last pair **/
+    ptr_t tail_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t* slab = get_slab_ptr(bucket_id, tail_slab_ptr);
+    while (slab[NEXT_SLAB_PTR_LANE] != EMPTY_SLAB_PTR) {
+        tail_slab_ptr = slab[NEXT_SLAB_PTR_LANE];
+        slab = get_slab_ptr(bucket_id, tail_slab_ptr);
+    }
+    uint32_t used_lanes = ~FindEmptyLanes(slab) & PAIR_PTR_LANES_MASK;
+    uint32_t tail_lane = used_lanes ? 32 - __builtin_clz(used_lanes) : 0;
+
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        /** Branch 2: drop the keys in the chain, including earlier ones **/
+        const _Key& key = keys[order[i]];
+        if (Search(bucket_id, key).second) continue;
+
+        ptr_t pair_ptr = AllocatePair(key, values[order[i]]);
+        if (pair_ptr == EMPTY_PAIR_PTR) continue;
+
+        /** Branch 3: append it, linking a new slab to a full tail **/
+        if (tail_lane == NEXT_SLAB_PTR_LANE) {
+            ptr_t new_slab_ptr = AllocateSlab(tail_slab_ptr);
+            slab[NEXT_SLAB_PTR_LANE] = new_slab_ptr;
+            tail_slab_ptr = new_slab_ptr;
+            slab = get_slab_ptr(bucket_id, tail_slab_ptr);
+            tail_lane = 0;
+        }
+        slab[tail_lane++] = EncodePairPtr(pair_ptr, ComputeFingerprint(key));
+    }
+}
+
+/**
+ * Host kernels: each one processes [begin, end) of a batch on a single worker
+ * thread, with its own copy of the context (as a kernel receives its own
+ * copy of the context on the device).
+ */
+template <typename _Key, typename _Value, typename _Hash>
+void SearchKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        _Key* keys,
+        const uint32_t* order,
+        _Value* values,
+        uint8_t* founds,
+        uint32_t begin,
+        uint32_t end,
+        uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t j = begin; j < end; ++j) {
+        const uint32_t i = order ? order[j] : j;
+        pair_t<iterator_t, bool> result = slab_hash_ctx.Search(
+                slab_hash_ctx.ComputeBucket(keys[i]), keys[i]);
+
+        bool found = result.second;
+        founds[i] = found;
+        values[i] = found ? slab_hash_ctx.get_pair_alloc_ctx()
+                                    .extract(result.first)
+                                    .second
+                          : _Value(0);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void InsertKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        _Key* keys,
+        _Value* values,
+        uint8_t* statuses,
+        uint32_t begin,
+        uint32_t end,
+        uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t i = begin; i < end; ++i) {
+        pair_t<iterator_t, bool> result = slab_hash_ctx.Insert(
+                slab_hash_ctx.ComputeBucket(keys[i]), keys[i], values[i]);
+        if (statuses) statuses[i] = InsertStatus(result.first);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void RemoveKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        _Key* keys,
+        uint32_t begin,
+        uint32_t end,
+        uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t i = begin; i < end; ++i) {
+        slab_hash_ctx.Remove(slab_hash_ctx.ComputeBucket(keys[i]), keys[i]);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void InsertOrAssignKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        _Key* keys,
+        _Value* values,
+        uint8_t* statuses,
+        uint32_t begin,
+        uint32_t end,
+        uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t i = begin; i < end; ++i) {
+        pair_t<iterator_t, bool> result = slab_hash_ctx.InsertOrAssign(
+                slab_hash_ctx.ComputeBucket(keys[i]), keys[i], values[i]);
+        if (statuses) statuses[i] = InsertStatus(result.first);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash, typename _Reduce>
+void InsertOrReduceKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        _Key* keys,
+        _Value* values,
+        uint8_t* statuses,
+        uint32_t begin,
+        uint32_t end,
+        uint32_t worker_id,
+        _Reduce reduce) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t i = begin; i < end; ++i) {
+        pair_t<iterator_t, bool> result = slab_hash_ctx.InsertOrReduce(
+                slab_hash_ctx.ComputeBucket(keys[i]), keys[i], values[i],
+                reduce);
+        if (statuses) statuses[i] = InsertStatus(result.first);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void ActivateKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        _Key* keys,
+        iterator_t* iterators,
+        uint8_t* is_new,
+        uint32_t begin,
+        uint32_t end,
+        uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t i = begin; i < end; ++i) {
+        pair_t<iterator_t, bool> result = slab_hash_ctx.InsertOrReduce(
+                slab_hash_ctx.ComputeBucket(keys[i]), keys[i], _Value(),
+                ReduceKeep<_Value>());
+        iterators[i] = result.first;
+        is_new[i] = result.second;
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void UpdateExistingKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        _Key* keys,
+        _Value* values,
+        uint32_t begin,
+        uint32_t end,
+        uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t i = begin; i < end; ++i) {
+        slab_hash_ctx.UpdateExisting(slab_hash_ctx.ComputeBucket(keys[i]),
+                                     keys[i], values[i]);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void InsertMultiKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        _Key* keys,
+        _Value* values,
+        uint8_t* statuses,
+        uint32_t begin,
+        uint32_t end,
+        uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t i = begin; i < end; ++i) {
+        iterator_t iterator = slab_hash_ctx.InsertMulti(
+                slab_hash_ctx.ComputeBucket(keys[i]), keys[i], values[i]);
+        if (statuses) statuses[i] = InsertStatus(iterator);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void CountKernelHost(SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+                     _Key* keys,
+                     uint32_t* counts,
+                     uint32_t begin,
+                     uint32_t end,
+                     uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t i = begin; i < end; ++i) {
+        counts[i] = slab_hash_ctx.Count(slab_hash_ctx.ComputeBucket(keys[i]),
+                                        keys[i]);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SearchAllKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        _Key* keys,
+        uint32_t* offsets,
+        _Value* values,
+        uint32_t begin,
+        uint32_t end,
+        uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t i = begin; i < end; ++i) {
+        slab_hash_ctx.SearchAll(slab_hash_ctx.ComputeBucket(keys[i]), keys[i],
+                                values + offsets[i],
+                                offsets[i + 1] - offsets[i]);
+    }
+}
+
+/* Host counterpart of bucket_count_kernel, for buckets in [begin, end) */
+template <typename _Key, typename _Value, typename _Hash>
+void BucketCountKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        uint32_t* d_count_result,
+        uint32_t begin,
+        uint32_t end) {
+    for (uint32_t bucket_id = begin; bucket_id < end; ++bucket_id) {
+        uint32_t count = 0;
+
+        const ptr_t* slab =
+                slab_hash_ctx.get_unit_ptr_from_list_head(bucket_id, 0);
+        while (true) {
+            count += NEXT_SLAB_PTR_LANE -
+                     __builtin_popcount(FindEmptyLanes(slab));
+            ptr_t next = slab[NEXT_SLAB_PTR_LANE];
+            if (next == EMPTY_SLAB_PTR) break;
+            slab = slab_hash_ctx.get_unit_ptr_from_list_nodes(next, 0);
+        }
+
+        d_count_result[bucket_id] = count;
+    }
+}
+
+/* Host counterparts of ExportKernel and ForEachKernel */
+template <typename _Key, typename _Value, typename _Hash>
+void ExportKernelHost(SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+                      const uint32_t* d_offsets,
+                      _Key* keys,
+                      _Value* values,
+                      uint32_t begin,
+                      uint32_t end) {
+    MemoryAllocContext<pair_t<_Key, _Value>> pair_allocator_ctx =
+            slab_hash_ctx.get_pair_alloc_ctx();
+
+    for (uint32_t bucket_id = begin; bucket_id < end; ++bucket_id) {
+        uint32_t offset = d_offsets[bucket_id];
+
+        const ptr_t* slab =
+                slab_hash_ctx.get_unit_ptr_from_list_head(bucket_id, 0);
+        while (true) {
+            uint32_t pair_lanes = ~FindEmptyLanes(slab) & PAIR_PTR_LANES_MASK;
+            while (pair_lanes) {
+                int32_t lane_id = __builtin_ctz(pair_lanes);
+                const pair_t<_Key, _Value>& pair = pair_allocator_ctx.extract(
+                        slab_hash_ctx.DecodePairPtr(slab[lane_id]));
+                if (keys) keys[offset] = pair.first;
+                if (values) values[offset] = pair.second;
+                ++offset;
+                pair_lanes &= pair_lanes - 1;
+            }
+            ptr_t next = slab[NEXT_SLAB_PTR_LANE];
+            if (next == EMPTY_SLAB_PTR) break;
+            slab = slab_hash_ctx.get_unit_ptr_from_list_nodes(next, 0);
+        }
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash, typename _Func>
+void ForEachKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        _Func& func,
+        uint32_t begin,
+        uint32_t end) {
+    MemoryAllocContext<pair_t<_Key, _Value>> pair_allocator_ctx =
+            slab_hash_ctx.get_pair_alloc_ctx();
+
+    for (uint32_t bucket_id = begin; bucket_id < end; ++bucket_id) {
+        const ptr_t* slab =
+                slab_hash_ctx.get_unit_ptr_from_list_head(bucket_id, 0);
+        while (true) {
+            uint32_t pair_lanes = ~FindEmptyLanes(slab) & PAIR_PTR_LANES_MASK;
+            while (pair_lanes) {
+                int32_t lane_id = __builtin_ctz(pair_lanes);
+                pair_t<_Key, _Value>& pair = pair_allocator_ctx.extract(
+                        slab_hash_ctx.DecodePairPtr(slab[lane_id]));
+                func(pair.first, pair.second);
+                pair_lanes &= pair_lanes - 1;
+            }
+            ptr_t next = slab[NEXT_SLAB_PTR_LANE];
+            if (next == EMPTY_SLAB_PTR) break;
+            slab = slab_hash_ctx.get_unit_ptr_from_list_nodes(next, 0);
+        }
+    }
+}
+
+/* Host counterparts of RehashKernel, FreeChainsKernel, SplitKernel,
+ * CompactKernel and BulkBuildKernel */
+template <typename _Key, typename _Value, typename _Hash>
+void RehashKernelHost(SlabHashContext<_Key, _Value, _Hash, false> old_ctx,
+                      SlabHashContext<_Key, _Value, _Hash, false> new_ctx,
+                      uint32_t begin,
+                      uint32_t end,
+                      uint32_t worker_id) {
+    new_ctx.get_slab_alloc_ctx().Init(worker_id);
+    MemoryAllocContext<pair_t<_Key, _Value>> pair_allocator_ctx =
+            old_ctx.get_pair_alloc_ctx();
+
+    for (uint32_t bucket_id = begin; bucket_id < end; ++bucket_id) {
+        const ptr_t* slab = old_ctx.get_unit_ptr_from_list_head(bucket_id, 0);
+        while (true) {
+            uint32_t pair_lanes = ~FindEmptyLanes(slab) & PAIR_PTR_LANES_MASK;
+            while (pair_lanes) {
+                int32_t lane_id = __builtin_ctz(pair_lanes);
+                const _Key& key =
+                        pair_allocator_ctx
+                                .extract(old_ctx.DecodePairPtr(slab[lane_id]))
+                                .first;
+                new_ctx.InsertPairPtr(new_ctx.ComputeBucket(key),
+                                      slab[lane_id]);
+                pair_lanes &= pair_lanes - 1;
+            }
+            ptr_t next = slab[NEXT_SLAB_PTR_LANE];
+            if (next == EMPTY_SLAB_PTR) break;
+            slab = old_ctx.get_unit_ptr_from_list_nodes(next, 0);
+        }
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void FreeChainsKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        uint32_t begin,
+        uint32_t end) {
+    for (uint32_t bucket_id = begin; bucket_id < end; ++bucket_id) {
+        slab_hash_ctx.FreeChain(bucket_id);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SplitKernelHost(SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+                     uint32_t first_bucket,
+                     uint32_t begin,
+                     uint32_t end,
+                     uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t i = begin; i < end; ++i) {
+        slab_hash_ctx.SplitBucket(first_bucket + i);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void CompactKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        uint32_t begin,
+        uint32_t end,
+        uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t bucket_id = begin; bucket_id < end; ++bucket_id) {
+        slab_hash_ctx.CompactBucket(bucket_id);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void BulkBuildKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, false> slab_hash_ctx,
+        const _Key* keys,
+        const _Value* values,
+        const uint32_t* offsets,
+        const uint32_t* order,
+        uint32_t begin,
+        uint32_t end,
+        uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t bucket_id = begin; bucket_id < end; ++bucket_id) {
+        slab_hash_ctx.BuildBucket(bucket_id, keys, values,
+                                  order + offsets[bucket_id],
+                                  offsets[bucket_id + 1] - offsets[bucket_id]);
+    }
+}
+
+/* Host counterpart of compute_stats_allocators */
+template <typename _Context>
+void ComputeStatsAllocatorsHost(uint32_t* d_count_super_block,
+                                _Context slab_hash_ctx) {
+    uint32_t num_bitmaps =
+            slab_hash_ctx.get_slab_alloc_ctx().num_mem_blocks_per_super_block_ *
+            32;
+    for (uint32_t i = 0;
+         i < slab_hash_ctx.get_slab_alloc_ctx().num_super_blocks_; i++) {
+        for (uint32_t j = 0; j < num_bitmaps; ++j) {
+            uint32_t read_bitmap = *(
+                    slab_hash_ctx.get_slab_alloc_ctx().get_ptr_for_bitmap(i,
+                                                                          j));
+            d_count_super_block[i] += __builtin_popcount(read_bitmap);
+        }
+    }
+}
+
+/* Host counterparts of CountBucketKeysKernel and PartitionKeysKernel */
+template <typename _Context, typename _Key>
+void CountBucketKeysKernelHost(_Context slab_hash_ctx,
+                               const _Key* keys,
+                               uint32_t* counts,
+                               uint32_t begin,
+                               uint32_t end) {
+    for (uint32_t i = begin; i < end; ++i) {
+        atomicAdd(&counts[slab_hash_ctx.ComputeBucket(keys[i])], 1);
+    }
+}
+
+template <typename _Context, typename _Key>
+void PartitionKeysKernelHost(_Context slab_hash_ctx,
+                             const _Key* keys,
+                             uint32_t* cursors,
+                             uint32_t* order,
+                             uint32_t begin,
+                             uint32_t end) {
+    for (uint32_t i = begin; i < end; ++i) {
+        order[atomicAdd(&cursors[slab_hash_ctx.ComputeBucket(keys[i])], 1)] =
+                i;
+    }
+}
+
+/* Host counterparts of CountChainSlabsKernel and GatherChainsKernel */
+template <typename _Context>
+void CountChainSlabsKernelHost(_Context slab_hash_ctx,
+                               uint32_t* counts,
+                               uint32_t begin,
+                               uint32_t end) {
+    for (uint32_t bucket_id = begin; bucket_id < end; ++bucket_id) {
+        uint32_t count = 0;
+        ptr_t slab_ptr = *slab_hash_ctx.get_unit_ptr_from_list_head(
+                bucket_id, NEXT_SLAB_PTR_LANE);
+        while (slab_ptr != EMPTY_SLAB_PTR) {
+            ++count;
+            slab_ptr = *slab_hash_ctx.get_unit_ptr_from_list_nodes(
+                    slab_ptr, NEXT_SLAB_PTR_LANE);
+        }
+        counts[bucket_id] = count;
+    }
+}
+
+template <typename _Context>
+void GatherChainsKernelHost(_Context slab_hash_ctx,
+                            const uint32_t* offsets,
+                            uint32_t* slabs,
+                            uint32_t begin,
+                            uint32_t end) {
+    const SlabAllocContext& alloc_ctx = slab_hash_ctx.get_slab_alloc_ctx();
+    for (uint32_t bucket_id = begin; bucket_id < end; ++bucket_id) {
+        uint32_t index = offsets[bucket_id];
+        ptr_t* next_ptr = slab_hash_ctx.get_unit_ptr_from_list_head(
+                bucket_id, NEXT_SLAB_PTR_LANE);
+        ptr_t slab_ptr = *next_ptr;
+        while (slab_ptr != EMPTY_SLAB_PTR) {
+            *next_ptr = alloc_ctx.getSequentialAddress(index);
+            uint32_t* slab = slabs + size_t(index) * WARP_WIDTH;
+            std::memcpy(slab,
+                        slab_hash_ctx.get_unit_ptr_from_list_nodes(slab_ptr, 0),
+                        WARP_WIDTH * sizeof(uint32_t));
+            next_ptr = slab + NEXT_SLAB_PTR_LANE;
+            slab_ptr = *next_ptr;
+            ++index;
+        }
+    }
+}
+
+/* Host counterparts of DedupBucketKeysKernel and CompactBucketKeysKernel */
+template <typename _Key, typename _Value, typename _Combine>
+void DedupBucketKeysKernelHost(const _Key* keys,
+                               const _Value* values,
+                               const uint32_t* offsets,
+                               uint32_t* order,
+                               _Value* merged,
+                               uint32_t* counts,
+                               uint32_t begin,
+                               uint32_t end,
+                               _Combine combine) {
+    for (uint32_t bucket_id = begin; bucket_id < end; ++bucket_id) {
+        uint32_t range_begin = offsets[bucket_id];
+        uint32_t range_end = offsets[bucket_id + 1];
+        uint32_t unique_end = range_begin;
+        for (uint32_t i = range_begin; i < range_end; ++i) {
+            uint32_t index = order[i];
+            uint32_t j = range_begin;
+            while (j < unique_end && !(keys[order[j]] == keys[index])) {
+                ++j;
+            }
+            if (j < unique_end) {
+                combine(&order[j], &merged[j], index, values[index]);
+            } else {
+                order[unique_end] = index;
+                merged[unique_end] = values[index];
+                ++unique_end;
+            }
+        }
+        counts[bucket_id] = unique_end - range_begin;
+    }
+}
+
+template <typename _Key, typename _Value>
+void CompactBucketKeysKernelHost(const _Key* keys,
+                                 const uint32_t* offsets,
+                                 const uint32_t* order,
+                                 const _Value* merged,
+                                 const uint32_t* unique_offsets,
+                                 _Key* unique_keys,
+                                 _Value* unique_values,
+                                 uint32_t begin,
+                                 uint32_t end) {
+    for (uint32_t bucket_id = begin; bucket_id < end; ++bucket_id) {
+        uint32_t range_begin = offsets[bucket_id];
+        uint32_t unique_begin = unique_offsets[bucket_id];
+        uint32_t num_unique = unique_offsets[bucket_id + 1] - unique_begin;
+        for (uint32_t i = 0; i < num_unique; ++i) {
+            unique_keys[unique_begin + i] = keys[order[range_begin + i]];
+            unique_values[unique_begin + i] = merged[range_begin + i];
+        }
+    }
+}
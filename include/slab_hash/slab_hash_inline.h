@@ -0,0 +1,2691 @@
+/*
+ * Copyright 2019 Saman Ashkiani
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Inline specialization of SlabHash, selected when both the key and the value
+ * fit in 32 bits (IsInlinePair). Included from slab_hash.h.
+ *
+ * As in the original SlabHash, a slab stores 15 pairs directly:
+ * lanes:  0  1  2  3 ... 28 29 |   30   |  31
+ *         k  v  k  v ...  k  v | unused | next
+ * A pair is inserted/removed with a single 64-bit CAS on its (key, value)
+ * lanes, so there is no pair pool and no pointer to dereference.
+ * The key whose bits are all 1 (EMPTY_KEY) is reserved, and is ignored by all
+ * the operations: the inserting ones report it as STATUS_RESERVED_KEY.
+ */
+
+template <typename _Key, typename _Value, typename _Hash>
+class SlabHashContext<_Key, _Value, _Hash, true> {
+public:
+    SlabHashContext();
+    __host__ void Setup(Slab* bucket_list_head,
+                        const uint32_t num_buckets,
+                        const SlabAllocContext& allocator_ctx);
+
+    /* Core SIMT operations */
+    __device__ bool Insert(bool& lane_active,
+                           const uint32_t lane_id,
+                           const uint32_t bucket_id,
+                           const _Key& key,
+                           const _Value& value);
+
+    __device__ pair_t<_Value, bool> Search(bool& lane_active,
+                                           const uint32_t lane_id,
+                                           const uint32_t bucket_id,
+                                           const _Key& key);
+
+    __device__ bool Remove(bool& lane_active,
+                           const uint32_t lane_id,
+                           const uint32_t bucket_id,
+                           const _Key& key);
+
+    /* The value lane of an existing key is overwritten with an atomicExch */
+    __device__ bool InsertOrAssign(bool& lane_active,
+                                   const uint32_t lane_id,
+                                   const uint32_t bucket_id,
+                                   const _Key& key,
+                                   const _Value& value);
+
+    __device__ bool UpdateExisting(bool& lane_active,
+                                   const uint32_t lane_id,
+                                   const uint32_t bucket_id,
+                                   const _Key& key,
+                                   const _Value& value);
+
+    /* @reduce is called on the value lane of an existing key */
+    template <typename _Reduce>
+    __device__ bool InsertOrReduce(bool& lane_active,
+                                   const uint32_t lane_id,
+                                   const uint32_t bucket_id,
+                                   const _Key& key,
+                                   const _Value& value,
+                                   const _Reduce& reduce);
+
+    /* Rehash primitives: InsertPairBits stores a (key, value) pair of
+     * another table in the chain of @bucket_id, without looking for its key;
+     * FreeChain frees the slabs chained after the head of @bucket_id */
+    __device__ void InsertPairBits(bool& lane_active,
+                                   const uint32_t lane_id,
+                                   const uint32_t bucket_id,
+                                   const uint64_t pair);
+
+    __device__ void FreeChain(const uint32_t lane_id, const uint32_t bucket_id);
+
+    /* Linear hashing: moves the pairs of @bucket_id that belong to
+     * bucket_id + num_buckets at the next level into that (empty) bucket */
+    __device__ void SplitBucket(const uint32_t lane_id,
+                                const uint32_t bucket_id);
+
+    /* Compaction: packs the pairs of @bucket_id toward its head slab, in
+     * chain order, then unlinks and frees the slabs left empty */
+    __device__ void CompactBucket(const uint32_t lane_id,
+                                  const uint32_t bucket_id);
+
+    /* Bulk build: appends the pairs (keys[order[i]], values[order[i]]),
+     * i < @num_keys, all of @bucket_id, after the last pair of its chain
+     * with plain stores, skipping the keys already in the chain. The
+     * caller owns the bucket, see BulkBuildInlineKernel */
+    __device__ void BuildBucket(const uint32_t lane_id,
+                                const uint32_t bucket_id,
+                                const _Key* keys,
+                                const _Value* values,
+                                const uint32_t* order,
+                                const uint32_t num_keys);
+
+#ifdef SLABHASH_BACKEND_CPU
+    /* Core scalar operations, one key per host thread */
+    bool Insert(const uint32_t bucket_id, const _Key& key, const _Value& value);
+
+    pair_t<_Value, bool> Search(const uint32_t bucket_id, const _Key& key);
+
+    bool Remove(const uint32_t bucket_id, const _Key& key);
+
+    bool InsertOrAssign(const uint32_t bucket_id,
+                        const _Key& key,
+                        const _Value& value);
+
+    bool UpdateExisting(const uint32_t bucket_id,
+                        const _Key& key,
+                        const _Value& value);
+
+    template <typename _Reduce>
+    bool InsertOrReduce(const uint32_t bucket_id,
+                        const _Key& key,
+                        const _Value& value,
+                        const _Reduce& reduce);
+
+    void InsertPairBits(const uint32_t bucket_id, const uint64_t pair);
+
+    void FreeChain(const uint32_t bucket_id);
+
+    void SplitBucket(const uint32_t bucket_id);
+
+    void CompactBucket(const uint32_t bucket_id);
+
+    void BuildBucket(const uint32_t bucket_id,
+                     const _Key* keys,
+                     const _Value* values,
+                     const uint32_t* order,
+                     const uint32_t num_keys);
+#endif
+
+    /* Hash function. With linear hashing, @num_buckets is the bucket count
+     * of the current level, and the buckets below @split_bucket have
+     * already been split in two, see SplitBucket */
+    __device__ __host__ uint32_t ComputeBucket(const _Key& key) const;
+    __device__ __host__ uint32_t ComputeSplitBucket(const _Key& key) const;
+
+    /* Point to another bucket array, e.g. to rehash into it */
+    __host__ void SetBuckets(Slab* bucket_list_head,
+                             const uint32_t num_buckets,
+                             const uint32_t split_bucket = 0);
+    /* Refresh the allocator context after SlabAlloc::Reserve */
+    __host__ void SetSlabAllocator(const SlabAllocContext& slab_alloc_ctx);
+    /* Allocate the slabs extending a chain next to its tail slab when
+     * possible, see SlabAllocContext::WarpAllocateNear */
+    __host__ void SetNearTailAllocation(const bool near_tail_allocation);
+
+    /* Raw bits of keys and values, as stored in the slab lanes */
+    __device__ __host__ static __forceinline__ uint32_t
+    KeyToBits(const _Key& key) {
+        uint32_t bits = 0;
+        memcpy(&bits, &key, sizeof(_Key));
+        return bits;
+    }
+    __device__ __host__ static __forceinline__ uint32_t
+    ValueToBits(const _Value& value) {
+        uint32_t bits = 0;
+        memcpy(&bits, &value, sizeof(_Value));
+        return bits;
+    }
+    __device__ __host__ static __forceinline__ _Key
+    BitsToKey(const uint32_t bits) {
+        _Key key;
+        memcpy(&key, &bits, sizeof(_Key));
+        return key;
+    }
+    __device__ __host__ static __forceinline__ _Value
+    BitsToValue(const uint32_t bits) {
+        _Value value;
+        memcpy(&value, &bits, sizeof(_Value));
+        return value;
+    }
+    __device__ __host__ static __forceinline__ uint64_t
+    MakePair64(const uint32_t key_bits, const uint32_t value_bits) {
+        return (uint64_t(value_bits) << 32) | key_bits;
+    }
+
+    __device__ __host__ SlabAllocContext& get_slab_alloc_ctx() {
+        return slab_list_allocator_ctx_;
+    }
+
+    __device__ __forceinline__ ptr_t* get_unit_ptr_from_list_nodes(
+            const ptr_t slab_ptr, const uint32_t lane_id) {
+        return slab_list_allocator_ctx_.get_unit_ptr_from_slab(slab_ptr,
+                                                               lane_id);
+    }
+    __device__ __forceinline__ ptr_t* get_unit_ptr_from_list_head(
+            const uint32_t bucket_id, const uint32_t lane_id) {
+        return reinterpret_cast<uint32_t*>(bucket_list_head_) +
+               bucket_id * BASE_UNIT_SIZE + lane_id;
+    }
+
+private:
+    __device__ __forceinline__ int32_t WarpFindKey(const uint32_t key_bits,
+                                                   const uint32_t lane_id,
+                                                   const uint32_t unit_data);
+    __device__ __forceinline__ int32_t WarpFindEmpty(const uint32_t lane_id,
+                                                     const uint32_t unit_data);
+
+    /* A new slab to link after @tail_slab_ptr (HEAD_SLAB_PTR for the
+     * bucket head) */
+    __device__ __forceinline__ ptr_t AllocateSlab(const uint32_t lane_id,
+                                                  const ptr_t tail_slab_ptr);
+
+#ifdef SLABHASH_BACKEND_CPU
+    ptr_t* get_slab_ptr(const uint32_t bucket_id, const ptr_t slab_ptr);
+    ptr_t AllocateSlab(const ptr_t tail_slab_ptr);
+#endif
+    __device__ __forceinline__ void FreeSlab(const ptr_t slab_ptr);
+
+private:
+    uint32_t num_buckets_;
+    uint32_t split_bucket_;
+    _Hash hash_fn_;
+
+    bool near_tail_allocation_;
+
+    Slab* bucket_list_head_;
+    SlabAllocContext slab_list_allocator_ctx_;
+};
+
+template <typename _Key, typename _Value, typename _Hash>
+class SlabHash<_Key, _Value, _Hash, true> {
+public:
+    /* @max_keyvalue_count sizes the slab allocator. The slabs store the
+     * keys themselves, so @use_fingerprints is ignored: it is kept for
+     * interface compatibility */
+    SlabHash(const uint32_t max_bucket_count,
+             const uint32_t max_keyvalue_count,
+             uint32_t device_idx,
+             bool use_fingerprints = false);
+
+    ~SlabHash();
+
+    double ComputeLoadFactor(int flag = 0);
+
+    /* Without a pair pool, every key but EMPTY_KEY is stored: @statuses (if
+     * not nullptr) is set to STATUS_SUCCESS, and to STATUS_RESERVED_KEY for
+     * EMPTY_KEY. Without @statuses, EMPTY_KEY fails an assert in debug
+     * builds. The same goes for InsertOrAssign and InsertOrReduce, while
+     * BulkBuild skips it */
+    void Insert(_Key* keys,
+                _Value* values,
+                uint32_t num_keys,
+                uint8_t* statuses = nullptr);
+    void Search(_Key* keys, _Value* values, uint8_t* founds, uint32_t num_keys);
+    void Remove(_Key* keys, uint32_t num_keys);
+
+    /* Bulk load: the keys are grouped by bucket, then a warp per bucket
+     * appends its pairs to the chain with plain stores, see the pool
+     * layout */
+    void BulkBuild(_Key* keys, _Value* values, uint32_t num_keys);
+
+    void InsertOrAssign(_Key* keys,
+                        _Value* values,
+                        uint32_t num_keys,
+                        uint8_t* statuses = nullptr);
+    void UpdateExisting(_Key* keys, _Value* values, uint32_t num_keys);
+
+    template <typename _Reduce>
+    void InsertOrReduce(_Key* keys,
+                        _Value* values,
+                        uint32_t num_keys,
+                        _Reduce reduce,
+                        uint8_t* statuses = nullptr);
+
+    /* Parallel iteration over the stored pairs.
+     * Export writes them to @keys and @values (either can be nullptr), which
+     * must hold Size() entries, and returns their number: the pairs are
+     * counted per bucket, the counts prefix-summed, and each bucket then
+     * writes its chain to its own range. ForEach calls func(key, value) on
+     * every pair, the value being writable in place. As the keys are
+     * stored as is, Export and ForEach need no pair pool either */
+    uint32_t Size();
+    uint32_t Export(_Key* keys, _Value* values);
+    template <typename _Func>
+    void ForEach(_Func func);
+
+    /* Redistribute the pairs over @new_bucket_count buckets, a warp per old
+     * bucket: the pairs are moved from slab to slab. The old chains are then
+     * reset and returned to the slab allocator.
+     * With SetMaxChainLength(l), l > 0, the inserting operations call Rehash
+     * once ComputeAverageChainLength (slabs per bucket) exceeds l */
+    void Rehash(uint32_t new_bucket_count);
+    void SetMaxChainLength(float max_chain_length);
+    double ComputeAverageChainLength();
+
+    /* Reclaim the slabs emptied by Remove: a warp per bucket packs the
+     * pairs toward the head slab, then unlinks and frees the slabs left
+     * empty. Must not overlap with other operations */
+    void Compact();
+
+    /* Copy the slab chains into a fresh, contiguous layout, bucket after
+     * bucket, see the pool layout. Must not overlap with other operations */
+    void Relayout();
+
+    /* Slab allocation policy: by default a warp allocates from the memory
+     * block hashed from its id; with @near_tail_allocation, the slab that
+     * extends a chain is taken from the block of its tail slab if that
+     * block has room, which keeps long chains within a few blocks */
+    void SetNearTailAllocation(bool near_tail_allocation);
+
+    /* Group the queries of Search by bucket first, see the pool layout */
+    void SetBucketOrderedSearch(bool bucket_ordered_search);
+
+    /* Reduce the batches of Insert, InsertOrAssign and InsertOrReduce to
+     * one pair per distinct key first, see the pool layout */
+    void SetBatchDeduplication(bool batch_deduplication);
+
+    /* Linear hashing: instead of a global Rehash, the trigger above splits
+     * the @splits_per_batch buckets at the split pointer, so that the table
+     * grows a few buckets per batch. The head array is extended to
+     * @max_bucket_count buckets, and doubled (heads only) when full */
+    void EnableLinearHashing(uint32_t max_bucket_count,
+                             uint32_t splits_per_batch);
+
+    /* No pair pool: grow the slab allocator for @max_keyvalue_count pairs.
+     * Returns false beyond its super blocks */
+    bool Reserve(uint32_t max_keyvalue_count);
+
+    /* Whether an inserting batch of @num_keys keys may grow the slab
+     * allocator, which must then not overlap with other operations: the
+     * inserting operations grow it up front, see ReserveSlabs */
+    bool MayGrowSlabs(uint32_t num_keys);
+
+private:
+    /* Group @keys by bucket: @d_offsets (num_buckets_ + 1 entries) gets the
+     * prefix sum of the bucket counts, and @d_order (@num_keys entries) the
+     * indices of the keys of each bucket, in the range of that bucket */
+    void PartitionByBucket(_Key* keys,
+                           uint32_t num_keys,
+                           uint32_t* d_offsets,
+                           uint32_t* d_order);
+    /* In-batch deduplication: allocates @unique_keys and @unique_values,
+     * writes to them one pair per distinct key of the batch, grouped by
+     * bucket, with the value @combine keeps, and returns their number */
+    template <typename _Combine>
+    uint32_t DeduplicateBatch(_Key* keys,
+                              _Value* values,
+                              uint32_t num_keys,
+                              _Key** unique_keys,
+                              _Value** unique_values,
+                              _Combine combine);
+    /* Number of pairs per bucket */
+    void CountBuckets(uint32_t* d_bucket_count);
+    /* Exclusive prefix sum of the bucket counts in @d_offsets
+     * (num_buckets_ + 1 entries), returns the total */
+    uint32_t ComputeBucketOffsets(uint32_t* d_offsets);
+    /* Set the @statuses of the EMPTY_KEY @keys to STATUS_RESERVED_KEY, or,
+     * without @statuses, assert that there is none in debug builds */
+    void MarkReservedKeys(_Key* keys, uint32_t num_keys, uint8_t* statuses);
+    /* Slabs taken from the slab allocator, i.e. excluding the list heads,
+     * read from its running count */
+    uint32_t CountAllocatedSlabs();
+    /* Grow the slab allocator if @num_new_slabs more slabs may not fit in
+     * its free units: the warps probe the memory blocks until they find a
+     * free unit, and would spin forever on a full allocator. Past the
+     * largest geometry (see SlabAlloc::MaxReserve) it cannot grow further */
+    void ReserveSlabs(uint64_t num_new_slabs);
+    /* An inserting batch of @num_keys keys takes at most a slab per
+     * INLINE_PAIRS_PER_SLAB keys, plus one per bucket it touches */
+    uint64_t MaxNewSlabs(uint32_t num_keys) const;
+    void RehashIfNeeded();
+    /* Grow the head array to @bucket_capacity, without moving any pair */
+    void ReserveBuckets(uint32_t bucket_capacity);
+    void SplitBuckets(uint32_t num_splits);
+
+    uint32_t num_buckets_;
+
+    Slab* bucket_list_head_;
+
+    SlabHashContext<_Key, _Value, _Hash, true> gpu_context_;
+
+    std::shared_ptr<SlabAlloc> slab_list_allocator_;
+
+    uint32_t device_idx_;
+
+    float max_chain_length_;
+    bool bucket_ordered_search_;
+    bool batch_deduplication_;
+
+    /* Linear hashing: num_buckets_ - split_bucket_ buckets in the current
+     * level, the first split_bucket_ of which are split */
+    uint32_t bucket_capacity_;
+    uint32_t split_bucket_;
+    uint32_t splits_per_batch_;
+};
+
+/**
+ * Definitions
+ **/
+template <typename _Key, typename _Value, typename _Hash>
+SlabHashContext<_Key, _Value, _Hash, true>::SlabHashContext()
+    : num_buckets_(0),
+      split_bucket_(0),
+      near_tail_allocation_(false),
+      bucket_list_head_(nullptr) {
+    static_assert(IsInlinePair<_Key, _Value>::value,
+                  "Inline slabs require 32-bit keys and values");
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__host__ void SlabHashContext<_Key, _Value, _Hash, true>::Setup(
+        Slab* bucket_list_head,
+        const uint32_t num_buckets,
+        const SlabAllocContext& allocator_ctx) {
+    bucket_list_head_ = bucket_list_head;
+
+    num_buckets_ = num_buckets;
+    slab_list_allocator_ctx_ = allocator_ctx;
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__host__ void SlabHashContext<_Key, _Value, _Hash, true>::SetBuckets(
+        Slab* bucket_list_head,
+        const uint32_t num_buckets,
+        const uint32_t split_bucket /* = 0 */) {
+    bucket_list_head_ = bucket_list_head;
+    num_buckets_ = num_buckets;
+    split_bucket_ = split_bucket;
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__host__ void SlabHashContext<_Key, _Value, _Hash, true>::SetSlabAllocator(
+        const SlabAllocContext& slab_alloc_ctx) {
+    slab_list_allocator_ctx_ = slab_alloc_ctx;
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__host__ void
+SlabHashContext<_Key, _Value, _Hash, true>::SetNearTailAllocation(
+        const bool near_tail_allocation) {
+    near_tail_allocation_ = near_tail_allocation;
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__device__ __host__ __forceinline__ uint32_t
+SlabHashContext<_Key, _Value, _Hash, true>::ComputeBucket(
+        const _Key& key) const {
+    uint64_t hash = hash_fn_(key);
+    uint32_t bucket_id = hash % num_buckets_;
+    return (bucket_id < split_bucket_) ? hash % (2 * num_buckets_) : bucket_id;
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__device__ __host__ __forceinline__ uint32_t
+SlabHashContext<_Key, _Value, _Hash, true>::ComputeSplitBucket(
+        const _Key& key) const {
+    return hash_fn_(key) % (2 * num_buckets_);
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__device__ __forceinline__ int32_t
+SlabHashContext<_Key, _Value, _Hash, true>::WarpFindKey(
+        const uint32_t key_bits,
+        const uint32_t lane_id,
+        const uint32_t unit_data) {
+    bool is_lane_found =
+            ((1 << lane_id) & INLINE_KEY_LANES_MASK) && unit_data == key_bits;
+
+    return __ffs(__ballot_sync(INLINE_KEY_LANES_MASK, is_lane_found)) - 1;
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__device__ __forceinline__ int32_t
+SlabHashContext<_Key, _Value, _Hash, true>::WarpFindEmpty(
+        const uint32_t lane_id, const uint32_t unit_data) {
+    bool is_lane_empty =
+            ((1 << lane_id) & INLINE_KEY_LANES_MASK) && unit_data == EMPTY_KEY;
+
+    return __ffs(__ballot_sync(INLINE_KEY_LANES_MASK, is_lane_empty)) - 1;
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__device__ __forceinline__ ptr_t
+SlabHashContext<_Key, _Value, _Hash, true>::AllocateSlab(
+        const uint32_t lane_id, const ptr_t tail_slab_ptr) {
+    return (near_tail_allocation_ && tail_slab_ptr != HEAD_SLAB_PTR)
+                   ? slab_list_allocator_ctx_.WarpAllocateNear(lane_id,
+                                                               tail_slab_ptr)
+                   : slab_list_allocator_ctx_.WarpAllocate(lane_id);
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__device__ __forceinline__ void
+SlabHashContext<_Key, _Value, _Hash, true>::FreeSlab(const ptr_t slab_ptr) {
+    slab_list_allocator_ctx_.FreeUntouched(slab_ptr);
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__device__ pair_t<_Value, bool>
+SlabHashContext<_Key, _Value, _Hash, true>::Search(bool& to_search,
+                                                   const uint32_t lane_id,
+                                                   const uint32_t bucket_id,
+                                                   const _Key& query_key) {
+    uint32_t work_queue = 0;
+    uint32_t prev_work_queue = work_queue;
+    uint32_t curr_slab_ptr = HEAD_SLAB_PTR;
+
+    _Value value = _Value(0);
+    bool mask = false;
+
+    /** > Loop when we have active lanes **/
+    while ((work_queue = __ballot_sync(ACTIVE_LANES_MASK, to_search))) {
+        /** 0. Restart from linked list head if the last query is finished **/
+        curr_slab_ptr =
+                (prev_work_queue != work_queue) ? HEAD_SLAB_PTR : curr_slab_ptr;
+        uint32_t src_lane = __ffs(work_queue) - 1;
+        uint32_t src_bucket =
+                __shfl_sync(ACTIVE_LANES_MASK, bucket_id, src_lane, WARP_WIDTH);
+        uint32_t src_key = __shfl_sync(ACTIVE_LANES_MASK, KeyToBits(query_key),
+                                       src_lane, WARP_WIDTH);
+
+        const uint32_t unit_data =
+                (curr_slab_ptr == HEAD_SLAB_PTR)
+                        ? *(get_unit_ptr_from_list_head(src_bucket, lane_id))
+                        : *(get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                         lane_id));
+
+        int32_t lane_found = WarpFindKey(src_key, lane_id, unit_data);
+
+        /** 1. Found in this slab, SUCCEED **/
+        if (lane_found >= 0) {
+            /* broadcast found value: the next lane */
+            uint32_t found_value = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                               lane_found + 1, WARP_WIDTH);
+
+            if (lane_id == src_lane) {
+                to_search = false;
+
+                value = BitsToValue(found_value);
+                mask = true;
+            }
+        }
+
+        /** 2. Not found in this slab **/
+        else {
+            /* broadcast next slab: lane 31 reads 'next' */
+            ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                              NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+
+            /** 2.1. Next slab is empty, ABORT **/
+            if (next_slab_ptr == EMPTY_SLAB_PTR) {
+                if (lane_id == src_lane) {
+                    to_search = false;
+                }
+            }
+            /** 2.2. Next slab exists, RESTART **/
+            else {
+                curr_slab_ptr = next_slab_ptr;
+            }
+        }
+
+        prev_work_queue = work_queue;
+    }
+
+    return pair_t<_Value, bool>(value, mask);
+}
+
+/*
+ * Insert: ABORT if found
+ * WE DO NOT ALLOW DUPLICATE KEYS
+ */
+template <typename _Key, typename _Value, typename _Hash>
+__device__ bool SlabHashContext<_Key, _Value, _Hash, true>::Insert(
+        bool& to_be_inserted,
+        const uint32_t lane_id,
+        const uint32_t bucket_id,
+        const _Key& key,
+        const _Value& value) {
+    uint32_t work_queue = 0;
+    uint32_t prev_work_queue = 0;
+    uint32_t curr_slab_ptr = HEAD_SLAB_PTR;
+
+    bool mask = false;
+
+    /** > Loop when we have active lanes **/
+    while ((work_queue = __ballot_sync(ACTIVE_LANES_MASK, to_be_inserted))) {
+        /** 0. Restart from linked list head if last insertion is finished **/
+        curr_slab_ptr =
+                (prev_work_queue != work_queue) ? HEAD_SLAB_PTR : curr_slab_ptr;
+        uint32_t src_lane = __ffs(work_queue) - 1;
+        uint32_t src_bucket =
+                __shfl_sync(ACTIVE_LANES_MASK, bucket_id, src_lane, WARP_WIDTH);
+        uint32_t src_key = __shfl_sync(ACTIVE_LANES_MASK, KeyToBits(key),
+                                       src_lane, WARP_WIDTH);
+
+        /* Each lane in the warp reads a uint in the slab */
+        uint32_t unit_data =
+                (curr_slab_ptr == HEAD_SLAB_PTR)
+                        ? *(get_unit_ptr_from_list_head(src_bucket, lane_id))
+                        : *(get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                         lane_id));
+
+        int32_t lane_found = WarpFindKey(src_key, lane_id, unit_data);
+        int32_t lane_empty = WarpFindEmpty(lane_id, unit_data);
+
+        /** Branch 1: key already existing, ABORT **/
+        if (lane_found >= 0) {
+            if (lane_id == src_lane) {
+                to_be_inserted = false;
+            }
+        }
+
+        /** Branch 2: empty slot available, try to insert **/
+        else if (lane_empty >= 0) {
+            if (lane_id == src_lane) {
+                const uint32_t* unit_data_ptr =
+                        (curr_slab_ptr == HEAD_SLAB_PTR)
+                                ? get_unit_ptr_from_list_head(src_bucket,
+                                                              lane_empty)
+                                : get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                               lane_empty);
+                unsigned long long old_pair = atomicCAS(
+                        (unsigned long long*)unit_data_ptr, EMPTY_PAIR_64,
+                        MakePair64(src_key, ValueToBits(value)));
+
+                /** Branch 2.1: SUCCEED **/
+                if (old_pair == EMPTY_PAIR_64) {
+                    to_be_inserted = false;
+                    mask = true;
+                }
+                /** Branch 2.2: failed: RESTART **/
+            }
+        }
+
+        /** Branch 3: nothing found in this slab, goto next slab **/
+        else {
+            /* broadcast next slab */
+            ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                              NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+
+            /** Branch 3.1: next slab existing, RESTART this lane **/
+            if (next_slab_ptr != EMPTY_SLAB_PTR) {
+                curr_slab_ptr = next_slab_ptr;
+            }
+
+            /** Branch 3.2: next slab empty, try to allocate one **/
+            else {
+                ptr_t new_next_slab_ptr =
+                        AllocateSlab(lane_id, curr_slab_ptr);
+
+                if (lane_id == NEXT_SLAB_PTR_LANE) {
+                    const uint32_t* unit_data_ptr =
+                            (curr_slab_ptr == HEAD_SLAB_PTR)
+                                    ? get_unit_ptr_from_list_head(
+                                              src_bucket, NEXT_SLAB_PTR_LANE)
+                                    : get_unit_ptr_from_list_nodes(
+                                              curr_slab_ptr,
+                                              NEXT_SLAB_PTR_LANE);
+
+                    ptr_t old_next_slab_ptr =
+                            atomicCAS((unsigned int*)unit_data_ptr,
+                                      EMPTY_SLAB_PTR, new_next_slab_ptr);
+
+                    /** Branch 3.2.1: other thread allocated, RESTART lane **/
+                    if (old_next_slab_ptr != EMPTY_SLAB_PTR) {
+                        FreeSlab(new_next_slab_ptr);
+                    }
+                    /** Branch 3.2.2: this thread allocated, RESTART lane **/
+                }
+            }
+        }
+
+        prev_work_queue = work_queue;
+    }
+
+    return mask;
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__device__ bool SlabHashContext<_Key, _Value, _Hash, true>::Remove(
+        bool& to_be_deleted,
+        const uint32_t lane_id,
+        const uint32_t bucket_id,
+        const _Key& key) {
+    uint32_t work_queue = 0;
+    uint32_t prev_work_queue = 0;
+    uint32_t curr_slab_ptr = HEAD_SLAB_PTR;
+
+    bool mask = false;
+
+    /** > Loop when we have active lanes **/
+    while ((work_queue = __ballot_sync(ACTIVE_LANES_MASK, to_be_deleted))) {
+        /** 0. Restart from linked list head if last deletion is finished **/
+        curr_slab_ptr =
+                (prev_work_queue != work_queue) ? HEAD_SLAB_PTR : curr_slab_ptr;
+        uint32_t src_lane = __ffs(work_queue) - 1;
+        uint32_t src_bucket =
+                __shfl_sync(ACTIVE_LANES_MASK, bucket_id, src_lane, WARP_WIDTH);
+        uint32_t src_key = __shfl_sync(ACTIVE_LANES_MASK, KeyToBits(key),
+                                       src_lane, WARP_WIDTH);
+
+        const uint32_t unit_data =
+                (curr_slab_ptr == HEAD_SLAB_PTR)
+                        ? *(get_unit_ptr_from_list_head(src_bucket, lane_id))
+                        : *(get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                         lane_id));
+
+        int32_t lane_found = WarpFindKey(src_key, lane_id, unit_data);
+
+        /** Branch 1: key found **/
+        if (lane_found >= 0) {
+            uint32_t found_value = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                               lane_found + 1, WARP_WIDTH);
+
+            if (lane_id == src_lane) {
+                uint32_t* unit_data_ptr =
+                        (curr_slab_ptr == HEAD_SLAB_PTR)
+                                ? get_unit_ptr_from_list_head(src_bucket,
+                                                              lane_found)
+                                : get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                               lane_found);
+                uint64_t pair_to_delete = MakePair64(src_key, found_value);
+
+                unsigned long long old_pair =
+                        atomicCAS((unsigned long long*)unit_data_ptr,
+                                  pair_to_delete, EMPTY_PAIR_64);
+                /** Branch 1.1: this thread reset **/
+                mask = (old_pair == pair_to_delete);
+                /** Branch 1.2: other thread did the job **/
+                to_be_deleted = false;
+            }
+        } else {  // no matching slot found:
+            ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                              NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+            if (next_slab_ptr == EMPTY_SLAB_PTR) {
+                // not found:
+                to_be_deleted = false;
+            } else {
+                curr_slab_ptr = next_slab_ptr;
+            }
+        }
+        prev_work_queue = work_queue;
+    }
+
+    return mask;
+}
+
+/*
+ * InsertOrAssign: REPLACE the value if found. Returns true if inserted
+ */
+template <typename _Key, typename _Value, typename _Hash>
+__device__ bool SlabHashContext<_Key, _Value, _Hash, true>::InsertOrAssign(
+        bool& to_be_inserted,
+        const uint32_t lane_id,
+        const uint32_t bucket_id,
+        const _Key& key,
+        const _Value& value) {
+    uint32_t work_queue = 0;
+    uint32_t prev_work_queue = 0;
+    uint32_t curr_slab_ptr = HEAD_SLAB_PTR;
+
+    bool mask = false;
+
+    /** > Loop when we have active lanes **/
+    while ((work_queue = __ballot_sync(ACTIVE_LANES_MASK, to_be_inserted))) {
+        /** 0. Restart from linked list head if last insertion is finished **/
+        curr_slab_ptr =
+                (prev_work_queue != work_queue) ? HEAD_SLAB_PTR : curr_slab_ptr;
+        uint32_t src_lane = __ffs(work_queue) - 1;
+        uint32_t src_bucket =
+                __shfl_sync(ACTIVE_LANES_MASK, bucket_id, src_lane, WARP_WIDTH);
+        uint32_t src_key = __shfl_sync(ACTIVE_LANES_MASK, KeyToBits(key),
+                                       src_lane, WARP_WIDTH);
+
+        uint32_t unit_data =
+                (curr_slab_ptr == HEAD_SLAB_PTR)
+                        ? *(get_unit_ptr_from_list_head(src_bucket, lane_id))
+                        : *(get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                         lane_id));
+
+        int32_t lane_found = WarpFindKey(src_key, lane_id, unit_data);
+        int32_t lane_empty = WarpFindEmpty(lane_id, unit_data);
+
+        /** Branch 1: key already existing, REPLACE the value **/
+        if (lane_found >= 0) {
+            if (lane_id == src_lane) {
+                uint32_t* unit_data_ptr =
+                        (curr_slab_ptr == HEAD_SLAB_PTR)
+                                ? get_unit_ptr_from_list_head(src_bucket,
+                                                              lane_found + 1)
+                                : get_unit_ptr_from_list_nodes(
+                                          curr_slab_ptr, lane_found + 1);
+                atomicExch((unsigned int*)unit_data_ptr, ValueToBits(value));
+                to_be_inserted = false;
+            }
+        }
+
+        /** Branch 2: empty slot available, try to insert **/
+        else if (lane_empty >= 0) {
+            if (lane_id == src_lane) {
+                const uint32_t* unit_data_ptr =
+                        (curr_slab_ptr == HEAD_SLAB_PTR)
+                                ? get_unit_ptr_from_list_head(src_bucket,
+                                                              lane_empty)
+                                : get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                               lane_empty);
+                unsigned long long old_pair = atomicCAS(
+                        (unsigned long long*)unit_data_ptr, EMPTY_PAIR_64,
+                        MakePair64(src_key, ValueToBits(value)));
+
+                /** Branch 2.1: SUCCEED **/
+                if (old_pair == EMPTY_PAIR_64) {
+                    to_be_inserted = false;
+                    mask = true;
+                }
+                /** Branch 2.2: failed: RESTART **/
+            }
+        }
+
+        /** Branch 3: nothing found in this slab, goto next slab **/
+        else {
+            ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                              NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+
+            /** Branch 3.1: next slab existing, RESTART this lane **/
+            if (next_slab_ptr != EMPTY_SLAB_PTR) {
+                curr_slab_ptr = next_slab_ptr;
+            }
+
+            /** Branch 3.2: next slab empty, try to allocate one **/
+            else {
+                ptr_t new_next_slab_ptr =
+                        AllocateSlab(lane_id, curr_slab_ptr);
+
+                if (lane_id == NEXT_SLAB_PTR_LANE) {
+                    const uint32_t* unit_data_ptr =
+                            (curr_slab_ptr == HEAD_SLAB_PTR)
+                                    ? get_unit_ptr_from_list_head(
+                                              src_bucket, NEXT_SLAB_PTR_LANE)
+                                    : get_unit_ptr_from_list_nodes(
+                                              curr_slab_ptr,
+                                              NEXT_SLAB_PTR_LANE);
+
+                    ptr_t old_next_slab_ptr =
+                            atomicCAS((unsigned int*)unit_data_ptr,
+                                      EMPTY_SLAB_PTR, new_next_slab_ptr);
+
+                    /** Branch 3.2.1: other thread allocated, RESTART lane **/
+                    if (old_next_slab_ptr != EMPTY_SLAB_PTR) {
+                        FreeSlab(new_next_slab_ptr);
+                    }
+                    /** Branch 3.2.2: this thread allocated, RESTART lane **/
+                }
+            }
+        }
+
+        prev_work_queue = work_queue;
+    }
+
+    return mask;
+}
+
+/*
+ * InsertOrReduce: COMBINE the values with @reduce if found. Returns true if
+ * inserted
+ */
+template <typename _Key, typename _Value, typename _Hash>
+template <typename _Reduce>
+__device__ bool SlabHashContext<_Key, _Value, _Hash, true>::InsertOrReduce(
+        bool& to_be_inserted,
+        const uint32_t lane_id,
+        const uint32_t bucket_id,
+        const _Key& key,
+        const _Value& value,
+        const _Reduce& reduce) {
+    uint32_t work_queue = 0;
+    uint32_t prev_work_queue = 0;
+    uint32_t curr_slab_ptr = HEAD_SLAB_PTR;
+
+    bool mask = false;
+
+    /** > Loop when we have active lanes **/
+    while ((work_queue = __ballot_sync(ACTIVE_LANES_MASK, to_be_inserted))) {
+        /** 0. Restart from linked list head if last insertion is finished **/
+        curr_slab_ptr =
+                (prev_work_queue != work_queue) ? HEAD_SLAB_PTR : curr_slab_ptr;
+        uint32_t src_lane = __ffs(work_queue) - 1;
+        uint32_t src_bucket =
+                __shfl_sync(ACTIVE_LANES_MASK, bucket_id, src_lane, WARP_WIDTH);
+        uint32_t src_key = __shfl_sync(ACTIVE_LANES_MASK, KeyToBits(key),
+                                       src_lane, WARP_WIDTH);
+
+        uint32_t unit_data =
+                (curr_slab_ptr == HEAD_SLAB_PTR)
+                        ? *(get_unit_ptr_from_list_head(src_bucket, lane_id))
+                        : *(get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                         lane_id));
+
+        int32_t lane_found = WarpFindKey(src_key, lane_id, unit_data);
+        int32_t lane_empty = WarpFindEmpty(lane_id, unit_data);
+
+        /** Branch 1: key already existing, COMBINE the values **/
+        if (lane_found >= 0) {
+            if (lane_id == src_lane) {
+                uint32_t* unit_data_ptr =
+                        (curr_slab_ptr == HEAD_SLAB_PTR)
+                                ? get_unit_ptr_from_list_head(src_bucket,
+                                                              lane_found + 1)
+                                : get_unit_ptr_from_list_nodes(
+                                          curr_slab_ptr, lane_found + 1);
+                reduce(reinterpret_cast<_Value*>(unit_data_ptr), value);
+                to_be_inserted = false;
+            }
+        }
+
+        /** Branch 2: empty slot available, try to insert **/
+        else if (lane_empty >= 0) {
+            if (lane_id == src_lane) {
+                const uint32_t* unit_data_ptr =
+                        (curr_slab_ptr == HEAD_SLAB_PTR)
+                                ? get_unit_ptr_from_list_head(src_bucket,
+                                                              lane_empty)
+                                : get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                               lane_empty);
+                unsigned long long old_pair = atomicCAS(
+                        (unsigned long long*)unit_data_ptr, EMPTY_PAIR_64,
+                        MakePair64(src_key, ValueToBits(value)));
+
+                /** Branch 2.1: SUCCEED **/
+                if (old_pair == EMPTY_PAIR_64) {
+                    to_be_inserted = false;
+                    mask = true;
+                }
+                /** Branch 2.2: failed: RESTART **/
+            }
+        }
+
+        /** Branch 3: nothing found in this slab, goto next slab **/
+        else {
+            ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                              NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+
+            /** Branch 3.1: next slab existing, RESTART this lane **/
+            if (next_slab_ptr != EMPTY_SLAB_PTR) {
+                curr_slab_ptr = next_slab_ptr;
+            }
+
+            /** Branch 3.2: next slab empty, try to allocate one **/
+            else {
+                ptr_t new_next_slab_ptr =
+                        AllocateSlab(lane_id, curr_slab_ptr);
+
+                if (lane_id == NEXT_SLAB_PTR_LANE) {
+                    const uint32_t* unit_data_ptr =
+                            (curr_slab_ptr == HEAD_SLAB_PTR)
+                                    ? get_unit_ptr_from_list_head(
+                                              src_bucket, NEXT_SLAB_PTR_LANE)
+                                    : get_unit_ptr_from_list_nodes(
+                                              curr_slab_ptr,
+                                              NEXT_SLAB_PTR_LANE);
+
+                    ptr_t old_next_slab_ptr =
+                            atomicCAS((unsigned int*)unit_data_ptr,
+                                      EMPTY_SLAB_PTR, new_next_slab_ptr);
+
+                    /** Branch 3.2.1: other thread allocated, RESTART lane **/
+                    if (old_next_slab_ptr != EMPTY_SLAB_PTR) {
+                        FreeSlab(new_next_slab_ptr);
+                    }
+                    /** Branch 3.2.2: this thread allocated, RESTART lane **/
+                }
+            }
+        }
+
+        prev_work_queue = work_queue;
+    }
+
+    return mask;
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__device__ bool SlabHashContext<_Key, _Value, _Hash, true>::UpdateExisting(
+        bool& to_update,
+        const uint32_t lane_id,
+        const uint32_t bucket_id,
+        const _Key& key,
+        const _Value& value) {
+    uint32_t work_queue = 0;
+    uint32_t prev_work_queue = work_queue;
+    uint32_t curr_slab_ptr = HEAD_SLAB_PTR;
+
+    bool mask = false;
+
+    /** > Loop when we have active lanes **/
+    while ((work_queue = __ballot_sync(ACTIVE_LANES_MASK, to_update))) {
+        /** 0. Restart from linked list head if the last query is finished **/
+        curr_slab_ptr =
+                (prev_work_queue != work_queue) ? HEAD_SLAB_PTR : curr_slab_ptr;
+        uint32_t src_lane = __ffs(work_queue) - 1;
+        uint32_t src_bucket =
+                __shfl_sync(ACTIVE_LANES_MASK, bucket_id, src_lane, WARP_WIDTH);
+        uint32_t src_key = __shfl_sync(ACTIVE_LANES_MASK, KeyToBits(key),
+                                       src_lane, WARP_WIDTH);
+
+        const uint32_t unit_data =
+                (curr_slab_ptr == HEAD_SLAB_PTR)
+                        ? *(get_unit_ptr_from_list_head(src_bucket, lane_id))
+                        : *(get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                         lane_id));
+
+        int32_t lane_found = WarpFindKey(src_key, lane_id, unit_data);
+
+        /** 1. Found in this slab, REPLACE the value **/
+        if (lane_found >= 0) {
+            if (lane_id == src_lane) {
+                uint32_t* unit_data_ptr =
+                        (curr_slab_ptr == HEAD_SLAB_PTR)
+                                ? get_unit_ptr_from_list_head(src_bucket,
+                                                              lane_found + 1)
+                                : get_unit_ptr_from_list_nodes(
+                                          curr_slab_ptr, lane_found + 1);
+                atomicExch((unsigned int*)unit_data_ptr, ValueToBits(value));
+                to_update = false;
+                mask = true;
+            }
+        }
+
+        /** 2. Not found in this slab **/
+        else {
+            ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                              NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+
+            /** 2.1. Next slab is empty, ABORT **/
+            if (next_slab_ptr == EMPTY_SLAB_PTR) {
+                if (lane_id == src_lane) {
+                    to_update = false;
+                }
+            }
+            /** 2.2. Next slab exists, RESTART **/
+            else {
+                curr_slab_ptr = next_slab_ptr;
+            }
+        }
+
+        prev_work_queue = work_queue;
+    }
+
+    return mask;
+}
+
+/*
+ * InsertPairBits: Insert without the key lookup, see Rehash
+ */
+template <typename _Key, typename _Value, typename _Hash>
+__device__ void SlabHashContext<_Key, _Value, _Hash, true>::InsertPairBits(
+        bool& to_be_inserted,
+        const uint32_t lane_id,
+        const uint32_t bucket_id,
+        const uint64_t pair) {
+    uint32_t work_queue = 0;
+    uint32_t prev_work_queue = 0;
+    uint32_t curr_slab_ptr = HEAD_SLAB_PTR;
+
+    /** > Loop when we have active lanes **/
+    while ((work_queue = __ballot_sync(ACTIVE_LANES_MASK, to_be_inserted))) {
+        /** 0. Restart from linked list head if last insertion is finished **/
+        curr_slab_ptr =
+                (prev_work_queue != work_queue) ? HEAD_SLAB_PTR : curr_slab_ptr;
+        uint32_t src_lane = __ffs(work_queue) - 1;
+        uint32_t src_bucket =
+                __shfl_sync(ACTIVE_LANES_MASK, bucket_id, src_lane, WARP_WIDTH);
+
+        uint32_t unit_data =
+                (curr_slab_ptr == HEAD_SLAB_PTR)
+                        ? *(get_unit_ptr_from_list_head(src_bucket, lane_id))
+                        : *(get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                         lane_id));
+
+        int32_t lane_empty = WarpFindEmpty(lane_id, unit_data);
+
+        /** Branch 2: empty slot available, try to insert **/
+        if (lane_empty >= 0) {
+            if (lane_id == src_lane) {
+                const uint32_t* unit_data_ptr =
+                        (curr_slab_ptr == HEAD_SLAB_PTR)
+                                ? get_unit_ptr_from_list_head(src_bucket,
+                                                              lane_empty)
+                                : get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                               lane_empty);
+                unsigned long long old_pair =
+                        atomicCAS((unsigned long long*)unit_data_ptr,
+                                  EMPTY_PAIR_64, pair);
+
+                /** Branch 2.1: SUCCEED **/
+                if (old_pair == EMPTY_PAIR_64) {
+                    to_be_inserted = false;
+                }
+                /** Branch 2.2: failed: RESTART **/
+            }
+        }
+
+        /** Branch 3: no empty slot in this slab, goto next slab **/
+        else {
+            ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                              NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+
+            /** Branch 3.1: next slab existing, RESTART this lane **/
+            if (next_slab_ptr != EMPTY_SLAB_PTR) {
+                curr_slab_ptr = next_slab_ptr;
+            }
+
+            /** Branch 3.2: next slab empty, try to allocate one **/
+            else {
+                ptr_t new_next_slab_ptr =
+                        AllocateSlab(lane_id, curr_slab_ptr);
+
+                if (lane_id == NEXT_SLAB_PTR_LANE) {
+                    const uint32_t* unit_data_ptr =
+                            (curr_slab_ptr == HEAD_SLAB_PTR)
+                                    ? get_unit_ptr_from_list_head(
+                                              src_bucket, NEXT_SLAB_PTR_LANE)
+                                    : get_unit_ptr_from_list_nodes(
+                                              curr_slab_ptr,
+                                              NEXT_SLAB_PTR_LANE);
+
+                    ptr_t old_next_slab_ptr =
+                            atomicCAS((unsigned int*)unit_data_ptr,
+                                      EMPTY_SLAB_PTR, new_next_slab_ptr);
+
+                    /** Branch 3.2.1: other thread allocated, RESTART lane **/
+                    if (old_next_slab_ptr != EMPTY_SLAB_PTR) {
+                        FreeSlab(new_next_slab_ptr);
+                    }
+                    /** Branch 3.2.2: this thread allocated, RESTART lane **/
+                }
+            }
+        }
+
+        prev_work_queue = work_queue;
+    }
+}
+
+/*
+ * FreeChain: the slab allocator clears a slab when it hands it out, so the
+ * slabs are released as they are
+ */
+template <typename _Key, typename _Value, typename _Hash>
+__device__ void SlabHashContext<_Key, _Value, _Hash, true>::FreeChain(
+        const uint32_t lane_id, const uint32_t bucket_id) {
+    uint32_t unit_data = *get_unit_ptr_from_list_head(bucket_id, lane_id);
+    ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                      NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+
+    while (next_slab_ptr != EMPTY_SLAB_PTR) {
+        ptr_t curr_slab_ptr = next_slab_ptr;
+        ptr_t* unit_data_ptr =
+                get_unit_ptr_from_list_nodes(curr_slab_ptr, lane_id);
+        unit_data = *unit_data_ptr;
+        next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                    NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+
+        if (lane_id == 0) {
+            FreeSlab(curr_slab_ptr);
+        }
+    }
+}
+
+/*
+ * SplitBucket: both lanes of a moved pair are reset, as inserts expect
+ * EMPTY_PAIR_64
+ */
+template <typename _Key, typename _Value, typename _Hash>
+__device__ void SlabHashContext<_Key, _Value, _Hash, true>::SplitBucket(
+        const uint32_t lane_id, const uint32_t bucket_id) {
+    const uint32_t split_bucket_id = bucket_id + num_buckets_;
+    uint32_t curr_slab_ptr = HEAD_SLAB_PTR;
+
+    while (true) {
+        ptr_t* unit_data_ptr =
+                (curr_slab_ptr == HEAD_SLAB_PTR)
+                        ? get_unit_ptr_from_list_head(bucket_id, lane_id)
+                        : get_unit_ptr_from_list_nodes(curr_slab_ptr, lane_id);
+        uint32_t unit_data = *unit_data_ptr;
+        uint32_t value_bits = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                          (lane_id + 1) & 0x1F, WARP_WIDTH);
+
+        bool to_be_moved = ((INLINE_KEY_LANES_MASK >> lane_id) & 1) &&
+                           unit_data != EMPTY_KEY &&
+                           ComputeSplitBucket(BitsToKey(unit_data)) ==
+                                   split_bucket_id;
+        if (to_be_moved) {
+            *reinterpret_cast<uint64_t*>(unit_data_ptr) = EMPTY_PAIR_64;
+        }
+        InsertPairBits(to_be_moved, lane_id, split_bucket_id,
+                       MakePair64(unit_data, value_bits));
+
+        ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                          NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+        if (next_slab_ptr == EMPTY_SLAB_PTR) break;
+        curr_slab_ptr = next_slab_ptr;
+    }
+}
+
+/*
+ * CompactBucket: as in the pool layout, with pairs of lanes. The i-th live
+ * pair of the chain goes to pair i % 15 of its i / 15-th slab, both lanes
+ * of a pair moving together
+ */
+template <typename _Key, typename _Value, typename _Hash>
+__device__ void SlabHashContext<_Key, _Value, _Hash, true>::CompactBucket(
+        const uint32_t lane_id, const uint32_t bucket_id) {
+    const uint32_t key_lane = lane_id & ~1u;
+    ptr_t src_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t dst_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t prev_dst_slab_ptr = EMPTY_SLAB_PTR;
+    uint32_t dst_count = 0;
+
+    while (src_slab_ptr != EMPTY_SLAB_PTR) {
+        uint32_t unit_data =
+                (src_slab_ptr == HEAD_SLAB_PTR)
+                        ? *get_unit_ptr_from_list_head(bucket_id, lane_id)
+                        : *get_unit_ptr_from_list_nodes(src_slab_ptr, lane_id);
+        uint32_t dst_unit_data =
+                (dst_slab_ptr == HEAD_SLAB_PTR)
+                        ? *get_unit_ptr_from_list_head(bucket_id, lane_id)
+                        : *get_unit_ptr_from_list_nodes(dst_slab_ptr, lane_id);
+        ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                          NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+        ptr_t next_dst_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, dst_unit_data,
+                                              NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+
+        uint32_t live_key_lanes = __ballot_sync(
+                ACTIVE_LANES_MASK, ((INLINE_KEY_LANES_MASK >> lane_id) & 1) &&
+                                           unit_data != EMPTY_KEY);
+
+        /** Branch 1: pack the live pairs, overflowing into the next slab **/
+        if (key_lane < 2 * INLINE_PAIRS_PER_SLAB &&
+            ((live_key_lanes >> key_lane) & 1)) {
+            uint32_t position =
+                    dst_count + __popc(live_key_lanes & ((1u << key_lane) - 1));
+            ptr_t slab_ptr = dst_slab_ptr;
+            if (position >= INLINE_PAIRS_PER_SLAB) {
+                slab_ptr = next_dst_slab_ptr;
+                position -= INLINE_PAIRS_PER_SLAB;
+            }
+            const uint32_t dst_lane = 2 * position + (lane_id & 1);
+            *((slab_ptr == HEAD_SLAB_PTR)
+                      ? get_unit_ptr_from_list_head(bucket_id, dst_lane)
+                      : get_unit_ptr_from_list_nodes(slab_ptr, dst_lane)) =
+                    unit_data;
+        }
+        dst_count += __popc(live_key_lanes);
+        if (dst_count >= INLINE_PAIRS_PER_SLAB) {
+            prev_dst_slab_ptr = dst_slab_ptr;
+            dst_slab_ptr = next_dst_slab_ptr;
+            dst_count -= INLINE_PAIRS_PER_SLAB;
+        }
+        src_slab_ptr = next_slab_ptr;
+    }
+
+    /** Branch 2: the last dst slab is empty, cut the chain before it **/
+    ptr_t last_slab_ptr = dst_slab_ptr;
+    if (dst_count == 0 && dst_slab_ptr != HEAD_SLAB_PTR) {
+        last_slab_ptr = prev_dst_slab_ptr;
+    }
+    ptr_t* unit_data_ptr =
+            (last_slab_ptr == HEAD_SLAB_PTR)
+                    ? get_unit_ptr_from_list_head(bucket_id, lane_id)
+                    : get_unit_ptr_from_list_nodes(last_slab_ptr, lane_id);
+    ptr_t free_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, *unit_data_ptr,
+                                      NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+    if (lane_id == NEXT_SLAB_PTR_LANE) {
+        *unit_data_ptr = EMPTY_SLAB_PTR;
+    } else if (last_slab_ptr == dst_slab_ptr &&
+               lane_id < 2 * INLINE_PAIRS_PER_SLAB &&
+               lane_id >= 2 * dst_count) {
+        *unit_data_ptr = EMPTY_KEY;
+    }
+
+    /** Branch 3: free the unlinked slabs **/
+    while (free_slab_ptr != EMPTY_SLAB_PTR) {
+        ptr_t next_slab_ptr = __shfl_sync(
+                ACTIVE_LANES_MASK,
+                *get_unit_ptr_from_list_nodes(free_slab_ptr, lane_id),
+                NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+        if (lane_id == 0) {
+            FreeSlab(free_slab_ptr);
+        }
+        free_slab_ptr = next_slab_ptr;
+    }
+}
+
+/*
+ * BuildBucket: as in the pool layout, a pair per lane, written to the pair
+ * of lanes after the last pair of the tail slab.
+ */
+template <typename _Key, typename _Value, typename _Hash>
+__device__ void SlabHashContext<_Key, _Value, _Hash, true>::BuildBucket(
+        const uint32_t lane_id,
+        const uint32_t bucket_id,
+        const _Key* keys,
+        const _Value* values,
+        const uint32_t* order,
+        const uint32_t num_keys) {
+    /** Branch 1: find the tail slab and the pair after its last pair **/
+    ptr_t tail_slab_ptr = HEAD_SLAB_PTR;
+    uint32_t unit_data = *get_unit_ptr_from_list_head(bucket_id, lane_id);
+    ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                      NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+    while (next_slab_ptr != EMPTY_SLAB_PTR) {
+        tail_slab_ptr = next_slab_ptr;
+        unit_data = *get_unit_ptr_from_list_nodes(tail_slab_ptr, lane_id);
+        next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                    NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+    }
+    uint32_t tail_pair =
+            (33 - __clz(__ballot_sync(ACTIVE_LANES_MASK,
+                                      unit_data != EMPTY_KEY) &
+                        INLINE_KEY_LANES_MASK)) >>
+            1;
+
+    for (uint32_t first = 0; first < num_keys; first += WARP_WIDTH) {
+        bool lane_active = (first + lane_id < num_keys);
+        _Key key;
+        _Value value;
+        if (lane_active) {
+            key = keys[order[first + lane_id]];
+            value = values[order[first + lane_id]];
+            lane_active = (KeyToBits(key) != EMPTY_KEY);
+        }
+
+        /** Branch 2: drop the keys in the chain, then the duplicates **/
+        bool to_search = lane_active;
+        bool is_found = Search(to_search, lane_id, bucket_id, key).second;
+        bool is_new = lane_active && !is_found;
+        uint32_t key_bits = lane_active ? KeyToBits(key) : EMPTY_KEY;
+        uint32_t active_lanes = __ballot_sync(ACTIVE_LANES_MASK, lane_active);
+        while (active_lanes) {
+            uint32_t src_lane = __ffs(active_lanes) - 1;
+            uint32_t src_key = __shfl_sync(ACTIVE_LANES_MASK, key_bits,
+                                           src_lane, WARP_WIDTH);
+            if (src_lane < lane_id && src_key == key_bits) {
+                is_new = false;
+            }
+            active_lanes &= active_lanes - 1;
+        }
+
+        uint32_t new_lanes = __ballot_sync(ACTIVE_LANES_MASK, is_new);
+        uint32_t rank = __popc(new_lanes & ((1u << lane_id) - 1));
+        uint32_t num_new = __popc(new_lanes);
+
+        /** Branch 3: append them, linking a new slab to a full tail **/
+        while (num_new > 0) {
+            if (tail_pair == INLINE_PAIRS_PER_SLAB) {
+                ptr_t new_slab_ptr = AllocateSlab(lane_id, tail_slab_ptr);
+                if (lane_id == NEXT_SLAB_PTR_LANE) {
+                    *((tail_slab_ptr == HEAD_SLAB_PTR)
+                              ? get_unit_ptr_from_list_head(bucket_id,
+                                                            lane_id)
+                              : get_unit_ptr_from_list_nodes(tail_slab_ptr,
+                                                             lane_id)) =
+                            new_slab_ptr;
+                }
+                tail_slab_ptr = new_slab_ptr;
+                tail_pair = 0;
+            }
+
+            uint32_t num_written = (num_new < INLINE_PAIRS_PER_SLAB - tail_pair)
+                                           ? num_new
+                                           : INLINE_PAIRS_PER_SLAB - tail_pair;
+            if (is_new && rank < num_written) {
+                uint32_t* pair_ptr =
+                        (tail_slab_ptr == HEAD_SLAB_PTR)
+                                ? get_unit_ptr_from_list_head(
+                                          bucket_id, 2 * (tail_pair + rank))
+                                : get_unit_ptr_from_list_nodes(
+                                          tail_slab_ptr,
+                                          2 * (tail_pair + rank));
+                pair_ptr[1] = ValueToBits(value);
+                pair_ptr[0] = key_bits;
+                is_new = false;
+            } else if (is_new) {
+                rank -= num_written;
+            }
+            tail_pair += num_written;
+            num_new -= num_written;
+        }
+        __threadfence();
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void SearchInlineKernel(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        _Key* keys,
+        const uint32_t* order,
+        _Value* values,
+        uint8_t* founds,
+        uint32_t num_queries) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    /* This warp is idle */
+    if ((tid - lane_id) >= num_queries) {
+        return;
+    }
+
+    /* Initialize the memory allocator on each warp */
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    /* With an @order, the query of this lane and its results' position */
+    uint32_t query_id = tid;
+    bool lane_active = false;
+    uint32_t bucket_id = 0;
+    _Key key;
+
+    if (tid < num_queries) {
+        query_id = order ? order[tid] : tid;
+        key = keys[query_id];
+        lane_active = (slab_hash_ctx.KeyToBits(key) != EMPTY_KEY);
+        bucket_id = slab_hash_ctx.ComputeBucket(key);
+    }
+
+    pair_t<_Value, bool> result =
+            slab_hash_ctx.Search(lane_active, lane_id, bucket_id, key);
+
+    if (tid < num_queries) {
+        founds[query_id] = result.second;
+        values[query_id] = result.first;
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void InsertInlineKernel(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        _Key* keys,
+        _Value* values,
+        uint32_t num_keys) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    if ((tid - lane_id) >= num_keys) {
+        return;
+    }
+
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    bool lane_active = false;
+    uint32_t bucket_id = 0;
+    _Key key;
+    _Value value;
+
+    if (tid < num_keys) {
+        key = keys[tid];
+        value = values[tid];
+        lane_active = (slab_hash_ctx.KeyToBits(key) != EMPTY_KEY);
+        bucket_id = slab_hash_ctx.ComputeBucket(key);
+    }
+
+    slab_hash_ctx.Insert(lane_active, lane_id, bucket_id, key, value);
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void RemoveInlineKernel(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        _Key* keys,
+        uint32_t num_keys) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    if ((tid - lane_id) >= num_keys) {
+        return;
+    }
+
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    bool lane_active = false;
+    uint32_t bucket_id = 0;
+    _Key key;
+
+    if (tid < num_keys) {
+        key = keys[tid];
+        lane_active = (slab_hash_ctx.KeyToBits(key) != EMPTY_KEY);
+        bucket_id = slab_hash_ctx.ComputeBucket(key);
+    }
+
+    slab_hash_ctx.Remove(lane_active, lane_id, bucket_id, key);
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void InsertOrAssignInlineKernel(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        _Key* keys,
+        _Value* values,
+        uint32_t num_keys) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    if ((tid - lane_id) >= num_keys) {
+        return;
+    }
+
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    bool lane_active = false;
+    uint32_t bucket_id = 0;
+    _Key key;
+    _Value value;
+
+    if (tid < num_keys) {
+        key = keys[tid];
+        value = values[tid];
+        lane_active = (slab_hash_ctx.KeyToBits(key) != EMPTY_KEY);
+        bucket_id = slab_hash_ctx.ComputeBucket(key);
+    }
+
+    slab_hash_ctx.InsertOrAssign(lane_active, lane_id, bucket_id, key, value);
+}
+
+template <typename _Key, typename _Value, typename _Hash, typename _Reduce>
+__global__ void InsertOrReduceInlineKernel(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        _Key* keys,
+        _Value* values,
+        uint32_t num_keys,
+        _Reduce reduce) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    if ((tid - lane_id) >= num_keys) {
+        return;
+    }
+
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    bool lane_active = false;
+    uint32_t bucket_id = 0;
+    _Key key;
+    _Value value;
+
+    if (tid < num_keys) {
+        key = keys[tid];
+        value = values[tid];
+        lane_active = (slab_hash_ctx.KeyToBits(key) != EMPTY_KEY);
+        bucket_id = slab_hash_ctx.ComputeBucket(key);
+    }
+
+    slab_hash_ctx.InsertOrReduce(lane_active, lane_id, bucket_id, key, value,
+                                 reduce);
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void UpdateExistingInlineKernel(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        _Key* keys,
+        _Value* values,
+        uint32_t num_keys) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    if ((tid - lane_id) >= num_keys) {
+        return;
+    }
+
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    bool lane_active = false;
+    uint32_t bucket_id = 0;
+    _Key key;
+    _Value value;
+
+    if (tid < num_keys) {
+        key = keys[tid];
+        value = values[tid];
+        lane_active = (slab_hash_ctx.KeyToBits(key) != EMPTY_KEY);
+        bucket_id = slab_hash_ctx.ComputeBucket(key);
+    }
+
+    slab_hash_ctx.UpdateExisting(lane_active, lane_id, bucket_id, key, value);
+}
+
+/* Number of pairs within each bucket, one warp per bucket */
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void bucket_count_inline_kernel(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        uint32_t* d_count_result,
+        uint32_t num_buckets) {
+    // global warp ID
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t wid = tid >> 5;
+    // assigning a warp per bucket
+    if (wid >= num_buckets) {
+        return;
+    }
+
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    // initializing the memory allocator on each warp:
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    uint32_t count = 0;
+
+    uint32_t src_unit_data =
+            *slab_hash_ctx.get_unit_ptr_from_list_head(wid, lane_id);
+
+    count += __popc(
+            __ballot_sync(INLINE_KEY_LANES_MASK, src_unit_data != EMPTY_KEY));
+    uint32_t next = __shfl_sync(0xFFFFFFFF, src_unit_data, 31, 32);
+
+    while (next != EMPTY_SLAB_PTR) {
+        src_unit_data =
+                *slab_hash_ctx.get_unit_ptr_from_list_nodes(next, lane_id);
+        count += __popc(__ballot_sync(INLINE_KEY_LANES_MASK,
+                                      src_unit_data != EMPTY_KEY));
+        next = __shfl_sync(0xFFFFFFFF, src_unit_data, 31, 32);
+    }
+    // writing back the results:
+    if (lane_id == 0) {
+        d_count_result[wid] = count;
+    }
+}
+
+/*
+ * Export: a warp per bucket writes the pairs of its chain, see ExportKernel.
+ * The value of the pair in lanes (2i, 2i + 1) is shuffled to lane 2i.
+ */
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void ExportInlineKernel(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        const uint32_t* d_offsets,
+        _Key* keys,
+        _Value* values,
+        uint32_t num_buckets) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t wid = tid >> 5;
+    if (wid >= num_buckets) {
+        return;
+    }
+
+    uint32_t lane_id = threadIdx.x & 0x1F;
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    uint32_t offset = d_offsets[wid];
+    uint32_t src_unit_data =
+            *slab_hash_ctx.get_unit_ptr_from_list_head(wid, lane_id);
+
+    while (true) {
+        uint32_t value_bits = __shfl_sync(ACTIVE_LANES_MASK, src_unit_data,
+                                          (lane_id + 1) & 0x1F, WARP_WIDTH);
+        bool lane_valid = ((INLINE_KEY_LANES_MASK >> lane_id) & 1) &&
+                          src_unit_data != EMPTY_KEY;
+        uint32_t valid_lanes = __ballot_sync(ACTIVE_LANES_MASK, lane_valid);
+
+        if (lane_valid) {
+            uint32_t index =
+                    offset + __popc(valid_lanes & ((1u << lane_id) - 1));
+            if (keys) keys[index] = slab_hash_ctx.BitsToKey(src_unit_data);
+            if (values) values[index] = slab_hash_ctx.BitsToValue(value_bits);
+        }
+        offset += __popc(valid_lanes);
+
+        uint32_t next = __shfl_sync(ACTIVE_LANES_MASK, src_unit_data,
+                                    NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+        if (next == EMPTY_SLAB_PTR) break;
+        src_unit_data =
+                *slab_hash_ctx.get_unit_ptr_from_list_nodes(next, lane_id);
+    }
+}
+
+/*
+ * ForEach: a warp per bucket, each key lane visits its pair, and passes the
+ * value lane by reference
+ */
+template <typename _Key, typename _Value, typename _Hash, typename _Func>
+__global__ void ForEachInlineKernel(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        _Func func,
+        uint32_t num_buckets) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t wid = tid >> 5;
+    if (wid >= num_buckets) {
+        return;
+    }
+
+    uint32_t lane_id = threadIdx.x & 0x1F;
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    uint32_t* unit_data_ptr =
+            slab_hash_ctx.get_unit_ptr_from_list_head(wid, lane_id);
+
+    while (true) {
+        uint32_t src_unit_data = *unit_data_ptr;
+        if (((INLINE_KEY_LANES_MASK >> lane_id) & 1) &&
+            src_unit_data != EMPTY_KEY) {
+            func(slab_hash_ctx.BitsToKey(src_unit_data),
+                 *reinterpret_cast<_Value*>(unit_data_ptr + 1));
+        }
+
+        uint32_t next = __shfl_sync(ACTIVE_LANES_MASK, src_unit_data,
+                                    NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+        if (next == EMPTY_SLAB_PTR) break;
+        unit_data_ptr =
+                slab_hash_ctx.get_unit_ptr_from_list_nodes(next, lane_id);
+    }
+}
+
+/*
+ * Rehash: a warp per bucket of the old table moves the pairs of its chain
+ * into the chains of @new_ctx, see RehashKernel
+ */
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void RehashInlineKernel(
+        SlabHashContext<_Key, _Value, _Hash, true> old_ctx,
+        SlabHashContext<_Key, _Value, _Hash, true> new_ctx,
+        uint32_t num_buckets) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t wid = tid >> 5;
+    if (wid >= num_buckets) {
+        return;
+    }
+
+    uint32_t lane_id = threadIdx.x & 0x1F;
+    new_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    uint32_t src_unit_data = *old_ctx.get_unit_ptr_from_list_head(wid, lane_id);
+
+    while (true) {
+        uint32_t value_bits = __shfl_sync(ACTIVE_LANES_MASK, src_unit_data,
+                                          (lane_id + 1) & 0x1F, WARP_WIDTH);
+        bool lane_active = ((INLINE_KEY_LANES_MASK >> lane_id) & 1) &&
+                           src_unit_data != EMPTY_KEY;
+        uint32_t new_bucket = 0;
+        if (lane_active) {
+            new_bucket =
+                    new_ctx.ComputeBucket(old_ctx.BitsToKey(src_unit_data));
+        }
+        new_ctx.InsertPairBits(lane_active, lane_id, new_bucket,
+                               old_ctx.MakePair64(src_unit_data, value_bits));
+
+        uint32_t next = __shfl_sync(ACTIVE_LANES_MASK, src_unit_data,
+                                    NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+        if (next == EMPTY_SLAB_PTR) break;
+        src_unit_data = *old_ctx.get_unit_ptr_from_list_nodes(next, lane_id);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void FreeChainsInlineKernel(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        uint32_t num_buckets) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t wid = tid >> 5;
+    if (wid >= num_buckets) {
+        return;
+    }
+
+    uint32_t lane_id = threadIdx.x & 0x1F;
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+    slab_hash_ctx.FreeChain(lane_id, wid);
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void SplitInlineKernel(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        uint32_t first_bucket,
+        uint32_t num_splits) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t wid = tid >> 5;
+    if (wid >= num_splits) {
+        return;
+    }
+
+    uint32_t lane_id = threadIdx.x & 0x1F;
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+    slab_hash_ctx.SplitBucket(lane_id, first_bucket + wid);
+}
+
+/* A warp per bucket compacts its chain, see CompactBucket */
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void CompactInlineKernel(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        uint32_t num_buckets) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t wid = tid >> 5;
+    if (wid >= num_buckets) {
+        return;
+    }
+
+    uint32_t lane_id = threadIdx.x & 0x1F;
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+    slab_hash_ctx.CompactBucket(lane_id, wid);
+}
+
+/* A warp per bucket appends its range of the partitioned keys, see
+ * BuildBucket */
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void BulkBuildInlineKernel(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        const _Key* keys,
+        const _Value* values,
+        const uint32_t* offsets,
+        const uint32_t* order,
+        uint32_t num_buckets) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t wid = tid >> 5;
+    if (wid >= num_buckets) {
+        return;
+    }
+
+    uint32_t lane_id = threadIdx.x & 0x1F;
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+    slab_hash_ctx.BuildBucket(lane_id, wid, keys, values, order + offsets[wid],
+                              offsets[wid + 1] - offsets[wid]);
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+__global__ void MarkReservedKeysInlineKernel(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        const _Key* keys,
+        uint8_t* statuses,
+        uint32_t num_keys) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    if (tid >= num_keys || slab_hash_ctx.KeyToBits(keys[tid]) != EMPTY_KEY) {
+        return;
+    }
+    assert(statuses && "EMPTY_KEY is reserved in the inline layout");
+    if (statuses) statuses[tid] = STATUS_RESERVED_KEY;
+}
+
+#ifdef SLABHASH_BACKEND_CPU
+#include "slab_hash_inline_host.h"
+#endif
+
+template <typename _Key, typename _Value, typename _Hash>
+SlabHash<_Key, _Value, _Hash, true>::SlabHash(
+        const uint32_t max_bucket_count,
+        const uint32_t max_keyvalue_count,
+        uint32_t device_idx,
+        bool /*use_fingerprints*/ /* = false */)
+    : num_buckets_(max_bucket_count),
+      bucket_list_head_(nullptr),
+      device_idx_(device_idx),
+      max_chain_length_(0),
+      bucket_ordered_search_(false),
+      batch_deduplication_(false),
+      bucket_capacity_(max_bucket_count),
+      split_bucket_(0),
+      splits_per_batch_(0) {
+    slab_list_allocator_ = std::make_shared<SlabAlloc>(
+            max_keyvalue_count / INLINE_PAIRS_PER_SLAB + 1);
+
+#ifndef SLABHASH_BACKEND_CPU
+    int32_t device_count = 0;
+    CHECK_CUDA(cudaGetDeviceCount(&device_count));
+    assert(device_idx_ < device_count);
+#endif
+    BackendSetDevice(device_idx_);
+
+    // allocating initial buckets:
+    BackendMalloc(&bucket_list_head_, sizeof(Slab) * num_buckets_);
+    BackendMemset(bucket_list_head_, 0xFF, sizeof(Slab) * num_buckets_);
+
+    gpu_context_.Setup(bucket_list_head_, num_buckets_,
+                       slab_list_allocator_->getContext());
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+SlabHash<_Key, _Value, _Hash, true>::~SlabHash() {
+    BackendSetDevice(device_idx_);
+    BackendFree(bucket_list_head_);
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHash<_Key, _Value, _Hash, true>::Insert(
+        _Key* keys,
+        _Value* values,
+        uint32_t num_keys,
+        uint8_t* statuses /* = nullptr */) {
+    BackendSetDevice(device_idx_);
+    if (statuses) BackendMemset(statuses, STATUS_SUCCESS, num_keys);
+    MarkReservedKeys(keys, num_keys, statuses);
+    _Key* unique_keys = nullptr;
+    _Value* unique_values = nullptr;
+    if (batch_deduplication_ && statuses == nullptr) {
+        num_keys = DeduplicateBatch(keys, values, num_keys, &unique_keys,
+                                    &unique_values, DedupKeepFirst<_Value>());
+        keys = unique_keys;
+        values = unique_values;
+    }
+    ReserveSlabs(MaxNewSlabs(num_keys));
+
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_,
+               InsertInlineKernel<_Key, _Value, _Hash>, gpu_context_, keys,
+               values, num_keys);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_keys, [&](uint32_t worker_id, uint32_t begin,
+                              uint32_t end) {
+        InsertInlineKernelHost(gpu_context_, keys, values, begin, end,
+                               worker_id);
+    });
+#else
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    InsertInlineKernel<_Key, _Value, _Hash>
+            <<<num_blocks, BLOCKSIZE_>>>(gpu_context_, keys, values, num_keys);
+#endif
+
+    if (unique_keys) {
+        BackendFree(unique_keys);
+        BackendFree(unique_values);
+    }
+
+    RehashIfNeeded();
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHash<_Key, _Value, _Hash, true>::BulkBuild(_Key* keys,
+                                                    _Value* values,
+                                                    uint32_t num_keys) {
+    BackendSetDevice(device_idx_);
+    uint32_t* d_offsets;
+    uint32_t* d_order;
+    BackendMalloc(&d_offsets, sizeof(uint32_t) * (num_buckets_ + 1));
+    BackendMalloc(&d_order, sizeof(uint32_t) * num_keys);
+
+    PartitionByBucket(keys, num_keys, d_offsets, d_order);
+    ReserveSlabs(MaxNewSlabs(num_keys));
+
+    /* A warp per bucket appends its keys */
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    SimtLaunch(num_blocks, blocksize,
+               BulkBuildInlineKernel<_Key, _Value, _Hash>,
+               gpu_context_, keys, values, d_offsets, d_order, num_buckets_);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_buckets_, [&](uint32_t worker_id, uint32_t begin,
+                                  uint32_t end) {
+        BulkBuildInlineKernelHost(gpu_context_, keys, values, d_offsets,
+                                  d_order, begin, end, worker_id);
+    });
+#else
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    BulkBuildInlineKernel<_Key, _Value, _Hash><<<num_blocks, blocksize>>>(
+            gpu_context_, keys, values, d_offsets, d_order, num_buckets_);
+#endif
+
+    BackendFree(d_offsets);
+    BackendFree(d_order);
+
+    RehashIfNeeded();
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHash<_Key, _Value, _Hash, true>::PartitionByBucket(
+        _Key* keys,
+        uint32_t num_keys,
+        uint32_t* d_offsets,
+        uint32_t* d_order) {
+    uint32_t* d_cursors;
+    BackendMalloc(&d_cursors, sizeof(uint32_t) * (num_buckets_ + 1));
+    BackendMemset(d_offsets, 0, sizeof(uint32_t) * (num_buckets_ + 1));
+
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_,
+               CountBucketKeysKernel<
+                       SlabHashContext<_Key, _Value, _Hash, true>, _Key>,
+               gpu_context_, keys, d_offsets, num_keys);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_keys, [&](uint32_t /*worker_id*/, uint32_t begin,
+                              uint32_t end) {
+        CountBucketKeysKernelHost(gpu_context_, keys, d_offsets, begin, end);
+    });
+#else
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    CountBucketKeysKernel<<<num_blocks, BLOCKSIZE_>>>(gpu_context_, keys,
+                                                      d_offsets, num_keys);
+#endif
+    BackendExclusiveScan(d_offsets, num_buckets_ + 1);
+
+    BackendMemcpy(d_cursors, d_offsets, sizeof(uint32_t) * (num_buckets_ + 1));
+#if defined(SLABHASH_BACKEND_SIMT)
+    SimtLaunch(num_blocks, BLOCKSIZE_,
+               PartitionKeysKernel<
+                       SlabHashContext<_Key, _Value, _Hash, true>, _Key>,
+               gpu_context_, keys, d_cursors, d_order, num_keys);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_keys, [&](uint32_t /*worker_id*/, uint32_t begin,
+                              uint32_t end) {
+        PartitionKeysKernelHost(gpu_context_, keys, d_cursors, d_order, begin,
+                                end);
+    });
+#else
+    PartitionKeysKernel<<<num_blocks, BLOCKSIZE_>>>(gpu_context_, keys,
+                                                    d_cursors, d_order,
+                                                    num_keys);
+#endif
+
+    BackendFree(d_cursors);
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+template <typename _Combine>
+uint32_t SlabHash<_Key, _Value, _Hash, true>::DeduplicateBatch(
+        _Key* keys,
+        _Value* values,
+        uint32_t num_keys,
+        _Key** unique_keys,
+        _Value** unique_values,
+        _Combine combine) {
+    uint32_t* d_offsets;
+    uint32_t* d_order;
+    uint32_t* d_unique_offsets;
+    _Value* d_merged;
+    BackendMalloc(&d_offsets, sizeof(uint32_t) * (num_buckets_ + 1));
+    BackendMalloc(&d_order, sizeof(uint32_t) * num_keys);
+    BackendMalloc(&d_unique_offsets, sizeof(uint32_t) * (num_buckets_ + 1));
+    BackendMalloc(&d_merged, sizeof(_Value) * num_keys);
+
+    PartitionByBucket(keys, num_keys, d_offsets, d_order);
+
+    /* A thread per bucket */
+    BackendMemset(d_unique_offsets, 0, sizeof(uint32_t) * (num_buckets_ + 1));
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_buckets_ + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_,
+               DedupBucketKeysKernel<_Key, _Value, _Combine>, keys, values,
+               d_offsets, d_order, d_merged, d_unique_offsets, num_buckets_,
+               combine);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_buckets_, [&](uint32_t /*worker_id*/, uint32_t begin,
+                                  uint32_t end) {
+        DedupBucketKeysKernelHost(keys, values, d_offsets, d_order, d_merged,
+                                  d_unique_offsets, begin, end, combine);
+    });
+#else
+    const uint32_t num_blocks = (num_buckets_ + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    DedupBucketKeysKernel<_Key, _Value, _Combine><<<num_blocks, BLOCKSIZE_>>>(
+            keys, values, d_offsets, d_order, d_merged, d_unique_offsets,
+            num_buckets_, combine);
+#endif
+
+    BackendExclusiveScan(d_unique_offsets, num_buckets_ + 1);
+    uint32_t num_unique;
+    BackendMemcpy(&num_unique, d_unique_offsets + num_buckets_,
+                  sizeof(uint32_t));
+
+    BackendMalloc(unique_keys, sizeof(_Key) * num_unique);
+    BackendMalloc(unique_values, sizeof(_Value) * num_unique);
+#if defined(SLABHASH_BACKEND_SIMT)
+    SimtLaunch(num_blocks, BLOCKSIZE_, CompactBucketKeysKernel<_Key, _Value>,
+               keys, d_offsets, d_order, d_merged, d_unique_offsets,
+               *unique_keys, *unique_values, num_buckets_);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_buckets_, [&](uint32_t /*worker_id*/, uint32_t begin,
+                                  uint32_t end) {
+        CompactBucketKeysKernelHost(keys, d_offsets, d_order, d_merged,
+                                    d_unique_offsets, *unique_keys,
+                                    *unique_values, begin, end);
+    });
+#else
+    CompactBucketKeysKernel<_Key, _Value><<<num_blocks, BLOCKSIZE_>>>(
+            keys, d_offsets, d_order, d_merged, d_unique_offsets, *unique_keys,
+            *unique_values, num_buckets_);
+#endif
+
+    BackendFree(d_offsets);
+    BackendFree(d_order);
+    BackendFree(d_unique_offsets);
+    BackendFree(d_merged);
+    return num_unique;
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHash<_Key, _Value, _Hash, true>::Search(_Key* keys,
+                                                 _Value* values,
+                                                 uint8_t* founds,
+                                                 uint32_t num_queries) {
+    BackendSetDevice(device_idx_);
+    uint32_t* d_order = nullptr;
+    if (bucket_ordered_search_) {
+        uint32_t* d_offsets;
+        BackendMalloc(&d_offsets, sizeof(uint32_t) * (num_buckets_ + 1));
+        BackendMalloc(&d_order, sizeof(uint32_t) * num_queries);
+        PartitionByBucket(keys, num_queries, d_offsets, d_order);
+        BackendFree(d_offsets);
+    }
+
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_queries + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_,
+               SearchInlineKernel<_Key, _Value, _Hash>, gpu_context_, keys,
+               d_order, values, founds, num_queries);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_queries, [&](uint32_t worker_id, uint32_t begin,
+                                 uint32_t end) {
+        SearchInlineKernelHost(gpu_context_, keys, d_order, values, founds,
+                               begin, end, worker_id);
+    });
+#else
+    const uint32_t num_blocks = (num_queries + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SearchInlineKernel<_Key, _Value, _Hash><<<num_blocks, BLOCKSIZE_>>>(
+            gpu_context_, keys, d_order, values, founds, num_queries);
+#endif
+
+    if (d_order) BackendFree(d_order);
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHash<_Key, _Value, _Hash, true>::Remove(_Key* keys,
+                                                 uint32_t num_keys) {
+    BackendSetDevice(device_idx_);
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_,
+               RemoveInlineKernel<_Key, _Value, _Hash>, gpu_context_, keys,
+               num_keys);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_keys, [&](uint32_t worker_id, uint32_t begin,
+                              uint32_t end) {
+        RemoveInlineKernelHost(gpu_context_, keys, begin, end, worker_id);
+    });
+#else
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    RemoveInlineKernel<_Key, _Value, _Hash>
+            <<<num_blocks, BLOCKSIZE_>>>(gpu_context_, keys, num_keys);
+#endif
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHash<_Key, _Value, _Hash, true>::InsertOrAssign(
+        _Key* keys,
+        _Value* values,
+        uint32_t num_keys,
+        uint8_t* statuses /* = nullptr */) {
+    BackendSetDevice(device_idx_);
+    if (statuses) BackendMemset(statuses, STATUS_SUCCESS, num_keys);
+    MarkReservedKeys(keys, num_keys, statuses);
+    _Key* unique_keys = nullptr;
+    _Value* unique_values = nullptr;
+    if (batch_deduplication_ && statuses == nullptr) {
+        num_keys = DeduplicateBatch(keys, values, num_keys, &unique_keys,
+                                    &unique_values, DedupKeepLast<_Value>());
+        keys = unique_keys;
+        values = unique_values;
+    }
+    ReserveSlabs(MaxNewSlabs(num_keys));
+
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_,
+               InsertOrAssignInlineKernel<_Key, _Value, _Hash>, gpu_context_,
+               keys, values, num_keys);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_keys, [&](uint32_t worker_id, uint32_t begin,
+                              uint32_t end) {
+        InsertOrAssignInlineKernelHost(gpu_context_, keys, values, begin, end,
+                                       worker_id);
+    });
+#else
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    InsertOrAssignInlineKernel<_Key, _Value, _Hash>
+            <<<num_blocks, BLOCKSIZE_>>>(gpu_context_, keys, values, num_keys);
+#endif
+
+    if (unique_keys) {
+        BackendFree(unique_keys);
+        BackendFree(unique_values);
+    }
+
+    RehashIfNeeded();
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+template <typename _Reduce>
+void SlabHash<_Key, _Value, _Hash, true>::InsertOrReduce(
+        _Key* keys,
+        _Value* values,
+        uint32_t num_keys,
+        _Reduce reduce,
+        uint8_t* statuses /* = nullptr */) {
+    BackendSetDevice(device_idx_);
+    if (statuses) BackendMemset(statuses, STATUS_SUCCESS, num_keys);
+    MarkReservedKeys(keys, num_keys, statuses);
+    _Key* unique_keys = nullptr;
+    _Value* unique_values = nullptr;
+    if (batch_deduplication_ && statuses == nullptr) {
+        num_keys = DeduplicateBatch(keys, values, num_keys, &unique_keys,
+                                    &unique_values,
+                                    DedupReduce<_Value, _Reduce>(reduce));
+        keys = unique_keys;
+        values = unique_values;
+    }
+    ReserveSlabs(MaxNewSlabs(num_keys));
+
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_,
+               InsertOrReduceInlineKernel<_Key, _Value, _Hash, _Reduce>,
+               gpu_context_, keys, values, num_keys, reduce);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_keys, [&](uint32_t worker_id, uint32_t begin,
+                              uint32_t end) {
+        InsertOrReduceInlineKernelHost(gpu_context_, keys, values, begin, end,
+                                       worker_id, reduce);
+    });
+#else
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    InsertOrReduceInlineKernel<_Key, _Value, _Hash, _Reduce>
+            <<<num_blocks, BLOCKSIZE_>>>(gpu_context_, keys, values, num_keys,
+                                         reduce);
+#endif
+
+    if (unique_keys) {
+        BackendFree(unique_keys);
+        BackendFree(unique_values);
+    }
+
+    RehashIfNeeded();
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHash<_Key, _Value, _Hash, true>::UpdateExisting(_Key* keys,
+                                                         _Value* values,
+                                                         uint32_t num_keys) {
+    BackendSetDevice(device_idx_);
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_,
+               UpdateExistingInlineKernel<_Key, _Value, _Hash>, gpu_context_,
+               keys, values, num_keys);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_keys, [&](uint32_t worker_id, uint32_t begin,
+                              uint32_t end) {
+        UpdateExistingInlineKernelHost(gpu_context_, keys, values, begin, end,
+                                       worker_id);
+    });
+#else
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    UpdateExistingInlineKernel<_Key, _Value, _Hash>
+            <<<num_blocks, BLOCKSIZE_>>>(gpu_context_, keys, values, num_keys);
+#endif
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHash<_Key, _Value, _Hash, true>::CountBuckets(
+        uint32_t* d_bucket_count) {
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    SimtLaunch(num_blocks, blocksize,
+               bucket_count_inline_kernel<_Key, _Value, _Hash>, gpu_context_,
+               d_bucket_count, num_buckets_);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_buckets_, [&](uint32_t /*worker_id*/, uint32_t begin,
+                                  uint32_t end) {
+        BucketCountInlineKernelHost(gpu_context_, d_bucket_count, begin, end);
+    });
+#else
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    bucket_count_inline_kernel<_Key, _Value, _Hash><<<num_blocks, blocksize>>>(
+            gpu_context_, d_bucket_count, num_buckets_);
+#endif
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+uint32_t SlabHash<_Key, _Value, _Hash, true>::ComputeBucketOffsets(
+        uint32_t* d_offsets) {
+    BackendMemset(d_offsets, 0, sizeof(uint32_t) * (num_buckets_ + 1));
+    CountBuckets(d_offsets);
+    BackendExclusiveScan(d_offsets, num_buckets_ + 1);
+
+    uint32_t num_pairs;
+    BackendMemcpy(&num_pairs, d_offsets + num_buckets_, sizeof(uint32_t));
+    return num_pairs;
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+uint32_t SlabHash<_Key, _Value, _Hash, true>::Size() {
+    BackendSetDevice(device_idx_);
+    uint32_t* d_offsets;
+    BackendMalloc(&d_offsets, sizeof(uint32_t) * (num_buckets_ + 1));
+    uint32_t num_pairs = ComputeBucketOffsets(d_offsets);
+    BackendFree(d_offsets);
+    return num_pairs;
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+uint32_t SlabHash<_Key, _Value, _Hash, true>::Export(_Key* keys,
+                                                     _Value* values) {
+    BackendSetDevice(device_idx_);
+    uint32_t* d_offsets;
+    BackendMalloc(&d_offsets, sizeof(uint32_t) * (num_buckets_ + 1));
+    uint32_t num_pairs = ComputeBucketOffsets(d_offsets);
+
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    SimtLaunch(num_blocks, blocksize, ExportInlineKernel<_Key, _Value, _Hash>,
+               gpu_context_, d_offsets, keys, values, num_buckets_);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_buckets_, [&](uint32_t /*worker_id*/, uint32_t begin,
+                                  uint32_t end) {
+        ExportInlineKernelHost(gpu_context_, d_offsets, keys, values, begin,
+                               end);
+    });
+#else
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    ExportInlineKernel<_Key, _Value, _Hash><<<num_blocks, blocksize>>>(
+            gpu_context_, d_offsets, keys, values, num_buckets_);
+#endif
+
+    BackendFree(d_offsets);
+    return num_pairs;
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+template <typename _Func>
+void SlabHash<_Key, _Value, _Hash, true>::ForEach(_Func func) {
+    BackendSetDevice(device_idx_);
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    SimtLaunch(num_blocks, blocksize,
+               ForEachInlineKernel<_Key, _Value, _Hash, _Func>, gpu_context_,
+               func, num_buckets_);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_buckets_, [&](uint32_t /*worker_id*/, uint32_t begin,
+                                  uint32_t end) {
+        ForEachInlineKernelHost(gpu_context_, func, begin, end);
+    });
+#else
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    ForEachInlineKernel<_Key, _Value, _Hash, _Func>
+            <<<num_blocks, blocksize>>>(gpu_context_, func, num_buckets_);
+#endif
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHash<_Key, _Value, _Hash, true>::Rehash(uint32_t new_bucket_count) {
+    assert(new_bucket_count > 0);
+    BackendSetDevice(device_idx_);
+    /* The new chains take at most a slab per INLINE_PAIRS_PER_SLAB pairs,
+     * and the old slabs are only freed afterwards */
+    ReserveSlabs(uint64_t(num_buckets_) + CountAllocatedSlabs());
+    const uint32_t bucket_capacity =
+            std::max(new_bucket_count, bucket_capacity_);
+    Slab* new_bucket_list_head;
+    BackendMalloc(&new_bucket_list_head, sizeof(Slab) * bucket_capacity);
+    BackendMemset(new_bucket_list_head, 0xFF, sizeof(Slab) * bucket_capacity);
+
+    SlabHashContext<_Key, _Value, _Hash, true> new_context = gpu_context_;
+    new_context.SetBuckets(new_bucket_list_head, new_bucket_count);
+
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    SimtLaunch(num_blocks, blocksize, RehashInlineKernel<_Key, _Value, _Hash>,
+               gpu_context_, new_context, num_buckets_);
+    SimtLaunch(num_blocks, blocksize,
+               FreeChainsInlineKernel<_Key, _Value, _Hash>, gpu_context_,
+               num_buckets_);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_buckets_, [&](uint32_t worker_id, uint32_t begin,
+                                  uint32_t end) {
+        RehashInlineKernelHost(gpu_context_, new_context, begin, end,
+                               worker_id);
+    });
+    ParallelFor(num_buckets_, [&](uint32_t /*worker_id*/, uint32_t begin,
+                                  uint32_t end) {
+        FreeChainsInlineKernelHost(gpu_context_, begin, end);
+    });
+#else
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    RehashInlineKernel<_Key, _Value, _Hash><<<num_blocks, blocksize>>>(
+            gpu_context_, new_context, num_buckets_);
+    FreeChainsInlineKernel<_Key, _Value, _Hash>
+            <<<num_blocks, blocksize>>>(gpu_context_, num_buckets_);
+#endif
+
+    BackendFree(bucket_list_head_);
+    bucket_list_head_ = new_bucket_list_head;
+    num_buckets_ = new_bucket_count;
+    bucket_capacity_ = bucket_capacity;
+    split_bucket_ = 0;
+    gpu_context_.SetBuckets(bucket_list_head_, num_buckets_);
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHash<_Key, _Value, _Hash, true>::Compact() {
+    BackendSetDevice(device_idx_);
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    SimtLaunch(num_blocks, blocksize, CompactInlineKernel<_Key, _Value, _Hash>,
+               gpu_context_, num_buckets_);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_buckets_, [&](uint32_t worker_id, uint32_t begin,
+                                  uint32_t end) {
+        CompactInlineKernelHost(gpu_context_, begin, end, worker_id);
+    });
+#else
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    CompactInlineKernel<_Key, _Value, _Hash>
+            <<<num_blocks, blocksize>>>(gpu_context_, num_buckets_);
+#endif
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHash<_Key, _Value, _Hash, true>::Relayout() {
+    BackendSetDevice(device_idx_);
+    uint32_t* d_offsets;
+    BackendMalloc(&d_offsets, sizeof(uint32_t) * (num_buckets_ + 1));
+    BackendMemset(d_offsets, 0, sizeof(uint32_t) * (num_buckets_ + 1));
+
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ + blocksize - 1) / blocksize;
+    SimtLaunch(num_blocks, blocksize, CountChainSlabsKernel<
+                       SlabHashContext<_Key, _Value, _Hash, true>>,
+               gpu_context_, d_offsets, num_buckets_);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_buckets_, [&](uint32_t /*worker_id*/, uint32_t begin,
+                                  uint32_t end) {
+        CountChainSlabsKernelHost(gpu_context_, d_offsets, begin, end);
+    });
+#else
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ + blocksize - 1) / blocksize;
+    CountChainSlabsKernel<<<num_blocks, blocksize>>>(gpu_context_, d_offsets,
+                                                     num_buckets_);
+#endif
+    BackendExclusiveScan(d_offsets, num_buckets_ + 1);
+
+    uint32_t num_slabs;
+    BackendMemcpy(&num_slabs, d_offsets + num_buckets_, sizeof(uint32_t));
+    if (num_slabs > 0) {
+        uint32_t* d_slabs;
+        BackendMalloc(&d_slabs, sizeof(Slab) * num_slabs);
+#if defined(SLABHASH_BACKEND_SIMT)
+        const uint32_t num_blocks =
+                (num_buckets_ * 32 + blocksize - 1) / blocksize;
+        SimtLaunch(num_blocks, blocksize, GatherChainsKernel<
+                           SlabHashContext<_Key, _Value, _Hash, true>>,
+                   gpu_context_, d_offsets, d_slabs, num_buckets_);
+#elif defined(SLABHASH_BACKEND_CPU)
+        ParallelFor(num_buckets_, [&](uint32_t /*worker_id*/, uint32_t begin,
+                                      uint32_t end) {
+            GatherChainsKernelHost(gpu_context_, d_offsets, d_slabs, begin,
+                                   end);
+        });
+#else
+        const uint32_t num_blocks =
+                (num_buckets_ * 32 + blocksize - 1) / blocksize;
+        GatherChainsKernel<<<num_blocks, blocksize>>>(gpu_context_, d_offsets,
+                                                      d_slabs, num_buckets_);
+#endif
+        slab_list_allocator_->Relayout(d_slabs, num_slabs);
+        BackendFree(d_slabs);
+    }
+    BackendFree(d_offsets);
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHash<_Key, _Value, _Hash, true>::SetMaxChainLength(
+        float max_chain_length) {
+    max_chain_length_ = max_chain_length;
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHash<_Key, _Value, _Hash, true>::SetNearTailAllocation(
+        bool near_tail_allocation) {
+    gpu_context_.SetNearTailAllocation(near_tail_allocation);
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHash<_Key, _Value, _Hash, true>::SetBucketOrderedSearch(
+        bool bucket_ordered_search) {
+    bucket_ordered_search_ = bucket_ordered_search;
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHash<_Key, _Value, _Hash, true>::SetBatchDeduplication(
+        bool batch_deduplication) {
+    batch_deduplication_ = batch_deduplication;
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+double SlabHash<_Key, _Value, _Hash, true>::ComputeAverageChainLength() {
+    BackendSetDevice(device_idx_);
+    return double(num_buckets_ + CountAllocatedSlabs()) / double(num_buckets_);
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHash<_Key, _Value, _Hash, true>::RehashIfNeeded() {
+    if (max_chain_length_ <= 0) return;
+
+    double average_chain_length = ComputeAverageChainLength();
+    if (average_chain_length > max_chain_length_ && splits_per_batch_ > 0) {
+        SplitBuckets(splits_per_batch_);
+    } else if (average_chain_length > max_chain_length_) {
+        /* Enough buckets for the current slabs to become list heads */
+        uint32_t new_bucket_count = std::max(
+                2 * num_buckets_,
+                uint32_t(std::ceil(num_buckets_ * average_chain_length)));
+        Rehash(new_bucket_count);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHash<_Key, _Value, _Hash, true>::EnableLinearHashing(
+        uint32_t max_bucket_count, uint32_t splits_per_batch) {
+    ReserveBuckets(max_bucket_count);
+    splits_per_batch_ = splits_per_batch;
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+bool SlabHash<_Key, _Value, _Hash, true>::Reserve(
+        uint32_t max_keyvalue_count) {
+    BackendSetDevice(device_idx_);
+    if (!slab_list_allocator_->Reserve(
+                max_keyvalue_count / INLINE_PAIRS_PER_SLAB + 1)) {
+        return false;
+    }
+    gpu_context_.SetSlabAllocator(slab_list_allocator_->getContext());
+    return true;
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHash<_Key, _Value, _Hash, true>::ReserveBuckets(
+        uint32_t bucket_capacity) {
+    if (bucket_capacity <= bucket_capacity_) return;
+
+    BackendSetDevice(device_idx_);
+    Slab* new_bucket_list_head;
+    BackendMalloc(&new_bucket_list_head, sizeof(Slab) * bucket_capacity);
+    BackendMemcpy(new_bucket_list_head, bucket_list_head_,
+                  sizeof(Slab) * num_buckets_);
+    BackendMemset(new_bucket_list_head + num_buckets_, 0xFF,
+                  sizeof(Slab) * (bucket_capacity - num_buckets_));
+
+    BackendFree(bucket_list_head_);
+    bucket_list_head_ = new_bucket_list_head;
+    bucket_capacity_ = bucket_capacity;
+    gpu_context_.SetBuckets(bucket_list_head_, num_buckets_ - split_bucket_,
+                            split_bucket_);
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHash<_Key, _Value, _Hash, true>::SplitBuckets(uint32_t num_splits) {
+    const uint32_t level_buckets = num_buckets_ - split_bucket_;
+    num_splits = std::min(num_splits, level_buckets - split_bucket_);
+    if (num_buckets_ + num_splits > bucket_capacity_) {
+        ReserveBuckets(
+                std::max(2 * bucket_capacity_, num_buckets_ + num_splits));
+    }
+
+    BackendSetDevice(device_idx_);
+    /* A split bucket gets at most as many slabs as its chain had, plus the
+     * head of the new one */
+    ReserveSlabs(uint64_t(num_splits) + CountAllocatedSlabs());
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_splits * 32 + blocksize - 1) / blocksize;
+    SimtLaunch(num_blocks, blocksize, SplitInlineKernel<_Key, _Value, _Hash>,
+               gpu_context_, split_bucket_, num_splits);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_splits, [&](uint32_t worker_id, uint32_t begin,
+                                uint32_t end) {
+        SplitInlineKernelHost(gpu_context_, split_bucket_, begin, end,
+                              worker_id);
+    });
+#else
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_splits * 32 + blocksize - 1) / blocksize;
+    SplitInlineKernel<_Key, _Value, _Hash><<<num_blocks, blocksize>>>(
+            gpu_context_, split_bucket_, num_splits);
+#endif
+
+    /* A level is complete once all its buckets are split */
+    num_buckets_ += num_splits;
+    split_bucket_ += num_splits;
+    if (split_bucket_ == level_buckets) split_bucket_ = 0;
+    gpu_context_.SetBuckets(bucket_list_head_, num_buckets_ - split_bucket_,
+                            split_bucket_);
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHash<_Key, _Value, _Hash, true>::MarkReservedKeys(
+        _Key* keys, uint32_t num_keys, uint8_t* statuses) {
+#ifdef NDEBUG
+    if (statuses == nullptr) return;
+#endif
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_,
+               MarkReservedKeysInlineKernel<_Key, _Value, _Hash>, gpu_context_,
+               keys, statuses, num_keys);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_keys, [&](uint32_t /*worker_id*/, uint32_t begin,
+                              uint32_t end) {
+        MarkReservedKeysInlineKernelHost(gpu_context_, keys, statuses, begin,
+                                         end);
+    });
+#else
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    MarkReservedKeysInlineKernel<_Key, _Value, _Hash>
+            <<<num_blocks, BLOCKSIZE_>>>(gpu_context_, keys, statuses,
+                                         num_keys);
+#endif
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+uint32_t SlabHash<_Key, _Value, _Hash, true>::CountAllocatedSlabs() {
+    return slab_list_allocator_->NumAllocated();
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHash<_Key, _Value, _Hash, true>::ReserveSlabs(
+        uint64_t num_new_slabs) {
+    const uint64_t num_slabs = num_new_slabs + CountAllocatedSlabs();
+    if (num_slabs <= slab_list_allocator_->NumUnits()) return;
+    slab_list_allocator_->Reserve(uint32_t(std::min<uint64_t>(
+            num_slabs, slab_list_allocator_->MaxReserve())));
+    gpu_context_.SetSlabAllocator(slab_list_allocator_->getContext());
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+uint64_t SlabHash<_Key, _Value, _Hash, true>::MaxNewSlabs(
+        uint32_t num_keys) const {
+    return num_keys / INLINE_PAIRS_PER_SLAB + std::min(num_keys, num_buckets_);
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+bool SlabHash<_Key, _Value, _Hash, true>::MayGrowSlabs(uint32_t num_keys) {
+    return MaxNewSlabs(num_keys) + CountAllocatedSlabs() >
+           slab_list_allocator_->NumUnits();
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+double SlabHash<_Key, _Value, _Hash, true>::ComputeLoadFactor(
+        int flag /* = 0 */) {
+    uint32_t* h_bucket_count = new uint32_t[num_buckets_];
+    uint32_t* d_bucket_count;
+    BackendMalloc(&d_bucket_count, sizeof(uint32_t) * num_buckets_);
+    BackendMemset(d_bucket_count, 0, sizeof(uint32_t) * num_buckets_);
+
+    //---------------------------------
+    // counting the number of inserted elements:
+    CountBuckets(d_bucket_count);
+    BackendMemcpy(h_bucket_count, d_bucket_count,
+                  sizeof(uint32_t) * num_buckets_);
+
+    int total_elements_stored = 0;
+    for (uint32_t i = 0; i < num_buckets_; i++) {
+        total_elements_stored += h_bucket_count[i];
+    }
+
+    if (flag) {
+        printf("## Total elements stored: %d (%lu bytes).\n",
+               total_elements_stored,
+               total_elements_stored * (sizeof(_Key) + sizeof(_Value)));
+    }
+
+    // computing load factor
+    int total_mem_units = num_buckets_ + CountAllocatedSlabs();
+
+    double load_factor =
+            double(total_elements_stored * (sizeof(_Key) + sizeof(_Value))) /
+            double(total_mem_units * WARP_WIDTH * sizeof(uint32_t));
+
+    if (d_bucket_count) BackendFree(d_bucket_count);
+    delete[] h_bucket_count;
+
+    return load_factor;
+}
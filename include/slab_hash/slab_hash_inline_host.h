@@ -0,0 +1,800 @@
+/*
+ * Copyright 2019 Saman Ashkiani
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Host backend (SLABHASH_BACKEND_CPU) of the inline SlabHashContext.
+ * Included from slab_hash_inline.h.
+ *
+ * Keys are stored in the slabs, so SlabProbe compares the query with all the
+ * keys of a slab at once.
+ */
+
+template <typename _Key, typename _Value, typename _Hash>
+ptr_t* SlabHashContext<_Key, _Value, _Hash, true>::get_slab_ptr(
+        const uint32_t bucket_id, const ptr_t slab_ptr) {
+    return (slab_ptr == HEAD_SLAB_PTR)
+                   ? get_unit_ptr_from_list_head(bucket_id, 0)
+                   : get_unit_ptr_from_list_nodes(slab_ptr, 0);
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+ptr_t SlabHashContext<_Key, _Value, _Hash, true>::AllocateSlab(
+        const ptr_t tail_slab_ptr) {
+    return (near_tail_allocation_ && tail_slab_ptr != HEAD_SLAB_PTR)
+                   ? slab_list_allocator_ctx_.AllocateNear(tail_slab_ptr)
+                   : slab_list_allocator_ctx_.Allocate();
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+pair_t<_Value, bool> SlabHashContext<_Key, _Value, _Hash, true>::Search(
+        const uint32_t bucket_id, const _Key& query_key) {
+    ptr_t curr_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t unit_data[WARP_WIDTH];
+    const uint32_t key_bits = KeyToBits(query_key);
+
+    while (true) {
+        const ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        for (uint32_t lane_id = 0; lane_id < WARP_WIDTH; ++lane_id) {
+            unit_data[lane_id] = AtomicLoad(slab + lane_id);
+        }
+
+        uint32_t found_lanes =
+                SlabProbe(unit_data, key_bits) & INLINE_KEY_LANES_MASK;
+
+        /** 1. Found in this slab, SUCCEED **/
+        if (found_lanes) {
+            int32_t lane_found = __builtin_ctz(found_lanes);
+            return pair_t<_Value, bool>(
+                    BitsToValue(unit_data[lane_found + 1]), true);
+        }
+
+        /** 2. Not found in this slab **/
+        ptr_t next_slab_ptr = unit_data[NEXT_SLAB_PTR_LANE];
+
+        /** 2.1. Next slab is empty, ABORT **/
+        if (next_slab_ptr == EMPTY_SLAB_PTR) {
+            return pair_t<_Value, bool>(_Value(0), false);
+        }
+        /** 2.2. Next slab exists, RESTART **/
+        curr_slab_ptr = next_slab_ptr;
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+bool SlabHashContext<_Key, _Value, _Hash, true>::Insert(
+        const uint32_t bucket_id, const _Key& key, const _Value& value) {
+    ptr_t curr_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t unit_data[WARP_WIDTH];
+    const uint32_t key_bits = KeyToBits(key);
+
+    while (true) {
+        ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        for (uint32_t lane_id = 0; lane_id < WARP_WIDTH; ++lane_id) {
+            unit_data[lane_id] = AtomicLoad(slab + lane_id);
+        }
+
+        /** Branch 1: key already existing, ABORT **/
+        if (SlabProbe(unit_data, key_bits) & INLINE_KEY_LANES_MASK) {
+            return false;
+        }
+
+        /** Branch 2: empty slot available, try to insert **/
+        uint32_t empty_lanes =
+                SlabProbe(unit_data, EMPTY_KEY) & INLINE_KEY_LANES_MASK;
+        if (empty_lanes) {
+            int32_t lane_empty = __builtin_ctz(empty_lanes);
+            unsigned long long old_pair = atomicCAS(
+                    (unsigned long long*)(slab + lane_empty), EMPTY_PAIR_64,
+                    MakePair64(key_bits, ValueToBits(value)));
+
+            /** Branch 2.1: SUCCEED **/
+            if (old_pair == EMPTY_PAIR_64) {
+                return true;
+            }
+            /** Branch 2.2: failed: RESTART on the same slab **/
+            continue;
+        }
+
+        /** Branch 3: nothing found in this slab, goto next slab **/
+        ptr_t next_slab_ptr = unit_data[NEXT_SLAB_PTR_LANE];
+
+        /** Branch 3.1: next slab existing, RESTART this lane **/
+        if (next_slab_ptr != EMPTY_SLAB_PTR) {
+            curr_slab_ptr = next_slab_ptr;
+            continue;
+        }
+
+        /** Branch 3.2: next slab empty, try to allocate one **/
+        ptr_t new_next_slab_ptr = AllocateSlab(curr_slab_ptr);
+        ptr_t old_next_slab_ptr = atomicCAS(slab + NEXT_SLAB_PTR_LANE,
+                                            EMPTY_SLAB_PTR, new_next_slab_ptr);
+
+        /** Branch 3.2.1: other thread allocated, RESTART lane **/
+        if (old_next_slab_ptr != EMPTY_SLAB_PTR) {
+            FreeSlab(new_next_slab_ptr);
+        }
+        /** Branch 3.2.2: this thread allocated, RESTART lane **/
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+bool SlabHashContext<_Key, _Value, _Hash, true>::Remove(
+        const uint32_t bucket_id, const _Key& key) {
+    ptr_t curr_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t unit_data[WARP_WIDTH];
+    const uint32_t key_bits = KeyToBits(key);
+
+    while (true) {
+        ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        for (uint32_t lane_id = 0; lane_id < WARP_WIDTH; ++lane_id) {
+            unit_data[lane_id] = AtomicLoad(slab + lane_id);
+        }
+
+        uint32_t found_lanes =
+                SlabProbe(unit_data, key_bits) & INLINE_KEY_LANES_MASK;
+
+        /** Branch 1: key found **/
+        if (found_lanes) {
+            int32_t lane_found = __builtin_ctz(found_lanes);
+            uint64_t pair_to_delete =
+                    MakePair64(key_bits, unit_data[lane_found + 1]);
+            unsigned long long old_pair =
+                    atomicCAS((unsigned long long*)(slab + lane_found),
+                              pair_to_delete, EMPTY_PAIR_64);
+
+            /** Branch 1.1: this thread reset **/
+            /** Branch 1.2: other thread did the job **/
+            return old_pair == pair_to_delete;
+        }
+
+        ptr_t next_slab_ptr = unit_data[NEXT_SLAB_PTR_LANE];
+        if (next_slab_ptr == EMPTY_SLAB_PTR) {
+            return false;
+        }
+        curr_slab_ptr = next_slab_ptr;
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+bool SlabHashContext<_Key, _Value, _Hash, true>::InsertOrAssign(
+        const uint32_t bucket_id, const _Key& key, const _Value& value) {
+    ptr_t curr_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t unit_data[WARP_WIDTH];
+    const uint32_t key_bits = KeyToBits(key);
+
+    while (true) {
+        ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        for (uint32_t lane_id = 0; lane_id < WARP_WIDTH; ++lane_id) {
+            unit_data[lane_id] = AtomicLoad(slab + lane_id);
+        }
+
+        /** Branch 1: key already existing, REPLACE the value **/
+        uint32_t found_lanes =
+                SlabProbe(unit_data, key_bits) & INLINE_KEY_LANES_MASK;
+        if (found_lanes) {
+            int32_t lane_found = __builtin_ctz(found_lanes);
+            atomicExch(slab + lane_found + 1, ValueToBits(value));
+            return false;
+        }
+
+        /** Branch 2: empty slot available, try to insert **/
+        uint32_t empty_lanes =
+                SlabProbe(unit_data, EMPTY_KEY) & INLINE_KEY_LANES_MASK;
+        if (empty_lanes) {
+            int32_t lane_empty = __builtin_ctz(empty_lanes);
+            unsigned long long old_pair = atomicCAS(
+                    (unsigned long long*)(slab + lane_empty), EMPTY_PAIR_64,
+                    MakePair64(key_bits, ValueToBits(value)));
+
+            /** Branch 2.1: SUCCEED **/
+            if (old_pair == EMPTY_PAIR_64) {
+                return true;
+            }
+            /** Branch 2.2: failed: RESTART on the same slab **/
+            continue;
+        }
+
+        /** Branch 3: nothing found in this slab, goto next slab **/
+        ptr_t next_slab_ptr = unit_data[NEXT_SLAB_PTR_LANE];
+
+        /** Branch 3.1: next slab existing, RESTART this lane **/
+        if (next_slab_ptr != EMPTY_SLAB_PTR) {
+            curr_slab_ptr = next_slab_ptr;
+            continue;
+        }
+
+        /** Branch 3.2: next slab empty, try to allocate one **/
+        ptr_t new_next_slab_ptr = AllocateSlab(curr_slab_ptr);
+        ptr_t old_next_slab_ptr = atomicCAS(slab + NEXT_SLAB_PTR_LANE,
+                                            EMPTY_SLAB_PTR, new_next_slab_ptr);
+
+        /** Branch 3.2.1: other thread allocated, RESTART lane **/
+        if (old_next_slab_ptr != EMPTY_SLAB_PTR) {
+            FreeSlab(new_next_slab_ptr);
+        }
+        /** Branch 3.2.2: this thread allocated, RESTART lane **/
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+template <typename _Reduce>
+bool SlabHashContext<_Key, _Value, _Hash, true>::InsertOrReduce(
+        const uint32_t bucket_id,
+        const _Key& key,
+        const _Value& value,
+        const _Reduce& reduce) {
+    ptr_t curr_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t unit_data[WARP_WIDTH];
+    const uint32_t key_bits = KeyToBits(key);
+
+    while (true) {
+        ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        for (uint32_t lane_id = 0; lane_id < WARP_WIDTH; ++lane_id) {
+            unit_data[lane_id] = AtomicLoad(slab + lane_id);
+        }
+
+        /** Branch 1: key already existing, COMBINE the values **/
+        uint32_t found_lanes =
+                SlabProbe(unit_data, key_bits) & INLINE_KEY_LANES_MASK;
+        if (found_lanes) {
+            int32_t lane_found = __builtin_ctz(found_lanes);
+            reduce(reinterpret_cast<_Value*>(slab + lane_found + 1), value);
+            return false;
+        }
+
+        /** Branch 2: empty slot available, try to insert **/
+        uint32_t empty_lanes =
+                SlabProbe(unit_data, EMPTY_KEY) & INLINE_KEY_LANES_MASK;
+        if (empty_lanes) {
+            int32_t lane_empty = __builtin_ctz(empty_lanes);
+            unsigned long long old_pair = atomicCAS(
+                    (unsigned long long*)(slab + lane_empty), EMPTY_PAIR_64,
+                    MakePair64(key_bits, ValueToBits(value)));
+
+            /** Branch 2.1: SUCCEED **/
+            if (old_pair == EMPTY_PAIR_64) {
+                return true;
+            }
+            /** Branch 2.2: failed: RESTART on the same slab **/
+            continue;
+        }
+
+        /** Branch 3: nothing found in this slab, goto next slab **/
+        ptr_t next_slab_ptr = unit_data[NEXT_SLAB_PTR_LANE];
+
+        /** Branch 3.1: next slab existing, RESTART this lane **/
+        if (next_slab_ptr != EMPTY_SLAB_PTR) {
+            curr_slab_ptr = next_slab_ptr;
+            continue;
+        }
+
+        /** Branch 3.2: next slab empty, try to allocate one **/
+        ptr_t new_next_slab_ptr = AllocateSlab(curr_slab_ptr);
+        ptr_t old_next_slab_ptr = atomicCAS(slab + NEXT_SLAB_PTR_LANE,
+                                            EMPTY_SLAB_PTR, new_next_slab_ptr);
+
+        /** Branch 3.2.1: other thread allocated, RESTART lane **/
+        if (old_next_slab_ptr != EMPTY_SLAB_PTR) {
+            FreeSlab(new_next_slab_ptr);
+        }
+        /** Branch 3.2.2: this thread allocated, RESTART lane **/
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+bool SlabHashContext<_Key, _Value, _Hash, true>::UpdateExisting(
+        const uint32_t bucket_id, const _Key& key, const _Value& value) {
+    ptr_t curr_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t unit_data[WARP_WIDTH];
+    const uint32_t key_bits = KeyToBits(key);
+
+    while (true) {
+        ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        for (uint32_t lane_id = 0; lane_id < WARP_WIDTH; ++lane_id) {
+            unit_data[lane_id] = AtomicLoad(slab + lane_id);
+        }
+
+        uint32_t found_lanes =
+                SlabProbe(unit_data, key_bits) & INLINE_KEY_LANES_MASK;
+
+        /** 1. Found in this slab, REPLACE the value **/
+        if (found_lanes) {
+            int32_t lane_found = __builtin_ctz(found_lanes);
+            atomicExch(slab + lane_found + 1, ValueToBits(value));
+            return true;
+        }
+
+        /** 2. Not found in this slab **/
+        ptr_t next_slab_ptr = unit_data[NEXT_SLAB_PTR_LANE];
+        if (next_slab_ptr == EMPTY_SLAB_PTR) {
+            return false;
+        }
+        curr_slab_ptr = next_slab_ptr;
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHashContext<_Key, _Value, _Hash, true>::InsertPairBits(
+        const uint32_t bucket_id, const uint64_t pair) {
+    ptr_t curr_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t unit_data[WARP_WIDTH];
+
+    while (true) {
+        ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        for (uint32_t lane_id = 0; lane_id < WARP_WIDTH; ++lane_id) {
+            unit_data[lane_id] = AtomicLoad(slab + lane_id);
+        }
+
+        /** Branch 2: empty slot available, try to insert **/
+        uint32_t empty_lanes =
+                SlabProbe(unit_data, EMPTY_KEY) & INLINE_KEY_LANES_MASK;
+        if (empty_lanes) {
+            int32_t lane_empty = __builtin_ctz(empty_lanes);
+            unsigned long long old_pair =
+                    atomicCAS((unsigned long long*)(slab + lane_empty),
+                              EMPTY_PAIR_64, pair);
+
+            /** Branch 2.1: SUCCEED **/
+            if (old_pair == EMPTY_PAIR_64) {
+                return;
+            }
+            /** Branch 2.2: failed: RESTART on the same slab **/
+            continue;
+        }
+
+        /** Branch 3: no empty slot in this slab, goto next slab **/
+        ptr_t next_slab_ptr = unit_data[NEXT_SLAB_PTR_LANE];
+
+        /** Branch 3.1: next slab existing, RESTART this lane **/
+        if (next_slab_ptr != EMPTY_SLAB_PTR) {
+            curr_slab_ptr = next_slab_ptr;
+            continue;
+        }
+
+        /** Branch 3.2: next slab empty, try to allocate one **/
+        ptr_t new_next_slab_ptr = AllocateSlab(curr_slab_ptr);
+        ptr_t old_next_slab_ptr = atomicCAS(slab + NEXT_SLAB_PTR_LANE,
+                                            EMPTY_SLAB_PTR, new_next_slab_ptr);
+
+        /** Branch 3.2.1: other thread allocated, RESTART lane **/
+        if (old_next_slab_ptr != EMPTY_SLAB_PTR) {
+            FreeSlab(new_next_slab_ptr);
+        }
+        /** Branch 3.2.2: this thread allocated, RESTART lane **/
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHashContext<_Key, _Value, _Hash, true>::FreeChain(
+        const uint32_t bucket_id) {
+    ptr_t next_slab_ptr =
+            *get_unit_ptr_from_list_head(bucket_id, NEXT_SLAB_PTR_LANE);
+    while (next_slab_ptr != EMPTY_SLAB_PTR) {
+        ptr_t curr_slab_ptr = next_slab_ptr;
+        ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        next_slab_ptr = slab[NEXT_SLAB_PTR_LANE];
+        FreeSlab(curr_slab_ptr);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHashContext<_Key, _Value, _Hash, true>::SplitBucket(
+        const uint32_t bucket_id) {
+    const uint32_t split_bucket_id = bucket_id + num_buckets_;
+    ptr_t curr_slab_ptr = HEAD_SLAB_PTR;
+
+    while (curr_slab_ptr != EMPTY_SLAB_PTR) {
+        ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        uint32_t key_lanes =
+                ~SlabProbe(slab, EMPTY_KEY) & INLINE_KEY_LANES_MASK;
+        while (key_lanes) {
+            int32_t lane_id = __builtin_ctz(key_lanes);
+            if (ComputeSplitBucket(BitsToKey(slab[lane_id])) ==
+                split_bucket_id) {
+                InsertPairBits(split_bucket_id,
+                               MakePair64(slab[lane_id], slab[lane_id + 1]));
+                slab[lane_id] = EMPTY_KEY;
+                slab[lane_id + 1] = EMPTY_KEY;
+            }
+            key_lanes &= key_lanes - 1;
+        }
+        curr_slab_ptr = slab[NEXT_SLAB_PTR_LANE];
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHashContext<_Key, _Value, _Hash, true>::CompactBucket(
+        const uint32_t bucket_id) {
+    ptr_t src_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t dst_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t prev_dst_slab_ptr = EMPTY_SLAB_PTR;
+    uint32_t dst_count = 0;
+
+    while (src_slab_ptr != EMPTY_SLAB_PTR) {
+        ptr_t* slab = get_slab_ptr(bucket_id, src_slab_ptr);
+        for (uint32_t lane_id = 0; lane_id < 2 * INLINE_PAIRS_PER_SLAB;
+             lane_id += 2) {
+            if (slab[lane_id] == EMPTY_KEY) continue;
+
+            /* Never past the source lanes, which were just read */
+            ptr_t* dst_slab = get_slab_ptr(bucket_id, dst_slab_ptr);
+            dst_slab[2 * dst_count] = slab[lane_id];
+            dst_slab[2 * dst_count + 1] = slab[lane_id + 1];
+            if (++dst_count == INLINE_PAIRS_PER_SLAB) {
+                prev_dst_slab_ptr = dst_slab_ptr;
+                dst_slab_ptr = dst_slab[NEXT_SLAB_PTR_LANE];
+                dst_count = 0;
+            }
+        }
+        src_slab_ptr = slab[NEXT_SLAB_PTR_LANE];
+    }
+
+    /* Cut the chain after the last non-empty slab, and free the rest */
+    ptr_t* last_slab;
+    if (dst_count == 0 && dst_slab_ptr != HEAD_SLAB_PTR) {
+        last_slab = get_slab_ptr(bucket_id, prev_dst_slab_ptr);
+    } else {
+        last_slab = get_slab_ptr(bucket_id, dst_slab_ptr);
+        std::fill(last_slab + 2 * dst_count,
+                  last_slab + 2 * INLINE_PAIRS_PER_SLAB, EMPTY_KEY);
+    }
+    ptr_t free_slab_ptr = last_slab[NEXT_SLAB_PTR_LANE];
+    last_slab[NEXT_SLAB_PTR_LANE] = EMPTY_SLAB_PTR;
+    while (free_slab_ptr != EMPTY_SLAB_PTR) {
+        ptr_t next_slab_ptr =
+                get_slab_ptr(bucket_id, free_slab_ptr)[NEXT_SLAB_PTR_LANE];
+        FreeSlab(free_slab_ptr);
+        free_slab_ptr = next_slab_ptr;
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SlabHashContext<_Key, _Value, _Hash, true>::BuildBucket(
+        const uint32_t bucket_id,
+        const _Key* keys,
+        const _Value* values,
+        const uint32_t* order,
+        const uint32_t num_keys) {
+    /** Branch 1: find the tail slab and the key lane after its last pair **/
+    ptr_t tail_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t* slab = get_slab_ptr(bucket_id, tail_slab_ptr);
+    while (slab[NEXT_SLAB_PTR_LANE] != EMPTY_SLAB_PTR) {
+        tail_slab_ptr = slab[NEXT_SLAB_PTR_LANE];
+        slab = get_slab_ptr(bucket_id, tail_slab_ptr);
+    }
+    uint32_t used_lanes =
+            ~SlabProbe(slab, EMPTY_KEY) & INLINE_KEY_LANES_MASK;
+    uint32_t tail_lane = used_lanes ? 33 - __builtin_clz(used_lanes) : 0;
+
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        /** Branch 2: drop the keys in the chain, including earlier ones **/
+        const uint32_t key_bits = KeyToBits(keys[order[i]]);
+        if (key_bits == EMPTY_KEY || Search(bucket_id, keys[order[i]]).second) {
+            continue;
+        }
+
+        /** Branch 3: append it, linking a new slab to a full tail **/
+        if (tail_lane == 2 * INLINE_PAIRS_PER_SLAB) {
+            ptr_t new_slab_ptr = AllocateSlab(tail_slab_ptr);
+            slab[NEXT_SLAB_PTR_LANE] = new_slab_ptr;
+            tail_slab_ptr = new_slab_ptr;
+            slab = get_slab_ptr(bucket_id, tail_slab_ptr);
+            tail_lane = 0;
+        }
+        slab[tail_lane + 1] = ValueToBits(values[order[i]]);
+        slab[tail_lane] = key_bits;
+        tail_lane += 2;
+    }
+}
+
+/**
+ * Host kernels, see slab_hash_host.h
+ */
+template <typename _Key, typename _Value, typename _Hash>
+void SearchInlineKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        _Key* keys,
+        const uint32_t* order,
+        _Value* values,
+        uint8_t* founds,
+        uint32_t begin,
+        uint32_t end,
+        uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t j = begin; j < end; ++j) {
+        const uint32_t i = order ? order[j] : j;
+        if (slab_hash_ctx.KeyToBits(keys[i]) == EMPTY_KEY) {
+            founds[i] = false;
+            values[i] = _Value(0);
+            continue;
+        }
+
+        pair_t<_Value, bool> result = slab_hash_ctx.Search(
+                slab_hash_ctx.ComputeBucket(keys[i]), keys[i]);
+        founds[i] = result.second;
+        values[i] = result.first;
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void InsertInlineKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        _Key* keys,
+        _Value* values,
+        uint32_t begin,
+        uint32_t end,
+        uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t i = begin; i < end; ++i) {
+        if (slab_hash_ctx.KeyToBits(keys[i]) == EMPTY_KEY) continue;
+        slab_hash_ctx.Insert(slab_hash_ctx.ComputeBucket(keys[i]), keys[i],
+                             values[i]);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void RemoveInlineKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        _Key* keys,
+        uint32_t begin,
+        uint32_t end,
+        uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t i = begin; i < end; ++i) {
+        if (slab_hash_ctx.KeyToBits(keys[i]) == EMPTY_KEY) continue;
+        slab_hash_ctx.Remove(slab_hash_ctx.ComputeBucket(keys[i]), keys[i]);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void InsertOrAssignInlineKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        _Key* keys,
+        _Value* values,
+        uint32_t begin,
+        uint32_t end,
+        uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t i = begin; i < end; ++i) {
+        if (slab_hash_ctx.KeyToBits(keys[i]) == EMPTY_KEY) continue;
+        slab_hash_ctx.InsertOrAssign(slab_hash_ctx.ComputeBucket(keys[i]),
+                                     keys[i], values[i]);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash, typename _Reduce>
+void InsertOrReduceInlineKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        _Key* keys,
+        _Value* values,
+        uint32_t begin,
+        uint32_t end,
+        uint32_t worker_id,
+        _Reduce reduce) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t i = begin; i < end; ++i) {
+        if (slab_hash_ctx.KeyToBits(keys[i]) == EMPTY_KEY) continue;
+        slab_hash_ctx.InsertOrReduce(slab_hash_ctx.ComputeBucket(keys[i]),
+                                     keys[i], values[i], reduce);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void UpdateExistingInlineKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        _Key* keys,
+        _Value* values,
+        uint32_t begin,
+        uint32_t end,
+        uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t i = begin; i < end; ++i) {
+        if (slab_hash_ctx.KeyToBits(keys[i]) == EMPTY_KEY) continue;
+        slab_hash_ctx.UpdateExisting(slab_hash_ctx.ComputeBucket(keys[i]),
+                                     keys[i], values[i]);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void BucketCountInlineKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        uint32_t* d_count_result,
+        uint32_t begin,
+        uint32_t end) {
+    for (uint32_t bucket_id = begin; bucket_id < end; ++bucket_id) {
+        uint32_t count = 0;
+
+        const ptr_t* slab =
+                slab_hash_ctx.get_unit_ptr_from_list_head(bucket_id, 0);
+        while (true) {
+            count += INLINE_PAIRS_PER_SLAB -
+                     __builtin_popcount(SlabProbe(slab, EMPTY_KEY) &
+                                        INLINE_KEY_LANES_MASK);
+            ptr_t next = slab[NEXT_SLAB_PTR_LANE];
+            if (next == EMPTY_SLAB_PTR) break;
+            slab = slab_hash_ctx.get_unit_ptr_from_list_nodes(next, 0);
+        }
+
+        d_count_result[bucket_id] = count;
+    }
+}
+
+/* Host counterparts of ExportInlineKernel and ForEachInlineKernel */
+template <typename _Key, typename _Value, typename _Hash>
+void ExportInlineKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        const uint32_t* d_offsets,
+        _Key* keys,
+        _Value* values,
+        uint32_t begin,
+        uint32_t end) {
+    for (uint32_t bucket_id = begin; bucket_id < end; ++bucket_id) {
+        uint32_t offset = d_offsets[bucket_id];
+
+        const ptr_t* slab =
+                slab_hash_ctx.get_unit_ptr_from_list_head(bucket_id, 0);
+        while (true) {
+            uint32_t key_lanes =
+                    ~SlabProbe(slab, EMPTY_KEY) & INLINE_KEY_LANES_MASK;
+            while (key_lanes) {
+                int32_t lane_id = __builtin_ctz(key_lanes);
+                if (keys) {
+                    keys[offset] = slab_hash_ctx.BitsToKey(slab[lane_id]);
+                }
+                if (values) {
+                    values[offset] =
+                            slab_hash_ctx.BitsToValue(slab[lane_id + 1]);
+                }
+                ++offset;
+                key_lanes &= key_lanes - 1;
+            }
+            ptr_t next = slab[NEXT_SLAB_PTR_LANE];
+            if (next == EMPTY_SLAB_PTR) break;
+            slab = slab_hash_ctx.get_unit_ptr_from_list_nodes(next, 0);
+        }
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash, typename _Func>
+void ForEachInlineKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        _Func& func,
+        uint32_t begin,
+        uint32_t end) {
+    for (uint32_t bucket_id = begin; bucket_id < end; ++bucket_id) {
+        ptr_t* slab = slab_hash_ctx.get_unit_ptr_from_list_head(bucket_id, 0);
+        while (true) {
+            uint32_t key_lanes =
+                    ~SlabProbe(slab, EMPTY_KEY) & INLINE_KEY_LANES_MASK;
+            while (key_lanes) {
+                int32_t lane_id = __builtin_ctz(key_lanes);
+                func(slab_hash_ctx.BitsToKey(slab[lane_id]),
+                     *reinterpret_cast<_Value*>(slab + lane_id + 1));
+                key_lanes &= key_lanes - 1;
+            }
+            ptr_t next = slab[NEXT_SLAB_PTR_LANE];
+            if (next == EMPTY_SLAB_PTR) break;
+            slab = slab_hash_ctx.get_unit_ptr_from_list_nodes(next, 0);
+        }
+    }
+}
+
+/* Host counterparts of RehashInlineKernel, FreeChainsInlineKernel,
+ * SplitInlineKernel, CompactInlineKernel and BulkBuildInlineKernel */
+template <typename _Key, typename _Value, typename _Hash>
+void RehashInlineKernelHost(SlabHashContext<_Key, _Value, _Hash, true> old_ctx,
+                            SlabHashContext<_Key, _Value, _Hash, true> new_ctx,
+                            uint32_t begin,
+                            uint32_t end,
+                            uint32_t worker_id) {
+    new_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t bucket_id = begin; bucket_id < end; ++bucket_id) {
+        const ptr_t* slab = old_ctx.get_unit_ptr_from_list_head(bucket_id, 0);
+        while (true) {
+            uint32_t key_lanes =
+                    ~SlabProbe(slab, EMPTY_KEY) & INLINE_KEY_LANES_MASK;
+            while (key_lanes) {
+                int32_t lane_id = __builtin_ctz(key_lanes);
+                new_ctx.InsertPairBits(
+                        new_ctx.ComputeBucket(old_ctx.BitsToKey(slab[lane_id])),
+                        old_ctx.MakePair64(slab[lane_id], slab[lane_id + 1]));
+                key_lanes &= key_lanes - 1;
+            }
+            ptr_t next = slab[NEXT_SLAB_PTR_LANE];
+            if (next == EMPTY_SLAB_PTR) break;
+            slab = old_ctx.get_unit_ptr_from_list_nodes(next, 0);
+        }
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void FreeChainsInlineKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        uint32_t begin,
+        uint32_t end) {
+    for (uint32_t bucket_id = begin; bucket_id < end; ++bucket_id) {
+        slab_hash_ctx.FreeChain(bucket_id);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void SplitInlineKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        uint32_t first_bucket,
+        uint32_t begin,
+        uint32_t end,
+        uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t i = begin; i < end; ++i) {
+        slab_hash_ctx.SplitBucket(first_bucket + i);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void CompactInlineKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        uint32_t begin,
+        uint32_t end,
+        uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t bucket_id = begin; bucket_id < end; ++bucket_id) {
+        slab_hash_ctx.CompactBucket(bucket_id);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void BulkBuildInlineKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        const _Key* keys,
+        const _Value* values,
+        const uint32_t* offsets,
+        const uint32_t* order,
+        uint32_t begin,
+        uint32_t end,
+        uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t bucket_id = begin; bucket_id < end; ++bucket_id) {
+        slab_hash_ctx.BuildBucket(bucket_id, keys, values,
+                                  order + offsets[bucket_id],
+                                  offsets[bucket_id + 1] - offsets[bucket_id]);
+    }
+}
+
+template <typename _Key, typename _Value, typename _Hash>
+void MarkReservedKeysInlineKernelHost(
+        SlabHashContext<_Key, _Value, _Hash, true> slab_hash_ctx,
+        const _Key* keys,
+        uint8_t* statuses,
+        uint32_t begin,
+        uint32_t end) {
+    for (uint32_t i = begin; i < end; ++i) {
+        if (slab_hash_ctx.KeyToBits(keys[i]) != EMPTY_KEY) continue;
+        assert(statuses && "EMPTY_KEY is reserved in the inline layout");
+        if (statuses) statuses[i] = STATUS_RESERVED_KEY;
+    }
+}
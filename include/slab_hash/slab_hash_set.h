@@ -0,0 +1,832 @@
+/*
+ * Copyright 2019 Saman Ashkiani
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Key-only counterpart of SlabHash: the slabs, the slab allocator and the
+ * fingerprint encoding are the same, but the pool stores keys alone
+ * (MemoryAlloc<_Key>), and only membership is supported.
+ */
+
+#include "slab_hash.h"
+
+/**
+ * Interface
+ **/
+template <typename _Key, typename _Hash>
+class SlabHashSetContext;
+
+template <typename _Key, typename _Hash>
+class SlabHashSet {
+public:
+    SlabHashSet(const uint32_t max_bucket_count,
+                const uint32_t max_key_count,
+                uint32_t device_idx,
+                bool use_fingerprints = false);
+
+    ~SlabHashSet();
+
+    double ComputeLoadFactor(int flag = 0);
+
+    void Insert(_Key* keys, uint32_t num_keys);
+    void Contains(_Key* keys, uint8_t* founds, uint32_t num_keys);
+    void Remove(_Key* keys, uint32_t num_keys);
+
+private:
+    uint32_t num_buckets_;
+
+    Slab* bucket_list_head_;
+
+    SlabHashSetContext<_Key, _Hash> gpu_context_;
+
+    std::shared_ptr<MemoryAlloc<_Key>> key_allocator_;
+    std::shared_ptr<SlabAlloc> slab_list_allocator_;
+
+    uint32_t device_idx_;
+};
+
+/**
+ * Implementation
+ **/
+template <typename _Key, typename _Hash>
+class SlabHashSetContext {
+public:
+    SlabHashSetContext();
+    __host__ void Setup(Slab* bucket_list_head,
+                        const uint32_t num_buckets,
+                        const SlabAllocContext& allocator_ctx,
+                        const MemoryAllocContext<_Key>& key_allocator_ctx,
+                        const uint32_t fingerprint_bits = 0);
+
+    /* Core SIMT operations */
+    __device__ bool Insert(bool& lane_active,
+                           const uint32_t lane_id,
+                           const uint32_t bucket_id,
+                           const _Key& key);
+
+    __device__ bool Contains(bool& lane_active,
+                             const uint32_t lane_id,
+                             const uint32_t bucket_id,
+                             const _Key& key);
+
+    __device__ bool Remove(bool& lane_active,
+                           const uint32_t lane_id,
+                           const uint32_t bucket_id,
+                           const _Key& key);
+
+#ifdef SLABHASH_BACKEND_CPU
+    /* Core scalar operations, one key per host thread */
+    bool Insert(const uint32_t bucket_id, const _Key& key);
+    bool Contains(const uint32_t bucket_id, const _Key& key);
+    bool Remove(const uint32_t bucket_id, const _Key& key);
+#endif
+
+    /* Hash function */
+    __device__ __host__ uint32_t ComputeBucket(const _Key& key) const;
+
+    /* Fingerprints, see SlabHashContext */
+    __device__ __host__ uint32_t ComputeFingerprint(const _Key& key) const;
+    __device__ __host__ __forceinline__ ptr_t
+    EncodeKeyPtr(const ptr_t key_ptr, const uint32_t fingerprint) const {
+        return key_ptr | fingerprint;
+    }
+    __device__ __host__ __forceinline__ ptr_t
+    DecodeKeyPtr(const ptr_t unit_data) const {
+        return unit_data & ~fingerprint_mask_;
+    }
+
+    __device__ __host__ SlabAllocContext& get_slab_alloc_ctx() {
+        return slab_list_allocator_ctx_;
+    }
+    __device__ __host__ MemoryAllocContext<_Key> get_key_alloc_ctx() {
+        return key_allocator_ctx_;
+    }
+
+    __device__ __forceinline__ ptr_t* get_unit_ptr_from_list_nodes(
+            const ptr_t slab_ptr, const uint32_t lane_id) {
+        return slab_list_allocator_ctx_.get_unit_ptr_from_slab(slab_ptr,
+                                                               lane_id);
+    }
+    __device__ __forceinline__ ptr_t* get_unit_ptr_from_list_head(
+            const uint32_t bucket_id, const uint32_t lane_id) {
+        return reinterpret_cast<uint32_t*>(bucket_list_head_) +
+               bucket_id * BASE_UNIT_SIZE + lane_id;
+    }
+
+private:
+    __device__ __forceinline__ void WarpSyncKey(const _Key& key,
+                                                const uint32_t lane_id,
+                                                _Key& ret);
+    __device__ __forceinline__ int32_t WarpFindKey(const _Key& src_key,
+                                                   const uint32_t fingerprint,
+                                                   const uint32_t lane_id,
+                                                   const uint32_t unit_data);
+    __device__ __forceinline__ int32_t WarpFindEmpty(const uint32_t unit_data);
+
+    __device__ __forceinline__ ptr_t AllocateSlab(const uint32_t lane_id);
+
+#ifdef SLABHASH_BACKEND_CPU
+    int32_t FindKey(const _Key& key,
+                    const uint32_t fingerprint,
+                    const ptr_t* slab,
+                    const uint32_t empty_lanes);
+
+    ptr_t* get_slab_ptr(const uint32_t bucket_id, const ptr_t slab_ptr);
+    ptr_t AllocateSlab();
+#endif
+    __device__ __forceinline__ void FreeSlab(const ptr_t slab_ptr);
+
+private:
+    uint32_t num_buckets_;
+    _Hash hash_fn_;
+
+    /* High bits of a slab word holding a fingerprint, 0 if disabled */
+    uint32_t fingerprint_mask_;
+
+    Slab* bucket_list_head_;
+    SlabAllocContext slab_list_allocator_ctx_;
+    MemoryAllocContext<_Key> key_allocator_ctx_;
+};
+
+/**
+ * Definitions
+ **/
+template <typename _Key, typename _Hash>
+SlabHashSetContext<_Key, _Hash>::SlabHashSetContext()
+    : num_buckets_(0), fingerprint_mask_(0), bucket_list_head_(nullptr) {}
+
+template <typename _Key, typename _Hash>
+__host__ void SlabHashSetContext<_Key, _Hash>::Setup(
+        Slab* bucket_list_head,
+        const uint32_t num_buckets,
+        const SlabAllocContext& allocator_ctx,
+        const MemoryAllocContext<_Key>& key_allocator_ctx,
+        const uint32_t fingerprint_bits /* = 0 */) {
+    bucket_list_head_ = bucket_list_head;
+
+    num_buckets_ = num_buckets;
+    slab_list_allocator_ctx_ = allocator_ctx;
+    key_allocator_ctx_ = key_allocator_ctx;
+
+    assert(fingerprint_bits <= MAX_FINGERPRINT_BITS);
+    fingerprint_mask_ = ~(0xFFFFFFFF >> fingerprint_bits);
+}
+
+template <typename _Key, typename _Hash>
+__device__ __host__ __forceinline__ uint32_t
+SlabHashSetContext<_Key, _Hash>::ComputeBucket(const _Key& key) const {
+    return hash_fn_(key) % num_buckets_;
+}
+
+template <typename _Key, typename _Hash>
+__device__ __host__ __forceinline__ uint32_t
+SlabHashSetContext<_Key, _Hash>::ComputeFingerprint(const _Key& key) const {
+    uint64_t mixed = uint64_t(hash_fn_(key)) * UINT64_C(0x9E3779B97F4A7C15);
+    return uint32_t(mixed >> 32) & fingerprint_mask_;
+}
+
+template <typename _Key, typename _Hash>
+__device__ __forceinline__ void SlabHashSetContext<_Key, _Hash>::WarpSyncKey(
+        const _Key& key, const uint32_t lane_id, _Key& ret) {
+    const int chunks = sizeof(_Key) / sizeof(int);
+#pragma unroll 1
+    for (size_t i = 0; i < chunks; ++i) {
+        ((int*)(&ret))[i] = __shfl_sync(ACTIVE_LANES_MASK, ((int*)(&key))[i],
+                                        lane_id, WARP_WIDTH);
+    }
+}
+
+template <typename _Key, typename _Hash>
+__device__ int32_t SlabHashSetContext<_Key, _Hash>::WarpFindKey(
+        const _Key& key,
+        const uint32_t fingerprint,
+        const uint32_t lane_id,
+        const ptr_t ptr) {
+    bool is_lane_found =
+            /* select key lanes */
+            ((1 << lane_id) & PAIR_PTR_LANES_MASK)
+            /* validate key addrs */
+            && (ptr != EMPTY_PAIR_PTR)
+            /* filter by fingerprint */
+            && (ptr & fingerprint_mask_) == fingerprint
+            /* find keys in memory heap */
+            && key_allocator_ctx_.extract(DecodeKeyPtr(ptr)) == key;
+
+    return __ffs(__ballot_sync(PAIR_PTR_LANES_MASK, is_lane_found)) - 1;
+}
+
+template <typename _Key, typename _Hash>
+__device__ __forceinline__ int32_t
+SlabHashSetContext<_Key, _Hash>::WarpFindEmpty(const ptr_t ptr) {
+    bool is_lane_empty = (ptr == EMPTY_PAIR_PTR);
+
+    return __ffs(__ballot_sync(PAIR_PTR_LANES_MASK, is_lane_empty)) - 1;
+}
+
+template <typename _Key, typename _Hash>
+__device__ __forceinline__ ptr_t
+SlabHashSetContext<_Key, _Hash>::AllocateSlab(const uint32_t lane_id) {
+    return slab_list_allocator_ctx_.WarpAllocate(lane_id);
+}
+
+template <typename _Key, typename _Hash>
+__device__ __forceinline__ void SlabHashSetContext<_Key, _Hash>::FreeSlab(
+        const ptr_t slab_ptr) {
+    slab_list_allocator_ctx_.FreeUntouched(slab_ptr);
+}
+
+template <typename _Key, typename _Hash>
+__device__ bool SlabHashSetContext<_Key, _Hash>::Contains(
+        bool& to_search,
+        const uint32_t lane_id,
+        const uint32_t bucket_id,
+        const _Key& query_key) {
+    uint32_t work_queue = 0;
+    uint32_t prev_work_queue = work_queue;
+    uint32_t curr_slab_ptr = HEAD_SLAB_PTR;
+
+    bool mask = false;
+
+    /** > Loop when we have active lanes **/
+    while ((work_queue = __ballot_sync(ACTIVE_LANES_MASK, to_search))) {
+        /** 0. Restart from linked list head if the last query is finished **/
+        curr_slab_ptr =
+                (prev_work_queue != work_queue) ? HEAD_SLAB_PTR : curr_slab_ptr;
+        uint32_t src_lane = __ffs(work_queue) - 1;
+        uint32_t src_bucket =
+                __shfl_sync(ACTIVE_LANES_MASK, bucket_id, src_lane, WARP_WIDTH);
+
+        _Key src_key;
+        WarpSyncKey(query_key, src_lane, src_key);
+        uint32_t src_fingerprint = ComputeFingerprint(src_key);
+
+        /* Each lane in the warp reads a uint in the slab in parallel */
+        const uint32_t unit_data =
+                (curr_slab_ptr == HEAD_SLAB_PTR)
+                        ? *(get_unit_ptr_from_list_head(src_bucket, lane_id))
+                        : *(get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                         lane_id));
+
+        int32_t lane_found =
+                WarpFindKey(src_key, src_fingerprint, lane_id, unit_data);
+
+        /** 1. Found in this slab, SUCCEED **/
+        if (lane_found >= 0) {
+            if (lane_id == src_lane) {
+                to_search = false;
+                mask = true;
+            }
+        }
+
+        /** 2. Not found in this slab **/
+        else {
+            /* broadcast next slab: lane 31 reads 'next' */
+            ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                              NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+
+            /** 2.1. Next slab is empty, ABORT **/
+            if (next_slab_ptr == EMPTY_SLAB_PTR) {
+                if (lane_id == src_lane) {
+                    to_search = false;
+                }
+            }
+            /** 2.2. Next slab exists, RESTART **/
+            else {
+                curr_slab_ptr = next_slab_ptr;
+            }
+        }
+
+        prev_work_queue = work_queue;
+    }
+
+    return mask;
+}
+
+/*
+ * Insert: ABORT if found
+ */
+template <typename _Key, typename _Hash>
+__device__ bool SlabHashSetContext<_Key, _Hash>::Insert(
+        bool& to_be_inserted,
+        const uint32_t lane_id,
+        const uint32_t bucket_id,
+        const _Key& key) {
+    uint32_t work_queue = 0;
+    uint32_t prev_work_queue = 0;
+    uint32_t curr_slab_ptr = HEAD_SLAB_PTR;
+
+    bool mask = false;
+
+    /** WARNING: Allocation should be finished in warp,
+     * results are unexpected otherwise **/
+    ptr_t prealloc_key_internal_ptr = EMPTY_PAIR_PTR;
+    if (to_be_inserted) {
+        prealloc_key_internal_ptr = key_allocator_ctx_.Allocate();
+
+        /** Key pool full: ABORT **/
+        if (prealloc_key_internal_ptr == EMPTY_PAIR_PTR) {
+            to_be_inserted = false;
+        } else {
+            key_allocator_ctx_.extract(prealloc_key_internal_ptr) = key;
+        }
+    }
+
+    /** > Loop when we have active lanes **/
+    while ((work_queue = __ballot_sync(ACTIVE_LANES_MASK, to_be_inserted))) {
+        /** 0. Restart from linked list head if last insertion is finished **/
+        curr_slab_ptr =
+                (prev_work_queue != work_queue) ? HEAD_SLAB_PTR : curr_slab_ptr;
+        uint32_t src_lane = __ffs(work_queue) - 1;
+        uint32_t src_bucket =
+                __shfl_sync(ACTIVE_LANES_MASK, bucket_id, src_lane, WARP_WIDTH);
+        _Key src_key;
+        WarpSyncKey(key, src_lane, src_key);
+        uint32_t src_fingerprint = ComputeFingerprint(src_key);
+
+        /* Each lane in the warp reads a uint in the slab */
+        uint32_t unit_data =
+                (curr_slab_ptr == HEAD_SLAB_PTR)
+                        ? *(get_unit_ptr_from_list_head(src_bucket, lane_id))
+                        : *(get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                         lane_id));
+
+        int32_t lane_found =
+                WarpFindKey(src_key, src_fingerprint, lane_id, unit_data);
+        int32_t lane_empty = WarpFindEmpty(unit_data);
+
+        /** Branch 1: key already existing, ABORT **/
+        if (lane_found >= 0) {
+            if (lane_id == src_lane) {
+                /* free memory heap */
+                to_be_inserted = false;
+                key_allocator_ctx_.Free(prealloc_key_internal_ptr);
+            }
+        }
+
+        /** Branch 2: empty slot available, try to insert **/
+        else if (lane_empty >= 0) {
+            if (lane_id == src_lane) {
+                const uint32_t* unit_data_ptr =
+                        (curr_slab_ptr == HEAD_SLAB_PTR)
+                                ? get_unit_ptr_from_list_head(src_bucket,
+                                                              lane_empty)
+                                : get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                               lane_empty);
+                ptr_t old_key_internal_ptr = atomicCAS(
+                        (unsigned int*)unit_data_ptr, EMPTY_PAIR_PTR,
+                        EncodeKeyPtr(prealloc_key_internal_ptr,
+                                     src_fingerprint));
+
+                /** Branch 2.1: SUCCEED **/
+                if (old_key_internal_ptr == EMPTY_PAIR_PTR) {
+                    to_be_inserted = false;
+                    mask = true;
+                }
+                /** Branch 2.2: failed: RESTART **/
+            }
+        }
+
+        /** Branch 3: nothing found in this slab, goto next slab **/
+        else {
+            /* broadcast next slab */
+            ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                              NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+
+            /** Branch 3.1: next slab existing, RESTART this lane **/
+            if (next_slab_ptr != EMPTY_SLAB_PTR) {
+                curr_slab_ptr = next_slab_ptr;
+            }
+
+            /** Branch 3.2: next slab empty, try to allocate one **/
+            else {
+                ptr_t new_next_slab_ptr = AllocateSlab(lane_id);
+
+                if (lane_id == NEXT_SLAB_PTR_LANE) {
+                    const uint32_t* unit_data_ptr =
+                            (curr_slab_ptr == HEAD_SLAB_PTR)
+                                    ? get_unit_ptr_from_list_head(
+                                              src_bucket, NEXT_SLAB_PTR_LANE)
+                                    : get_unit_ptr_from_list_nodes(
+                                              curr_slab_ptr,
+                                              NEXT_SLAB_PTR_LANE);
+
+                    ptr_t old_next_slab_ptr =
+                            atomicCAS((unsigned int*)unit_data_ptr,
+                                      EMPTY_SLAB_PTR, new_next_slab_ptr);
+
+                    /** Branch 3.2.1: other thread allocated, RESTART lane **/
+                    if (old_next_slab_ptr != EMPTY_SLAB_PTR) {
+                        FreeSlab(new_next_slab_ptr);
+                    }
+                    /** Branch 3.2.2: this thread allocated, RESTART lane **/
+                }
+            }
+        }
+
+        prev_work_queue = work_queue;
+    }
+
+    return mask;
+}
+
+template <typename _Key, typename _Hash>
+__device__ bool SlabHashSetContext<_Key, _Hash>::Remove(
+        bool& to_be_deleted,
+        const uint32_t lane_id,
+        const uint32_t bucket_id,
+        const _Key& key) {
+    uint32_t work_queue = 0;
+    uint32_t prev_work_queue = 0;
+    uint32_t curr_slab_ptr = HEAD_SLAB_PTR;
+
+    bool mask = false;
+
+    /** > Loop when we have active lanes **/
+    while ((work_queue = __ballot_sync(ACTIVE_LANES_MASK, to_be_deleted))) {
+        /** 0. Restart from linked list head if last deletion is finished **/
+        curr_slab_ptr =
+                (prev_work_queue != work_queue) ? HEAD_SLAB_PTR : curr_slab_ptr;
+        uint32_t src_lane = __ffs(work_queue) - 1;
+        uint32_t src_bucket =
+                __shfl_sync(ACTIVE_LANES_MASK, bucket_id, src_lane, WARP_WIDTH);
+
+        _Key src_key;
+        WarpSyncKey(key, src_lane, src_key);
+        uint32_t src_fingerprint = ComputeFingerprint(src_key);
+
+        const uint32_t unit_data =
+                (curr_slab_ptr == HEAD_SLAB_PTR)
+                        ? *(get_unit_ptr_from_list_head(src_bucket, lane_id))
+                        : *(get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                         lane_id));
+
+        int32_t lane_found =
+                WarpFindKey(src_key, src_fingerprint, lane_id, unit_data);
+
+        /** Branch 1: key found **/
+        if (lane_found >= 0) {
+            ptr_t src_key_internal_ptr = __shfl_sync(
+                    ACTIVE_LANES_MASK, unit_data, lane_found, WARP_WIDTH);
+
+            if (lane_id == src_lane) {
+                uint32_t* unit_data_ptr =
+                        (curr_slab_ptr == HEAD_SLAB_PTR)
+                                ? get_unit_ptr_from_list_head(src_bucket,
+                                                              lane_found)
+                                : get_unit_ptr_from_list_nodes(curr_slab_ptr,
+                                                               lane_found);
+                ptr_t old_key_internal_ptr =
+                        atomicCAS((unsigned int*)(unit_data_ptr),
+                                  src_key_internal_ptr, EMPTY_PAIR_PTR);
+                /** Branch 1.1: this thread reset, free src_addr **/
+                if (old_key_internal_ptr == src_key_internal_ptr) {
+                    key_allocator_ctx_.Free(
+                            DecodeKeyPtr(src_key_internal_ptr));
+                    mask = true;
+                }
+                /** Branch 1.2: other thread did the job, avoid double free **/
+                to_be_deleted = false;
+            }
+        } else {  // no matching slot found:
+            ptr_t next_slab_ptr = __shfl_sync(ACTIVE_LANES_MASK, unit_data,
+                                              NEXT_SLAB_PTR_LANE, WARP_WIDTH);
+            if (next_slab_ptr == EMPTY_SLAB_PTR) {
+                // not found:
+                to_be_deleted = false;
+            } else {
+                curr_slab_ptr = next_slab_ptr;
+            }
+        }
+        prev_work_queue = work_queue;
+    }
+
+    return mask;
+}
+
+template <typename _Key, typename _Hash>
+__global__ void ContainsSetKernel(
+        SlabHashSetContext<_Key, _Hash> slab_hash_ctx,
+        _Key* keys,
+        uint8_t* founds,
+        uint32_t num_queries) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    /* This warp is idle */
+    if ((tid - lane_id) >= num_queries) {
+        return;
+    }
+
+    /* Initialize the memory allocator on each warp */
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    bool lane_active = false;
+    uint32_t bucket_id = 0;
+    _Key key;
+
+    if (tid < num_queries) {
+        lane_active = true;
+        key = keys[tid];
+        bucket_id = slab_hash_ctx.ComputeBucket(key);
+    }
+
+    bool found = slab_hash_ctx.Contains(lane_active, lane_id, bucket_id, key);
+
+    if (tid < num_queries) {
+        founds[tid] = found;
+    }
+}
+
+template <typename _Key, typename _Hash>
+__global__ void InsertSetKernel(SlabHashSetContext<_Key, _Hash> slab_hash_ctx,
+                                _Key* keys,
+                                uint32_t num_keys) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    if ((tid - lane_id) >= num_keys) {
+        return;
+    }
+
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    bool lane_active = false;
+    uint32_t bucket_id = 0;
+    _Key key;
+
+    if (tid < num_keys) {
+        lane_active = true;
+        key = keys[tid];
+        bucket_id = slab_hash_ctx.ComputeBucket(key);
+    }
+
+    slab_hash_ctx.Insert(lane_active, lane_id, bucket_id, key);
+}
+
+template <typename _Key, typename _Hash>
+__global__ void RemoveSetKernel(SlabHashSetContext<_Key, _Hash> slab_hash_ctx,
+                                _Key* keys,
+                                uint32_t num_keys) {
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    if ((tid - lane_id) >= num_keys) {
+        return;
+    }
+
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    bool lane_active = false;
+    uint32_t bucket_id = 0;
+    _Key key;
+
+    if (tid < num_keys) {
+        lane_active = true;
+        key = keys[tid];
+        bucket_id = slab_hash_ctx.ComputeBucket(key);
+    }
+
+    slab_hash_ctx.Remove(lane_active, lane_id, bucket_id, key);
+}
+
+/* Number of keys within each bucket, one warp per bucket */
+template <typename _Key, typename _Hash>
+__global__ void bucket_count_set_kernel(
+        SlabHashSetContext<_Key, _Hash> slab_hash_ctx,
+        uint32_t* d_count_result,
+        uint32_t num_buckets) {
+    // global warp ID
+    uint32_t tid = threadIdx.x + blockIdx.x * blockDim.x;
+    uint32_t wid = tid >> 5;
+    // assigning a warp per bucket
+    if (wid >= num_buckets) {
+        return;
+    }
+
+    uint32_t lane_id = threadIdx.x & 0x1F;
+
+    // initializing the memory allocator on each warp:
+    slab_hash_ctx.get_slab_alloc_ctx().Init(tid, lane_id);
+
+    uint32_t count = 0;
+
+    uint32_t src_unit_data =
+            *slab_hash_ctx.get_unit_ptr_from_list_head(wid, lane_id);
+
+    count += __popc(__ballot_sync(PAIR_PTR_LANES_MASK,
+                                  src_unit_data != EMPTY_PAIR_PTR));
+    uint32_t next = __shfl_sync(0xFFFFFFFF, src_unit_data, 31, 32);
+
+    while (next != EMPTY_SLAB_PTR) {
+        src_unit_data =
+                *slab_hash_ctx.get_unit_ptr_from_list_nodes(next, lane_id);
+        count += __popc(__ballot_sync(PAIR_PTR_LANES_MASK,
+                                      src_unit_data != EMPTY_PAIR_PTR));
+        next = __shfl_sync(0xFFFFFFFF, src_unit_data, 31, 32);
+    }
+    // writing back the results:
+    if (lane_id == 0) {
+        d_count_result[wid] = count;
+    }
+}
+
+#ifdef SLABHASH_BACKEND_CPU
+#include "slab_hash_set_host.h"
+#endif
+
+template <typename _Key, typename _Hash>
+SlabHashSet<_Key, _Hash>::SlabHashSet(const uint32_t max_bucket_count,
+                                      const uint32_t max_key_count,
+                                      uint32_t device_idx,
+                                      bool use_fingerprints /* = false */)
+    : num_buckets_(max_bucket_count),
+      bucket_list_head_(nullptr),
+      device_idx_(device_idx) {
+    // allocate an initialize the allocator:
+    key_allocator_ = std::make_shared<MemoryAlloc<_Key>>(max_key_count);
+    slab_list_allocator_ = std::make_shared<SlabAlloc>(
+            max_key_count / NEXT_SLAB_PTR_LANE + 1);
+
+#ifndef SLABHASH_BACKEND_CPU
+    int32_t device_count = 0;
+    CHECK_CUDA(cudaGetDeviceCount(&device_count));
+    assert(device_idx_ < device_count);
+#endif
+    BackendSetDevice(device_idx_);
+
+    // allocating initial buckets:
+    BackendMalloc(&bucket_list_head_, sizeof(Slab) * num_buckets_);
+    BackendMemset(bucket_list_head_, 0xFF, sizeof(Slab) * num_buckets_);
+
+    /* See SlabHash: key pointers leave the high bits for fingerprints */
+    uint32_t fingerprint_bits = 0;
+    if (use_fingerprints && max_key_count > 0) {
+        uint32_t key_ptr_bits = 32 - __builtin_clz(max_key_count);
+        fingerprint_bits = std::min(MAX_FINGERPRINT_BITS, 32 - key_ptr_bits);
+    }
+
+    gpu_context_.Setup(bucket_list_head_, num_buckets_,
+                       slab_list_allocator_->getContext(),
+                       key_allocator_->gpu_context_, fingerprint_bits);
+}
+
+template <typename _Key, typename _Hash>
+SlabHashSet<_Key, _Hash>::~SlabHashSet() {
+    BackendSetDevice(device_idx_);
+    BackendFree(bucket_list_head_);
+}
+
+template <typename _Key, typename _Hash>
+void SlabHashSet<_Key, _Hash>::Insert(_Key* keys, uint32_t num_keys) {
+    BackendSetDevice(device_idx_);
+    key_allocator_->Commit(num_keys);
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_, InsertSetKernel<_Key, _Hash>,
+               gpu_context_, keys, num_keys);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_keys, [&](uint32_t worker_id, uint32_t begin,
+                              uint32_t end) {
+        InsertSetKernelHost(gpu_context_, keys, begin, end, worker_id);
+    });
+#else
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    InsertSetKernel<_Key, _Hash>
+            <<<num_blocks, BLOCKSIZE_>>>(gpu_context_, keys, num_keys);
+#endif
+}
+
+template <typename _Key, typename _Hash>
+void SlabHashSet<_Key, _Hash>::Contains(_Key* keys,
+                                        uint8_t* founds,
+                                        uint32_t num_queries) {
+    BackendSetDevice(device_idx_);
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_queries + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_, ContainsSetKernel<_Key, _Hash>,
+               gpu_context_, keys, founds, num_queries);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_queries, [&](uint32_t worker_id, uint32_t begin,
+                                 uint32_t end) {
+        ContainsSetKernelHost(gpu_context_, keys, founds, begin, end,
+                              worker_id);
+    });
+#else
+    const uint32_t num_blocks = (num_queries + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    ContainsSetKernel<_Key, _Hash><<<num_blocks, BLOCKSIZE_>>>(
+            gpu_context_, keys, founds, num_queries);
+#endif
+}
+
+template <typename _Key, typename _Hash>
+void SlabHashSet<_Key, _Hash>::Remove(_Key* keys, uint32_t num_keys) {
+    BackendSetDevice(device_idx_);
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    SimtLaunch(num_blocks, BLOCKSIZE_, RemoveSetKernel<_Key, _Hash>,
+               gpu_context_, keys, num_keys);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_keys, [&](uint32_t worker_id, uint32_t begin,
+                              uint32_t end) {
+        RemoveSetKernelHost(gpu_context_, keys, begin, end, worker_id);
+    });
+#else
+    const uint32_t num_blocks = (num_keys + BLOCKSIZE_ - 1) / BLOCKSIZE_;
+    RemoveSetKernel<_Key, _Hash>
+            <<<num_blocks, BLOCKSIZE_>>>(gpu_context_, keys, num_keys);
+#endif
+}
+
+template <typename _Key, typename _Hash>
+double SlabHashSet<_Key, _Hash>::ComputeLoadFactor(int flag /* = 0 */) {
+    uint32_t* h_bucket_count = new uint32_t[num_buckets_];
+    uint32_t* d_bucket_count;
+    BackendMalloc(&d_bucket_count, sizeof(uint32_t) * num_buckets_);
+    BackendMemset(d_bucket_count, 0, sizeof(uint32_t) * num_buckets_);
+
+    const auto& dynamic_alloc = gpu_context_.get_slab_alloc_ctx();
+    const uint32_t num_super_blocks = dynamic_alloc.num_super_blocks_;
+    uint32_t* h_count_super_blocks = new uint32_t[num_super_blocks];
+    uint32_t* d_count_super_blocks;
+    BackendMalloc(&d_count_super_blocks, sizeof(uint32_t) * num_super_blocks);
+    BackendMemset(d_count_super_blocks, 0, sizeof(uint32_t) * num_super_blocks);
+    //---------------------------------
+    // counting the number of inserted elements:
+#if defined(SLABHASH_BACKEND_SIMT)
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    SimtLaunch(num_blocks, blocksize, bucket_count_set_kernel<_Key, _Hash>,
+               gpu_context_, d_bucket_count, num_buckets_);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ParallelFor(num_buckets_, [&](uint32_t /*worker_id*/, uint32_t begin,
+                                  uint32_t end) {
+        BucketCountSetKernelHost(gpu_context_, d_bucket_count, begin, end);
+    });
+#else
+    const uint32_t blocksize = 128;
+    const uint32_t num_blocks = (num_buckets_ * 32 + blocksize - 1) / blocksize;
+    bucket_count_set_kernel<_Key, _Hash><<<num_blocks, blocksize>>>(
+            gpu_context_, d_bucket_count, num_buckets_);
+#endif
+    BackendMemcpy(h_bucket_count, d_bucket_count,
+                  sizeof(uint32_t) * num_buckets_);
+
+    int total_elements_stored = 0;
+    for (uint32_t i = 0; i < num_buckets_; i++) {
+        total_elements_stored += h_bucket_count[i];
+    }
+
+    if (flag) {
+        printf("## Total elements stored: %d (%lu bytes).\n",
+               total_elements_stored, total_elements_stored * sizeof(_Key));
+    }
+
+    // counting total number of allocated memory units:
+#if defined(SLABHASH_BACKEND_SIMT)
+    int num_mem_units = dynamic_alloc.num_mem_blocks_per_super_block_ * 32;
+    int num_cuda_blocks = (num_mem_units + blocksize - 1) / blocksize;
+    SimtLaunch(num_cuda_blocks, blocksize,
+               compute_stats_allocators<SlabHashSetContext<_Key, _Hash>>,
+               d_count_super_blocks, gpu_context_);
+#elif defined(SLABHASH_BACKEND_CPU)
+    ComputeStatsAllocatorsHost(d_count_super_blocks, gpu_context_);
+#else
+    int num_mem_units = dynamic_alloc.num_mem_blocks_per_super_block_ * 32;
+    int num_cuda_blocks = (num_mem_units + blocksize - 1) / blocksize;
+    compute_stats_allocators<<<num_cuda_blocks, blocksize>>>(
+            d_count_super_blocks, gpu_context_);
+#endif
+
+    BackendMemcpy(h_count_super_blocks, d_count_super_blocks,
+                  sizeof(uint32_t) * num_super_blocks);
+
+    // computing load factor
+    int total_mem_units = num_buckets_;
+    for (uint32_t i = 0; i < num_super_blocks; i++)
+        total_mem_units += h_count_super_blocks[i];
+
+    double load_factor =
+            double(total_elements_stored * sizeof(_Key)) /
+            double(total_mem_units * WARP_WIDTH * sizeof(uint32_t));
+
+    if (d_count_super_blocks) BackendFree(d_count_super_blocks);
+    if (d_bucket_count) BackendFree(d_bucket_count);
+    delete[] h_bucket_count;
+    delete[] h_count_super_blocks;
+
+    return load_factor;
+}
@@ -0,0 +1,256 @@
+/*
+ * Copyright 2019 Saman Ashkiani
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Host backend (SLABHASH_BACKEND_CPU) of SlabHashSetContext.
+ * Included from slab_hash_set.h, see slab_hash_host.h.
+ */
+
+template <typename _Key, typename _Hash>
+ptr_t* SlabHashSetContext<_Key, _Hash>::get_slab_ptr(const uint32_t bucket_id,
+                                                     const ptr_t slab_ptr) {
+    return (slab_ptr == HEAD_SLAB_PTR)
+                   ? get_unit_ptr_from_list_head(bucket_id, 0)
+                   : get_unit_ptr_from_list_nodes(slab_ptr, 0);
+}
+
+template <typename _Key, typename _Hash>
+int32_t SlabHashSetContext<_Key, _Hash>::FindKey(const _Key& key,
+                                                 const uint32_t fingerprint,
+                                                 const ptr_t* slab,
+                                                 const uint32_t empty_lanes) {
+    uint32_t candidate_lanes = ~empty_lanes & PAIR_PTR_LANES_MASK;
+    if (fingerprint_mask_) {
+        candidate_lanes &= SlabProbe(slab, fingerprint, fingerprint_mask_);
+    }
+    while (candidate_lanes) {
+        int32_t lane_id = __builtin_ctz(candidate_lanes);
+        if (key_allocator_ctx_.extract(DecodeKeyPtr(slab[lane_id])) == key) {
+            return lane_id;
+        }
+        candidate_lanes &= candidate_lanes - 1;
+    }
+    return -1;
+}
+
+template <typename _Key, typename _Hash>
+ptr_t SlabHashSetContext<_Key, _Hash>::AllocateSlab() {
+    return slab_list_allocator_ctx_.Allocate();
+}
+
+template <typename _Key, typename _Hash>
+bool SlabHashSetContext<_Key, _Hash>::Contains(const uint32_t bucket_id,
+                                               const _Key& query_key) {
+    ptr_t curr_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t unit_data[WARP_WIDTH];
+    const uint32_t fingerprint = ComputeFingerprint(query_key);
+
+    while (true) {
+        const ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        for (uint32_t lane_id = 0; lane_id < WARP_WIDTH; ++lane_id) {
+            unit_data[lane_id] = AtomicLoad(slab + lane_id);
+        }
+
+        /** 1. Found in this slab, SUCCEED **/
+        if (FindKey(query_key, fingerprint, unit_data,
+                    FindEmptyLanes(unit_data)) >= 0) {
+            return true;
+        }
+
+        /** 2. Not found in this slab **/
+        ptr_t next_slab_ptr = unit_data[NEXT_SLAB_PTR_LANE];
+
+        /** 2.1. Next slab is empty, ABORT **/
+        if (next_slab_ptr == EMPTY_SLAB_PTR) {
+            return false;
+        }
+        /** 2.2. Next slab exists, RESTART **/
+        curr_slab_ptr = next_slab_ptr;
+    }
+}
+
+template <typename _Key, typename _Hash>
+bool SlabHashSetContext<_Key, _Hash>::Insert(const uint32_t bucket_id,
+                                             const _Key& key) {
+    ptr_t curr_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t unit_data[WARP_WIDTH];
+    const uint32_t fingerprint = ComputeFingerprint(key);
+
+    ptr_t prealloc_key_internal_ptr = key_allocator_ctx_.Allocate();
+
+    /** Key pool full: ABORT **/
+    if (prealloc_key_internal_ptr == EMPTY_PAIR_PTR) {
+        return false;
+    }
+    key_allocator_ctx_.extract(prealloc_key_internal_ptr) = key;
+
+    while (true) {
+        ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        for (uint32_t lane_id = 0; lane_id < WARP_WIDTH; ++lane_id) {
+            unit_data[lane_id] = AtomicLoad(slab + lane_id);
+        }
+
+        uint32_t empty_lanes = FindEmptyLanes(unit_data);
+
+        /** Branch 1: key already existing, ABORT **/
+        if (FindKey(key, fingerprint, unit_data, empty_lanes) >= 0) {
+            key_allocator_ctx_.Free(prealloc_key_internal_ptr);
+            return false;
+        }
+
+        /** Branch 2: empty slot available, try to insert **/
+        if (empty_lanes) {
+            int32_t lane_empty = __builtin_ctz(empty_lanes);
+            ptr_t old_key_internal_ptr = atomicCAS(
+                    slab + lane_empty, EMPTY_PAIR_PTR,
+                    EncodeKeyPtr(prealloc_key_internal_ptr, fingerprint));
+
+            /** Branch 2.1: SUCCEED **/
+            if (old_key_internal_ptr == EMPTY_PAIR_PTR) {
+                return true;
+            }
+            /** Branch 2.2: failed: RESTART on the same slab **/
+            continue;
+        }
+
+        /** Branch 3: nothing found in this slab, goto next slab **/
+        ptr_t next_slab_ptr = unit_data[NEXT_SLAB_PTR_LANE];
+
+        /** Branch 3.1: next slab existing, RESTART this lane **/
+        if (next_slab_ptr != EMPTY_SLAB_PTR) {
+            curr_slab_ptr = next_slab_ptr;
+            continue;
+        }
+
+        /** Branch 3.2: next slab empty, try to allocate one **/
+        ptr_t new_next_slab_ptr = AllocateSlab();
+        ptr_t old_next_slab_ptr = atomicCAS(slab + NEXT_SLAB_PTR_LANE,
+                                            EMPTY_SLAB_PTR, new_next_slab_ptr);
+
+        /** Branch 3.2.1: other thread allocated, RESTART lane **/
+        if (old_next_slab_ptr != EMPTY_SLAB_PTR) {
+            FreeSlab(new_next_slab_ptr);
+        }
+        /** Branch 3.2.2: this thread allocated, RESTART lane **/
+    }
+}
+
+template <typename _Key, typename _Hash>
+bool SlabHashSetContext<_Key, _Hash>::Remove(const uint32_t bucket_id,
+                                             const _Key& key) {
+    ptr_t curr_slab_ptr = HEAD_SLAB_PTR;
+    ptr_t unit_data[WARP_WIDTH];
+    const uint32_t fingerprint = ComputeFingerprint(key);
+
+    while (true) {
+        ptr_t* slab = get_slab_ptr(bucket_id, curr_slab_ptr);
+        for (uint32_t lane_id = 0; lane_id < WARP_WIDTH; ++lane_id) {
+            unit_data[lane_id] = AtomicLoad(slab + lane_id);
+        }
+
+        int32_t lane_found = FindKey(key, fingerprint, unit_data,
+                                     FindEmptyLanes(unit_data));
+
+        /** Branch 1: key found **/
+        if (lane_found >= 0) {
+            ptr_t key_to_delete = unit_data[lane_found];
+            ptr_t old_key_internal_ptr = atomicCAS(
+                    slab + lane_found, key_to_delete, EMPTY_PAIR_PTR);
+
+            /** Branch 1.1: this thread reset, free src_addr **/
+            if (old_key_internal_ptr == key_to_delete) {
+                key_allocator_ctx_.Free(DecodeKeyPtr(key_to_delete));
+                return true;
+            }
+            /** Branch 1.2: other thread did the job, avoid double free **/
+            return false;
+        }
+
+        ptr_t next_slab_ptr = unit_data[NEXT_SLAB_PTR_LANE];
+        if (next_slab_ptr == EMPTY_SLAB_PTR) {
+            return false;
+        }
+        curr_slab_ptr = next_slab_ptr;
+    }
+}
+
+/**
+ * Host kernels, see slab_hash_host.h
+ */
+template <typename _Key, typename _Hash>
+void ContainsSetKernelHost(SlabHashSetContext<_Key, _Hash> slab_hash_ctx,
+                           _Key* keys,
+                           uint8_t* founds,
+                           uint32_t begin,
+                           uint32_t end,
+                           uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t i = begin; i < end; ++i) {
+        founds[i] = slab_hash_ctx.Contains(
+                slab_hash_ctx.ComputeBucket(keys[i]), keys[i]);
+    }
+}
+
+template <typename _Key, typename _Hash>
+void InsertSetKernelHost(SlabHashSetContext<_Key, _Hash> slab_hash_ctx,
+                         _Key* keys,
+                         uint32_t begin,
+                         uint32_t end,
+                         uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t i = begin; i < end; ++i) {
+        slab_hash_ctx.Insert(slab_hash_ctx.ComputeBucket(keys[i]), keys[i]);
+    }
+}
+
+template <typename _Key, typename _Hash>
+void RemoveSetKernelHost(SlabHashSetContext<_Key, _Hash> slab_hash_ctx,
+                         _Key* keys,
+                         uint32_t begin,
+                         uint32_t end,
+                         uint32_t worker_id) {
+    slab_hash_ctx.get_slab_alloc_ctx().Init(worker_id);
+
+    for (uint32_t i = begin; i < end; ++i) {
+        slab_hash_ctx.Remove(slab_hash_ctx.ComputeBucket(keys[i]), keys[i]);
+    }
+}
+
+template <typename _Key, typename _Hash>
+void BucketCountSetKernelHost(SlabHashSetContext<_Key, _Hash> slab_hash_ctx,
+                              uint32_t* d_count_result,
+                              uint32_t begin,
+                              uint32_t end) {
+    for (uint32_t bucket_id = begin; bucket_id < end; ++bucket_id) {
+        uint32_t count = 0;
+
+        const ptr_t* slab =
+                slab_hash_ctx.get_unit_ptr_from_list_head(bucket_id, 0);
+        while (true) {
+            count += NEXT_SLAB_PTR_LANE -
+                     __builtin_popcount(FindEmptyLanes(slab));
+            ptr_t next = slab[NEXT_SLAB_PTR_LANE];
+            if (next == EMPTY_SLAB_PTR) break;
+            slab = slab_hash_ctx.get_unit_ptr_from_list_nodes(next, 0);
+        }
+
+        d_count_result[bucket_id] = count;
+    }
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2019 Saman Ashkiani
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Host counterpart of a ballot over a slab: SlabProbe(slab, value, word_mask)
+ * returns a 32-bit mask whose bit i is set iff (slab[i] & word_mask) == value.
+ * A slab is 128 bytes, i.e. two 512-bit or four 256-bit vector compares. The
+ * implementation is chosen once at runtime with CPUID, so that the binary
+ * does not need to be compiled with -mavx2/-mavx512f; the scalar version is
+ * the fallback on other CPUs and compilers.
+ */
+
+#include <cstdint>
+
+#include "config.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SLABHASH_SLAB_PROBE_X86
+#include <immintrin.h>
+#endif
+
+enum class SlabProbeISA { SCALAR, AVX2, AVX512 };
+
+using SlabProbeFunc = uint32_t (*)(const ptr_t* slab,
+                                   const ptr_t value,
+                                   const ptr_t word_mask);
+
+inline uint32_t SlabProbeScalar(const ptr_t* slab,
+                                const ptr_t value,
+                                const ptr_t word_mask) {
+    uint32_t mask = 0;
+    for (uint32_t lane_id = 0; lane_id < WARP_WIDTH; ++lane_id) {
+        mask |= uint32_t((slab[lane_id] & word_mask) == value) << lane_id;
+    }
+    return mask;
+}
+
+#ifdef SLABHASH_SLAB_PROBE_X86
+__attribute__((target("avx2"))) inline uint32_t SlabProbeAVX2(
+        const ptr_t* slab, const ptr_t value, const ptr_t word_mask) {
+    const __m256i needle = _mm256_set1_epi32(value);
+    const __m256i bits = _mm256_set1_epi32(word_mask);
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < WARP_WIDTH / 8; ++i) {
+        __m256i words = _mm256_and_si256(
+                _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i*>(slab + 8 * i)),
+                bits);
+        __m256i equal = _mm256_cmpeq_epi32(words, needle);
+        mask |= uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(equal)))
+                << (8 * i);
+    }
+    return mask;
+}
+
+__attribute__((target("avx512f"))) inline uint32_t SlabProbeAVX512(
+        const ptr_t* slab, const ptr_t value, const ptr_t word_mask) {
+    const __m512i needle = _mm512_set1_epi32(value);
+    const __m512i bits = _mm512_set1_epi32(word_mask);
+    __mmask16 lo = _mm512_cmpeq_epi32_mask(
+            _mm512_and_si512(_mm512_loadu_si512(slab), bits), needle);
+    __mmask16 hi = _mm512_cmpeq_epi32_mask(
+            _mm512_and_si512(_mm512_loadu_si512(slab + 16), bits), needle);
+    return uint32_t(lo) | (uint32_t(hi) << 16);
+}
+#endif
+
+/* The widest implementation supported by this CPU */
+inline SlabProbeISA SlabProbeDetectISA() {
+#ifdef SLABHASH_SLAB_PROBE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SlabProbeISA::AVX512;
+    if (__builtin_cpu_supports("avx2")) return SlabProbeISA::AVX2;
+#endif
+    return SlabProbeISA::SCALAR;
+}
+
+/* Falls back to the scalar version if @isa is not compiled in */
+inline SlabProbeFunc SlabProbeSelect(SlabProbeISA isa) {
+#ifdef SLABHASH_SLAB_PROBE_X86
+    switch (isa) {
+        case SlabProbeISA::AVX512:
+            return SlabProbeAVX512;
+        case SlabProbeISA::AVX2:
+            return SlabProbeAVX2;
+        default:
+            break;
+    }
+#endif
+    return SlabProbeScalar;
+}
+
+inline uint32_t SlabProbe(const ptr_t* slab,
+                          const ptr_t value,
+                          const ptr_t word_mask = 0xFFFFFFFF) {
+    static const SlabProbeFunc func = SlabProbeSelect(SlabProbeDetectISA());
+    return func(slab, value, word_mask);
+}
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2019 Saman Ashkiani
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Worker threads for the host backend. Included from backend.h.
+ * Also the readers-writer lock that UnorderedMap sessions share.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    explicit ThreadPool(uint32_t num_workers) : stop_(false) {
+        for (uint32_t i = 0; i < num_workers; ++i) {
+            workers_.emplace_back([this]() { WorkerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    /* Shared by all the tables: one helper per hardware thread, the calling
+     * thread being the last one */
+    static ThreadPool& Global() {
+        static ThreadPool pool(HardwareConcurrency() - 1);
+        return pool;
+    }
+
+    static uint32_t HardwareConcurrency() {
+        uint32_t num_threads = std::thread::hardware_concurrency();
+        return num_threads == 0 ? 1 : num_threads;
+    }
+
+    uint32_t num_workers() const { return workers_.size(); }
+
+    void Enqueue(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+private:
+    void WorkerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+                if (stop_ && tasks_.empty()) return;
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_;
+};
+
+/**
+ * Host counterpart of a kernel launch:
+ * [0, num_items) is split into contiguous chunks, one per hardware thread, and
+ * @func(chunk_id, begin, end) is called on each chunk. The chunk id plays the
+ * role of the global warp id (e.g. to select a resident memory block).
+ *
+ * The calling thread processes chunks as well, so ParallelFor can be nested
+ * in a pool task without starving the pool. Returns after all the chunks are
+ * finished.
+ */
+template <typename Func>
+void ParallelFor(uint32_t num_items, Func func) {
+    if (num_items == 0) return;
+
+    ThreadPool& pool = ThreadPool::Global();
+    const uint32_t num_chunks =
+            std::min(ThreadPool::HardwareConcurrency(), num_items);
+    const uint32_t chunk_size = (num_items + num_chunks - 1) / num_chunks;
+
+    struct State {
+        std::atomic<uint32_t> next_chunk;
+        std::atomic<uint32_t> num_done;
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+    auto state = std::make_shared<State>();
+    state->next_chunk = 0;
+    state->num_done = 0;
+
+    auto run = [state, func, num_items, num_chunks, chunk_size]() {
+        uint32_t chunk_id;
+        while ((chunk_id = state->next_chunk++) < num_chunks) {
+            uint32_t begin = chunk_id * chunk_size;
+            uint32_t end = std::min(begin + chunk_size, num_items);
+            if (begin < end) {
+                func(chunk_id, begin, end);
+            }
+            if (++state->num_done == num_chunks) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->cv.notify_all();
+            }
+        }
+    };
+
+    const uint32_t num_helpers = std::min(pool.num_workers(), num_chunks - 1);
+    for (uint32_t i = 0; i < num_helpers; ++i) {
+        pool.Enqueue(run);
+    }
+    run();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&]() { return state->num_done == num_chunks; });
+}
+
+/**
+ * Readers-writer lock (C++11 has no std::shared_mutex): the batches that
+ * only run kernels on a table hold it shared, the operations that
+ * restructure the table exclusively. Waiting writers hold off new readers,
+ * so that a stream of batches cannot starve a Rehash.
+ */
+class SharedMutex {
+public:
+    SharedMutex() : num_readers_(0), num_waiting_writers_(0), writer_(false) {}
+
+    void lock() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ++num_waiting_writers_;
+        cv_.wait(lock, [this]() { return !writer_ && num_readers_ == 0; });
+        --num_waiting_writers_;
+        writer_ = true;
+    }
+
+    void unlock() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            writer_ = false;
+        }
+        cv_.notify_all();
+    }
+
+    void lock_shared() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock,
+                 [this]() { return !writer_ && num_waiting_writers_ == 0; });
+        ++num_readers_;
+    }
+
+    void unlock_shared() {
+        bool last_reader;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            last_reader = --num_readers_ == 0;
+        }
+        if (last_reader) cv_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    uint32_t num_readers_;
+    uint32_t num_waiting_writers_;
+    bool writer_;
+};
+
+/* Holds @mutex shared, or exclusively with @exclusive, for its scope */
+class SharedMutexLock {
+public:
+    SharedMutexLock(SharedMutex& mutex, bool exclusive = false)
+        : mutex_(mutex), exclusive_(exclusive) {
+        exclusive_ ? mutex_.lock() : mutex_.lock_shared();
+    }
+    ~SharedMutexLock() {
+        exclusive_ ? mutex_.unlock() : mutex_.unlock_shared();
+    }
+
+    SharedMutexLock(const SharedMutexLock&) = delete;
+    SharedMutexLock& operator=(const SharedMutexLock&) = delete;
+
+private:
+    SharedMutex& mutex_;
+    bool exclusive_;
+};
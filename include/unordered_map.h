@@ -18,30 +18,23 @@
 
 #pragma once
 
-#include <thrust/device_vector.h>
-#include "slab_hash/slab_hash.h"
+#include <cstring>
+#include <future>
+#include <mutex>
 
-/*
- * Default hash function:
- * It treat any kind of input as a concatenation of ints.
- */
-template <typename Key>
-struct hash {
-    __device__ __host__ uint64_t operator()(const Key& key) const {
-        uint64_t hash = UINT64_C(14695981039346656037);
-
-        const int chunks = sizeof(Key) / sizeof(int);
-        for (size_t i = 0; i < chunks; ++i) {
-            hash ^= ((int32_t*)(&key))[i];
-            hash *= UINT64_C(1099511628211);
-        }
-        return hash;
-    }
-};
+#include "hash.h"
+#include "slab_hash/slab_hash.h"
+#include "slab_hash/thread_pool.h"
+#ifndef SLABHASH_BACKEND_CPU
+#include <thrust/device_vector.h>
+#endif
 
 /* Lightweight wrapper to handle host input */
 /* KeyT supports elementary types: int, long, etc. */
 /* ValueT supports arbitrary types in theory. */
+/* When both fit in 32 bits (IsInlinePair), the pairs are stored in the slabs
+ * and the key whose bits are all 1 (EMPTY_KEY, e.g. -1 for int) marks their
+ * empty slots: it cannot be stored, see STATUS_RESERVED_KEY. */
 template <typename KeyT, typename ValueT, typename HashFunc = hash<KeyT>>
 class UnorderedMap {
 public:
@@ -50,23 +43,134 @@ public:
                  uint32_t keys_per_bucket = 15,
                  float expected_occupancy_per_bucket = 0.6,
                  /* CUDA device */
-                 const uint32_t device_idx = 0);
+                 const uint32_t device_idx = 0,
+                 /* Tag slab words with hash bits to filter key compares */
+                 bool use_fingerprints = false);
     ~UnorderedMap();
 
+    /* Sessions, for concurrent host callers: a session has its own staging
+     * buffers (of max_keys entries, with pinned host mirrors on CUDA), copy
+     * stream and timer, and runs the std::vector overloads below on the
+     * shared table, e.g.
+     *   UnorderedMap<KeyT, ValueT>::Session session(map);
+     *   session.Search(keys, values, founds);
+     * The batches of different sessions run in parallel. Rehash, Compact,
+     * Relayout, BulkBuild, Reserve and the setters wait for them, and so do
+     * InsertOrAssign, UpdateExisting and InsertOrReduce, whose value stores
+     * are not atomic for wide values and would tear a concurrent Search,
+     * and the inserting batches once SetMaxChainLength lets them grow the
+     * table.
+     * A session is used by one thread at a time, and so are the methods of
+     * the map itself, whose std::vector overloads go through a session of
+     * their own */
+    class Session;
+
     /* We assert all memory buffers are allocated prior to the function call
          @keys_device stores keys in KeyT[num_keys x D],
          @[query]_values_device stores keys in ValueT[num_keys] */
     /* query_values[i] is undefined (basically ValueT(0)) if mask[i] == 0 */
+    /* The std::vector overloads take batches of any size: those larger than
+     * max_keys are streamed through the staging buffers in chunks of
+     * max_keys / 2, the copy of a chunk overlapping with the processing of
+     * the previous one. Each chunk is then a batch of its own, e.g. for
+     * SetBatchDeduplication. The returned time is that of the processing */
 
+#ifndef SLABHASH_BACKEND_CPU
     float Insert(thrust::device_vector<KeyT>& keys,
                  thrust::device_vector<ValueT>& values);
+#endif
     float Insert(const std::vector<KeyT>& keys,
                  const std::vector<ValueT>& values);
-    float Insert(KeyT* keys_device, ValueT* values_device, int num_keys);
+    float Insert(KeyT* keys_device,
+                 ValueT* values_device,
+                 int num_keys,
+                 uint8_t* statuses_device = nullptr);
 
+    /* The inserting operations drop the keys that do not fit in the pair
+     * pool: @statuses[i] is then STATUS_OUT_OF_CAPACITY, STATUS_SUCCESS
+     * otherwise (see Reserve). With inline pairs, they drop EMPTY_KEY:
+     * @statuses[i] is then STATUS_RESERVED_KEY, and without statuses it
+     * fails an assert in debug builds */
+    float Insert(const std::vector<KeyT>& keys,
+                 const std::vector<ValueT>& values,
+                 std::vector<uint8_t>& statuses);
+
+    /* Insert a large batch grouped by bucket: a warp per bucket appends its
+     * keys to the chain without CAS, e.g. to build a table from a scan.
+     * Same result as Insert, but EMPTY_KEY is skipped without an assert.
+     * Must not overlap with other operations */
+#ifndef SLABHASH_BACKEND_CPU
+    float BulkBuild(thrust::device_vector<KeyT>& keys,
+                    thrust::device_vector<ValueT>& values);
+#endif
+    float BulkBuild(const std::vector<KeyT>& keys,
+                    const std::vector<ValueT>& values);
+    float BulkBuild(KeyT* keys_device, ValueT* values_device, int num_keys);
+
+    /* Insert overwriting the values of existing keys */
+#ifndef SLABHASH_BACKEND_CPU
+    float InsertOrAssign(thrust::device_vector<KeyT>& keys,
+                         thrust::device_vector<ValueT>& values);
+#endif
+    float InsertOrAssign(const std::vector<KeyT>& keys,
+                         const std::vector<ValueT>& values);
+    float InsertOrAssign(KeyT* keys_device,
+                         ValueT* values_device,
+                         int num_keys,
+                         uint8_t* statuses_device = nullptr);
+
+    /* Overwrite the values of existing keys only, the others are ignored */
+#ifndef SLABHASH_BACKEND_CPU
+    float UpdateExisting(thrust::device_vector<KeyT>& keys,
+                         thrust::device_vector<ValueT>& values);
+#endif
+    float UpdateExisting(const std::vector<KeyT>& keys,
+                         const std::vector<ValueT>& values);
+    float UpdateExisting(KeyT* keys_device,
+                         ValueT* values_device,
+                         int num_keys);
+
+    /* Insert, or combine the values of existing keys with a reduction
+     * functor, e.g. ReduceAdd<ValueT>() (see slab_hash/reduce.h) */
+#ifndef SLABHASH_BACKEND_CPU
+    template <typename ReduceFunc>
+    float InsertOrReduce(thrust::device_vector<KeyT>& keys,
+                         thrust::device_vector<ValueT>& values,
+                         ReduceFunc reduce);
+#endif
+    template <typename ReduceFunc>
+    float InsertOrReduce(const std::vector<KeyT>& keys,
+                         const std::vector<ValueT>& values,
+                         ReduceFunc reduce);
+    template <typename ReduceFunc>
+    float InsertOrReduce(KeyT* keys_device,
+                         ValueT* values_device,
+                         int num_keys,
+                         ReduceFunc reduce,
+                         uint8_t* statuses_device = nullptr);
+
+    /* Find or insert each key, and return the pair pool index of its entry
+     * (a dense id < max_keys) and whether it was created; the vector
+     * overload resizes @iterators and @is_new to the keys. Pair pool only,
+     * i.e. not for keys and values that both fit in 32 bits */
+#ifndef SLABHASH_BACKEND_CPU
+    float Activate(thrust::device_vector<KeyT>& keys,
+                   thrust::device_vector<iterator_t>& iterators,
+                   thrust::device_vector<uint8_t>& is_new);
+#endif
+    float Activate(const std::vector<KeyT>& keys,
+                   std::vector<iterator_t>& iterators,
+                   std::vector<uint8_t>& is_new);
+    float Activate(KeyT* keys_device,
+                   iterator_t* iterators_device,
+                   uint8_t* is_new_device,
+                   int num_keys);
+
+#ifndef SLABHASH_BACKEND_CPU
     float Search(thrust::device_vector<KeyT>& query_keys,
                  thrust::device_vector<ValueT>& query_values,
                  thrust::device_vector<uint8_t>& mask);
+#endif
     float Search(const std::vector<KeyT>& query_keys,
                  std::vector<ValueT>& query_values,
                  std::vector<uint8_t>& mask);
@@ -75,29 +179,215 @@ public:
                  uint8_t* mask,
                  int num_keys);
 
+#ifndef SLABHASH_BACKEND_CPU
     float Remove(thrust::device_vector<KeyT>& keys);
+#endif
     float Remove(const std::vector<KeyT>& keys);
     float Remove(KeyT* keys, int num_keys);
 
+    /* Asynchronous variants of the std::vector overloads, e.g. to submit the
+     * next batch while consuming the results of the previous one. The batch
+     * is queued to a worker thread of the table, which runs the queued
+     * batches one at a time in submission order, and the future is set when
+     * its batch is done (with the time of the operation). The inputs are
+     * taken by value, so move them in. The worker runs them through a
+     * session of its own, so the other methods may be called meanwhile,
+     * ordered with the pending batches as with any concurrent session */
+    struct SearchResult {
+        std::vector<ValueT> values;
+        std::vector<uint8_t> founds;
+        float time;
+    };
+    std::future<float> InsertAsync(std::vector<KeyT> keys,
+                                   std::vector<ValueT> values);
+    std::future<SearchResult> SearchAsync(std::vector<KeyT> query_keys);
+    std::future<float> RemoveAsync(std::vector<KeyT> keys);
+
+    /* Enumerate the stored pairs: the vector overloads are resized to the
+     * number of pairs, the device buffers must hold Size() entries. ForEach
+     * calls func(const KeyT&, ValueT&) on every pair, on the device */
+    uint32_t Size();
+#ifndef SLABHASH_BACKEND_CPU
+    float Export(thrust::device_vector<KeyT>& keys,
+                 thrust::device_vector<ValueT>& values);
+#endif
+    float Export(std::vector<KeyT>& keys, std::vector<ValueT>& values);
+    float Export(KeyT* keys_device, ValueT* values_device, uint32_t& num_pairs);
+    template <typename Func>
+    float ForEach(Func func);
+
+    /* Grow to @num_buckets buckets; with SetMaxChainLength(l), l > 0, the
+     * inserting operations do so whenever the average chain exceeds l slabs */
+    float Rehash(uint32_t num_buckets);
+    void SetMaxChainLength(float max_chain_length);
+    /* Grow by splitting @splits_per_batch buckets per batch instead (linear
+     * hashing), with room for @max_buckets buckets ahead */
+    void EnableLinearHashing(uint32_t max_buckets, uint32_t splits_per_batch);
+    /* Pack each chain toward its head and free the slabs emptied by Remove,
+     * e.g. between the batches of an insert/remove heavy workload */
+    float Compact();
+    /* Copy the chains into consecutive slabs, bucket after bucket, so that
+     * long-lived tables walk their chains in memory order again */
+    float Relayout();
+    /* Allocate the slabs that extend a chain next to its tail slab rather
+     * than in the block hashed from the warp id */
+    void SetNearTailAllocation(bool near_tail_allocation);
+    /* Run the queries of Search grouped by bucket, e.g. for large batches
+     * over long chains; the results keep the order of the queries */
+    void SetBucketOrderedSearch(bool bucket_ordered_search);
+    /* Reduce each batch of Insert, InsertOrAssign and InsertOrReduce to one
+     * pair per distinct key before it reaches the table (first copy, last
+     * copy, reduced copies respectively), for batches with many repeated
+     * keys. Not applied to the overloads that return statuses */
+    void SetBatchDeduplication(bool batch_deduplication);
+
+    /* Grow the pair pool to @max_pairs pairs without moving the stored ones,
+     * so that it can be sized for the typical load. The batches of the
+     * device-pointer overloads are still limited to the max_keys of the
+     * constructor; the std::vector ones are streamed through the staging
+     * buffers. Returns false if the pool cannot address that many pairs
+     * (with fingerprints) */
+    bool Reserve(uint32_t max_pairs);
+
     float ComputeLoadFactor(int flag = 0);
 
 private:
+    /* Queue @task to the worker of the asynchronous variants */
+    template <typename Result>
+    std::future<Result> Submit(std::function<Result()> task);
+
     uint32_t max_keys_;
     uint32_t num_buckets_;
     uint32_t cuda_device_idx_;
 
+    /* Timer of the device overloads */
+    BackendTimer timer_;
+
+    /* Staging of the std::vector overloads */
+    std::unique_ptr<Session> session_;
+
+    /* Asynchronous variants: a single worker, so that the batches run in
+     * submission order, with its own session. Started once by the first
+     * one, whichever thread submits it */
+    std::unique_ptr<Session> async_session_;
+    std::unique_ptr<ThreadPool> async_worker_;
+    std::once_flag async_worker_started_;
+
+    /* Held shared by the batches, exclusively by the operations that
+     * restructure the table or overwrite stored values, see Session. With
+     * automatic growth, the inserting batches may rehash, and hold it
+     * exclusively as well: set it up before the sessions start. So do the
+     * inserting batches that may grow the slab allocator of an inline
+     * table, as checked when they start (see SlabHash::MayGrowSlabs) */
+    SharedMutex mutex_;
+    std::atomic<bool> automatic_growth_;
+
+    std::shared_ptr<SlabHash<KeyT, ValueT, HashFunc>> slab_hash_;
+};
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+class UnorderedMap<KeyT, ValueT, HashFunc>::Session {
+public:
+    explicit Session(UnorderedMap& map);
+    ~Session();
+
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+    /* The std::vector overloads of UnorderedMap */
+    float Insert(const std::vector<KeyT>& keys,
+                 const std::vector<ValueT>& values);
+    float Insert(const std::vector<KeyT>& keys,
+                 const std::vector<ValueT>& values,
+                 std::vector<uint8_t>& statuses);
+    float BulkBuild(const std::vector<KeyT>& keys,
+                    const std::vector<ValueT>& values);
+    float InsertOrAssign(const std::vector<KeyT>& keys,
+                         const std::vector<ValueT>& values);
+    float UpdateExisting(const std::vector<KeyT>& keys,
+                         const std::vector<ValueT>& values);
+    template <typename ReduceFunc>
+    float InsertOrReduce(const std::vector<KeyT>& keys,
+                         const std::vector<ValueT>& values,
+                         ReduceFunc reduce);
+    float Activate(const std::vector<KeyT>& keys,
+                   std::vector<iterator_t>& iterators,
+                   std::vector<uint8_t>& is_new);
+    float Search(const std::vector<KeyT>& query_keys,
+                 std::vector<ValueT>& query_values,
+                 std::vector<uint8_t>& mask);
+    float Remove(const std::vector<KeyT>& keys);
+
+private:
+    /* Run a host batch of @num_keys entries through the staging buffers, in
+     * one chunk if it fits, otherwise in chunks alternating between the two
+     * halves (slots) of the buffers. For each chunk [begin, begin + count)
+     * staged at @offset in the buffers:
+     *   stage(begin, count, offset, stream) copies its inputs,
+     *   run(offset, count) processes it, on the default stream,
+     *   unstage(begin, count, offset, stream) copies its outputs back.
+     * The staging of a chunk is issued as soon as the slot is free, i.e.
+     * while the previous chunk runs. The time is that of the runs only */
+    template <typename Stage, typename Run, typename Unstage>
+    float StreamBatch(uint32_t num_keys,
+                      Stage stage,
+                      Run run,
+                      Unstage unstage);
+    template <typename Stage, typename Run>
+    float StreamBatch(uint32_t num_keys, Stage stage, Run run);
+
+    /* Copy @count entries between a host vector and @buffer + @offset,
+     * through its pinned mirror @host_buffer on CUDA, where copies from
+     * pageable memory do not overlap with the kernels. The outputs reach
+     * @dst once FlushOutputs follows the copy stream */
+    template <typename T>
+    void StageIn(T* buffer,
+                 T* host_buffer,
+                 uint32_t offset,
+                 const T* src,
+                 uint32_t count,
+                 BackendStream stream);
+    template <typename T>
+    void StageOut(T* dst,
+                  const T* buffer,
+                  T* host_buffer,
+                  uint32_t offset,
+                  uint32_t count,
+                  BackendStream stream);
+    void FlushOutputs();
+
+    UnorderedMap& map_;
+
     /* Timer */
-    cudaEvent_t start_;
-    cudaEvent_t stop_;
+    BackendTimer timer_;
 
-    /* Handled by CUDA */
+    /* Handled by the backend */
     KeyT* key_buffer_;
     ValueT* value_buffer_;
     KeyT* query_key_buffer_;
     ValueT* query_value_buffer_;
     uint8_t* query_result_buffer_;
+    iterator_t* iterator_buffer_;
 
-    std::shared_ptr<SlabHash<KeyT, ValueT, HashFunc>> slab_hash_;
+    /* Pinned mirrors of the buffers, on CUDA only */
+    KeyT* host_key_buffer_;
+    ValueT* host_value_buffer_;
+    KeyT* host_query_key_buffer_;
+    ValueT* host_query_value_buffer_;
+    uint8_t* host_query_result_buffer_;
+    iterator_t* host_iterator_buffer_;
+
+    /* Outputs staged in the mirrors, to copy out to the host vectors */
+    struct PendingOutput {
+        void* dst;
+        const void* src;
+        size_t bytes;
+    };
+    std::vector<PendingOutput> pending_outputs_;
+
+    /* Staging copies, and the end of the last chunk run from each slot */
+    BackendStream copy_stream_;
+    BackendEvent chunk_done_[2];
 };
 
 template <typename KeyT, typename ValueT, typename HashFunc>
@@ -105,8 +395,12 @@ UnorderedMap<KeyT, ValueT, HashFunc>::UnorderedMap(
         uint32_t max_keys,
         uint32_t keys_per_bucket,
         float expected_occupancy_per_bucket,
-        const uint32_t device_idx)
-    : max_keys_(max_keys), cuda_device_idx_(device_idx), slab_hash_(nullptr) {
+        const uint32_t device_idx,
+        bool use_fingerprints)
+    : max_keys_(max_keys),
+      cuda_device_idx_(device_idx),
+      automatic_growth_(false),
+      slab_hash_(nullptr) {
     /* Set bucket size */
     uint32_t expected_keys_per_bucket =
             expected_occupancy_per_bucket * keys_per_bucket;
@@ -114,93 +408,289 @@ UnorderedMap<KeyT, ValueT, HashFunc>::UnorderedMap(
                    expected_keys_per_bucket;
 
     /* Set device */
+#ifndef SLABHASH_BACKEND_CPU
     int32_t cuda_device_count_ = 0;
     CHECK_CUDA(cudaGetDeviceCount(&cuda_device_count_));
     assert(cuda_device_idx_ < cuda_device_count_);
-    CHECK_CUDA(cudaSetDevice(cuda_device_idx_));
-
-    // allocating key, value arrays:
-    CHECK_CUDA(cudaMalloc(&key_buffer_, sizeof(KeyT) * max_keys_));
-    CHECK_CUDA(cudaMalloc(&value_buffer_, sizeof(ValueT) * max_keys_));
-    CHECK_CUDA(cudaMalloc(&query_key_buffer_, sizeof(KeyT) * max_keys_));
-    CHECK_CUDA(cudaMalloc(&query_value_buffer_, sizeof(ValueT) * max_keys_));
-    CHECK_CUDA(cudaMalloc(&query_result_buffer_, sizeof(uint8_t) * max_keys_));
-
-    CHECK_CUDA(cudaEventCreate(&start_));
-    CHECK_CUDA(cudaEventCreate(&stop_));
+#endif
+    BackendSetDevice(cuda_device_idx_);
 
     // allocate an initialize the allocator:
     slab_hash_ = std::make_shared<SlabHash<KeyT, ValueT, HashFunc>>(
-            num_buckets_, max_keys_, cuda_device_idx_);
+            num_buckets_, max_keys_, cuda_device_idx_, use_fingerprints);
+
+    session_.reset(new Session(*this));
 }
 
 template <typename KeyT, typename ValueT, typename HashFunc>
 UnorderedMap<KeyT, ValueT, HashFunc>::~UnorderedMap() {
-    CHECK_CUDA(cudaSetDevice(cuda_device_idx_));
+    /* Finish the pending asynchronous batches first */
+    async_worker_.reset();
+}
 
-    CHECK_CUDA(cudaFree(key_buffer_));
-    CHECK_CUDA(cudaFree(value_buffer_));
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Insert(
+        const std::vector<KeyT>& keys, const std::vector<ValueT>& values) {
+    return session_->Insert(keys, values);
+}
 
-    CHECK_CUDA(cudaFree(query_key_buffer_));
-    CHECK_CUDA(cudaFree(query_value_buffer_));
+#ifndef SLABHASH_BACKEND_CPU
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Insert(
+        thrust::device_vector<KeyT>& keys,
+        thrust::device_vector<ValueT>& values) {
+    float time;
+    assert(values.size() == keys.size());
+
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_,
+                         automatic_growth_ ||
+                                 slab_hash_->MayGrowSlabs(keys.size()));
+    timer_.Start();
+
+    slab_hash_->Insert(thrust::raw_pointer_cast(keys.data()),
+                       thrust::raw_pointer_cast(values.data()), keys.size());
 
-    CHECK_CUDA(cudaEventDestroy(start_));
-    CHECK_CUDA(cudaEventDestroy(stop_));
+    time = timer_.Stop();
+    return time;
+}
+#endif
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Insert(
+        KeyT* keys,
+        ValueT* values,
+        int num_keys,
+        uint8_t* statuses /* = nullptr */) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_,
+                         automatic_growth_ ||
+                                 slab_hash_->MayGrowSlabs(num_keys));
+    timer_.Start();
+    slab_hash_->Insert(keys, values, num_keys, statuses);
+    time = timer_.Stop();
+    return time;
 }
 
 template <typename KeyT, typename ValueT, typename HashFunc>
 float UnorderedMap<KeyT, ValueT, HashFunc>::Insert(
+        const std::vector<KeyT>& keys,
+        const std::vector<ValueT>& values,
+        std::vector<uint8_t>& statuses) {
+    return session_->Insert(keys, values, statuses);
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::BulkBuild(
+        const std::vector<KeyT>& keys, const std::vector<ValueT>& values) {
+    return session_->BulkBuild(keys, values);
+}
+
+#ifndef SLABHASH_BACKEND_CPU
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::BulkBuild(
+        thrust::device_vector<KeyT>& keys,
+        thrust::device_vector<ValueT>& values) {
+    float time;
+    assert(values.size() == keys.size());
+
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_, true);
+    timer_.Start();
+
+    slab_hash_->BulkBuild(thrust::raw_pointer_cast(keys.data()),
+                          thrust::raw_pointer_cast(values.data()),
+                          keys.size());
+
+    time = timer_.Stop();
+    return time;
+}
+#endif
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::BulkBuild(KeyT* keys,
+                                                      ValueT* values,
+                                                      int num_keys) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_, true);
+    timer_.Start();
+    slab_hash_->BulkBuild(keys, values, num_keys);
+    time = timer_.Stop();
+    return time;
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::InsertOrAssign(
         const std::vector<KeyT>& keys, const std::vector<ValueT>& values) {
+    return session_->InsertOrAssign(keys, values);
+}
+
+#ifndef SLABHASH_BACKEND_CPU
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::InsertOrAssign(
+        thrust::device_vector<KeyT>& keys,
+        thrust::device_vector<ValueT>& values) {
     float time;
     assert(values.size() == keys.size());
 
-    CHECK_CUDA(cudaSetDevice(cuda_device_idx_));
-    CHECK_CUDA(cudaMemcpy(key_buffer_, keys.data(), sizeof(KeyT) * keys.size(),
-                          cudaMemcpyHostToDevice));
-    CHECK_CUDA(cudaMemcpy(value_buffer_, values.data(),
-                          sizeof(ValueT) * values.size(),
-                          cudaMemcpyHostToDevice));
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_, true);
+    timer_.Start();
 
-    CHECK_CUDA(cudaEventRecord(start_, 0));
+    slab_hash_->InsertOrAssign(thrust::raw_pointer_cast(keys.data()),
+                               thrust::raw_pointer_cast(values.data()),
+                               keys.size());
 
-    slab_hash_->Insert(key_buffer_, value_buffer_, keys.size());
+    time = timer_.Stop();
+    return time;
+}
+#endif
 
-    CHECK_CUDA(cudaEventRecord(stop_, 0));
-    CHECK_CUDA(cudaEventSynchronize(stop_));
-    CHECK_CUDA(cudaEventElapsedTime(&time, start_, stop_));
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::InsertOrAssign(
+        KeyT* keys,
+        ValueT* values,
+        int num_keys,
+        uint8_t* statuses /* = nullptr */) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_, true);
+    timer_.Start();
+    slab_hash_->InsertOrAssign(keys, values, num_keys, statuses);
+    time = timer_.Stop();
     return time;
 }
 
 template <typename KeyT, typename ValueT, typename HashFunc>
-float UnorderedMap<KeyT, ValueT, HashFunc>::Insert(
+float UnorderedMap<KeyT, ValueT, HashFunc>::UpdateExisting(
+        const std::vector<KeyT>& keys, const std::vector<ValueT>& values) {
+    return session_->UpdateExisting(keys, values);
+}
+
+#ifndef SLABHASH_BACKEND_CPU
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::UpdateExisting(
         thrust::device_vector<KeyT>& keys,
         thrust::device_vector<ValueT>& values) {
     float time;
     assert(values.size() == keys.size());
 
-    CHECK_CUDA(cudaSetDevice(cuda_device_idx_));
-    CHECK_CUDA(cudaEventRecord(start_, 0));
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_, true);
+    timer_.Start();
 
-    slab_hash_->Insert(thrust::raw_pointer_cast(keys.data()),
-                       thrust::raw_pointer_cast(values.data()), keys.size());
+    slab_hash_->UpdateExisting(thrust::raw_pointer_cast(keys.data()),
+                               thrust::raw_pointer_cast(values.data()),
+                               keys.size());
 
-    CHECK_CUDA(cudaEventRecord(stop_, 0));
-    CHECK_CUDA(cudaEventSynchronize(stop_));
-    CHECK_CUDA(cudaEventElapsedTime(&time, start_, stop_));
+    time = timer_.Stop();
     return time;
 }
+#endif
 
 template <typename KeyT, typename ValueT, typename HashFunc>
-float UnorderedMap<KeyT, ValueT, HashFunc>::Insert(KeyT* keys,
-                                                   ValueT* values,
-                                                   int num_keys) {
+float UnorderedMap<KeyT, ValueT, HashFunc>::UpdateExisting(KeyT* keys,
+                                                           ValueT* values,
+                                                           int num_keys) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_, true);
+    timer_.Start();
+    slab_hash_->UpdateExisting(keys, values, num_keys);
+    time = timer_.Stop();
+    return time;
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+template <typename ReduceFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::InsertOrReduce(
+        const std::vector<KeyT>& keys,
+        const std::vector<ValueT>& values,
+        ReduceFunc reduce) {
+    return session_->InsertOrReduce(keys, values, reduce);
+}
+
+#ifndef SLABHASH_BACKEND_CPU
+template <typename KeyT, typename ValueT, typename HashFunc>
+template <typename ReduceFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::InsertOrReduce(
+        thrust::device_vector<KeyT>& keys,
+        thrust::device_vector<ValueT>& values,
+        ReduceFunc reduce) {
+    float time;
+    assert(values.size() == keys.size());
+
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_, true);
+    timer_.Start();
+
+    slab_hash_->InsertOrReduce(thrust::raw_pointer_cast(keys.data()),
+                               thrust::raw_pointer_cast(values.data()),
+                               keys.size(), reduce);
+
+    time = timer_.Stop();
+    return time;
+}
+#endif
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+template <typename ReduceFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::InsertOrReduce(
+        KeyT* keys,
+        ValueT* values,
+        int num_keys,
+        ReduceFunc reduce,
+        uint8_t* statuses /* = nullptr */) {
     float time;
-    CHECK_CUDA(cudaSetDevice(cuda_device_idx_));
-    CHECK_CUDA(cudaEventRecord(start_, 0));
-    slab_hash_->Insert(keys, values, num_keys);
-    CHECK_CUDA(cudaEventRecord(stop_, 0));
-    CHECK_CUDA(cudaEventSynchronize(stop_));
-    CHECK_CUDA(cudaEventElapsedTime(&time, start_, stop_));
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_, true);
+    timer_.Start();
+    slab_hash_->InsertOrReduce(keys, values, num_keys, reduce, statuses);
+    time = timer_.Stop();
+    return time;
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Activate(
+        const std::vector<KeyT>& keys,
+        std::vector<iterator_t>& iterators,
+        std::vector<uint8_t>& is_new) {
+    return session_->Activate(keys, iterators, is_new);
+}
+
+#ifndef SLABHASH_BACKEND_CPU
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Activate(
+        thrust::device_vector<KeyT>& keys,
+        thrust::device_vector<iterator_t>& iterators,
+        thrust::device_vector<uint8_t>& is_new) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_, automatic_growth_);
+    timer_.Start();
+
+    slab_hash_->Activate(thrust::raw_pointer_cast(keys.data()),
+                         thrust::raw_pointer_cast(iterators.data()),
+                         thrust::raw_pointer_cast(is_new.data()), keys.size());
+
+    time = timer_.Stop();
+    return time;
+}
+#endif
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Activate(KeyT* keys,
+                                                     iterator_t* iterators,
+                                                     uint8_t* is_new,
+                                                     int num_keys) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_, automatic_growth_);
+    timer_.Start();
+    slab_hash_->Activate(keys, iterators, is_new, num_keys);
+    time = timer_.Stop();
     return time;
 }
 
@@ -209,59 +699,31 @@ float UnorderedMap<KeyT, ValueT, HashFunc>::Search(
         const std::vector<KeyT>& query_keys,
         std::vector<ValueT>& query_values,
         std::vector<uint8_t>& query_found) {
-    float time;
-    assert(query_found.size() >= query_keys.size());
-    assert(query_values.size() >= query_keys.size());
-
-    CHECK_CUDA(cudaSetDevice(cuda_device_idx_));
-    CHECK_CUDA(cudaMemcpy(query_key_buffer_, query_keys.data(),
-                          sizeof(KeyT) * query_keys.size(),
-                          cudaMemcpyHostToDevice));
-    CHECK_CUDA(cudaMemset(query_value_buffer_, 0xFF,
-                          sizeof(ValueT) * query_keys.size()));
-    CHECK_CUDA(cudaMemset(query_result_buffer_, 0,
-                          sizeof(uint8_t) * query_keys.size()));
-
-    CHECK_CUDA(cudaEventRecord(start_, 0));
-
-    slab_hash_->Search(query_key_buffer_, query_value_buffer_,
-                       query_result_buffer_, query_keys.size());
-
-    CHECK_CUDA(cudaEventRecord(stop_, 0));
-    CHECK_CUDA(cudaEventSynchronize(stop_));
-    CHECK_CUDA(cudaEventElapsedTime(&time, start_, stop_));
-
-    CHECK_CUDA(cudaMemcpy(query_values.data(), query_value_buffer_,
-                          sizeof(ValueT) * query_keys.size(),
-                          cudaMemcpyDeviceToHost));
-    CHECK_CUDA(cudaMemcpy(query_found.data(), query_result_buffer_,
-                          sizeof(uint8_t) * query_keys.size(),
-                          cudaMemcpyDeviceToHost));
-    CHECK_CUDA(cudaDeviceSynchronize());
-    return time;
+    return session_->Search(query_keys, query_values, query_found);
 }
 
+#ifndef SLABHASH_BACKEND_CPU
 template <typename KeyT, typename ValueT, typename HashFunc>
 float UnorderedMap<KeyT, ValueT, HashFunc>::Search(
         thrust::device_vector<KeyT>& query_keys,
         thrust::device_vector<ValueT>& query_values,
         thrust::device_vector<uint8_t>& mask) {
     float time;
-    CHECK_CUDA(cudaSetDevice(cuda_device_idx_));
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_);
 
     thrust::fill(mask.begin(), mask.end(), 0);
-    CHECK_CUDA(cudaEventRecord(start_, 0));
+    timer_.Start();
 
     slab_hash_->Search(thrust::raw_pointer_cast(query_keys.data()),
                        thrust::raw_pointer_cast(query_values.data()),
                        thrust::raw_pointer_cast(mask.data()),
                        query_keys.size());
 
-    CHECK_CUDA(cudaEventRecord(stop_, 0));
-    CHECK_CUDA(cudaEventSynchronize(stop_));
-    CHECK_CUDA(cudaEventElapsedTime(&time, start_, stop_));
+    time = timer_.Stop();
     return time;
 }
+#endif
 
 template <typename KeyT, typename ValueT, typename HashFunc>
 float UnorderedMap<KeyT, ValueT, HashFunc>::Search(KeyT* query_keys,
@@ -269,67 +731,662 @@ float UnorderedMap<KeyT, ValueT, HashFunc>::Search(KeyT* query_keys,
                                                    uint8_t* mask,
                                                    int num_keys) {
     float time;
-    CHECK_CUDA(cudaSetDevice(cuda_device_idx_));
-    CHECK_CUDA(cudaMemset(mask, 0, sizeof(uint8_t) * num_keys));
-    CHECK_CUDA(cudaEventRecord(start_, 0));
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_);
+    BackendMemset(mask, 0, sizeof(uint8_t) * num_keys);
+    timer_.Start();
 
     slab_hash_->Search(query_keys, query_values, mask, num_keys);
 
-    CHECK_CUDA(cudaEventRecord(stop_, 0));
-    CHECK_CUDA(cudaEventSynchronize(stop_));
-    CHECK_CUDA(cudaEventElapsedTime(&time, start_, stop_));
+    time = timer_.Stop();
     return time;
 }
 
 template <typename KeyT, typename ValueT, typename HashFunc>
 float UnorderedMap<KeyT, ValueT, HashFunc>::Remove(
         const std::vector<KeyT>& keys) {
-    float time;
-    CHECK_CUDA(cudaSetDevice(cuda_device_idx_));
-    CHECK_CUDA(cudaMemcpy(key_buffer_, keys.data(), sizeof(KeyT) * keys.size(),
-                          cudaMemcpyHostToDevice));
-
-    CHECK_CUDA(cudaEventRecord(start_, 0));
-
-    slab_hash_->Remove(key_buffer_, keys.size());
-
-    CHECK_CUDA(cudaEventRecord(stop_, 0));
-    CHECK_CUDA(cudaEventSynchronize(stop_));
-    CHECK_CUDA(cudaEventElapsedTime(&time, start_, stop_));
-    return time;
+    return session_->Remove(keys);
 }
 
+#ifndef SLABHASH_BACKEND_CPU
 template <typename KeyT, typename ValueT, typename HashFunc>
 float UnorderedMap<KeyT, ValueT, HashFunc>::Remove(
         thrust::device_vector<KeyT>& keys) {
     float time;
-    CHECK_CUDA(cudaSetDevice(cuda_device_idx_));
-    CHECK_CUDA(cudaEventRecord(start_, 0));
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_);
+    timer_.Start();
 
     slab_hash_->Remove(thrust::raw_pointer_cast(keys.data()), keys.size());
-    CHECK_CUDA(cudaEventRecord(stop_, 0));
-    CHECK_CUDA(cudaEventSynchronize(stop_));
-    CHECK_CUDA(cudaEventElapsedTime(&time, start_, stop_));
+    time = timer_.Stop();
 
     return time;
 }
+#endif
 
 template <typename KeyT, typename ValueT, typename HashFunc>
 float UnorderedMap<KeyT, ValueT, HashFunc>::Remove(KeyT* keys, int num_keys) {
     float time;
-    CHECK_CUDA(cudaSetDevice(cuda_device_idx_));
-    CHECK_CUDA(cudaEventRecord(start_, 0));
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_);
+    timer_.Start();
 
     slab_hash_->Remove(keys, num_keys);
-    CHECK_CUDA(cudaEventRecord(stop_, 0));
-    CHECK_CUDA(cudaEventSynchronize(stop_));
-    CHECK_CUDA(cudaEventElapsedTime(&time, start_, stop_));
+    time = timer_.Stop();
 
     return time;
 }
 
+template <typename KeyT, typename ValueT, typename HashFunc>
+template <typename Result>
+std::future<Result> UnorderedMap<KeyT, ValueT, HashFunc>::Submit(
+        std::function<Result()> task) {
+    std::call_once(async_worker_started_, [this]() {
+        async_session_.reset(new Session(*this));
+        async_worker_.reset(new ThreadPool(1));
+    });
+    auto packaged_task =
+            std::make_shared<std::packaged_task<Result()>>(std::move(task));
+    async_worker_->Enqueue([packaged_task]() { (*packaged_task)(); });
+    return packaged_task->get_future();
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+std::future<float> UnorderedMap<KeyT, ValueT, HashFunc>::InsertAsync(
+        std::vector<KeyT> keys, std::vector<ValueT> values) {
+    auto batch = std::make_shared<
+            std::pair<std::vector<KeyT>, std::vector<ValueT>>>(
+            std::move(keys), std::move(values));
+    return Submit<float>([this, batch]() {
+        return async_session_->Insert(batch->first, batch->second);
+    });
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+std::future<typename UnorderedMap<KeyT, ValueT, HashFunc>::SearchResult>
+UnorderedMap<KeyT, ValueT, HashFunc>::SearchAsync(
+        std::vector<KeyT> query_keys) {
+    auto batch = std::make_shared<std::vector<KeyT>>(std::move(query_keys));
+    return Submit<SearchResult>([this, batch]() {
+        SearchResult result;
+        result.values.resize(batch->size());
+        result.founds.resize(batch->size());
+        result.time =
+                async_session_->Search(*batch, result.values, result.founds);
+        return result;
+    });
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+std::future<float> UnorderedMap<KeyT, ValueT, HashFunc>::RemoveAsync(
+        std::vector<KeyT> keys) {
+    auto batch = std::make_shared<std::vector<KeyT>>(std::move(keys));
+    return Submit<float>(
+            [this, batch]() { return async_session_->Remove(*batch); });
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+uint32_t UnorderedMap<KeyT, ValueT, HashFunc>::Size() {
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_);
+    return slab_hash_->Size();
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Export(
+        std::vector<KeyT>& keys, std::vector<ValueT>& values) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_);
+
+    /* The inline layout has no pair pool: the table may outgrow max_keys */
+    uint32_t num_pairs = slab_hash_->Size();
+    KeyT* keys_device;
+    ValueT* values_device;
+    BackendMalloc(&keys_device, sizeof(KeyT) * num_pairs);
+    BackendMalloc(&values_device, sizeof(ValueT) * num_pairs);
+
+    timer_.Start();
+
+    num_pairs = slab_hash_->Export(keys_device, values_device);
+
+    time = timer_.Stop();
+
+    keys.resize(num_pairs);
+    values.resize(num_pairs);
+    BackendMemcpy(keys.data(), keys_device, sizeof(KeyT) * num_pairs);
+    BackendMemcpy(values.data(), values_device, sizeof(ValueT) * num_pairs);
+    BackendSynchronize();
+
+    BackendFree(keys_device);
+    BackendFree(values_device);
+    return time;
+}
+
+#ifndef SLABHASH_BACKEND_CPU
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Export(
+        thrust::device_vector<KeyT>& keys,
+        thrust::device_vector<ValueT>& values) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_);
+
+    uint32_t num_pairs = slab_hash_->Size();
+    keys.resize(num_pairs);
+    values.resize(num_pairs);
+
+    timer_.Start();
+
+    slab_hash_->Export(thrust::raw_pointer_cast(keys.data()),
+                       thrust::raw_pointer_cast(values.data()));
+
+    time = timer_.Stop();
+    return time;
+}
+#endif
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Export(KeyT* keys,
+                                                   ValueT* values,
+                                                   uint32_t& num_pairs) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_);
+    timer_.Start();
+    num_pairs = slab_hash_->Export(keys, values);
+    time = timer_.Stop();
+    return time;
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+template <typename Func>
+float UnorderedMap<KeyT, ValueT, HashFunc>::ForEach(Func func) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_);
+    timer_.Start();
+    slab_hash_->ForEach(func);
+    time = timer_.Stop();
+    return time;
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Rehash(uint32_t num_buckets) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_, true);
+    timer_.Start();
+    slab_hash_->Rehash(num_buckets);
+    time = timer_.Stop();
+    return time;
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Compact() {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_, true);
+    timer_.Start();
+    slab_hash_->Compact();
+    time = timer_.Stop();
+    return time;
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Relayout() {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    SharedMutexLock lock(mutex_, true);
+    timer_.Start();
+    slab_hash_->Relayout();
+    time = timer_.Stop();
+    return time;
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+void UnorderedMap<KeyT, ValueT, HashFunc>::SetMaxChainLength(
+        float max_chain_length) {
+    SharedMutexLock lock(mutex_, true);
+    slab_hash_->SetMaxChainLength(max_chain_length);
+    automatic_growth_ = max_chain_length > 0;
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+void UnorderedMap<KeyT, ValueT, HashFunc>::SetNearTailAllocation(
+        bool near_tail_allocation) {
+    SharedMutexLock lock(mutex_, true);
+    slab_hash_->SetNearTailAllocation(near_tail_allocation);
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+void UnorderedMap<KeyT, ValueT, HashFunc>::SetBucketOrderedSearch(
+        bool bucket_ordered_search) {
+    SharedMutexLock lock(mutex_, true);
+    slab_hash_->SetBucketOrderedSearch(bucket_ordered_search);
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+void UnorderedMap<KeyT, ValueT, HashFunc>::SetBatchDeduplication(
+        bool batch_deduplication) {
+    SharedMutexLock lock(mutex_, true);
+    slab_hash_->SetBatchDeduplication(batch_deduplication);
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+void UnorderedMap<KeyT, ValueT, HashFunc>::EnableLinearHashing(
+        uint32_t max_buckets, uint32_t splits_per_batch) {
+    SharedMutexLock lock(mutex_, true);
+    slab_hash_->EnableLinearHashing(max_buckets, splits_per_batch);
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+bool UnorderedMap<KeyT, ValueT, HashFunc>::Reserve(uint32_t max_pairs) {
+    SharedMutexLock lock(mutex_, true);
+    return slab_hash_->Reserve(max_pairs);
+}
+
 template <typename KeyT, typename ValueT, typename HashFunc>
 float UnorderedMap<KeyT, ValueT, HashFunc>::ComputeLoadFactor(
         int flag /* = 0 */) {
+    SharedMutexLock lock(mutex_);
     return slab_hash_->ComputeLoadFactor(flag);
 }
+
+/** Sessions **/
+template <typename KeyT, typename ValueT, typename HashFunc>
+UnorderedMap<KeyT, ValueT, HashFunc>::Session::Session(UnorderedMap& map)
+    : map_(map) {
+    BackendSetDevice(map_.cuda_device_idx_);
+
+    // allocating key, value arrays:
+    BackendMalloc(&key_buffer_, sizeof(KeyT) * map_.max_keys_);
+    BackendMalloc(&value_buffer_, sizeof(ValueT) * map_.max_keys_);
+    BackendMalloc(&query_key_buffer_, sizeof(KeyT) * map_.max_keys_);
+    BackendMalloc(&query_value_buffer_, sizeof(ValueT) * map_.max_keys_);
+    BackendMalloc(&query_result_buffer_, sizeof(uint8_t) * map_.max_keys_);
+    BackendMalloc(&iterator_buffer_, sizeof(iterator_t) * map_.max_keys_);
+#ifdef SLABHASH_BACKEND_CPU
+    host_key_buffer_ = nullptr;
+    host_value_buffer_ = nullptr;
+    host_query_key_buffer_ = nullptr;
+    host_query_value_buffer_ = nullptr;
+    host_query_result_buffer_ = nullptr;
+    host_iterator_buffer_ = nullptr;
+#else
+    BackendMallocHost(&host_key_buffer_, sizeof(KeyT) * map_.max_keys_);
+    BackendMallocHost(&host_value_buffer_, sizeof(ValueT) * map_.max_keys_);
+    BackendMallocHost(&host_query_key_buffer_,
+                      sizeof(KeyT) * map_.max_keys_);
+    BackendMallocHost(&host_query_value_buffer_,
+                      sizeof(ValueT) * map_.max_keys_);
+    BackendMallocHost(&host_query_result_buffer_,
+                      sizeof(uint8_t) * map_.max_keys_);
+    BackendMallocHost(&host_iterator_buffer_,
+                      sizeof(iterator_t) * map_.max_keys_);
+#endif
+    BackendStreamCreate(&copy_stream_);
+    BackendEventCreate(&chunk_done_[0]);
+    BackendEventCreate(&chunk_done_[1]);
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+UnorderedMap<KeyT, ValueT, HashFunc>::Session::~Session() {
+    BackendSetDevice(map_.cuda_device_idx_);
+
+    BackendFree(key_buffer_);
+    BackendFree(value_buffer_);
+
+    BackendFree(query_key_buffer_);
+    BackendFree(query_value_buffer_);
+    BackendFree(query_result_buffer_);
+    BackendFree(iterator_buffer_);
+
+#ifndef SLABHASH_BACKEND_CPU
+    BackendFreeHost(host_key_buffer_);
+    BackendFreeHost(host_value_buffer_);
+    BackendFreeHost(host_query_key_buffer_);
+    BackendFreeHost(host_query_value_buffer_);
+    BackendFreeHost(host_query_result_buffer_);
+    BackendFreeHost(host_iterator_buffer_);
+#endif
+
+    BackendStreamDestroy(copy_stream_);
+    BackendEventDestroy(chunk_done_[0]);
+    BackendEventDestroy(chunk_done_[1]);
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+template <typename Stage, typename Run, typename Unstage>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Session::StreamBatch(
+        uint32_t num_keys,
+        Stage stage,
+        Run run,
+        Unstage unstage) {
+    const uint32_t num_slots =
+            num_keys > map_.max_keys_ && map_.max_keys_ > 1 ? 2 : 1;
+    const uint32_t chunk_size = map_.max_keys_ / num_slots;
+    assert(chunk_size > 0 || num_keys == 0);
+
+    float time = 0;
+    stage(0, std::min(num_keys, chunk_size), 0, copy_stream_);
+    for (uint32_t begin = 0, chunk = 0; begin < num_keys;
+         begin += chunk_size, ++chunk) {
+        const uint32_t slot = chunk % num_slots;
+        const uint32_t offset = slot * chunk_size;
+        const uint32_t count = std::min(chunk_size, num_keys - begin);
+
+        /* The chunk is staged, and the outputs of the previous one are out */
+        BackendStreamSynchronize(copy_stream_);
+        FlushOutputs();
+        timer_.Start();
+        run(offset, count);
+        timer_.Mark();
+        BackendEventRecord(chunk_done_[slot]);
+
+        /* Stage the next chunk once the chunk before this one released its
+         * slot, while this one runs */
+        const uint32_t next_begin = begin + chunk_size;
+        if (next_begin < num_keys) {
+            const uint32_t next_slot = (chunk + 1) % num_slots;
+            BackendStreamWaitEvent(copy_stream_, chunk_done_[next_slot]);
+            stage(next_begin, std::min(chunk_size, num_keys - next_begin),
+                  next_slot * chunk_size, copy_stream_);
+        }
+        time += timer_.Elapsed();
+
+        BackendStreamWaitEvent(copy_stream_, chunk_done_[slot]);
+        unstage(begin, count, offset, copy_stream_);
+    }
+    BackendStreamSynchronize(copy_stream_);
+    FlushOutputs();
+    return time;
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+template <typename Stage, typename Run>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Session::StreamBatch(
+        uint32_t num_keys, Stage stage, Run run) {
+    return StreamBatch(num_keys, stage, run,
+                       [](uint32_t, uint32_t, uint32_t, BackendStream) {});
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+template <typename T>
+void UnorderedMap<KeyT, ValueT, HashFunc>::Session::StageIn(
+        T* buffer,
+        T* host_buffer,
+        uint32_t offset,
+        const T* src,
+        uint32_t count,
+        BackendStream stream) {
+#ifdef SLABHASH_BACKEND_CPU
+    (void)host_buffer;
+    BackendMemcpyAsync(buffer + offset, src, sizeof(T) * count, stream);
+#else
+    /* The slot of the mirror was last read by the chunk before the
+     * previous one, whose copy is complete */
+    std::memcpy(host_buffer + offset, src, sizeof(T) * count);
+    BackendMemcpyAsync(buffer + offset, host_buffer + offset,
+                       sizeof(T) * count, stream);
+#endif
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+template <typename T>
+void UnorderedMap<KeyT, ValueT, HashFunc>::Session::StageOut(
+        T* dst,
+        const T* buffer,
+        T* host_buffer,
+        uint32_t offset,
+        uint32_t count,
+        BackendStream stream) {
+#ifdef SLABHASH_BACKEND_CPU
+    (void)host_buffer;
+    BackendMemcpyAsync(dst, buffer + offset, sizeof(T) * count, stream);
+#else
+    BackendMemcpyAsync(host_buffer + offset, buffer + offset,
+                       sizeof(T) * count, stream);
+    pending_outputs_.push_back({dst, host_buffer + offset, sizeof(T) * count});
+#endif
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+void UnorderedMap<KeyT, ValueT, HashFunc>::Session::FlushOutputs() {
+    for (const PendingOutput& output : pending_outputs_) {
+        std::memcpy(output.dst, output.src, output.bytes);
+    }
+    pending_outputs_.clear();
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Session::Insert(
+        const std::vector<KeyT>& keys, const std::vector<ValueT>& values) {
+    assert(values.size() == keys.size());
+
+    BackendSetDevice(map_.cuda_device_idx_);
+    SharedMutexLock lock(map_.mutex_,
+                         map_.automatic_growth_ ||
+                                 map_.slab_hash_->MayGrowSlabs(keys.size()));
+    return StreamBatch(
+            keys.size(),
+            [&](uint32_t begin, uint32_t count, uint32_t offset,
+                BackendStream stream) {
+                StageIn(key_buffer_, host_key_buffer_, offset,
+                        keys.data() + begin, count, stream);
+                StageIn(value_buffer_, host_value_buffer_, offset,
+                        values.data() + begin, count, stream);
+            },
+            [&](uint32_t offset, uint32_t count) {
+                map_.slab_hash_->Insert(key_buffer_ + offset,
+                                        value_buffer_ + offset, count);
+            });
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Session::Insert(
+        const std::vector<KeyT>& keys,
+        const std::vector<ValueT>& values,
+        std::vector<uint8_t>& statuses) {
+    assert(values.size() == keys.size());
+
+    BackendSetDevice(map_.cuda_device_idx_);
+    SharedMutexLock lock(map_.mutex_,
+                         map_.automatic_growth_ ||
+                                 map_.slab_hash_->MayGrowSlabs(keys.size()));
+    statuses.resize(keys.size());
+    return StreamBatch(
+            keys.size(),
+            [&](uint32_t begin, uint32_t count, uint32_t offset,
+                BackendStream stream) {
+                StageIn(key_buffer_, host_key_buffer_, offset,
+                        keys.data() + begin, count, stream);
+                StageIn(value_buffer_, host_value_buffer_, offset,
+                        values.data() + begin, count, stream);
+            },
+            [&](uint32_t offset, uint32_t count) {
+                map_.slab_hash_->Insert(key_buffer_ + offset,
+                                        value_buffer_ + offset, count,
+                                        query_result_buffer_ + offset);
+            },
+            [&](uint32_t begin, uint32_t count, uint32_t offset,
+                BackendStream stream) {
+                StageOut(statuses.data() + begin, query_result_buffer_,
+                         host_query_result_buffer_, offset, count, stream);
+            });
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Session::BulkBuild(
+        const std::vector<KeyT>& keys, const std::vector<ValueT>& values) {
+    assert(values.size() == keys.size());
+
+    BackendSetDevice(map_.cuda_device_idx_);
+    SharedMutexLock lock(map_.mutex_, true);
+    return StreamBatch(
+            keys.size(),
+            [&](uint32_t begin, uint32_t count, uint32_t offset,
+                BackendStream stream) {
+                StageIn(key_buffer_, host_key_buffer_, offset,
+                        keys.data() + begin, count, stream);
+                StageIn(value_buffer_, host_value_buffer_, offset,
+                        values.data() + begin, count, stream);
+            },
+            [&](uint32_t offset, uint32_t count) {
+                map_.slab_hash_->BulkBuild(key_buffer_ + offset,
+                                           value_buffer_ + offset, count);
+            });
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Session::InsertOrAssign(
+        const std::vector<KeyT>& keys, const std::vector<ValueT>& values) {
+    assert(values.size() == keys.size());
+
+    BackendSetDevice(map_.cuda_device_idx_);
+    SharedMutexLock lock(map_.mutex_, true);
+    return StreamBatch(
+            keys.size(),
+            [&](uint32_t begin, uint32_t count, uint32_t offset,
+                BackendStream stream) {
+                StageIn(key_buffer_, host_key_buffer_, offset,
+                        keys.data() + begin, count, stream);
+                StageIn(value_buffer_, host_value_buffer_, offset,
+                        values.data() + begin, count, stream);
+            },
+            [&](uint32_t offset, uint32_t count) {
+                map_.slab_hash_->InsertOrAssign(key_buffer_ + offset,
+                                                value_buffer_ + offset, count);
+            });
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Session::UpdateExisting(
+        const std::vector<KeyT>& keys, const std::vector<ValueT>& values) {
+    assert(values.size() == keys.size());
+
+    BackendSetDevice(map_.cuda_device_idx_);
+    SharedMutexLock lock(map_.mutex_, true);
+    return StreamBatch(
+            keys.size(),
+            [&](uint32_t begin, uint32_t count, uint32_t offset,
+                BackendStream stream) {
+                StageIn(key_buffer_, host_key_buffer_, offset,
+                        keys.data() + begin, count, stream);
+                StageIn(value_buffer_, host_value_buffer_, offset,
+                        values.data() + begin, count, stream);
+            },
+            [&](uint32_t offset, uint32_t count) {
+                map_.slab_hash_->UpdateExisting(key_buffer_ + offset,
+                                                value_buffer_ + offset, count);
+            });
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+template <typename ReduceFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Session::InsertOrReduce(
+        const std::vector<KeyT>& keys,
+        const std::vector<ValueT>& values,
+        ReduceFunc reduce) {
+    assert(values.size() == keys.size());
+
+    BackendSetDevice(map_.cuda_device_idx_);
+    SharedMutexLock lock(map_.mutex_, true);
+    return StreamBatch(
+            keys.size(),
+            [&](uint32_t begin, uint32_t count, uint32_t offset,
+                BackendStream stream) {
+                StageIn(key_buffer_, host_key_buffer_, offset,
+                        keys.data() + begin, count, stream);
+                StageIn(value_buffer_, host_value_buffer_, offset,
+                        values.data() + begin, count, stream);
+            },
+            [&](uint32_t offset, uint32_t count) {
+                map_.slab_hash_->InsertOrReduce(key_buffer_ + offset,
+                                                value_buffer_ + offset, count,
+                                                reduce);
+            });
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Session::Activate(
+        const std::vector<KeyT>& keys,
+        std::vector<iterator_t>& iterators,
+        std::vector<uint8_t>& is_new) {
+    iterators.resize(keys.size());
+    is_new.resize(keys.size());
+
+    BackendSetDevice(map_.cuda_device_idx_);
+    SharedMutexLock lock(map_.mutex_, map_.automatic_growth_);
+    return StreamBatch(
+            keys.size(),
+            [&](uint32_t begin, uint32_t count, uint32_t offset,
+                BackendStream stream) {
+                StageIn(key_buffer_, host_key_buffer_, offset,
+                        keys.data() + begin, count, stream);
+            },
+            [&](uint32_t offset, uint32_t count) {
+                map_.slab_hash_->Activate(key_buffer_ + offset,
+                                          iterator_buffer_ + offset,
+                                          query_result_buffer_ + offset, count);
+            },
+            [&](uint32_t begin, uint32_t count, uint32_t offset,
+                BackendStream stream) {
+                StageOut(iterators.data() + begin, iterator_buffer_,
+                         host_iterator_buffer_, offset, count, stream);
+                StageOut(is_new.data() + begin, query_result_buffer_,
+                         host_query_result_buffer_, offset, count, stream);
+            });
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Session::Search(
+        const std::vector<KeyT>& query_keys,
+        std::vector<ValueT>& query_values,
+        std::vector<uint8_t>& query_found) {
+    assert(query_found.size() >= query_keys.size());
+    assert(query_values.size() >= query_keys.size());
+
+    BackendSetDevice(map_.cuda_device_idx_);
+    SharedMutexLock lock(map_.mutex_);
+    return StreamBatch(
+            query_keys.size(),
+            [&](uint32_t begin, uint32_t count, uint32_t offset,
+                BackendStream stream) {
+                StageIn(query_key_buffer_, host_query_key_buffer_, offset,
+                        query_keys.data() + begin, count, stream);
+            },
+            [&](uint32_t offset, uint32_t count) {
+                BackendMemset(query_value_buffer_ + offset, 0xFF,
+                              sizeof(ValueT) * count);
+                BackendMemset(query_result_buffer_ + offset, 0,
+                              sizeof(uint8_t) * count);
+                map_.slab_hash_->Search(query_key_buffer_ + offset,
+                                        query_value_buffer_ + offset,
+                                        query_result_buffer_ + offset, count);
+            },
+            [&](uint32_t begin, uint32_t count, uint32_t offset,
+                BackendStream stream) {
+                StageOut(query_values.data() + begin, query_value_buffer_,
+                         host_query_value_buffer_, offset, count, stream);
+                StageOut(query_found.data() + begin, query_result_buffer_,
+                         host_query_result_buffer_, offset, count, stream);
+            });
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMap<KeyT, ValueT, HashFunc>::Session::Remove(
+        const std::vector<KeyT>& keys) {
+    BackendSetDevice(map_.cuda_device_idx_);
+    SharedMutexLock lock(map_.mutex_);
+    return StreamBatch(
+            keys.size(),
+            [&](uint32_t begin, uint32_t count, uint32_t offset,
+                BackendStream stream) {
+                StageIn(key_buffer_, host_key_buffer_, offset,
+                        keys.data() + begin, count, stream);
+            },
+            [&](uint32_t offset, uint32_t count) {
+                map_.slab_hash_->Remove(key_buffer_ + offset, count);
+            });
+}
@@ -0,0 +1,403 @@
+/*
+ * Copyright 2019 Saman Ashkiani
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+
+#include <numeric>
+
+#include "hash.h"
+#include "slab_hash/slab_hash.h"
+#ifndef SLABHASH_BACKEND_CPU
+#include <thrust/device_vector.h>
+#include <thrust/scan.h>
+#endif
+
+/* Lightweight wrapper to handle host input, see UnorderedMap.
+ * A key may be inserted several times; a query returns all its values in a
+ * CSR layout: the values of query_keys[i] are
+ * values[offsets[i]:offsets[i + 1]], in no particular order. */
+template <typename KeyT, typename ValueT, typename HashFunc = hash<KeyT>>
+class UnorderedMultiMap {
+public:
+    UnorderedMultiMap(uint32_t max_keys,
+                      /* Preset hash table params to estimate bucket num */
+                      uint32_t keys_per_bucket = 15,
+                      float expected_occupancy_per_bucket = 0.6,
+                      /* CUDA device */
+                      const uint32_t device_idx = 0,
+                      /* Tag slab words with hash bits to filter key compares */
+                      bool use_fingerprints = false);
+    ~UnorderedMultiMap();
+
+#ifndef SLABHASH_BACKEND_CPU
+    float Insert(thrust::device_vector<KeyT>& keys,
+                 thrust::device_vector<ValueT>& values);
+#endif
+    float Insert(const std::vector<KeyT>& keys,
+                 const std::vector<ValueT>& values);
+    float Insert(KeyT* keys_device, ValueT* values_device, int num_keys);
+
+    /* Number of values of each query key */
+#ifndef SLABHASH_BACKEND_CPU
+    float Count(thrust::device_vector<KeyT>& query_keys,
+                thrust::device_vector<uint32_t>& counts);
+#endif
+    float Count(const std::vector<KeyT>& query_keys,
+                std::vector<uint32_t>& counts);
+    float Count(KeyT* query_keys_device, uint32_t* counts_device, int num_keys);
+
+    /* Count + prefix sum + SearchAll: @offsets and @values are resized */
+#ifndef SLABHASH_BACKEND_CPU
+    float SearchAll(thrust::device_vector<KeyT>& query_keys,
+                    thrust::device_vector<uint32_t>& offsets,
+                    thrust::device_vector<ValueT>& values);
+#endif
+    float SearchAll(const std::vector<KeyT>& query_keys,
+                    std::vector<uint32_t>& offsets,
+                    std::vector<ValueT>& values);
+    /* @offsets_device (num_keys + 1) is provided by the caller, from the
+     * exclusive prefix sum of Count */
+    float SearchAll(KeyT* query_keys_device,
+                    uint32_t* offsets_device,
+                    ValueT* values_device,
+                    int num_keys);
+
+    /* Removes one pair per occurrence of a key in @keys */
+#ifndef SLABHASH_BACKEND_CPU
+    float Remove(thrust::device_vector<KeyT>& keys);
+#endif
+    float Remove(const std::vector<KeyT>& keys);
+    float Remove(KeyT* keys, int num_keys);
+
+    float ComputeLoadFactor(int flag = 0);
+
+private:
+    uint32_t max_keys_;
+    uint32_t num_buckets_;
+    uint32_t cuda_device_idx_;
+
+    /* Timer */
+    BackendTimer timer_;
+
+    /* Handled by the backend */
+    KeyT* key_buffer_;
+    ValueT* value_buffer_;
+    uint32_t* offset_buffer_;
+
+    /* Duplicate keys need the pair pool: never the inline layout */
+    std::shared_ptr<SlabHash<KeyT, ValueT, HashFunc, false>> slab_hash_;
+};
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+UnorderedMultiMap<KeyT, ValueT, HashFunc>::UnorderedMultiMap(
+        uint32_t max_keys,
+        uint32_t keys_per_bucket,
+        float expected_occupancy_per_bucket,
+        const uint32_t device_idx,
+        bool use_fingerprints)
+    : max_keys_(max_keys), cuda_device_idx_(device_idx), slab_hash_(nullptr) {
+    /* Set bucket size */
+    uint32_t expected_keys_per_bucket =
+            expected_occupancy_per_bucket * keys_per_bucket;
+    num_buckets_ = (max_keys + expected_keys_per_bucket - 1) /
+                   expected_keys_per_bucket;
+
+    /* Set device */
+#ifndef SLABHASH_BACKEND_CPU
+    int32_t cuda_device_count_ = 0;
+    CHECK_CUDA(cudaGetDeviceCount(&cuda_device_count_));
+    assert(cuda_device_idx_ < cuda_device_count_);
+#endif
+    BackendSetDevice(cuda_device_idx_);
+
+    // allocating key, value, offset arrays:
+    BackendMalloc(&key_buffer_, sizeof(KeyT) * max_keys_);
+    BackendMalloc(&value_buffer_, sizeof(ValueT) * max_keys_);
+    BackendMalloc(&offset_buffer_, sizeof(uint32_t) * (max_keys_ + 1));
+
+    // allocate an initialize the allocator:
+    slab_hash_ = std::make_shared<SlabHash<KeyT, ValueT, HashFunc, false>>(
+            num_buckets_, max_keys_, cuda_device_idx_, use_fingerprints);
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+UnorderedMultiMap<KeyT, ValueT, HashFunc>::~UnorderedMultiMap() {
+    BackendSetDevice(cuda_device_idx_);
+
+    BackendFree(key_buffer_);
+    BackendFree(value_buffer_);
+    BackendFree(offset_buffer_);
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMultiMap<KeyT, ValueT, HashFunc>::Insert(
+        const std::vector<KeyT>& keys, const std::vector<ValueT>& values) {
+    float time = 0;
+    assert(values.size() == keys.size());
+
+    BackendSetDevice(cuda_device_idx_);
+    /* Batches larger than the buffers are copied in chunks of max_keys_ */
+    for (uint32_t begin = 0; begin < keys.size(); begin += max_keys_) {
+        const uint32_t count =
+                std::min<size_t>(max_keys_, keys.size() - begin);
+        BackendMemcpy(key_buffer_, keys.data() + begin, sizeof(KeyT) * count);
+        BackendMemcpy(value_buffer_, values.data() + begin,
+                      sizeof(ValueT) * count);
+
+        timer_.Start();
+        slab_hash_->InsertMulti(key_buffer_, value_buffer_, count);
+        time += timer_.Stop();
+    }
+    return time;
+}
+
+#ifndef SLABHASH_BACKEND_CPU
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMultiMap<KeyT, ValueT, HashFunc>::Insert(
+        thrust::device_vector<KeyT>& keys,
+        thrust::device_vector<ValueT>& values) {
+    float time;
+    assert(values.size() == keys.size());
+
+    BackendSetDevice(cuda_device_idx_);
+    timer_.Start();
+
+    slab_hash_->InsertMulti(thrust::raw_pointer_cast(keys.data()),
+                            thrust::raw_pointer_cast(values.data()),
+                            keys.size());
+
+    time = timer_.Stop();
+    return time;
+}
+#endif
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMultiMap<KeyT, ValueT, HashFunc>::Insert(KeyT* keys,
+                                                        ValueT* values,
+                                                        int num_keys) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    timer_.Start();
+    slab_hash_->InsertMulti(keys, values, num_keys);
+    time = timer_.Stop();
+    return time;
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMultiMap<KeyT, ValueT, HashFunc>::Count(
+        const std::vector<KeyT>& query_keys, std::vector<uint32_t>& counts) {
+    float time = 0;
+    assert(counts.size() >= query_keys.size());
+
+    BackendSetDevice(cuda_device_idx_);
+    for (uint32_t begin = 0; begin < query_keys.size(); begin += max_keys_) {
+        const uint32_t count =
+                std::min<size_t>(max_keys_, query_keys.size() - begin);
+        BackendMemcpy(key_buffer_, query_keys.data() + begin,
+                      sizeof(KeyT) * count);
+
+        timer_.Start();
+        slab_hash_->Count(key_buffer_, offset_buffer_, count);
+        time += timer_.Stop();
+
+        BackendMemcpy(counts.data() + begin, offset_buffer_,
+                      sizeof(uint32_t) * count);
+    }
+    BackendSynchronize();
+    return time;
+}
+
+#ifndef SLABHASH_BACKEND_CPU
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMultiMap<KeyT, ValueT, HashFunc>::Count(
+        thrust::device_vector<KeyT>& query_keys,
+        thrust::device_vector<uint32_t>& counts) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    timer_.Start();
+
+    slab_hash_->Count(thrust::raw_pointer_cast(query_keys.data()),
+                      thrust::raw_pointer_cast(counts.data()),
+                      query_keys.size());
+
+    time = timer_.Stop();
+    return time;
+}
+#endif
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMultiMap<KeyT, ValueT, HashFunc>::Count(KeyT* query_keys,
+                                                       uint32_t* counts,
+                                                       int num_keys) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    timer_.Start();
+
+    slab_hash_->Count(query_keys, counts, num_keys);
+
+    time = timer_.Stop();
+    return time;
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMultiMap<KeyT, ValueT, HashFunc>::SearchAll(
+        const std::vector<KeyT>& query_keys,
+        std::vector<uint32_t>& offsets,
+        std::vector<ValueT>& values) {
+    float time = 0;
+    const uint32_t num_keys = query_keys.size();
+
+    BackendSetDevice(cuda_device_idx_);
+
+    /* Pass 1: counts, turned into offsets on the host. The keys are
+     * processed in chunks of max_keys_, the size of the buffers */
+    offsets.resize(num_keys + 1);
+    offsets[0] = 0;
+    for (uint32_t begin = 0; begin < num_keys; begin += max_keys_) {
+        const uint32_t count = std::min(max_keys_, num_keys - begin);
+        BackendMemcpy(key_buffer_, query_keys.data() + begin,
+                      sizeof(KeyT) * count);
+
+        timer_.Start();
+        slab_hash_->Count(key_buffer_, offset_buffer_, count);
+        time += timer_.Stop();
+
+        BackendMemcpy(offsets.data() + 1 + begin, offset_buffer_,
+                      sizeof(uint32_t) * count);
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    /* Pass 2: values, at the offsets of the whole batch. A single chunk
+     * still has its keys in the buffer */
+    ValueT* result_buffer;
+    values.resize(offsets[num_keys]);
+    BackendMalloc(&result_buffer, sizeof(ValueT) * values.size());
+    for (uint32_t begin = 0; begin < num_keys; begin += max_keys_) {
+        const uint32_t count = std::min(max_keys_, num_keys - begin);
+        if (num_keys > max_keys_) {
+            BackendMemcpy(key_buffer_, query_keys.data() + begin,
+                          sizeof(KeyT) * count);
+        }
+        BackendMemcpy(offset_buffer_, offsets.data() + begin,
+                      sizeof(uint32_t) * (count + 1));
+
+        timer_.Start();
+        slab_hash_->SearchAll(key_buffer_, offset_buffer_, result_buffer,
+                              count);
+        time += timer_.Stop();
+    }
+
+    BackendMemcpy(values.data(), result_buffer,
+                  sizeof(ValueT) * values.size());
+    BackendSynchronize();
+    BackendFree(result_buffer);
+    return time;
+}
+
+#ifndef SLABHASH_BACKEND_CPU
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMultiMap<KeyT, ValueT, HashFunc>::SearchAll(
+        thrust::device_vector<KeyT>& query_keys,
+        thrust::device_vector<uint32_t>& offsets,
+        thrust::device_vector<ValueT>& values) {
+    float time;
+    const uint32_t num_keys = query_keys.size();
+
+    BackendSetDevice(cuda_device_idx_);
+    timer_.Start();
+
+    offsets.resize(num_keys + 1);
+    offsets[num_keys] = 0;
+    slab_hash_->Count(thrust::raw_pointer_cast(query_keys.data()),
+                      thrust::raw_pointer_cast(offsets.data()), num_keys);
+    thrust::exclusive_scan(offsets.begin(), offsets.end(), offsets.begin());
+
+    values.resize(offsets[num_keys]);
+    slab_hash_->SearchAll(thrust::raw_pointer_cast(query_keys.data()),
+                          thrust::raw_pointer_cast(offsets.data()),
+                          thrust::raw_pointer_cast(values.data()), num_keys);
+
+    time = timer_.Stop();
+    return time;
+}
+#endif
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMultiMap<KeyT, ValueT, HashFunc>::SearchAll(KeyT* query_keys,
+                                                           uint32_t* offsets,
+                                                           ValueT* values,
+                                                           int num_keys) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    timer_.Start();
+
+    slab_hash_->SearchAll(query_keys, offsets, values, num_keys);
+
+    time = timer_.Stop();
+    return time;
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMultiMap<KeyT, ValueT, HashFunc>::Remove(
+        const std::vector<KeyT>& keys) {
+    float time = 0;
+    BackendSetDevice(cuda_device_idx_);
+    for (uint32_t begin = 0; begin < keys.size(); begin += max_keys_) {
+        const uint32_t count =
+                std::min<size_t>(max_keys_, keys.size() - begin);
+        BackendMemcpy(key_buffer_, keys.data() + begin, sizeof(KeyT) * count);
+
+        timer_.Start();
+        slab_hash_->Remove(key_buffer_, count);
+        time += timer_.Stop();
+    }
+    return time;
+}
+
+#ifndef SLABHASH_BACKEND_CPU
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMultiMap<KeyT, ValueT, HashFunc>::Remove(
+        thrust::device_vector<KeyT>& keys) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    timer_.Start();
+
+    slab_hash_->Remove(thrust::raw_pointer_cast(keys.data()), keys.size());
+    time = timer_.Stop();
+
+    return time;
+}
+#endif
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMultiMap<KeyT, ValueT, HashFunc>::Remove(KeyT* keys,
+                                                        int num_keys) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    timer_.Start();
+
+    slab_hash_->Remove(keys, num_keys);
+    time = timer_.Stop();
+
+    return time;
+}
+
+template <typename KeyT, typename ValueT, typename HashFunc>
+float UnorderedMultiMap<KeyT, ValueT, HashFunc>::ComputeLoadFactor(
+        int flag /* = 0 */) {
+    return slab_hash_->ComputeLoadFactor(flag);
+}
@@ -0,0 +1,266 @@
+/*
+ * Copyright 2019 Saman Ashkiani
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+
+#include "hash.h"
+#include "slab_hash/slab_hash_set.h"
+#ifndef SLABHASH_BACKEND_CPU
+#include <thrust/device_vector.h>
+#endif
+
+/* Lightweight wrapper to handle host input, see UnorderedMap */
+/* KeyT supports elementary types: int, long, etc. */
+template <typename KeyT, typename HashFunc = hash<KeyT>>
+class UnorderedSet {
+public:
+    UnorderedSet(uint32_t max_keys,
+                 /* Preset hash table params to estimate bucket num */
+                 uint32_t keys_per_bucket = 15,
+                 float expected_occupancy_per_bucket = 0.6,
+                 /* CUDA device */
+                 const uint32_t device_idx = 0,
+                 /* Tag slab words with hash bits to filter key compares */
+                 bool use_fingerprints = false);
+    ~UnorderedSet();
+
+    /* found[i] is 1 iff query_keys[i] is in the set */
+    /* The std::vector overloads take batches of any size, copied through
+     * buffers of max_keys entries in chunks of max_keys */
+
+#ifndef SLABHASH_BACKEND_CPU
+    float Insert(thrust::device_vector<KeyT>& keys);
+#endif
+    float Insert(const std::vector<KeyT>& keys);
+    float Insert(KeyT* keys_device, int num_keys);
+
+#ifndef SLABHASH_BACKEND_CPU
+    float Contains(thrust::device_vector<KeyT>& query_keys,
+                   thrust::device_vector<uint8_t>& found);
+#endif
+    float Contains(const std::vector<KeyT>& query_keys,
+                   std::vector<uint8_t>& found);
+    float Contains(KeyT* query_keys_device, uint8_t* found, int num_keys);
+
+#ifndef SLABHASH_BACKEND_CPU
+    float Remove(thrust::device_vector<KeyT>& keys);
+#endif
+    float Remove(const std::vector<KeyT>& keys);
+    float Remove(KeyT* keys, int num_keys);
+
+    float ComputeLoadFactor(int flag = 0);
+
+private:
+    uint32_t max_keys_;
+    uint32_t num_buckets_;
+    uint32_t cuda_device_idx_;
+
+    /* Timer */
+    BackendTimer timer_;
+
+    /* Handled by the backend */
+    KeyT* key_buffer_;
+    uint8_t* query_result_buffer_;
+
+    std::shared_ptr<SlabHashSet<KeyT, HashFunc>> slab_hash_;
+};
+
+template <typename KeyT, typename HashFunc>
+UnorderedSet<KeyT, HashFunc>::UnorderedSet(uint32_t max_keys,
+                                           uint32_t keys_per_bucket,
+                                           float expected_occupancy_per_bucket,
+                                           const uint32_t device_idx,
+                                           bool use_fingerprints)
+    : max_keys_(max_keys), cuda_device_idx_(device_idx), slab_hash_(nullptr) {
+    /* Set bucket size */
+    uint32_t expected_keys_per_bucket =
+            expected_occupancy_per_bucket * keys_per_bucket;
+    num_buckets_ = (max_keys + expected_keys_per_bucket - 1) /
+                   expected_keys_per_bucket;
+
+    /* Set device */
+#ifndef SLABHASH_BACKEND_CPU
+    int32_t cuda_device_count_ = 0;
+    CHECK_CUDA(cudaGetDeviceCount(&cuda_device_count_));
+    assert(cuda_device_idx_ < cuda_device_count_);
+#endif
+    BackendSetDevice(cuda_device_idx_);
+
+    // allocating key, result arrays:
+    BackendMalloc(&key_buffer_, sizeof(KeyT) * max_keys_);
+    BackendMalloc(&query_result_buffer_, sizeof(uint8_t) * max_keys_);
+
+    // allocate an initialize the allocator:
+    slab_hash_ = std::make_shared<SlabHashSet<KeyT, HashFunc>>(
+            num_buckets_, max_keys_, cuda_device_idx_, use_fingerprints);
+}
+
+template <typename KeyT, typename HashFunc>
+UnorderedSet<KeyT, HashFunc>::~UnorderedSet() {
+    BackendSetDevice(cuda_device_idx_);
+
+    BackendFree(key_buffer_);
+    BackendFree(query_result_buffer_);
+}
+
+template <typename KeyT, typename HashFunc>
+float UnorderedSet<KeyT, HashFunc>::Insert(const std::vector<KeyT>& keys) {
+    float time = 0;
+    BackendSetDevice(cuda_device_idx_);
+    /* Batches larger than the buffers are copied in chunks of max_keys_ */
+    for (uint32_t begin = 0; begin < keys.size(); begin += max_keys_) {
+        const uint32_t count =
+                std::min<size_t>(max_keys_, keys.size() - begin);
+        BackendMemcpy(key_buffer_, keys.data() + begin, sizeof(KeyT) * count);
+
+        timer_.Start();
+        slab_hash_->Insert(key_buffer_, count);
+        time += timer_.Stop();
+    }
+    return time;
+}
+
+#ifndef SLABHASH_BACKEND_CPU
+template <typename KeyT, typename HashFunc>
+float UnorderedSet<KeyT, HashFunc>::Insert(thrust::device_vector<KeyT>& keys) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    timer_.Start();
+
+    slab_hash_->Insert(thrust::raw_pointer_cast(keys.data()), keys.size());
+
+    time = timer_.Stop();
+    return time;
+}
+#endif
+
+template <typename KeyT, typename HashFunc>
+float UnorderedSet<KeyT, HashFunc>::Insert(KeyT* keys, int num_keys) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    timer_.Start();
+    slab_hash_->Insert(keys, num_keys);
+    time = timer_.Stop();
+    return time;
+}
+
+template <typename KeyT, typename HashFunc>
+float UnorderedSet<KeyT, HashFunc>::Contains(
+        const std::vector<KeyT>& query_keys, std::vector<uint8_t>& found) {
+    float time = 0;
+    assert(found.size() >= query_keys.size());
+
+    BackendSetDevice(cuda_device_idx_);
+    for (uint32_t begin = 0; begin < query_keys.size(); begin += max_keys_) {
+        const uint32_t count =
+                std::min<size_t>(max_keys_, query_keys.size() - begin);
+        BackendMemcpy(key_buffer_, query_keys.data() + begin,
+                      sizeof(KeyT) * count);
+        BackendMemset(query_result_buffer_, 0, sizeof(uint8_t) * count);
+
+        timer_.Start();
+        slab_hash_->Contains(key_buffer_, query_result_buffer_, count);
+        time += timer_.Stop();
+
+        BackendMemcpy(found.data() + begin, query_result_buffer_,
+                      sizeof(uint8_t) * count);
+    }
+    BackendSynchronize();
+    return time;
+}
+
+#ifndef SLABHASH_BACKEND_CPU
+template <typename KeyT, typename HashFunc>
+float UnorderedSet<KeyT, HashFunc>::Contains(
+        thrust::device_vector<KeyT>& query_keys,
+        thrust::device_vector<uint8_t>& found) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+
+    thrust::fill(found.begin(), found.end(), 0);
+    timer_.Start();
+
+    slab_hash_->Contains(thrust::raw_pointer_cast(query_keys.data()),
+                         thrust::raw_pointer_cast(found.data()),
+                         query_keys.size());
+
+    time = timer_.Stop();
+    return time;
+}
+#endif
+
+template <typename KeyT, typename HashFunc>
+float UnorderedSet<KeyT, HashFunc>::Contains(KeyT* query_keys,
+                                             uint8_t* found,
+                                             int num_keys) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    BackendMemset(found, 0, sizeof(uint8_t) * num_keys);
+    timer_.Start();
+
+    slab_hash_->Contains(query_keys, found, num_keys);
+
+    time = timer_.Stop();
+    return time;
+}
+
+template <typename KeyT, typename HashFunc>
+float UnorderedSet<KeyT, HashFunc>::Remove(const std::vector<KeyT>& keys) {
+    float time = 0;
+    BackendSetDevice(cuda_device_idx_);
+    for (uint32_t begin = 0; begin < keys.size(); begin += max_keys_) {
+        const uint32_t count =
+                std::min<size_t>(max_keys_, keys.size() - begin);
+        BackendMemcpy(key_buffer_, keys.data() + begin, sizeof(KeyT) * count);
+
+        timer_.Start();
+        slab_hash_->Remove(key_buffer_, count);
+        time += timer_.Stop();
+    }
+    return time;
+}
+
+#ifndef SLABHASH_BACKEND_CPU
+template <typename KeyT, typename HashFunc>
+float UnorderedSet<KeyT, HashFunc>::Remove(thrust::device_vector<KeyT>& keys) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    timer_.Start();
+
+    slab_hash_->Remove(thrust::raw_pointer_cast(keys.data()), keys.size());
+    time = timer_.Stop();
+
+    return time;
+}
+#endif
+
+template <typename KeyT, typename HashFunc>
+float UnorderedSet<KeyT, HashFunc>::Remove(KeyT* keys, int num_keys) {
+    float time;
+    BackendSetDevice(cuda_device_idx_);
+    timer_.Start();
+
+    slab_hash_->Remove(keys, num_keys);
+    time = timer_.Stop();
+
+    return time;
+}
+
+template <typename KeyT, typename HashFunc>
+float UnorderedSet<KeyT, HashFunc>::ComputeLoadFactor(int flag /* = 0 */) {
+    return slab_hash_->ComputeLoadFactor(flag);
+}
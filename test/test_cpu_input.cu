@@ -21,8 +21,10 @@
 #include <cstdlib>
 #include <iostream>
 #include <random>
+#include <thread>
 #include <vector>
-#include "coordinate_hash_map.cuh"
+#include "unordered_map.h"
+#include "coordinate.h"
 
 using KeyT = uint32_t;
 constexpr size_t D = 7;
@@ -187,9 +189,19 @@ int TestInsert(TestDataHelperCPU &data_generator) {
             data_generator.keys_pool_size_ / 2, 0.4f);
 
     auto &insert_data = std::get<0>(insert_query_data_tuple);
+#ifdef SLABHASH_BACKEND_SIMT
+    SimtResetStats();
+#endif
     time = hash_table.Insert(insert_data.keys, insert_data.values);
     printf("1) Hash table built in %.3f ms (%.3f M elements/s)\n", time,
            double(insert_data.keys.size()) / (time * 1000.0));
+#ifdef SLABHASH_BACKEND_SIMT
+    SimtStats stats = SimtGetStats();
+    printf("   SIMT: %lu warps, %.2f ballots per warp (max %lu), "
+           "%lu / %lu CAS failed\n",
+           stats.num_warps, double(stats.num_ballots) / stats.num_warps,
+           stats.max_ballots_per_warp, stats.num_cas_failures, stats.num_cas);
+#endif
     printf("   Load factor = %f\n", hash_table.ComputeLoadFactor());
 
     auto &query_data = std::get<1>(insert_query_data_tuple);
@@ -206,11 +218,150 @@ int TestInsert(TestDataHelperCPU &data_generator) {
     return 0;
 }
 
-int TestRemove(TestDataHelperCPU &data_generator) {
+int TestBulkBuild(TestDataHelperCPU &data_generator) {
     float time;
     UnorderedMap<KeyTD, ValueT, HashFunc> hash_table(
             data_generator.keys_pool_size_);
 
+    auto insert_query_data_tuple = data_generator.GenerateData(
+            data_generator.keys_pool_size_ / 4, 0.4f);
+
+    /** Each key twice in the batch: one copy is kept **/
+    auto &insert_data = std::get<0>(insert_query_data_tuple);
+    const uint32_t num_keys = insert_data.keys.size();
+    std::vector<KeyTD> keys = insert_data.keys;
+    keys.insert(keys.end(), insert_data.keys.begin(), insert_data.keys.end());
+    std::vector<ValueT> values = insert_data.values;
+    values.insert(values.end(), insert_data.values.begin(),
+                  insert_data.values.end());
+#ifdef SLABHASH_BACKEND_SIMT
+    SimtResetStats();
+#endif
+    time = hash_table.BulkBuild(keys, values);
+    printf("1) Hash table bulk built in %.3f ms (%.3f M elements/s)\n", time,
+           double(keys.size()) / (time * 1000.0));
+#ifdef SLABHASH_BACKEND_SIMT
+    SimtStats stats = SimtGetStats();
+    printf("   SIMT: %lu warps, %.2f ballots per warp (max %lu), "
+           "%lu / %lu CAS failed\n",
+           stats.num_warps, double(stats.num_ballots) / stats.num_warps,
+           stats.max_ballots_per_warp, stats.num_cas_failures, stats.num_cas);
+#endif
+    printf("   Load factor = %f\n", hash_table.ComputeLoadFactor());
+    if (hash_table.Size() != num_keys) return -1;
+
+    auto &query_data = std::get<1>(insert_query_data_tuple);
+    auto &query_data_gt = std::get<2>(insert_query_data_tuple);
+    hash_table.Search(query_data.keys, query_data.values, query_data.masks);
+    bool query_correct = data_generator.CheckQueryResult(
+            query_data.values, query_data.masks, query_data_gt.values,
+            query_data_gt.masks);
+    if (!query_correct) return -1;
+
+    /** The stored keys are skipped by a second build **/
+    for (auto &v : values) {
+        v += 1;
+    }
+    hash_table.BulkBuild(keys, values);
+    if (hash_table.Size() != num_keys) return -1;
+
+    /** Same results in bucket order **/
+    hash_table.SetBucketOrderedSearch(true);
+    time = hash_table.Search(query_data.keys, query_data.values,
+                             query_data.masks);
+    printf("2) Hash table searched in bucket order in %.3f ms (%.3f M "
+           "queries/s)\n",
+           time, double(query_data.keys.size()) / (time * 1000.0));
+    query_correct = data_generator.CheckQueryResult(
+            query_data.values, query_data.masks, query_data_gt.values,
+            query_data_gt.masks);
+    if (!query_correct) return -1;
+
+    /** In-batch deduplication: Insert keeps the first copy of each key **/
+    UnorderedMap<KeyTD, ValueT, HashFunc> deduplicated(
+            data_generator.keys_pool_size_);
+    deduplicated.SetBatchDeduplication(true);
+    std::copy(insert_data.values.begin(), insert_data.values.end(),
+              values.begin());
+    time = deduplicated.Insert(keys, values);
+    printf("3) Hash table inserted with in-batch deduplication in %.3f ms "
+           "(%.3f M elements/s)\n",
+           time, double(keys.size()) / (time * 1000.0));
+    if (deduplicated.Size() != num_keys) return -1;
+    deduplicated.Search(query_data.keys, query_data.values, query_data.masks);
+    query_correct = data_generator.CheckQueryResult(
+            query_data.values, query_data.masks, query_data_gt.values,
+            query_data_gt.masks);
+    if (!query_correct) return -1;
+
+    return 0;
+}
+
+int TestSessions(TestDataHelperCPU &data_generator) {
+    UnorderedMap<KeyTD, ValueT, HashFunc> hash_table(
+            data_generator.keys_pool_size_);
+
+    auto insert_query_data_tuple = data_generator.GenerateData(
+            data_generator.keys_pool_size_ / 2, 0.4f);
+    auto &insert_data = std::get<0>(insert_query_data_tuple);
+    auto &query_data = std::get<1>(insert_query_data_tuple);
+    auto &query_data_gt = std::get<2>(insert_query_data_tuple);
+
+    /** A session per thread, each inserting a slice of the keys **/
+    const uint32_t num_threads = 4;
+    const uint32_t num_keys = insert_data.keys.size();
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            UnorderedMap<KeyTD, ValueT, HashFunc>::Session session(hash_table);
+            uint32_t begin = num_keys * t / num_threads;
+            uint32_t end = num_keys * (t + 1) / num_threads;
+            session.Insert(std::vector<KeyTD>(insert_data.keys.begin() + begin,
+                                              insert_data.keys.begin() + end),
+                           std::vector<ValueT>(
+                                   insert_data.values.begin() + begin,
+                                   insert_data.values.begin() + end));
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+    if (hash_table.Size() != num_keys) return -1;
+
+    /** Readers search while a writer inserts the same pairs again **/
+    std::vector<DataTupleCPU> results(num_threads, query_data);
+    for (uint32_t t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            UnorderedMap<KeyTD, ValueT, HashFunc>::Session session(hash_table);
+            if (t == 0) {
+                session.Insert(insert_data.keys, insert_data.values);
+            } else {
+                session.Search(results[t].keys, results[t].values,
+                               results[t].masks);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (uint32_t t = 1; t < num_threads; ++t) {
+        bool query_correct = data_generator.CheckQueryResult(
+                results[t].values, results[t].masks, query_data_gt.values,
+                query_data_gt.masks);
+        if (!query_correct) return -1;
+    }
+    if (hash_table.Size() != num_keys) return -1;
+
+    return 0;
+}
+
+int TestRemove(TestDataHelperCPU &data_generator,
+               bool use_fingerprints = false) {
+    float time;
+    UnorderedMap<KeyTD, ValueT, HashFunc> hash_table(
+            data_generator.keys_pool_size_, 15, 0.6, 0, use_fingerprints);
+
     auto insert_query_data_tuple = data_generator.GenerateData(
             data_generator.keys_pool_size_ / 2, 1.0f);
 
@@ -302,8 +453,451 @@ int TestConflict(TestDataHelperCPU &data_generator) {
     return 0;
 }
 
-int main() {
-    const int key_value_pool_size = 1 << 20;
+int TestAssign(TestDataHelperCPU &data_generator) {
+    float time;
+    UnorderedMap<KeyTD, ValueT, HashFunc> hash_table(
+            data_generator.keys_pool_size_);
+
+    auto insert_query_data_tuple = data_generator.GenerateData(
+            data_generator.keys_pool_size_ / 2, 0.5f);
+
+    auto &insert_data = std::get<0>(insert_query_data_tuple);
+    time = hash_table.Insert(insert_data.keys, insert_data.values);
+    printf("1) Hash table built in %.3f ms (%.3f M elements/s)\n", time,
+           double(insert_data.keys.size()) / (time * 1000.0));
+
+    auto &query_data = std::get<1>(insert_query_data_tuple);
+    auto &query_data_gt = std::get<2>(insert_query_data_tuple);
+
+    /** Update all the queries: only the existing keys change **/
+    auto update_values = query_data_gt.values;
+    for (auto &v : update_values) {
+        v += 1;
+    }
+    time = hash_table.UpdateExisting(query_data.keys, update_values);
+    printf("2) Hash table updated in %.3f ms (%.3f M queries/s)\n", time,
+           double(query_data.keys.size()) / (time * 1000.0));
+    hash_table.Search(query_data.keys, query_data.values, query_data.masks);
+    bool query_correct = data_generator.CheckQueryResult(
+            query_data.values, query_data.masks, update_values,
+            query_data_gt.masks);
+    if (!query_correct) return -1;
+
+    /** Insert or assign all the queries: everything is found **/
+    auto assign_values = query_data_gt.values;
+    for (auto &v : assign_values) {
+        v += 2;
+    }
+    time = hash_table.InsertOrAssign(query_data.keys, assign_values);
+    printf("3) Hash table assigned in %.3f ms (%.3f M queries/s)\n", time,
+           double(query_data.keys.size()) / (time * 1000.0));
+    printf("   Load factor = %f\n", hash_table.ComputeLoadFactor());
+    hash_table.Search(query_data.keys, query_data.values, query_data.masks);
+    query_correct = data_generator.CheckQueryResult(
+            query_data.values, query_data.masks, assign_values,
+            std::vector<uint8_t>(query_data.keys.size(), 1));
+    if (!query_correct) return -1;
+
+    return 0;
+}
+
+struct MinOp {
+    ValueT operator()(const ValueT &a, const ValueT &b) const {
+        return b < a ? b : a;
+    }
+};
+
+int TestReduce(TestDataHelperCPU &data_generator) {
+    float time;
+    const int num_copies = 4;
+
+    auto insert_query_data_tuple = data_generator.GenerateData(
+            data_generator.keys_pool_size_ / num_copies, 1.0f);
+    auto &insert_data = std::get<0>(insert_query_data_tuple);
+    auto &query_data = std::get<1>(insert_query_data_tuple);
+    auto &query_data_gt = std::get<2>(insert_query_data_tuple);
+
+    /** Every key appears num_copies times in the batch, with values v + c **/
+    DataTupleCPU reduce_data;
+    for (int c = 0; c < num_copies; ++c) {
+        for (size_t i = 0; i < insert_data.keys.size(); ++i) {
+            reduce_data.keys.push_back(insert_data.keys[i]);
+            reduce_data.values.push_back(insert_data.values[i] + c);
+            reduce_data.masks.push_back(1);
+        }
+    }
+    reduce_data.Shuffle(data_generator.seed_);
+
+    UnorderedMap<KeyTD, ValueT, HashFunc> min_table(
+            data_generator.keys_pool_size_);
+    time = min_table.InsertOrReduce(reduce_data.keys, reduce_data.values,
+                                    ReduceCAS<ValueT, MinOp>());
+    printf("1) Min reduced in %.3f ms (%.3f M elements/s)\n", time,
+           double(reduce_data.keys.size()) / (time * 1000.0));
+    printf("   Load factor = %f\n", min_table.ComputeLoadFactor());
+    min_table.Search(query_data.keys, query_data.values, query_data.masks);
+    bool query_correct = data_generator.CheckQueryResult(
+            query_data.values, query_data.masks, query_data_gt.values,
+            query_data_gt.masks);
+    if (!query_correct) return -1;
+
+    UnorderedMap<KeyTD, ValueT, HashFunc> count_table(
+            data_generator.keys_pool_size_);
+    time = count_table.InsertOrReduce(
+            reduce_data.keys, std::vector<ValueT>(reduce_data.keys.size(), 1),
+            ReduceAdd<ValueT>());
+    printf("2) Counts reduced in %.3f ms (%.3f M elements/s)\n", time,
+           double(reduce_data.keys.size()) / (time * 1000.0));
+    count_table.Search(query_data.keys, query_data.values, query_data.masks);
+    query_correct = data_generator.CheckQueryResult(
+            query_data.values, query_data.masks,
+            std::vector<ValueT>(query_data.keys.size(), num_copies),
+            query_data_gt.masks);
+    if (!query_correct) return -1;
+
+    return 0;
+}
+
+int TestActivate(TestDataHelperCPU &data_generator) {
+    float time;
+    UnorderedMap<KeyTD, ValueT, HashFunc> hash_table(
+            data_generator.keys_pool_size_);
+
+    auto insert_query_data_tuple = data_generator.GenerateData(
+            data_generator.keys_pool_size_ / 2, 0.5f);
+    auto &insert_data = std::get<0>(insert_query_data_tuple);
+    auto &query_data = std::get<1>(insert_query_data_tuple);
+    auto &query_data_gt = std::get<2>(insert_query_data_tuple);
+
+    /** Every key appears twice: exactly one copy creates the entry **/
+    std::vector<KeyTD> activate_keys = insert_data.keys;
+    activate_keys.insert(activate_keys.end(), insert_data.keys.begin(),
+                         insert_data.keys.end());
+    const uint32_t num_inserted = insert_data.keys.size();
+    std::vector<iterator_t> iterators(activate_keys.size());
+    std::vector<uint8_t> is_new(activate_keys.size());
+    time = hash_table.Activate(activate_keys, iterators, is_new);
+    printf("1) Hash table activated in %.3f ms (%.3f M elements/s)\n", time,
+           double(activate_keys.size()) / (time * 1000.0));
+
+    std::vector<uint8_t> used(data_generator.keys_pool_size_, 0);
+    for (uint32_t i = 0; i < num_inserted; ++i) {
+        if (iterators[i] != iterators[i + num_inserted] ||
+            is_new[i] + is_new[i + num_inserted] != 1) {
+            printf("### Wrong activation of key %d\n", i);
+            return -1;
+        }
+        if (iterators[i] >= used.size() || used[iterators[i]]) {
+            printf("### Iterator %d is invalid or not unique\n", iterators[i]);
+            return -1;
+        }
+        used[iterators[i]] = 1;
+    }
+
+    /** Activate the queries: only the missing keys are new; the outputs
+     * are sized by Activate **/
+    std::vector<iterator_t> query_iterators;
+    std::vector<uint8_t> query_is_new;
+    time = hash_table.Activate(query_data.keys, query_iterators, query_is_new);
+    printf("2) Hash table activated in %.3f ms (%.3f M queries/s)\n", time,
+           double(query_data.keys.size()) / (time * 1000.0));
+    for (uint32_t i = 0; i < query_data.keys.size(); ++i) {
+        if (query_is_new[i] == query_data_gt.masks[i] ||
+            query_iterators[i] >= used.size() ||
+            used[query_iterators[i]] == query_is_new[i]) {
+            printf("### Wrong activation of query %d\n", i);
+            return -1;
+        }
+        used[query_iterators[i]] = 1;
+    }
+
+    return 0;
+}
+
+int TestExport(TestDataHelperCPU &data_generator) {
+    float time;
+    UnorderedMap<KeyTD, ValueT, HashFunc> hash_table(
+            data_generator.keys_pool_size_);
+
+    auto insert_query_data_tuple = data_generator.GenerateData(
+            data_generator.keys_pool_size_ / 2, 1.0f);
+    auto &insert_data = std::get<0>(insert_query_data_tuple);
+    hash_table.Insert(insert_data.keys, insert_data.values);
+
+    DataTupleCPU export_data;
+    time = hash_table.Export(export_data.keys, export_data.values);
+    printf("1) Hash table exported in %.3f ms (%.3f M elements/s)\n", time,
+           double(export_data.keys.size()) / (time * 1000.0));
+    if (export_data.keys.size() != insert_data.keys.size() ||
+        hash_table.Size() != insert_data.keys.size()) {
+        printf("### Exported %zu pairs, but %zu were inserted\n",
+               export_data.keys.size(), insert_data.keys.size());
+        return -1;
+    }
+
+    /** Every exported key is distinct, and maps to its exported value **/
+    std::vector<uint8_t> masks_gt(export_data.keys.size(), 1);
+    export_data.masks.resize(export_data.keys.size());
+    std::vector<ValueT> query_values(export_data.keys.size());
+    hash_table.Search(export_data.keys, query_values, export_data.masks);
+    bool query_correct = data_generator.CheckQueryResult(
+            query_values, export_data.masks, export_data.values, masks_gt);
+    if (!query_correct) return -1;
+
+    uint64_t sum = 0, sum_gt = 0;
+    for (size_t i = 0; i < export_data.values.size(); ++i) {
+        sum += export_data.values[i];
+        sum_gt += insert_data.values[i];
+    }
+    if (sum != sum_gt) {
+        printf("### Exported values do not match the inserted ones\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+int TestRehash(TestDataHelperCPU &data_generator) {
+    float time;
+    /** Few buckets: the chains are several slabs long **/
+    UnorderedMap<KeyTD, ValueT, HashFunc> hash_table(
+            data_generator.keys_pool_size_, 150, 1.0);
+
+    auto insert_query_data_tuple = data_generator.GenerateData(
+            data_generator.keys_pool_size_ / 2, 0.5f);
+    auto &insert_data = std::get<0>(insert_query_data_tuple);
+    auto &query_data = std::get<1>(insert_query_data_tuple);
+    auto &query_data_gt = std::get<2>(insert_query_data_tuple);
+
+    std::vector<iterator_t> iterators(insert_data.keys.size());
+    std::vector<uint8_t> is_new(insert_data.keys.size());
+    hash_table.Activate(insert_data.keys, iterators, is_new);
+    hash_table.InsertOrAssign(insert_data.keys, insert_data.values);
+    printf("   Load factor = %f\n", hash_table.ComputeLoadFactor());
+
+    time = hash_table.Rehash(data_generator.keys_pool_size_ / 10);
+    printf("1) Hash table rehashed in %.3f ms (%.3f M elements/s)\n", time,
+           double(insert_data.keys.size()) / (time * 1000.0));
+    printf("   Load factor = %f\n", hash_table.ComputeLoadFactor());
+
+    hash_table.Search(query_data.keys, query_data.values, query_data.masks);
+    bool query_correct = data_generator.CheckQueryResult(
+            query_data.values, query_data.masks, query_data_gt.values,
+            query_data_gt.masks);
+    if (!query_correct) return -1;
+
+    /** The pairs did not move in the pool **/
+    std::vector<iterator_t> rehashed_iterators(insert_data.keys.size());
+    hash_table.Activate(insert_data.keys, rehashed_iterators, is_new);
+    for (uint32_t i = 0; i < insert_data.keys.size(); ++i) {
+        if (is_new[i] || rehashed_iterators[i] != iterators[i]) {
+            printf("### Key %d moved in the pair pool\n", i);
+            return -1;
+        }
+    }
+
+    /** Rehash triggered by the inserts themselves **/
+    UnorderedMap<KeyTD, ValueT, HashFunc> auto_hash_table(
+            data_generator.keys_pool_size_, 150, 1.0, 0, true);
+    auto_hash_table.SetMaxChainLength(1.5f);
+    const size_t half = insert_data.keys.size() / 2;
+    std::vector<KeyTD> keys_a(insert_data.keys.begin(),
+                              insert_data.keys.begin() + half);
+    std::vector<ValueT> values_a(insert_data.values.begin(),
+                                 insert_data.values.begin() + half);
+    std::vector<KeyTD> keys_b(insert_data.keys.begin() + half,
+                              insert_data.keys.end());
+    std::vector<ValueT> values_b(insert_data.values.begin() + half,
+                                 insert_data.values.end());
+    auto_hash_table.Insert(keys_a, values_a);
+    auto_hash_table.Insert(keys_b, values_b);
+    printf("   Load factor = %f\n", auto_hash_table.ComputeLoadFactor());
+
+    auto_hash_table.Search(query_data.keys, query_data.values,
+                           query_data.masks);
+    query_correct = data_generator.CheckQueryResult(
+            query_data.values, query_data.masks, query_data_gt.values,
+            query_data_gt.masks);
+    if (!query_correct) return -1;
+
+    /** Linear hashing: a few buckets are split per batch, and the head
+     * array outgrows its initial capacity **/
+    UnorderedMap<KeyTD, ValueT, HashFunc> linear_hash_table(
+            data_generator.keys_pool_size_, 150, 1.0, 0, true);
+    linear_hash_table.SetMaxChainLength(1.5f);
+    linear_hash_table.EnableLinearHashing(
+            data_generator.keys_pool_size_ / 100, 256);
+    const size_t num_batches = 8;
+    const size_t batch_size =
+            (insert_data.keys.size() + num_batches - 1) / num_batches;
+    for (size_t i = 0; i < insert_data.keys.size(); i += batch_size) {
+        size_t end = std::min(i + batch_size, insert_data.keys.size());
+        std::vector<KeyTD> batch_keys(insert_data.keys.begin() + i,
+                                      insert_data.keys.begin() + end);
+        std::vector<ValueT> batch_values(insert_data.values.begin() + i,
+                                         insert_data.values.begin() + end);
+        time = linear_hash_table.Insert(batch_keys, batch_values);
+    }
+    printf("2) Hash table built with linear hashing, last batch in %.3f ms\n",
+           time);
+    printf("   Load factor = %f\n", linear_hash_table.ComputeLoadFactor());
+
+    linear_hash_table.Search(query_data.keys, query_data.values,
+                             query_data.masks);
+    query_correct = data_generator.CheckQueryResult(
+            query_data.values, query_data.masks, query_data_gt.values,
+            query_data_gt.masks);
+    if (!query_correct) return -1;
+    if (linear_hash_table.Size() != insert_data.keys.size()) return -1;
+
+    return 0;
+}
+
+int TestReserve(TestDataHelperCPU &data_generator) {
+    float time;
+    const uint32_t pool_size = data_generator.keys_pool_size_ / 4;
+    UnorderedMap<KeyTD, ValueT, HashFunc> hash_table(pool_size);
+
+    auto insert_data = std::get<0>(
+            data_generator.GenerateData(2 * pool_size, 1.0f));
+    std::vector<KeyTD> first_keys(insert_data.keys.begin(),
+                                  insert_data.keys.begin() + pool_size);
+    std::vector<ValueT> first_values(insert_data.values.begin(),
+                                     insert_data.values.begin() + pool_size);
+    std::vector<KeyTD> second_keys(insert_data.keys.begin() + pool_size,
+                                   insert_data.keys.end());
+    std::vector<ValueT> second_values(insert_data.values.begin() + pool_size,
+                                      insert_data.values.end());
+
+    /** The first half fills the pool, the second half is dropped **/
+    std::vector<uint8_t> statuses;
+    hash_table.Insert(first_keys, first_values, statuses);
+    for (uint32_t i = 0; i < pool_size; ++i) {
+        if (statuses[i] != STATUS_SUCCESS) {
+            printf("### Key %d should have been inserted\n", i);
+            return -1;
+        }
+    }
+    hash_table.Insert(second_keys, second_values, statuses);
+    for (uint32_t i = 0; i < pool_size; ++i) {
+        if (statuses[i] != STATUS_OUT_OF_CAPACITY) {
+            printf("### Key %d should be out of capacity\n", i);
+            return -1;
+        }
+    }
+    std::vector<iterator_t> iterators(pool_size);
+    std::vector<uint8_t> is_new(pool_size);
+    hash_table.Activate(second_keys, iterators, is_new);
+    for (uint32_t i = 0; i < pool_size; ++i) {
+        if (iterators[i] != OUT_OF_CAPACITY_ITERATOR || is_new[i]) {
+            printf("### Key %d should not be activated\n", i);
+            return -1;
+        }
+    }
+    if (hash_table.Size() != pool_size) return -1;
+
+    /** Grow the pool: the second half fits, the first half is unchanged **/
+    if (!hash_table.Reserve(2 * pool_size)) return -1;
+    hash_table.Insert(second_keys, second_values, statuses);
+    for (uint32_t i = 0; i < pool_size; ++i) {
+        if (statuses[i] != STATUS_SUCCESS) {
+            printf("### Key %d should have been inserted\n", i);
+            return -1;
+        }
+    }
+
+    /** The batches are limited to the constructor's max_keys **/
+    std::vector<ValueT> query_values(pool_size);
+    std::vector<uint8_t> query_masks(pool_size);
+    std::vector<uint8_t> masks_gt(pool_size, 1);
+    time = hash_table.Search(first_keys, query_values, query_masks);
+    printf("1) Hash table searched in %.3f ms (%.3f M queries/s)\n", time,
+           double(first_keys.size()) / (time * 1000.0));
+    bool query_correct = data_generator.CheckQueryResult(
+            query_values, query_masks, first_values, masks_gt);
+    hash_table.Search(second_keys, query_values, query_masks);
+    query_correct = query_correct &&
+                    data_generator.CheckQueryResult(query_values, query_masks,
+                                                    second_values, masks_gt);
+    if (!query_correct) return -1;
+
+    /** Pair pointers share the slab words with the fingerprints **/
+    UnorderedMap<KeyTD, ValueT, HashFunc> fingerprint_hash_table(
+            pool_size, 15, 0.6, 0, true);
+    if (fingerprint_hash_table.Reserve(1u << 24)) return -1;
+
+    return 0;
+}
+
+int TestCompact(TestDataHelperCPU &data_generator) {
+    float time;
+    const uint32_t num_keys = data_generator.keys_pool_size_ / 2;
+    UnorderedMap<KeyTD, ValueT, HashFunc> hash_table(
+            data_generator.keys_pool_size_, 150, 1.0, 0, true);
+    /* the chains grow next to their tail slabs */
+    hash_table.SetNearTailAllocation(true);
+
+    auto insert_data =
+            std::get<0>(data_generator.GenerateData(num_keys, 1.0f));
+    hash_table.Insert(insert_data.keys, insert_data.values);
+
+    /** Remove 3/4 of the keys: their slabs stay linked until compaction **/
+    const uint32_t num_removed = num_keys / 4 * 3;
+    std::vector<KeyTD> removed_keys(insert_data.keys.begin(),
+                                    insert_data.keys.begin() + num_removed);
+    std::vector<ValueT> removed_values(
+            insert_data.values.begin(),
+            insert_data.values.begin() + num_removed);
+    std::vector<KeyTD> kept_keys(insert_data.keys.begin() + num_removed,
+                                 insert_data.keys.end());
+    std::vector<ValueT> kept_values(insert_data.values.begin() + num_removed,
+                                    insert_data.values.end());
+    hash_table.Remove(removed_keys);
+    float load_factor = hash_table.ComputeLoadFactor();
+
+    time = hash_table.Compact();
+    printf("1) Hash table compacted in %.3f ms\n", time);
+    printf("   Load factor = %f -> %f\n", load_factor,
+           hash_table.ComputeLoadFactor());
+    if (hash_table.ComputeLoadFactor() <= load_factor) return -1;
+    if (hash_table.Size() != kept_keys.size()) return -1;
+
+    /** Lay the compacted chains out contiguously: nothing else changes **/
+    load_factor = hash_table.ComputeLoadFactor();
+    time = hash_table.Relayout();
+    printf("2) Hash table relaid out in %.3f ms\n", time);
+    if (hash_table.ComputeLoadFactor() != load_factor) return -1;
+    if (hash_table.Size() != kept_keys.size()) return -1;
+
+    std::vector<ValueT> query_values(num_removed);
+    std::vector<uint8_t> query_masks(num_removed);
+    hash_table.Search(kept_keys, query_values, query_masks);
+    bool query_correct = data_generator.CheckQueryResult(
+            std::vector<ValueT>(query_values.begin(),
+                                query_values.begin() + kept_keys.size()),
+            query_masks, kept_values,
+            std::vector<uint8_t>(kept_keys.size(), 1));
+    hash_table.Search(removed_keys, query_values, query_masks);
+    query_correct = query_correct &&
+                    data_generator.CheckQueryResult(
+                            query_values, query_masks, removed_values,
+                            std::vector<uint8_t>(num_removed, 0));
+    if (!query_correct) return -1;
+
+    /** The freed slabs are reused by the next insertions **/
+    hash_table.Insert(removed_keys, removed_values);
+    hash_table.Search(removed_keys, query_values, query_masks);
+    query_correct = data_generator.CheckQueryResult(
+            query_values, query_masks, removed_values,
+            std::vector<uint8_t>(num_removed, 1));
+    if (!query_correct) return -1;
+    if (hash_table.Size() != num_keys) return -1;
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const int key_value_pool_size = argc > 1 ? atoi(argv[1]) : 1 << 20;
     const float existing_ratio = 0.6f;
     UnorderedMap<KeyTD, ValueT, HashFunc> hash_table(
             key_value_pool_size);
@@ -320,10 +914,58 @@ int main() {
     assert(!TestRemove(data_generator) && "TestRemove failed.\n");
     printf("TestRemove passed.\n");
 
+    printf(">>> Test sequence: insert (all valid) -> query -> delete -> "
+           "query, with fingerprints\n");
+    assert(!TestRemove(data_generator, true) && "TestRemove failed.\n");
+    printf("TestRemove with fingerprints passed.\n");
+
     printf(">>> Test sequence: insert (all valid) -> query -> insert (all "
            "valid, duplicate) -> query\n");
     assert(!TestConflict(data_generator) && "TestConflict failed.\n");
     printf("TestConflict passed.\n");
 
+    printf(">>> Test sequence: insert (0.5 valid) -> update existing -> "
+           "query -> insert or assign -> query\n");
+    assert(!TestAssign(data_generator) && "TestAssign failed.\n");
+    printf("TestAssign passed.\n");
+
+    printf(">>> Test sequence: insert or reduce (4 copies per key) -> query\n");
+    assert(!TestReduce(data_generator) && "TestReduce failed.\n");
+    printf("TestReduce passed.\n");
+
+    printf(">>> Test sequence: activate (2 copies per key) -> activate "
+           "(0.5 valid)\n");
+    assert(!TestActivate(data_generator) && "TestActivate failed.\n");
+    printf("TestActivate passed.\n");
+
+    printf(">>> Test sequence: insert -> export -> query\n");
+    assert(!TestExport(data_generator) && "TestExport failed.\n");
+    printf("TestExport passed.\n");
+
+    printf(">>> Test sequence: activate -> rehash -> query -> activate, "
+           "insert with a chain length trigger -> query, insert with "
+           "linear hashing -> query\n");
+    assert(!TestRehash(data_generator) && "TestRehash failed.\n");
+    printf("TestRehash passed.\n");
+
+    printf(">>> Test sequence: insert past the pool capacity -> reserve -> "
+           "insert -> query\n");
+    assert(!TestReserve(data_generator) && "TestReserve failed.\n");
+    printf("TestReserve passed.\n");
+
+    printf(">>> Test sequence: insert -> delete (3/4) -> compact -> query "
+           "-> insert -> query\n");
+    assert(!TestCompact(data_generator) && "TestCompact failed.\n");
+    printf("TestCompact passed.\n");
+
+    printf(">>> Test sequence: bulk build with duplicates -> query\n");
+    assert(!TestBulkBuild(data_generator) && "TestBulkBuild failed.\n");
+    printf("TestBulkBuild passed.\n");
+
+    printf(">>> Test sequence: concurrent sessions insert -> concurrent "
+           "sessions query and insert\n");
+    assert(!TestSessions(data_generator) && "TestSessions failed.\n");
+    printf("TestSessions passed.\n");
+
     return 0;
 }
@@ -0,0 +1,409 @@
+/*
+ * Copyright 2019 Saman Ashkiani
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "unordered_map.h"
+
+/* 32-bit keys and values: pairs are stored inline in the slabs */
+using KeyT = uint32_t;
+using ValueT = uint32_t;
+
+static_assert(IsInlinePair<KeyT, ValueT>::value,
+              "uint32_t pairs should be stored inline");
+
+/* Unique random keys, EMPTY_KEY excluded */
+std::vector<KeyT> GenerateKeys(uint32_t num_keys, int64_t seed) {
+    std::mt19937 rng(seed);
+    std::unordered_set<KeyT> key_set;
+    std::vector<KeyT> keys;
+    while (keys.size() < num_keys) {
+        KeyT key = rng();
+        if (key != EMPTY_KEY && key_set.insert(key).second) {
+            keys.push_back(key);
+        }
+    }
+    return keys;
+}
+
+struct IncrementValue {
+    __device__ __host__ void operator()(const KeyT &/*key*/, ValueT &value) {
+        value += 1;
+    }
+};
+
+int main(int argc, char **argv) {
+    const uint32_t num_keys = argc > 1 ? atoi(argv[1]) : 1 << 20;
+    float time;
+
+    std::vector<KeyT> keys = GenerateKeys(num_keys, 1);
+    std::vector<ValueT> values(num_keys);
+    std::iota(values.begin(), values.end(), 0);
+
+    UnorderedMap<KeyT, ValueT> hash_table(num_keys);
+
+    /* Insert the first half: queries are 50% hits, 50% misses */
+    const uint32_t num_inserted = num_keys / 2;
+    std::vector<KeyT> insert_keys(keys.begin(), keys.begin() + num_inserted);
+    std::vector<ValueT> insert_values(values.begin(),
+                                      values.begin() + num_inserted);
+    time = hash_table.Insert(insert_keys, insert_values);
+    printf("1) Hash table built in %.3f ms (%.3f M elements/s)\n", time,
+           double(num_inserted) / (time * 1000.0));
+    printf("   Load factor = %f\n", hash_table.ComputeLoadFactor());
+
+    std::vector<ValueT> query_values(num_keys);
+    std::vector<uint8_t> query_masks(num_keys);
+    time = hash_table.Search(keys, query_values, query_masks);
+    printf("2) Hash table searched in %.3f ms (%.3f M queries/s)\n", time,
+           double(num_keys) / (time * 1000.0));
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(query_masks[i] == (i < num_inserted));
+        assert(i >= num_inserted || query_values[i] == values[i]);
+    }
+
+    /* Duplicates with different values: nothing changes */
+    std::vector<ValueT> duplicate_values = insert_values;
+    for (auto &v : duplicate_values) {
+        v += 1;
+    }
+    std::vector<uint8_t> statuses;
+    hash_table.Insert(insert_keys, duplicate_values, statuses);
+    hash_table.Search(keys, query_values, query_masks);
+    for (uint32_t i = 0; i < num_inserted; ++i) {
+        assert(statuses[i] == STATUS_SUCCESS);
+        assert(query_masks[i] && query_values[i] == values[i]);
+    }
+
+    /* Update existing keys only: the misses are not inserted */
+    std::vector<ValueT> all_values(num_keys);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        all_values[i] = values[i] + 2;
+    }
+    hash_table.UpdateExisting(keys, all_values);
+    hash_table.Search(keys, query_values, query_masks);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(query_masks[i] == (i < num_inserted));
+        assert(i >= num_inserted || query_values[i] == all_values[i]);
+    }
+
+    /* Insert or assign: the misses are inserted, the hits overwritten */
+    for (auto &v : all_values) {
+        v += 1;
+    }
+    hash_table.InsertOrAssign(keys, all_values);
+    hash_table.Search(keys, query_values, query_masks);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(query_masks[i] && query_values[i] == all_values[i]);
+    }
+
+    /* The reserved key is reported, and not stored */
+    hash_table.Insert(std::vector<KeyT>{EMPTY_KEY}, std::vector<ValueT>{0},
+                      statuses);
+    assert(statuses.size() == 1 && statuses[0] == STATUS_RESERVED_KEY);
+    hash_table.Search(std::vector<KeyT>{EMPTY_KEY}, query_values, query_masks);
+    assert(!query_masks[0]);
+
+    /* Remove everything */
+    time = hash_table.Remove(keys);
+    printf("3) Hash table deleted in %.3f ms (%.3f M queries/s)\n", time,
+           double(num_keys) / (time * 1000.0));
+    printf("   Load factor = %f\n", hash_table.ComputeLoadFactor());
+    hash_table.Search(keys, query_values, query_masks);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(!query_masks[i]);
+    }
+
+    /* The emptied slots are reused */
+    hash_table.Insert(insert_keys, duplicate_values);
+    hash_table.Search(insert_keys, query_values, query_masks);
+    for (uint32_t i = 0; i < num_inserted; ++i) {
+        assert(query_masks[i] && query_values[i] == duplicate_values[i]);
+    }
+
+    /* Reduce by key: a histogram over a batch with duplicate keys */
+    const uint32_t num_bins = std::max(num_keys / 16, 1u);
+    std::vector<KeyT> bin_keys(num_keys);
+    std::unordered_map<KeyT, ValueT> bin_counts_gt, bin_min_gt, bin_max_gt;
+    std::mt19937 rng(2);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        bin_keys[i] = keys[rng() % num_bins];
+        bin_counts_gt[bin_keys[i]]++;
+        bin_min_gt.insert({bin_keys[i], i});
+        bin_max_gt[bin_keys[i]] = i;
+    }
+    std::vector<ValueT> ones(num_keys, 1);
+
+    UnorderedMap<KeyT, ValueT> histogram(num_keys);
+    time = histogram.InsertOrReduce(bin_keys, ones, ReduceAdd<ValueT>());
+    printf("4) Histogram reduced in %.3f ms (%.3f M elements/s)\n", time,
+           double(num_keys) / (time * 1000.0));
+    histogram.InsertOrReduce(bin_keys, ones, ReduceAdd<ValueT>());
+    histogram.Search(bin_keys, query_values, query_masks);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(query_masks[i] &&
+               query_values[i] == 2 * bin_counts_gt[bin_keys[i]]);
+    }
+
+    UnorderedMap<KeyT, ValueT> last_index(num_keys);
+    last_index.InsertOrReduce(bin_keys, values, ReduceMax<ValueT>());
+    last_index.Search(bin_keys, query_values, query_masks);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(query_masks[i] && query_values[i] == bin_max_gt[bin_keys[i]]);
+    }
+
+    UnorderedMap<KeyT, ValueT> first_index(num_keys);
+    first_index.InsertOrReduce(bin_keys, values, ReduceMin<ValueT>());
+    first_index.Search(bin_keys, query_values, query_masks);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(query_masks[i] && query_values[i] == bin_min_gt[bin_keys[i]]);
+    }
+
+    /* Export and visit the histogram */
+    std::vector<KeyT> export_keys;
+    std::vector<ValueT> export_values;
+    time = histogram.Export(export_keys, export_values);
+    printf("5) Histogram exported in %.3f ms (%.3f M elements/s)\n", time,
+           double(export_keys.size()) / (time * 1000.0));
+    assert(export_keys.size() == bin_counts_gt.size());
+    assert(histogram.Size() == bin_counts_gt.size());
+    for (uint32_t i = 0; i < export_keys.size(); ++i) {
+        assert(export_values[i] == 2 * bin_counts_gt[export_keys[i]]);
+    }
+
+    histogram.ForEach(IncrementValue());
+    histogram.Search(export_keys, query_values, query_masks);
+    for (uint32_t i = 0; i < export_keys.size(); ++i) {
+        assert(query_masks[i] && query_values[i] == export_values[i] + 1);
+    }
+
+    /* Rehash a table of long chains, explicitly then on insertion */
+    UnorderedMap<KeyT, ValueT> rehashed(num_keys, 150, 1.0);
+    rehashed.Insert(insert_keys, insert_values);
+    time = rehashed.Rehash(std::max(num_keys / 10, 1u));
+    printf("6) Hash table rehashed in %.3f ms (%.3f M elements/s)\n", time,
+           double(num_inserted) / (time * 1000.0));
+    rehashed.SetMaxChainLength(1.5f);
+    rehashed.Insert(keys, values);
+    rehashed.Search(keys, query_values, query_masks);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(query_masks[i] && query_values[i] == values[i]);
+    }
+    assert(rehashed.Size() == num_keys);
+
+    /* Linear hashing: the table grows a few buckets per batch */
+    UnorderedMap<KeyT, ValueT> linear(num_keys, 150, 1.0);
+    linear.SetMaxChainLength(1.5f);
+    linear.EnableLinearHashing(std::max(num_keys / 50, 1u), 64);
+    const uint32_t batch_size = std::max(num_keys / 8, 1u);
+    for (uint32_t i = 0; i < num_keys; i += batch_size) {
+        uint32_t end = std::min(i + batch_size, num_keys);
+        linear.Insert(std::vector<KeyT>(keys.begin() + i, keys.begin() + end),
+                      std::vector<ValueT>(values.begin() + i,
+                                          values.begin() + end));
+    }
+    linear.Search(keys, query_values, query_masks);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(query_masks[i] && query_values[i] == values[i]);
+    }
+    assert(linear.Size() == num_keys);
+
+    /* Compaction after removing 3/4 of the keys of long chains, relayout */
+    UnorderedMap<KeyT, ValueT> compacted(num_keys, 150, 1.0);
+    compacted.Insert(insert_keys, insert_values);
+    const uint32_t num_removed = num_inserted / 4 * 3;
+    compacted.Remove(std::vector<KeyT>(insert_keys.begin(),
+                                       insert_keys.begin() + num_removed));
+    float load_factor = compacted.ComputeLoadFactor();
+    time = compacted.Compact();
+    printf("7) Hash table compacted in %.3f ms, load factor %f -> %f\n", time,
+           load_factor, compacted.ComputeLoadFactor());
+    assert(compacted.ComputeLoadFactor() > load_factor);
+    compacted.Search(keys, query_values, query_masks);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        bool is_kept = i >= num_removed && i < num_inserted;
+        assert(query_masks[i] == is_kept);
+        assert(!is_kept || query_values[i] == values[i]);
+    }
+    time = compacted.Relayout();
+    printf("8) Hash table relaid out in %.3f ms\n", time);
+    compacted.Search(keys, query_values, query_masks);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        bool is_kept = i >= num_removed && i < num_inserted;
+        assert(query_masks[i] == is_kept);
+        assert(!is_kept || query_values[i] == values[i]);
+    }
+    compacted.Insert(keys, values);
+    compacted.Search(keys, query_values, query_masks);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(query_masks[i] && query_values[i] == values[i]);
+    }
+
+    /* Long chains allocated next to their tail slabs */
+    UnorderedMap<KeyT, ValueT> near_tail(num_keys, 150, 1.0);
+    near_tail.SetNearTailAllocation(true);
+    time = near_tail.Insert(insert_keys, insert_values);
+    printf("9) Hash table built near the tails in %.3f ms (%.3f M "
+           "elements/s)\n",
+           time, double(num_inserted) / (time * 1000.0));
+    near_tail.Search(keys, query_values, query_masks);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(query_masks[i] == (i < num_inserted));
+        assert(i >= num_inserted || query_values[i] == values[i]);
+    }
+
+    /* Bulk build: the inserted half twice, with the reserved key, then a
+     * search in bucket order */
+    UnorderedMap<KeyT, ValueT> bulk(num_keys + 1);
+    std::vector<KeyT> bulk_keys = insert_keys;
+    bulk_keys.insert(bulk_keys.end(), insert_keys.begin(), insert_keys.end());
+    bulk_keys.push_back(EMPTY_KEY);
+    std::vector<ValueT> bulk_values = insert_values;
+    bulk_values.insert(bulk_values.end(), insert_values.begin(),
+                       insert_values.end());
+    bulk_values.push_back(0);
+    time = bulk.BulkBuild(bulk_keys, bulk_values);
+    printf("10) Hash table bulk built in %.3f ms (%.3f M elements/s)\n",
+           time, double(bulk_keys.size()) / (time * 1000.0));
+    assert(bulk.Size() == num_inserted);
+    bulk.BulkBuild(keys, all_values);
+    bulk.SetBucketOrderedSearch(true);
+    time = bulk.Search(keys, query_values, query_masks);
+    printf("11) Hash table searched in bucket order in %.3f ms (%.3f M "
+           "queries/s)\n",
+           time, double(num_keys) / (time * 1000.0));
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(query_masks[i]);
+        assert(query_values[i] == (i < num_inserted ? values[i]
+                                                    : all_values[i]));
+    }
+    assert(bulk.Size() == num_keys);
+
+    /* In-batch deduplication of the histogram keys: Insert keeps the first
+     * copy, InsertOrAssign the last one, InsertOrReduce reduces them */
+    UnorderedMap<KeyT, ValueT> deduplicated(num_keys);
+    deduplicated.SetBatchDeduplication(true);
+    time = deduplicated.Insert(bin_keys, values);
+    printf("12) Hash table inserted with in-batch deduplication in %.3f ms "
+           "(%.3f M elements/s)\n",
+           time, double(num_keys) / (time * 1000.0));
+    assert(deduplicated.Size() == bin_counts_gt.size());
+    deduplicated.Search(bin_keys, query_values, query_masks);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(query_masks[i] && query_values[i] == bin_min_gt[bin_keys[i]]);
+    }
+    deduplicated.InsertOrAssign(bin_keys, values);
+    deduplicated.Search(bin_keys, query_values, query_masks);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(query_masks[i] && query_values[i] == bin_max_gt[bin_keys[i]]);
+    }
+    deduplicated.InsertOrReduce(bin_keys, ones, ReduceAdd<ValueT>());
+    deduplicated.Search(bin_keys, query_values, query_masks);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(query_masks[i] &&
+               query_values[i] ==
+                       bin_max_gt[bin_keys[i]] + bin_counts_gt[bin_keys[i]]);
+    }
+    assert(deduplicated.Size() == bin_counts_gt.size());
+
+    /* The slab allocator is sized for a quarter of the keys, then grown */
+    const uint32_t quarter = num_keys / 4 + 1;
+    UnorderedMap<KeyT, ValueT> reserved(quarter);
+    assert(reserved.Reserve(num_keys));
+    for (uint32_t i = 0; i < num_keys; i += quarter) {
+        uint32_t end = std::min(i + quarter, num_keys);
+        std::vector<KeyT> batch_keys(keys.begin() + i, keys.begin() + end);
+        reserved.Insert(batch_keys, std::vector<ValueT>(values.begin() + i,
+                                                        values.begin() + end));
+        reserved.Search(batch_keys, query_values, query_masks);
+        for (uint32_t j = i; j < end; ++j) {
+            assert(query_masks[j - i] && query_values[j - i] == values[j]);
+        }
+    }
+    assert(reserved.Size() == num_keys);
+
+    /* Past max_keys, without Reserve: the slab allocator grows with the
+     * chains instead of running out of free units */
+    const uint32_t few = std::max(num_keys / 16, 1u);
+    UnorderedMap<KeyT, ValueT> overfull(few);
+    for (uint32_t i = 0; i < num_keys; i += few) {
+        uint32_t end = std::min(i + few, num_keys);
+        overfull.Insert(
+                std::vector<KeyT>(keys.begin() + i, keys.begin() + end),
+                std::vector<ValueT>(values.begin() + i, values.begin() + end));
+    }
+    assert(overfull.Size() == num_keys);
+    overfull.Search(keys, query_values, query_masks);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(query_masks[i] && query_values[i] == values[i]);
+    }
+
+    /* Batches larger than the staging buffers are streamed in chunks */
+    UnorderedMap<KeyT, ValueT> streamed(quarter);
+    assert(streamed.Reserve(num_keys));
+    time = streamed.Insert(keys, values, statuses);
+    printf("13) Hash table inserted in chunks in %.3f ms (%.3f M "
+           "elements/s)\n",
+           time, double(num_keys) / (time * 1000.0));
+    assert(statuses.size() == num_keys);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(statuses[i] == STATUS_SUCCESS);
+    }
+    assert(streamed.Size() == num_keys);
+    streamed.Remove(insert_keys);
+    streamed.Search(keys, query_values, query_masks);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(query_masks[i] == (i >= num_inserted));
+        assert(i < num_inserted || query_values[i] == values[i]);
+    }
+
+    /* Asynchronous batches run in submission order */
+    UnorderedMap<KeyT, ValueT> pipelined(num_keys);
+    auto inserted = pipelined.InsertAsync(insert_keys, insert_values);
+    auto searched = pipelined.SearchAsync(keys);
+    auto removed = pipelined.RemoveAsync(insert_keys);
+    auto searched_again = pipelined.SearchAsync(keys);
+    /* ... and the map stays usable meanwhile */
+    pipelined.Search(keys, query_values, query_masks);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(!query_masks[i] ||
+               (i < num_inserted && query_values[i] == values[i]));
+    }
+    time = inserted.get();
+    printf("14) Hash table built asynchronously in %.3f ms (%.3f M "
+           "elements/s)\n",
+           time, double(num_inserted) / (time * 1000.0));
+    auto search_result = searched.get();
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(search_result.founds[i] == (i < num_inserted));
+        assert(i >= num_inserted || search_result.values[i] == values[i]);
+    }
+    removed.get();
+    search_result = searched_again.get();
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(!search_result.founds[i]);
+    }
+
+    printf("TestInteger passed.\n");
+    return 0;
+}
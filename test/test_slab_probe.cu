@@ -0,0 +1,56 @@
+/*
+ * Copyright 2019 Saman Ashkiani
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cassert>
+#include <cstdio>
+#include <random>
+
+#include "slab_hash/slab_probe.h"
+
+/* Every vectorized probe supported by this CPU must agree with the scalar
+ * one, on slabs with an increasing ratio of empty lanes */
+int main() {
+    const char* isa_names[] = {"scalar", "avx2", "avx512"};
+    SlabProbeISA best_isa = SlabProbeDetectISA();
+    printf("Detected slab probe: %s\n", isa_names[int(best_isa)]);
+
+    std::mt19937 rng(0);
+    ptr_t slab[WARP_WIDTH];
+    for (int isa = 0; isa <= int(best_isa); ++isa) {
+        SlabProbeFunc probe = SlabProbeSelect(SlabProbeISA(isa));
+        for (uint32_t round = 0; round < 1024; ++round) {
+            uint32_t empty_percent = round % 101;
+            for (uint32_t lane_id = 0; lane_id < WARP_WIDTH; ++lane_id) {
+                slab[lane_id] = (rng() % 100 < empty_percent)
+                                        ? EMPTY_PAIR_PTR
+                                        : rng() % 4096 | (rng() << 24);
+            }
+            ptr_t value = (round & 1) ? EMPTY_PAIR_PTR : slab[round % 32];
+            assert(probe(slab, value, 0xFFFFFFFF) ==
+                   SlabProbeScalar(slab, value, 0xFFFFFFFF));
+
+            /* Fingerprint-like probe on the high bits */
+            ptr_t word_mask = 0xFF000000;
+            assert(probe(slab, value & word_mask, word_mask) ==
+                   SlabProbeScalar(slab, value & word_mask, word_mask));
+        }
+        printf("%s probe passed.\n", isa_names[isa]);
+    }
+
+    assert(SlabProbe(slab, EMPTY_PAIR_PTR) ==
+           SlabProbeScalar(slab, EMPTY_PAIR_PTR, 0xFFFFFFFF));
+    return 0;
+}
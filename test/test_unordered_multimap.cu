@@ -0,0 +1,162 @@
+/*
+ * Copyright 2019 Saman Ashkiani
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "unordered_multimap.h"
+
+/* Point ids binned by voxel ids */
+using KeyT = uint32_t;
+using ValueT = uint32_t;
+
+void TestMultiMap(uint32_t num_points, bool use_fingerprints) {
+    float time;
+
+    /* Voxel v holds the points i with i % num_voxels == v: bins of
+     * num_points / num_voxels points, larger than a slab */
+    const uint32_t num_voxels = std::max(num_points / 40, 1u);
+    std::vector<KeyT> keys(num_points);
+    std::vector<ValueT> values(num_points);
+    for (uint32_t i = 0; i < num_points; ++i) {
+        keys[i] = i % num_voxels;
+        values[i] = i;
+    }
+    std::mt19937 rng(1);
+    std::vector<uint32_t> order(num_points);
+    for (uint32_t i = 0; i < num_points; ++i) order[i] = i;
+    std::shuffle(order.begin(), order.end(), rng);
+    std::vector<KeyT> shuffled_keys(num_points);
+    std::vector<ValueT> shuffled_values(num_points);
+    for (uint32_t i = 0; i < num_points; ++i) {
+        shuffled_keys[i] = keys[order[i]];
+        shuffled_values[i] = values[order[i]];
+    }
+
+    UnorderedMultiMap<KeyT, ValueT> multimap(num_points, 15, 0.6, 0,
+                                             use_fingerprints);
+    time = multimap.Insert(shuffled_keys, shuffled_values);
+    printf("1) Multimap built in %.3f ms (%.3f M elements/s)\n", time,
+           double(num_points) / (time * 1000.0));
+
+    /* Every voxel, plus as many missing ones */
+    std::vector<KeyT> query_keys(2 * num_voxels);
+    for (uint32_t i = 0; i < 2 * num_voxels; ++i) query_keys[i] = i;
+
+    std::vector<uint32_t> counts(query_keys.size());
+    multimap.Count(query_keys, counts);
+
+    std::vector<uint32_t> offsets;
+    std::vector<ValueT> results;
+    time = multimap.SearchAll(query_keys, offsets, results);
+    printf("2) Multimap searched in %.3f ms (%.3f M queries/s)\n", time,
+           double(query_keys.size()) / (time * 1000.0));
+
+    assert(offsets.size() == query_keys.size() + 1);
+    assert(results.size() == num_points);
+    for (uint32_t v = 0; v < query_keys.size(); ++v) {
+        uint32_t expected = 0;
+        if (v < num_voxels) {
+            expected = num_points / num_voxels +
+                       (v < num_points % num_voxels ? 1 : 0);
+        }
+        assert(counts[v] == expected);
+        assert(offsets[v + 1] - offsets[v] == expected);
+
+        std::vector<ValueT> bin(results.begin() + offsets[v],
+                                results.begin() + offsets[v + 1]);
+        std::sort(bin.begin(), bin.end());
+        for (uint32_t j = 0; j < bin.size(); ++j) {
+            assert(bin[j] == v + j * num_voxels);
+        }
+    }
+
+    /* Remove one point per voxel */
+    std::vector<KeyT> remove_keys(query_keys.begin(),
+                                  query_keys.begin() + num_voxels);
+    multimap.Remove(remove_keys);
+    multimap.Count(query_keys, counts);
+    for (uint32_t v = 0; v < num_voxels; ++v) {
+        uint32_t expected = num_points / num_voxels +
+                            (v < num_points % num_voxels ? 1 : 0) - 1;
+        assert(counts[v] == expected);
+    }
+
+    /* Remove a hot key k times in one batch: the copies run on different
+     * workers and contend for the same pairs, yet each removes one. The
+     * copies fit in the pairs freed above */
+    const KeyT hot_key = 2 * num_voxels;
+    const uint32_t num_copies = std::min(num_voxels, 4096u);
+    const uint32_t num_removed = num_copies / 2;
+    std::vector<KeyT> hot_keys(num_copies, hot_key);
+    std::vector<ValueT> hot_values(num_copies);
+    for (uint32_t i = 0; i < num_copies; ++i) hot_values[i] = i;
+    multimap.Insert(hot_keys, hot_values);
+    hot_keys.resize(num_removed);
+    multimap.Remove(hot_keys);
+    std::vector<KeyT> hot_query(1, hot_key);
+    std::vector<uint32_t> hot_count(1);
+    multimap.Count(hot_query, hot_count);
+    assert(hot_count[0] == num_copies - num_removed);
+
+    /* Query and remove batches larger than max_keys go in chunks */
+    const uint32_t small_keys = 256, small_voxels = 16;
+    UnorderedMultiMap<KeyT, ValueT> small(small_keys, 15, 0.6, 0,
+                                          use_fingerprints);
+    std::vector<KeyT> small_insert(small_keys);
+    std::vector<ValueT> small_values(small_keys);
+    for (uint32_t i = 0; i < small_keys; ++i) {
+        small_insert[i] = i % small_voxels;
+        small_values[i] = i;
+    }
+    small.Insert(small_insert, small_values);
+    std::vector<KeyT> small_query(4 * small_keys);
+    for (uint32_t i = 0; i < small_query.size(); ++i) {
+        small_query[i] = i % (2 * small_voxels);
+    }
+    std::vector<uint32_t> small_counts(small_query.size());
+    small.Count(small_query, small_counts);
+    small.SearchAll(small_query, offsets, results);
+    assert(results.size() == 2 * small_keys * (small_keys / small_voxels));
+    for (uint32_t i = 0; i < small_query.size(); ++i) {
+        const uint32_t v = small_query[i];
+        const uint32_t expected = v < small_voxels ? small_keys / small_voxels
+                                                   : 0;
+        assert(small_counts[i] == expected);
+        assert(offsets[i + 1] - offsets[i] == expected);
+        for (uint32_t j = offsets[i]; j < offsets[i + 1]; ++j) {
+            assert(results[j] % small_voxels == v);
+        }
+    }
+    small.Remove(small_query);
+    small.Count(small_query, small_counts);
+    for (uint32_t i = 0; i < small_query.size(); ++i) {
+        assert(small_counts[i] == 0);
+    }
+}
+
+int main(int argc, char **argv) {
+    const uint32_t num_points = argc > 1 ? atoi(argv[1]) : 1 << 20;
+
+    TestMultiMap(num_points, false);
+    TestMultiMap(num_points, true);
+
+    printf("TestUnorderedMultiMap passed.\n");
+    return 0;
+}
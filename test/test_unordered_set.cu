@@ -0,0 +1,104 @@
+/*
+ * Copyright 2019 Saman Ashkiani
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <random>
+#include <unordered_set>
+#include <vector>
+#include "unordered_set.h"
+
+using KeyT = uint64_t;
+
+/* Unique random keys */
+std::vector<KeyT> GenerateKeys(uint32_t num_keys, int64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::unordered_set<KeyT> key_set;
+    std::vector<KeyT> keys;
+    while (keys.size() < num_keys) {
+        KeyT key = rng();
+        if (key_set.insert(key).second) {
+            keys.push_back(key);
+        }
+    }
+    return keys;
+}
+
+void TestSet(uint32_t num_keys, bool use_fingerprints) {
+    float time;
+
+    std::vector<KeyT> keys = GenerateKeys(num_keys, 1);
+    UnorderedSet<KeyT> set(num_keys, 15, 0.6, 0, use_fingerprints);
+
+    /* Insert the first half: queries are 50% hits, 50% misses */
+    const uint32_t num_inserted = num_keys / 2;
+    std::vector<KeyT> insert_keys(keys.begin(), keys.begin() + num_inserted);
+    time = set.Insert(insert_keys);
+    printf("1) Hash set built in %.3f ms (%.3f M elements/s)\n", time,
+           double(num_inserted) / (time * 1000.0));
+    printf("   Load factor = %f\n", set.ComputeLoadFactor());
+
+    std::vector<uint8_t> found(num_keys);
+    time = set.Contains(keys, found);
+    printf("2) Hash set searched in %.3f ms (%.3f M queries/s)\n", time,
+           double(num_keys) / (time * 1000.0));
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(found[i] == (i < num_inserted));
+    }
+
+    /* Duplicates are not stored twice: removing once removes them */
+    set.Insert(insert_keys);
+    time = set.Remove(insert_keys);
+    printf("3) Hash set deleted in %.3f ms (%.3f M queries/s)\n", time,
+           double(num_inserted) / (time * 1000.0));
+    set.Contains(keys, found);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(!found[i]);
+    }
+
+    /* The emptied slots and key pool entries are reused */
+    set.Insert(keys);
+    set.Contains(keys, found);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(found[i]);
+    }
+
+    /* Batches larger than max_keys go through the buffers in chunks */
+    const uint32_t num_small = std::min(num_keys, 64u);
+    UnorderedSet<KeyT> small(num_small, 15, 0.6, 0, use_fingerprints);
+    small.Insert(std::vector<KeyT>(keys.begin(), keys.begin() + num_small));
+    small.Contains(keys, found);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(found[i] == (i < num_small));
+    }
+    small.Remove(keys);
+    small.Contains(keys, found);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        assert(!found[i]);
+    }
+}
+
+int main(int argc, char **argv) {
+    const uint32_t num_keys = argc > 1 ? atoi(argv[1]) : 1 << 20;
+
+    TestSet(num_keys, false);
+    TestSet(num_keys, true);
+
+    printf("TestUnorderedSet passed.\n");
+    return 0;
+}